@@ -0,0 +1,70 @@
+/**
+ * @file       app_queue.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Queue of the frames that the application of a node sends.
+ *
+ *             The application enqueues its payloads and the MAC layer pulls
+ *             them in order: it takes the oldest one with app_queue_peek
+ *             when it may transmit, and once it knows the fate of the frame
+ *             it removes it with app_queue_commit or leaves it at the head
+ *             with app_queue_requeue to send it again. A payload that fails
+ *             APP_QUEUE_RETRIES times is dropped. The payloads are kept in
+ *             packet buffers of the size they need, and the queue holds at
+ *             most APP_QUEUE_SIZE of them, so a payload that finds the queue
+ *             full, or no buffer left, is dropped as well. The callback set
+ *             with app_queue_set_cb runs every time a payload leaves the
+ *             queue, so that the application can enqueue the next one.
+ *             APP_QUEUE_SIZE and APP_QUEUE_RETRIES in the config.h of the
+ *             project set the size and the attempts. The functions are
+ *             called from tasks, not from interrupts.
+ *
+ *             A SERIAL_PC2MOTE_QUEUE command reports the queue in a
+ *             SERIAL_MOTE2PC_QUEUE message, in little endian, and clears
+ *             the counters if its first byte is not zero: payloads queued
+ *             now (1), most queued at once (1), enqueued (4), sent (4),
+ *             dropped because the queue was full or no buffer was left (4),
+ *             dropped after APP_QUEUE_RETRIES failures (4), failed attempts
+ *             (4), and the mean and the longest time from enqueued to sent
+ *             (4 + 4), in ticks of the sleep timer.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef APP_QUEUE_H_
+#define APP_QUEUE_H_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+#include "packet_buffer.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef void (* app_queue_cb_t)(void);
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void app_queue_init(void);
+void app_queue_reset_stats(void);
+void app_queue_set_cb(app_queue_cb_t callback);
+
+bool app_queue_enqueue(const uint8_t* data, uint8_t length);
+packet_buffer_t* app_queue_peek(void);
+void app_queue_commit(void);
+void app_queue_requeue(void);
+uint8_t app_queue_depth(void);
+bool app_queue_is_full(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* APP_QUEUE_H_ */
@@ -0,0 +1,58 @@
+/**
+ * @file       deadline.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Deadline misses of the tasks that the scheduler runs by deadline.
+ *
+ *             Every task pushed with a deadline is accounted when it starts,
+ *             one table entry per callback: how many times it ran, how many
+ *             of them it started after its deadline and the latest it
+ *             started, in ticks of the sleep timer.
+ *
+ *             A SERIAL_PC2MOTE_DEADLINE command dumps the table in
+ *             SERIAL_MOTE2PC_DEADLINE messages, in little endian, and clears
+ *             it if its first byte is not zero:
+ *
+ *             HEADER  0x00, address of deadline_init (4), entries (1), tasks
+ *                     not tracked (4), tasks the scheduler has lost since
+ *                     boot (4)
+ *             ENTRY   0x01, index (1), address of the callback (4), count
+ *                     (4), misses (4), latest start after the deadline (4)
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+#define DEADLINE_MAX_TASKS              ( 16 )
+
+#define DEADLINE_MSG_HEADER             ( 0x00 )
+#define DEADLINE_MSG_ENTRY              ( 0x01 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void deadline_init(void);
+void deadline_reset(void);
+
+void deadline_task(task_cb_t callback, int32_t late);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* DEADLINE_H_ */
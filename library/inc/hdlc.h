@@ -21,6 +21,9 @@
 #define HDLC_HEADER_SIZE            ( 4 ) // Flag (1) + Command (1) + Address (2)
 #define HDLC_FOOTER_SIZE            ( 3 ) // CRC (2) + Flag (1)
 
+// Bytes of a frame of the given payload if every byte after the flag is escaped
+#define HDLC_FRAME_SIZE_MAX(size)   ( 2 * (HDLC_HEADER_SIZE + (size) + HDLC_FOOTER_SIZE) - 2 )
+
 #define HDLC_FLAG                   ( 0x7E )
 #define HDLC_ESCAPE                 ( 0x7D )
 #define HDLC_ESCAPE_MASK            ( 0x20 )
@@ -47,7 +50,7 @@ void hdlc_open_rx(uint8_t* buffer, uint8_t* size);
 hdlc_status_t hdlc_put_rx(uint8_t byte);
 hdlc_crc_t hdlc_close_rx(void);
 
-void hdlc_open_tx(uint8_t* buffer, uint8_t* size);
+void hdlc_open_tx(uint8_t* buffer, uint16_t* size);
 void hdlc_put_tx(uint8_t byte);
 void hdlc_close_tx(void);
 
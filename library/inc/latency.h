@@ -0,0 +1,84 @@
+/**
+ * @file       latency.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      How late the timer tasks and the start of frame interrupt run.
+ *
+ *             Enabled with LATENCY_ENABLED in the config.h of the project.
+ *             Two delays are measured with cpu_cycles_get:
+ *
+ *             TIMER   from the expiry of a virtual timer to the moment its
+ *                     callback starts running in the scheduler, one table
+ *                     entry per callback. The expiry is only known to the
+ *                     tick, so the delay is accurate to one tick. Timers
+ *                     that run before they are due are only counted.
+ *             SFD     from the start of frame to the call to rx_init in
+ *                     rf_core_interrupt. The cc2538 counts from the entry
+ *                     of the interrupt, the posix and sim platforms from
+ *                     the moment the SFD is raised.
+ *
+ *             Each one keeps the count, minimum, average and maximum cycles
+ *             and a histogram in fractions of a 32 kHz tick, with the bins
+ *             of the profiler: bin 0 counts delays shorter than 1/8 of a
+ *             tick, bin i (1 to 7) the ones shorter than 2^i/8 ticks and
+ *             the last bin the ones of 16 ticks or more.
+ *
+ *             A SERIAL_PC2MOTE_LATENCY command dumps the tables in
+ *             SERIAL_MOTE2PC_LATENCY messages, in little endian, and clears
+ *             them if its first byte is not zero:
+ *
+ *             HEADER  0x00, cycles per second (4), address of latency_init
+ *                     (4), entries (1), timers not tracked (4), bins (1)
+ *             TIMER   0x01, index (1), address of the callback (4), early
+ *                     (4), count (4), minimum (4), average (4) and maximum
+ *                     (4) cycles, histogram (2 per bin)
+ *             SFD     0x02, count (4), minimum (4), average (4) and maximum
+ *                     (4) cycles, histogram (2 per bin)
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "types.h"
+
+#include "bsp_timer.h"
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED                 ( 0 )
+#endif
+
+#define LATENCY_MAX_TIMERS              ( 16 )
+#define LATENCY_HISTOGRAM_BINS          ( 9 )
+
+#define LATENCY_MSG_HEADER              ( 0x00 )
+#define LATENCY_MSG_TIMER               ( 0x01 )
+#define LATENCY_MSG_SFD                 ( 0x02 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void latency_init(void);
+void latency_reset(void);
+
+uint32_t latency_due(bsp_timer_width_t expiry);
+void latency_timer(task_cb_t callback, uint32_t due);
+void latency_sfd(uint32_t start);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* LATENCY_H_ */
@@ -14,9 +14,17 @@
 
 /*================================ include ==================================*/
 
+#include "app_queue.h"
+#include "deadline.h"
+#include "latency.h"
 #include "packet_buffer.h"
+#include "power.h"
+#include "profiler.h"
 #include "random.h"
+#include "recorder.h"
 #include "serial.h"
+#include "timer_wheel.h"
+#include "trace.h"
 #include "virtual_timer.h"
 
 /*================================ define ===================================*/
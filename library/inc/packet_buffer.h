@@ -3,7 +3,34 @@
  * @author     Pere Tuset-Peiro (peretuset@openmote.com)
  * @version    v0.1
  * @date       May 2015
- * @brief
+ * @brief      Pools of packet buffers in two size classes.
+ *
+ *             The short buffers hold the control frames of the MAC layers,
+ *             FBP, ARP, ACK and WOR, and the full ones any frame. Each pool
+ *             keeps its free entries in a stack, so getting and releasing
+ *             a buffer take the same time whatever the pool holds. A buffer
+ *             is taken from the smallest pool that fits the size asked for,
+ *             or from a larger one if that one is empty, and NULL is
+ *             returned when none is left. PACKET_BUFFER_SHORT_COUNT and
+ *             PACKET_BUFFER_FULL_COUNT in the config.h of the project set
+ *             how many buffers each pool has.
+ *
+ *             A buffer counts its holders, so that the MAC layer, the path
+ *             that forwards a frame and a sniffer can share it without
+ *             copying the frame. packet_buffer_get returns it with a single
+ *             holder, packet_buffer_retain adds one and packet_buffer_release
+ *             drops one, and the buffer goes back to its pool when the last
+ *             holder releases it. A holder may also keep only part of the
+ *             frame, e.g. the payload without the MAC header, in a slice,
+ *             which points into the buffer and holds it in the same way.
+ *             The holders must not change the frame once it is shared.
+ *
+ *             A SERIAL_PC2MOTE_BUFFER command reports the pools in a
+ *             SERIAL_MOTE2PC_BUFFER message, in little endian, and clears
+ *             the high-water marks and the failures if its first byte is
+ *             not zero: pools (1), then for each pool the size of its
+ *             buffers (1), buffers (1), taken (1), most taken at once (1)
+ *             and the times it was found empty (4).
  *
  * @copyright  Copyright 2015, OpenMote Technologies, S.L.
  *             This file is licensed under the GNU General Public License v2.
@@ -18,15 +45,18 @@
 
 /*================================ define ===================================*/
 
-/*================================ typedef ==================================*/
+// Bytes of the buffers of each pool, a frame is at most 127 bytes with the
+// 2 bytes of the CRC, which the radio does not store in the buffer
+#define PACKET_BUFFER_SHORT_SIZE        ( 32 )
+#define PACKET_BUFFER_FULL_SIZE         ( 128 )
 
-typedef enum {
-    PACKET_STATUS_FREE  = 0x00,
-    PACKET_STATUS_TAKEN = 0x01
-} packet_status_t;
+#define PACKET_BUFFER_POOLS             ( 2 )
+
+/*================================ typedef ==================================*/
 
 typedef struct {
-    packet_status_t status;
+    uint8_t refs;                   // Holders of the buffer, 0 when it is free
+    uint8_t pool;                   // The pool the buffer belongs to
 
     uint8_t* payload;               // Pointer to the paypload
     uint8_t  length;                // Length of the payload
@@ -34,19 +64,30 @@ typedef struct {
     uint8_t  lqi;                   // The LQI value of the received packet
     uint8_t  crc;                   // The CRC value of the received packet
 
-    uint8_t buffer[128];            // The buffer where to store the packet (1B LENGTH + 127B DATA + 2B CRC)
-    uint8_t size;                   // The size occupied in the buffer
+    uint8_t* buffer;                // The buffer where to store the packet, from the pool
+    uint8_t size;                   // The size of the buffer
 } packet_buffer_t;
 
+typedef struct {
+    packet_buffer_t* packet_buffer; // The buffer the slice holds, NULL if none
+    uint8_t* data;                  // First byte of the slice
+    uint8_t  length;                // Bytes of the slice
+} packet_slice_t;
+
 /*=============================== variables =================================*/
 
 /*=============================== prototypes ================================*/
 
 void packet_buffer_init(void);
+void packet_buffer_reset_stats(void);
 
-packet_buffer_t* packet_buffer_get(void);
+packet_buffer_t* packet_buffer_get(uint8_t size);
+packet_buffer_t* packet_buffer_retain(packet_buffer_t* packet_buffer);
 void packet_buffer_release(packet_buffer_t* packet_buffer);
 
+bool packet_buffer_slice(packet_buffer_t* packet_buffer, uint8_t offset, uint8_t length, packet_slice_t* slice);
+void packet_slice_release(packet_slice_t* slice);
+
 /*================================= public ==================================*/
 
 /*================================ private ==================================*/
@@ -0,0 +1,80 @@
+/**
+ * @file       power.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Power mode of the CPU while the scheduler has nothing to run.
+ *
+ *             The governor looks at when the sleep timer fires next and
+ *             takes the deepest power mode that it can wake up from in time,
+ *             up to POWER_MODE_MAX in the config.h of the project:
+ *
+ *             PM0     any interrupt wakes up, when no timer is pending, the
+ *                     next one is close, the serial port or the radio are
+ *                     active
+ *             PM1     the next timer is at least POWER_PM1_MIN_TICKS away
+ *             PM2     the next timer is at least POWER_PM2_MIN_TICKS away
+ *
+ *             The sleep timer keeps running in all of them. In PM1 and PM2
+ *             the CPU wakes up the wake up time of the mode before the timer
+ *             is due, so the clocks are running again when it fires. The
+ *             UART and the radio are off in PM1 and PM2, so a mote that
+ *             listens to a computer keeps POWER_MODE_MAX at 0.
+ *
+ *             A SERIAL_PC2MOTE_POWER command reports the time spent in each
+ *             mode in a SERIAL_MOTE2PC_POWER message, in little endian, and
+ *             clears it if its first byte is not zero:
+ *
+ *             REPORT  modes (1), ticks since the last reset (4), sleeps kept
+ *                     shallower by the peripherals (4), then for each mode
+ *                     the times entered (4) and the ticks spent in it (4)
+ *
+ *             The time not spent in any mode is the active time. The ticks
+ *             wrap around after 36 hours.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "types.h"
+
+#include "cpu.h"
+
+/*================================ define ===================================*/
+
+#ifndef POWER_MODE_MAX
+#define POWER_MODE_MAX                  ( CPU_POWER_PM0 )
+#endif
+
+#define POWER_MODES                     ( CPU_POWER_PM2 + 1 )
+
+// Ticks of 32 kHz to restart the 32 MHz crystal after waking up
+#define POWER_PM1_WAKEUP_TICKS          ( 10 )
+#define POWER_PM2_WAKEUP_TICKS          ( 15 )
+
+// Shortest sleep that saves energy in each mode, wake up included
+#define POWER_PM1_MIN_TICKS             ( 20 )
+#define POWER_PM2_MIN_TICKS             ( 66 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void power_init(void);
+void power_reset(void);
+
+void power_idle(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* POWER_H_ */
@@ -0,0 +1,72 @@
+/**
+ * @file       profiler.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Execution time of the tasks run by the scheduler.
+ *
+ *             Enabled with PROFILER_ENABLED in the config.h of the project.
+ *             The scheduler times every task with cpu_cycles_get and the
+ *             profiler keeps the count, minimum, average and maximum cycles
+ *             of each callback, and a histogram of its durations in
+ *             fractions of a 32 kHz tick: bin 0 counts the tasks shorter
+ *             than 1/8 of a tick, bin i (1 to 7) the ones shorter than
+ *             2^i/8 ticks and the last bin the ones of 16 ticks or more.
+ *
+ *             A SERIAL_PC2MOTE_PROFILE command dumps the tables in
+ *             SERIAL_MOTE2PC_PROFILE messages, in little endian as the
+ *             records, and clears them if its first byte is not zero:
+ *
+ *             HEADER  0x00, cycles per second (4), address of profiler_init
+ *                     (4), entries (1), tasks not tracked (4), bins (1)
+ *             ENTRY   0x01, index (1), address of the callback (4), count
+ *                     (4), minimum (4), average (4) and maximum (4) cycles,
+ *                     histogram (2 per bin)
+ *
+ *             The addresses are the lower 32 bits, the one of profiler_init
+ *             lets the computer find the callbacks in the symbols of the
+ *             image even if it is position independent.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "types.h"
+
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED                ( 0 )
+#endif
+
+#define PROFILER_MAX_TASKS              ( 16 )
+#define PROFILER_HISTOGRAM_BINS         ( 9 )
+
+#define PROFILER_MSG_HEADER             ( 0x00 )
+#define PROFILER_MSG_ENTRY              ( 0x01 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void profiler_init(void);
+void profiler_reset(void);
+
+uint32_t profiler_start(void);
+void profiler_stop(task_cb_t callback, uint32_t start);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,81 @@
+/**
+ * @file       recorder.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Compact log of the radio and timer events that feed the MAC.
+ *
+ *             Every record starts with a byte that holds the type in the
+ *             three upper bits and the ticks elapsed since the previous
+ *             record in the five lower bits. If they do not fit the lower
+ *             bits are RECORDER_DELTA_LONG and two bytes follow with the
+ *             ticks (little endian), then comes the body of the type:
+ *
+ *             BEGIN   ticks (4), MAC type (1), MAC slots (1)
+ *             TIME    ticks (4), precedes a record more than 65535 ticks away
+ *             SFD     nothing
+ *             RX_DONE nothing
+ *             PACKET  length (1), RSSI (1), CRC and LQI (1), first bytes
+ *                     of the payload (up to RECORDER_PACKET_PREFIX)
+ *             RSSI    RSSI (1)
+ *             TIMER   virtual timer that expired (1)
+ *             LOST    records dropped before this one (2)
+ *
+ *             The records are sent to the computer in SERIAL_MOTE2PC_RECORD
+ *             messages that only hold whole records.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+#include "packet_buffer.h"
+
+/*================================ define ===================================*/
+
+#define RECORDER_TYPE_SHIFT             ( 5 )
+#define RECORDER_DELTA_MASK             ( 0x1F )
+#define RECORDER_DELTA_LONG             ( 0x1F )
+
+#define RECORDER_PACKET_PREFIX          ( 12 )
+
+// Longest record, a PACKET with a long delta
+#define RECORDER_RECORD_MAX             ( 1 + 2 + 3 + RECORDER_PACKET_PREFIX )
+
+/*================================ typedef ==================================*/
+
+typedef enum {
+    RECORDER_BEGIN   = 0x00,
+    RECORDER_TIME    = 0x01,
+    RECORDER_SFD     = 0x02,
+    RECORDER_RX_DONE = 0x03,
+    RECORDER_PACKET  = 0x04,
+    RECORDER_RSSI    = 0x05,
+    RECORDER_TIMER   = 0x06,
+    RECORDER_LOST    = 0x07
+} recorder_type_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void recorder_init(void);
+void recorder_start(uint8_t mac_type, uint8_t mac_slots);
+void recorder_stop(void);
+
+void recorder_sfd(void);
+void recorder_rx_done(void);
+void recorder_packet(const packet_buffer_t* packet_buffer);
+void recorder_rssi(int8_t rssi);
+void recorder_timer(uint8_t id);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* RECORDER_H_ */
@@ -17,6 +17,8 @@
 #include "types.h"
 #include "scheduler.h"
 
+#include "packet_buffer.h"
+
 /*================================ define ===================================*/
 
 /*================================ typedef ==================================*/
@@ -31,13 +33,29 @@ typedef struct {
 } serial_packet_t;
 
 typedef enum {
-    SERIAL_MOTE2PC_DATA  = (uint8_t) 'D',
-    SERIAL_MOTE2PC_RESET = (uint8_t) 'R'
+    SERIAL_MOTE2PC_BUFFER  = (uint8_t) 'B',
+    SERIAL_MOTE2PC_DATA    = (uint8_t) 'D',
+    SERIAL_MOTE2PC_RECORD  = (uint8_t) 'E',
+    SERIAL_MOTE2PC_FRAME   = (uint8_t) 'F',
+    SERIAL_MOTE2PC_LATENCY = (uint8_t) 'L',
+    SERIAL_MOTE2PC_DEADLINE = (uint8_t) 'M',
+    SERIAL_MOTE2PC_PROFILE = (uint8_t) 'P',
+    SERIAL_MOTE2PC_QUEUE   = (uint8_t) 'Q',
+    SERIAL_MOTE2PC_RESET   = (uint8_t) 'R',
+    SERIAL_MOTE2PC_TRACE   = (uint8_t) 'T',
+    SERIAL_MOTE2PC_POWER   = (uint8_t) 'W'
 } serial_mote2pc_t;
 
 typedef enum {
-    SERIAL_PC2MOTE_START = (uint8_t) 'A',
-    SERIAL_PC2MOTE_STOP  = (uint8_t) 'O'
+    SERIAL_PC2MOTE_START   = (uint8_t) 'A',
+    SERIAL_PC2MOTE_BUFFER  = (uint8_t) 'B',
+    SERIAL_PC2MOTE_LATENCY = (uint8_t) 'L',
+    SERIAL_PC2MOTE_DEADLINE = (uint8_t) 'M',
+    SERIAL_PC2MOTE_STOP    = (uint8_t) 'O',
+    SERIAL_PC2MOTE_PROFILE = (uint8_t) 'P',
+    SERIAL_PC2MOTE_QUEUE   = (uint8_t) 'Q',
+    SERIAL_PC2MOTE_TRACE   = (uint8_t) 'T',
+    SERIAL_PC2MOTE_POWER   = (uint8_t) 'W'
 } serial_pc2mote_t;
 
 /*=============================== variables =================================*/
@@ -51,9 +69,13 @@ bool serial_is_busy(void);
 void serial_register_mote2pc_cb(serial_mote2pc_t serial_mote2pc, serial_cb_t serial_cb, task_prio_t task_prio);
 void serial_register_pc2mote_cb(serial_pc2mote_t serial_pc2mote, serial_cb_t serial_cb, task_prio_t task_prio);
 
-void serial_push_msg(uint8_t command, uint8_t* message, uint8_t size);
+bool serial_push_msg(uint8_t command, uint8_t* message, uint8_t size);
+bool serial_push_msg_retry(uint8_t command, uint8_t* message, uint8_t size, task_cb_t retry_cb);
+bool serial_push_slice(uint8_t command, packet_buffer_t* packet_buffer, uint8_t offset, uint8_t size);
 void serial_parse_msg(serial_packet_t* serial_packet);
 
+uint8_t serial_put_le(uint8_t* buffer, uint32_t value, uint8_t size);
+
 /*================================= public ==================================*/
 
 /*================================ private ==================================*/
@@ -0,0 +1,92 @@
+/**
+ * @file       timer_wheel.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Hierarchical timing wheel for large numbers of timers.
+ *
+ *             Meant for the timeouts that the gateway keeps per node, e.g.
+ *             retransmissions, reservations or liveness, which are many,
+ *             long and mostly stopped or restarted before they expire. The
+ *             timers are owned by the caller, so there is no limit on how
+ *             many run at once, and each one pushes a task_t descriptor
+ *             when it expires, whose context tells which node it is for.
+ *
+ *             The wheel counts ticks of TIMER_WHEEL_TICK_SHIFT bits of the
+ *             sleep timer, about 1 ms, and has TIMER_WHEEL_LEVELS levels of
+ *             TIMER_WHEEL_SLOTS slots, each level 64 times coarser than the
+ *             one below, which covers 4.6 hours. A timer is linked to the
+ *             slot of its expiry in the lowest level that reaches it, so
+ *             starting and stopping one cost the same whatever the wheel
+ *             holds. When the wheel reaches the slot of a higher level the
+ *             timers in it move down a level, and when it reaches a slot of
+ *             the lowest level they expire. Timers further away wait in the
+ *             top level and move again when it comes round.
+ *
+ *             A single virtual timer wakes the wheel up, and only at the
+ *             ticks whose slots hold timers. Each time it handles at most
+ *             TIMER_WHEEL_BUDGET timers and pushes itself again for the
+ *             rest, so that a slot full of timers does not hold back the
+ *             other tasks. A timer never expires early and at most a tick
+ *             of the wheel late, plus the time it waits in the scheduler.
+ *
+ *             The functions are called from tasks, not from interrupts.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "types.h"
+
+#include "bsp_timer.h"
+
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+// Ticks of the sleep timer in a tick of the wheel, 32 ticks or 0.98 ms
+#define TIMER_WHEEL_TICK_SHIFT          ( 5 )
+
+#define TIMER_WHEEL_LEVELS              ( 4 )
+#define TIMER_WHEEL_SLOT_BITS           ( 6 )
+#define TIMER_WHEEL_SLOTS               ( 1 << TIMER_WHEEL_SLOT_BITS )
+
+// Timers handled each time the wheel runs before it yields to other tasks
+#ifndef TIMER_WHEEL_BUDGET
+#define TIMER_WHEEL_BUDGET              ( 16 )
+#endif
+
+/*================================ typedef ==================================*/
+
+typedef struct timer_wheel_timer_t {
+    task_t*  task;                  ///< Pushed when the timer expires
+    uint32_t expiry;                ///< Tick of the wheel at which it is due
+    uint16_t slot;                  ///< Slot it is linked to, if it runs
+    struct timer_wheel_timer_t* next;
+    struct timer_wheel_timer_t* prev;
+} timer_wheel_timer_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void timer_wheel_init(void);
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, task_t* task);
+void timer_wheel_start(timer_wheel_timer_t* timer, bsp_timer_width_t ticks);
+void timer_wheel_start_at(timer_wheel_timer_t* timer, bsp_timer_width_t expiry);
+void timer_wheel_stop(timer_wheel_timer_t* timer);
+bool timer_wheel_is_running(const timer_wheel_timer_t* timer);
+uint32_t timer_wheel_get_running(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* TIMER_WHEEL_H_ */
@@ -0,0 +1,109 @@
+/**
+ * @file       trace.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Timeline of the MAC kept in RAM, instead of the debug pins.
+ *
+ *             Tasks and interrupts push records with the time in ticks, an
+ *             event, whether it begins, ends or just happens, and an argument
+ *             into a circular buffer that keeps the most recent ones. The
+ *             TRACE_LEVEL in the config.h of the project selects the events
+ *             that are compiled in, the ones above it cost nothing:
+ *
+ *             TRACE_LEVEL_SLOT   FBP, ARP, DATA, ACK and WOR slots
+ *             TRACE_LEVEL_RADIO  and the radio transmitting or receiving
+ *             TRACE_LEVEL_TASK   and every task and virtual timer
+ *
+ *             A SERIAL_PC2MOTE_TRACE command drains the buffer in
+ *             SERIAL_MOTE2PC_TRACE messages, in little endian:
+ *
+ *             RECORDS 0x00, count (1), records of time (4), argument (4),
+ *                     event (1) and phase (1)
+ *             END     0x01, records overwritten (4), current time (4),
+ *                     address of trace_init (4)
+ *
+ *             The address of trace_init lets the computer name the tasks
+ *             from the symbols of the image, as the profiler does.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "types.h"
+
+/*================================ define ===================================*/
+
+#define TRACE_LEVEL_NONE                ( 0 )
+#define TRACE_LEVEL_SLOT                ( 1 )
+#define TRACE_LEVEL_RADIO               ( 2 )
+#define TRACE_LEVEL_TASK                ( 3 )
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL                     ( TRACE_LEVEL_NONE )
+#endif
+
+#define TRACE_MSG_RECORDS               ( 0x00 )
+#define TRACE_MSG_END                   ( 0x01 )
+
+#define TRACE_RECORD_SIZE               ( 4 + 4 + 1 + 1 )
+
+// Argument of the radio events
+#define TRACE_RADIO_RX                  ( 0 )
+#define TRACE_RADIO_TX                  ( 1 )
+
+#if (TRACE_LEVEL >= TRACE_LEVEL_SLOT)
+#define TRACE_SLOT(phase, event, arg)   trace_push(phase, event, arg)
+#else
+#define TRACE_SLOT(phase, event, arg)
+#endif
+
+#if (TRACE_LEVEL >= TRACE_LEVEL_RADIO)
+#define TRACE_RADIO(phase, arg)         trace_push(phase, TRACE_EVENT_RADIO, arg)
+#else
+#define TRACE_RADIO(phase, arg)
+#endif
+
+#if (TRACE_LEVEL >= TRACE_LEVEL_TASK)
+#define TRACE_TASK(phase, event, arg)   trace_push(phase, event, arg)
+#else
+#define TRACE_TASK(phase, event, arg)
+#endif
+
+/*================================ typedef ==================================*/
+
+typedef enum {
+    TRACE_INSTANT = 0x00,
+    TRACE_BEGIN   = 0x01,
+    TRACE_END     = 0x02
+} trace_phase_t;
+
+typedef enum {
+    TRACE_EVENT_FBP   = 0x00,
+    TRACE_EVENT_ARP   = 0x01,
+    TRACE_EVENT_DATA  = 0x02,
+    TRACE_EVENT_ACK   = 0x03,
+    TRACE_EVENT_WOR   = 0x04,
+    TRACE_EVENT_RADIO = 0x05,
+    TRACE_EVENT_TASK  = 0x06,
+    TRACE_EVENT_TIMER = 0x07
+} trace_event_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void trace_init(void);
+void trace_push(trace_phase_t phase, trace_event_t event, uint32_t arg);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* TRACE_H_ */
@@ -3,7 +3,34 @@
  * @author     Pere Tuset-Peiro (peretuset@openmote.com)
  * @version    v0.1
  * @date       May 2015
- * @brief
+ * @brief      Virtual timers multiplexed on the sleep timer.
+ *
+ *             The running timers are kept in a binary heap ordered by the
+ *             tick at which they expire, so starting and stopping a timer
+ *             take O(log n) and the interrupt only looks at the ones that
+ *             are due. Expiries are absolute, a timer that runs late does
+ *             not delay the ones after it. VIRTUAL_TIMER_MAX_TIMERS in the
+ *             config.h of the project sets how many timers can run at once.
+ *             Stopping a timer that has already expired does nothing, even
+ *             if another timer has been started in its place since.
+ *
+ *             The _at variants take the tick at which the timer expires
+ *             instead of a delay, so that a schedule built on an anchor,
+ *             e.g. the SFD of a frame, does not drift. A timer started at a
+ *             tick that has already passed expires right away.
+ *
+ *             The callback of a timer started with virtual_timer_start_isr_at
+ *             runs in an interrupt, for the actions that only write a
+ *             register of the radio and cannot wait for the scheduler. It
+ *             takes a fine tick of the radio timer, so such a timer can be
+ *             set in between two ticks of the sleep timer: once the sleep
+ *             timer is due, the compare of the radio timer is set for the
+ *             fine tick and its interrupt runs the callback. The radio timer
+ *             is started again from the sleep timer on each expiry of the
+ *             sleep timer, so both keep counting from the same tick. The
+ *             callback must take less than its budget, in microseconds, and
+ *             the times it does not are counted. A deadline task can follow
+ *             it for the rest of the work.
  *
  * @copyright  Copyright 2015, OpenMote Technologies, S.L.
  *             This file is licensed under the GNU General Public License v2.
@@ -14,9 +41,11 @@
 
 /*================================ include ==================================*/
 
+#include "config.h"
 #include "types.h"
 
 #include "bsp_timer.h"
+#include "radio_timer.h"
 
 #include "scheduler.h"
 
@@ -24,15 +53,22 @@
 
 #define VIRTUAL_TIMER_KICK_NOW                  ( 0 )
 
+#ifndef VIRTUAL_TIMER_MAX_TIMERS
+#define VIRTUAL_TIMER_MAX_TIMERS                ( 16 )
+#endif
+
 /*================================ typedef ==================================*/
 
 typedef bsp_timer_width_t virtual_timer_width_t;
 
-typedef uint8_t virtual_timer_id_t;
+typedef uint16_t virtual_timer_id_t;
+
+typedef void (* virtual_timer_isr_cb_t)(void);
 
 typedef enum {
     VIRTUAL_TIMER_STATUS_STOPPED = 0x00,
-    VIRTUAL_TIMER_STATUS_RUNNING = 0x01
+    VIRTUAL_TIMER_STATUS_RUNNING = 0x01,
+    VIRTUAL_TIMER_STATUS_WAITING = 0x02     ///< Due, waits for its fine tick
 } virtual_timer_status_t;
 
 typedef enum {
@@ -45,9 +81,15 @@ typedef struct virtual_timer_t {
     virtual_timer_status_t status;
     virtual_timer_type_t   type;
     virtual_timer_width_t  ticks;
-    virtual_timer_width_t  ticks_left;
+    virtual_timer_width_t  expiry;         ///< Tick at which it is due
     task_cb_t              callback;
     task_prio_t            priority;
+    task_t*                task;           ///< Pushed instead of the callback
+    bool                   edf;            ///< Pushed with a deadline
+    virtual_timer_width_t  slack;          ///< Ticks from the expiry to the deadline
+    virtual_timer_isr_cb_t isr;            ///< Run in the interrupt, before the task
+    uint16_t               budget;         ///< Microseconds the isr callback may take
+    uint8_t                fine;           ///< Fine ticks after the expiry to run the isr
 } virtual_timer_t;
 
 /*=============================== variables =================================*/
@@ -58,7 +100,13 @@ typedef struct virtual_timer_t {
 
 void virtual_timer_init(void);
 virtual_timer_id_t virtual_timer_start(virtual_timer_type_t vtimer_type, virtual_timer_width_t vtimer_ticks, task_cb_t task_callback, task_prio_t task_priority);
+virtual_timer_id_t virtual_timer_start_task(virtual_timer_type_t vtimer_type, virtual_timer_width_t vtimer_ticks, task_t* task);
+virtual_timer_id_t virtual_timer_start_deadline(virtual_timer_type_t vtimer_type, virtual_timer_width_t vtimer_ticks, task_cb_t task_callback, virtual_timer_width_t slack);
+virtual_timer_id_t virtual_timer_start_at(virtual_timer_width_t expiry, task_cb_t task_callback, task_prio_t task_priority);
+virtual_timer_id_t virtual_timer_start_deadline_at(virtual_timer_width_t expiry, task_cb_t task_callback, virtual_timer_width_t slack);
+virtual_timer_id_t virtual_timer_start_isr_at(radio_timer_width_t at, virtual_timer_isr_cb_t isr_callback, uint16_t budget, task_cb_t task_callback, virtual_timer_width_t slack);
 void virtual_timer_stop(virtual_timer_id_t vtimer_id);
+uint32_t virtual_timer_get_overruns(void);
 
 /*================================ private ==================================*/
 
@@ -0,0 +1,255 @@
+/**
+ * @file       app_queue.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Queue of the frames that the application of a node sends.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "config.h"
+#include "app_queue.h"
+
+#include "serial.h"
+
+#include "bsp_timer.h"
+
+/*================================ define ===================================*/
+
+// Payloads waiting to be sent
+#ifndef APP_QUEUE_SIZE
+#define APP_QUEUE_SIZE                  ( 4 )
+#endif
+
+// Attempts to send a payload before it is dropped
+#ifndef APP_QUEUE_RETRIES
+#define APP_QUEUE_RETRIES               ( 8 )
+#endif
+
+#define APP_QUEUE_REPORT_SIZE           ( 1 + 1 + 4 + 4 + 4 + 4 + 4 + 4 + 4 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    packet_buffer_t*  packet_buffer;
+    bsp_timer_width_t enqueued;     ///< Tick at which the payload was enqueued
+    uint8_t           attempts;     ///< Times the MAC layer failed to send it
+} app_queue_entry_t;
+
+typedef struct {
+    app_queue_entry_t entries[APP_QUEUE_SIZE];
+    uint8_t  head;                  ///< Oldest entry
+    uint8_t  depth;                 ///< Entries from the head
+    app_queue_cb_t callback;
+
+    // Counters
+    uint8_t  high;                  ///< Most entries queued at once
+    uint32_t enqueued;
+    uint32_t sent;
+    uint32_t dropped_full;
+    uint32_t dropped_retries;
+    uint32_t failures;
+    uint64_t delay_sum;             ///< Ticks from enqueued to sent
+    uint32_t delay_max;
+
+    // Report in progress
+    bool     reporting;
+    uint8_t  message[APP_QUEUE_REPORT_SIZE];
+    uint8_t  length;
+} app_queue_vars_t;
+
+/*=============================== variables =================================*/
+
+static app_queue_vars_t app_queue_vars;
+
+/*=============================== prototypes ================================*/
+
+static void app_queue_remove(void);
+static void app_queue_request(void);
+static void app_queue_report(void);
+
+/*================================= public ==================================*/
+
+void app_queue_init(void) {
+    // Initialize the memory of the variables
+    memset(&app_queue_vars, 0, sizeof(app_queue_vars_t));
+
+    // Register the serial callback that reports the queue
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_QUEUE, app_queue_request, TASK_PRIO_MIN);
+}
+
+void app_queue_reset_stats(void) {
+    // The high-water mark starts again from the entries queued now
+    app_queue_vars.high            = app_queue_vars.depth;
+    app_queue_vars.enqueued        = 0;
+    app_queue_vars.sent            = 0;
+    app_queue_vars.dropped_full    = 0;
+    app_queue_vars.dropped_retries = 0;
+    app_queue_vars.failures        = 0;
+    app_queue_vars.delay_sum       = 0;
+    app_queue_vars.delay_max       = 0;
+}
+
+void app_queue_set_cb(app_queue_cb_t callback) {
+    app_queue_vars.callback = callback;
+}
+
+bool app_queue_enqueue(const uint8_t* data, uint8_t length) {
+    app_queue_entry_t* entry;
+    packet_buffer_t* packet_buffer = NULL;
+
+    // Take a packet buffer that fits the payload, if the queue has room
+    if (app_queue_vars.depth < APP_QUEUE_SIZE) {
+        packet_buffer = packet_buffer_get(length);
+    }
+
+    if (packet_buffer == NULL) {
+        app_queue_vars.dropped_full++;
+        return false;
+    }
+
+    // Copy the payload
+    memcpy(packet_buffer->payload, data, length);
+    packet_buffer->length = length;
+
+    // Add it after the last entry
+    entry = &app_queue_vars.entries[(app_queue_vars.head + app_queue_vars.depth) % APP_QUEUE_SIZE];
+    entry->packet_buffer = packet_buffer;
+    entry->enqueued      = bsp_timer_get();
+    entry->attempts      = 0;
+
+    app_queue_vars.depth++;
+    app_queue_vars.enqueued++;
+    if (app_queue_vars.depth > app_queue_vars.high) {
+        app_queue_vars.high = app_queue_vars.depth;
+    }
+
+    return true;
+}
+
+packet_buffer_t* app_queue_peek(void) {
+    // The oldest payload, NULL if the queue is empty
+    if (app_queue_vars.depth == 0) {
+        return NULL;
+    }
+
+    return app_queue_vars.entries[app_queue_vars.head].packet_buffer;
+}
+
+void app_queue_commit(void) {
+    app_queue_entry_t* entry;
+    uint32_t delay;
+
+    if (app_queue_vars.depth == 0) {
+        return;
+    }
+
+    // Account for the time the payload waited
+    entry = &app_queue_vars.entries[app_queue_vars.head];
+    delay = (uint32_t) (bsp_timer_get() - entry->enqueued);
+    app_queue_vars.sent++;
+    app_queue_vars.delay_sum += delay;
+    if (delay > app_queue_vars.delay_max) {
+        app_queue_vars.delay_max = delay;
+    }
+
+    app_queue_remove();
+}
+
+void app_queue_requeue(void) {
+    app_queue_entry_t* entry;
+
+    if (app_queue_vars.depth == 0) {
+        return;
+    }
+
+    // The payload stays at the head, unless it failed too many times
+    entry = &app_queue_vars.entries[app_queue_vars.head];
+    app_queue_vars.failures++;
+    if (++entry->attempts >= APP_QUEUE_RETRIES) {
+        app_queue_vars.dropped_retries++;
+        app_queue_remove();
+    }
+}
+
+uint8_t app_queue_depth(void) {
+    return app_queue_vars.depth;
+}
+
+bool app_queue_is_full(void) {
+    return (app_queue_vars.depth == APP_QUEUE_SIZE);
+}
+
+/*================================ private ==================================*/
+
+static void app_queue_remove(void) {
+    app_queue_entry_t* entry = &app_queue_vars.entries[app_queue_vars.head];
+
+    // Release the packet buffer and move the head to the next entry
+    packet_buffer_release(entry->packet_buffer);
+    entry->packet_buffer = NULL;
+
+    app_queue_vars.head = (app_queue_vars.head + 1) % APP_QUEUE_SIZE;
+    app_queue_vars.depth--;
+
+    // Let the application enqueue the next payload
+    if (app_queue_vars.callback != NULL) {
+        app_queue_vars.callback();
+    }
+}
+
+static void app_queue_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+    uint8_t* message = app_queue_vars.message;
+    uint32_t mean;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A report in progress goes on, otherwise start one
+    if (app_queue_vars.reporting) {
+        return;
+    }
+
+    // Take the counters as they are now
+    mean = (app_queue_vars.sent > 0 ? (uint32_t) (app_queue_vars.delay_sum / app_queue_vars.sent) : 0);
+
+    app_queue_vars.length = 0;
+    message[app_queue_vars.length++] = app_queue_vars.depth;
+    message[app_queue_vars.length++] = app_queue_vars.high;
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.enqueued, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.sent, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.dropped_full, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.dropped_retries, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.failures, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], mean, 4);
+    app_queue_vars.length += serial_put_le(&message[app_queue_vars.length], app_queue_vars.delay_max, 4);
+
+    // Clear them if requested
+    if (serial_packet.length > 0 && buffer[0] != 0) {
+        app_queue_reset_stats();
+    }
+
+    app_queue_vars.reporting = true;
+
+    app_queue_report();
+}
+
+static void app_queue_report(void) {
+    // Try again later if the serial queue is full
+    if (!serial_push_msg_retry(SERIAL_MOTE2PC_QUEUE, app_queue_vars.message, app_queue_vars.length, app_queue_report)) {
+        return;
+    }
+
+    // The report is over
+    app_queue_vars.reporting = false;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file       deadline.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Deadline misses of the tasks that the scheduler runs by deadline.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "deadline.h"
+
+#include "serial.h"
+
+/*================================ define ===================================*/
+
+#define DEADLINE_ENTRY_SIZE             ( 1 + 1 + 4 + 4 + 4 + 4 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    task_cb_t callback;
+    uint32_t  count;
+    uint32_t  misses;
+    uint32_t  worst;                ///< Latest start after the deadline
+} deadline_entry_t;
+
+typedef struct {
+    deadline_entry_t entries[DEADLINE_MAX_TASKS];
+    uint8_t  used;                  ///< Entries that hold a callback
+    uint32_t untracked;             ///< Tasks that found the table full
+
+    // Dump in progress
+    bool     dumping;
+    bool     dump_reset;
+    uint8_t  dump_entries;          ///< Entries announced in the header
+    int16_t  dump_next;             ///< Next entry, -1 for the header
+    uint8_t  message[DEADLINE_ENTRY_SIZE];
+} deadline_vars_t;
+
+/*=============================== variables =================================*/
+
+static deadline_vars_t deadline_vars;
+
+/*=============================== prototypes ================================*/
+
+static deadline_entry_t* deadline_find(task_cb_t callback);
+static void deadline_request(void);
+static void deadline_dump(void);
+
+/*================================= public ==================================*/
+
+void deadline_init(void) {
+    // Initialize the memory of the variables
+    memset(&deadline_vars, 0, sizeof(deadline_vars_t));
+
+    // Register the serial callback that dumps the table
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_DEADLINE, deadline_request, TASK_PRIO_MIN);
+}
+
+void deadline_reset(void) {
+    // Clear the table
+    memset(deadline_vars.entries, 0, sizeof(deadline_vars.entries));
+    deadline_vars.used = 0;
+    deadline_vars.untracked = 0;
+}
+
+void deadline_task(task_cb_t callback, int32_t late) {
+    deadline_entry_t* entry;
+
+    entry = deadline_find(callback);
+    if (entry == NULL) {
+        deadline_vars.untracked++;
+        return;
+    }
+
+    // Starting at the deadline is still on time
+    entry->count++;
+    if (late > 0) {
+        entry->misses++;
+        if ((uint32_t) late > entry->worst) {
+            entry->worst = (uint32_t) late;
+        }
+    }
+}
+
+/*================================ private ==================================*/
+
+static deadline_entry_t* deadline_find(task_cb_t callback) {
+    deadline_entry_t* entry;
+
+    // Look for the callback among the ones seen so far
+    for (uint8_t i = 0; i < deadline_vars.used; i++) {
+        entry = &deadline_vars.entries[i];
+        if (entry->callback == callback) {
+            return entry;
+        }
+    }
+
+    // Otherwise take a new entry, if there is one
+    if (deadline_vars.used == DEADLINE_MAX_TASKS) {
+        return NULL;
+    }
+
+    entry = &deadline_vars.entries[deadline_vars.used++];
+    entry->callback = callback;
+
+    return entry;
+}
+
+static void deadline_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A dump in progress goes on, otherwise start one
+    if (deadline_vars.dumping) {
+        return;
+    }
+
+    deadline_vars.dumping = true;
+    deadline_vars.dump_reset = (serial_packet.length > 0 && buffer[0] != 0);
+    deadline_vars.dump_entries = deadline_vars.used;
+    deadline_vars.dump_next = -1;
+
+    deadline_dump();
+}
+
+static void deadline_dump(void) {
+    deadline_entry_t* entry;
+    uint8_t* message = deadline_vars.message;
+    uint8_t length;
+
+    while (deadline_vars.dump_next < deadline_vars.dump_entries) {
+        length = 0;
+
+        if (deadline_vars.dump_next < 0) {
+            // The header tells how many entries follow
+            message[length++] = DEADLINE_MSG_HEADER;
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) deadline_init, 4);
+            message[length++] = deadline_vars.dump_entries;
+            length += serial_put_le(&message[length], deadline_vars.untracked, 4);
+            length += serial_put_le(&message[length], scheduler_get_overflows(), 4);
+        } else {
+            // One entry per message
+            entry = &deadline_vars.entries[deadline_vars.dump_next];
+
+            message[length++] = DEADLINE_MSG_ENTRY;
+            message[length++] = (uint8_t) deadline_vars.dump_next;
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) entry->callback, 4);
+            length += serial_put_le(&message[length], entry->count, 4);
+            length += serial_put_le(&message[length], entry->misses, 4);
+            length += serial_put_le(&message[length], entry->worst, 4);
+        }
+
+        // Try again later if the serial queue is full
+        if (!serial_push_msg_retry(SERIAL_MOTE2PC_DEADLINE, message, length, deadline_dump)) {
+            return;
+        }
+
+        deadline_vars.dump_next++;
+    }
+
+    // The dump is over
+    if (deadline_vars.dump_reset) {
+        deadline_reset();
+    }
+    deadline_vars.dumping = false;
+}
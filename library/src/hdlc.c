@@ -31,7 +31,7 @@ typedef struct {
 
     // Transmit buffer
     uint8_t* tx_buffer_ptr;
-    uint8_t* tx_buffer_len;
+    uint16_t* tx_buffer_len;
 } hdlc_vars_t;
 
 /*=============================== variables =================================*/
@@ -108,7 +108,7 @@ hdlc_crc_t hdlc_close_rx(void) {
     }
 }
 
-void hdlc_open_tx(uint8_t * buffer, uint8_t * size) {
+void hdlc_open_tx(uint8_t * buffer, uint16_t * size) {
     // Reset the TX buffer variables
     hdlc_vars.tx_buffer_ptr = buffer;
     hdlc_vars.tx_buffer_len = size;
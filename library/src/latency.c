@@ -0,0 +1,285 @@
+/**
+ * @file       latency.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      How late the timer tasks and the start of frame interrupt run.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "latency.h"
+
+#if LATENCY_ENABLED
+
+#include "serial.h"
+
+#include "cpu.h"
+
+/*================================ define ===================================*/
+
+#define LATENCY_TICKS_PER_SECOND        ( 32768 )
+
+// Width of the first bin of the histogram, 1/8 of a tick
+#define LATENCY_BIN_DIVIDER             ( 8 )
+
+#define LATENCY_TIMER_SIZE              ( 1 + 1 + 4 + 4 + 4 + 4 + 4 + 4 + 2 * LATENCY_HISTOGRAM_BINS )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint16_t histogram[LATENCY_HISTOGRAM_BINS];
+} latency_stats_t;
+
+typedef struct {
+    task_cb_t       callback;
+    uint32_t        early;          ///< Timers that expired before time
+    latency_stats_t stats;
+} latency_entry_t;
+
+typedef struct {
+    latency_entry_t timers[LATENCY_MAX_TIMERS];
+    uint8_t  used;                  ///< Entries that hold a callback
+    uint32_t untracked;             ///< Timers that found the table full
+    latency_stats_t sfd;
+
+    uint32_t frequency;             ///< Cycles per second
+    uint32_t tick_cycles;           ///< Cycles per tick
+    uint32_t bin_width;             ///< Cycles in the first bin
+
+    // Dump in progress
+    bool     dumping;
+    bool     dump_reset;
+    uint8_t  dump_entries;          ///< Entries announced in the header
+    int16_t  dump_next;             ///< Next entry, -1 for the header
+    uint8_t  message[LATENCY_TIMER_SIZE];
+} latency_vars_t;
+
+/*=============================== variables =================================*/
+
+static latency_vars_t latency_vars;
+
+/*=============================== prototypes ================================*/
+
+static latency_entry_t* latency_find(task_cb_t callback);
+static void latency_update(latency_stats_t* stats, uint32_t cycles);
+static uint8_t latency_bin(uint32_t cycles);
+static void latency_request(void);
+static void latency_dump(void);
+static uint8_t latency_put_stats(uint8_t* buffer, const latency_stats_t* stats);
+
+/*================================= public ==================================*/
+
+void latency_init(void) {
+    // Initialize the memory of the variables
+    memset(&latency_vars, 0, sizeof(latency_vars_t));
+
+    // Scale the histograms to the counter of the platform
+    latency_vars.frequency = cpu_cycles_frequency();
+    latency_vars.tick_cycles = latency_vars.frequency / LATENCY_TICKS_PER_SECOND;
+    latency_vars.bin_width = latency_vars.tick_cycles / LATENCY_BIN_DIVIDER;
+    if (latency_vars.bin_width == 0) {
+        latency_vars.bin_width = 1;
+    }
+
+    // Register the serial callback that dumps the tables
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_LATENCY, latency_request, TASK_PRIO_MIN);
+}
+
+void latency_reset(void) {
+    // Clear the tables but keep the scale
+    cpu_disable_interrupts();
+    memset(latency_vars.timers, 0, sizeof(latency_vars.timers));
+    memset(&latency_vars.sfd, 0, sizeof(latency_vars.sfd));
+    latency_vars.used = 0;
+    latency_vars.untracked = 0;
+    cpu_enable_interrupts();
+}
+
+uint32_t latency_due(bsp_timer_width_t expiry) {
+    int32_t late;
+
+    // Ticks since the timer was due, negative if it expired before time
+    late = (int32_t) (bsp_timer_get() - expiry);
+
+    // The cycle count at which the timer was due
+    return cpu_cycles_get() - (uint32_t) (late * (int32_t) latency_vars.tick_cycles);
+}
+
+void latency_timer(task_cb_t callback, uint32_t due) {
+    latency_entry_t* entry;
+    int32_t cycles;
+
+    // The counter wraps around, the difference does not
+    cycles = (int32_t) (cpu_cycles_get() - due);
+
+    entry = latency_find(callback);
+    if (entry == NULL) {
+        latency_vars.untracked++;
+        return;
+    }
+
+    // A timer that runs before it is due is only counted
+    if (cycles < 0) {
+        entry->early++;
+        return;
+    }
+
+    latency_update(&entry->stats, (uint32_t) cycles);
+}
+
+void latency_sfd(uint32_t start) {
+    latency_update(&latency_vars.sfd, cpu_cycles_get() - start);
+}
+
+/*================================ private ==================================*/
+
+static latency_entry_t* latency_find(task_cb_t callback) {
+    latency_entry_t* entry;
+
+    // Look for the callback among the ones seen so far
+    for (uint8_t i = 0; i < latency_vars.used; i++) {
+        entry = &latency_vars.timers[i];
+        if (entry->callback == callback) {
+            return entry;
+        }
+    }
+
+    // Otherwise take a new entry, if there is one
+    if (latency_vars.used == LATENCY_MAX_TIMERS) {
+        return NULL;
+    }
+
+    entry = &latency_vars.timers[latency_vars.used++];
+    entry->callback = callback;
+
+    return entry;
+}
+
+static void latency_update(latency_stats_t* stats, uint32_t cycles) {
+    uint8_t bin;
+
+    // Update the statistics of the delay
+    if (stats->count == 0 || cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->count++;
+    stats->total += cycles;
+
+    bin = latency_bin(cycles);
+    if (stats->histogram[bin] < UINT16_MAX) {
+        stats->histogram[bin]++;
+    }
+}
+
+static uint8_t latency_bin(uint32_t cycles) {
+    uint32_t units;
+    uint8_t bin = 0;
+
+    // Bin i holds delays below 2^i units of 1/8 of a tick
+    units = cycles / latency_vars.bin_width;
+    while (units > 0 && bin < LATENCY_HISTOGRAM_BINS - 1) {
+        units >>= 1;
+        bin++;
+    }
+
+    return bin;
+}
+
+static void latency_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A dump in progress goes on, otherwise start one
+    if (latency_vars.dumping) {
+        return;
+    }
+
+    latency_vars.dumping = true;
+    latency_vars.dump_reset = (serial_packet.length > 0 && buffer[0] != 0);
+    latency_vars.dump_entries = latency_vars.used;
+    latency_vars.dump_next = -1;
+
+    latency_dump();
+}
+
+static void latency_dump(void) {
+    latency_entry_t* entry;
+    uint8_t* message = latency_vars.message;
+    uint8_t length;
+
+    // The header, one message per timer entry and the SFD at the end
+    while (latency_vars.dump_next <= latency_vars.dump_entries) {
+        length = 0;
+
+        if (latency_vars.dump_next < 0) {
+            // The header tells how to read the entries
+            message[length++] = LATENCY_MSG_HEADER;
+            length += serial_put_le(&message[length], latency_vars.frequency, 4);
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) latency_init, 4);
+            message[length++] = latency_vars.dump_entries;
+            length += serial_put_le(&message[length], latency_vars.untracked, 4);
+            message[length++] = LATENCY_HISTOGRAM_BINS;
+        } else if (latency_vars.dump_next < latency_vars.dump_entries) {
+            entry = &latency_vars.timers[latency_vars.dump_next];
+
+            message[length++] = LATENCY_MSG_TIMER;
+            message[length++] = (uint8_t) latency_vars.dump_next;
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) entry->callback, 4);
+            length += serial_put_le(&message[length], entry->early, 4);
+            length += latency_put_stats(&message[length], &entry->stats);
+        } else {
+            message[length++] = LATENCY_MSG_SFD;
+            length += latency_put_stats(&message[length], &latency_vars.sfd);
+        }
+
+        // Try again later if the serial queue is full
+        if (!serial_push_msg_retry(SERIAL_MOTE2PC_LATENCY, message, length, latency_dump)) {
+            return;
+        }
+
+        latency_vars.dump_next++;
+    }
+
+    // The dump is over
+    if (latency_vars.dump_reset) {
+        latency_reset();
+    }
+    latency_vars.dumping = false;
+}
+
+static uint8_t latency_put_stats(uint8_t* buffer, const latency_stats_t* stats) {
+    uint32_t average;
+    uint8_t length = 0;
+
+    average = (stats->count > 0 ? (uint32_t) (stats->total / stats->count) : 0);
+
+    length += serial_put_le(&buffer[length], stats->count, 4);
+    length += serial_put_le(&buffer[length], stats->min, 4);
+    length += serial_put_le(&buffer[length], average, 4);
+    length += serial_put_le(&buffer[length], stats->max, 4);
+    for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BINS; i++) {
+        length += serial_put_le(&buffer[length], stats->histogram[i], 2);
+    }
+
+    return length;
+}
+
+#endif /* LATENCY_ENABLED */
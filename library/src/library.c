@@ -29,14 +29,44 @@
 
 /* Function to initialize the library */
 void library_init(void) {
-    // Initialize the queue manager
-    packet_buffer_init();
-
     // Initialize the virtual timer
     virtual_timer_init();
 
+    // Initialize the timer wheel
+    timer_wheel_init();
+
     // Initialize the serial port
     serial_init();
+
+    // Initialize the queue manager, it registers a serial command
+    packet_buffer_init();
+
+    // Initialize the queue of the application, it registers a serial command
+    app_queue_init();
+
+    // Initialize the event recorder
+    recorder_init();
+
+    // Initialize the idle power modes
+    power_init();
+
+    // Initialize the deadline misses of the tasks
+    deadline_init();
+
+#if PROFILER_ENABLED
+    // Initialize the task profiler
+    profiler_init();
+#endif
+
+#if (TRACE_LEVEL > TRACE_LEVEL_NONE)
+    // Initialize the event trace
+    trace_init();
+#endif
+
+#if LATENCY_ENABLED
+    // Initialize the timer and interrupt latency histograms
+    latency_init();
+#endif
 }
 
 /*================================ private ==================================*/
@@ -11,83 +11,229 @@
 
 /*================================ include ==================================*/
 
+#include "config.h"
 #include "packet_buffer.h"
 
+#include "serial.h"
+
 #include "cpu.h"
-#include "leds.h"
 
 /*================================ define ===================================*/
 
+#ifndef PACKET_BUFFER_SHORT_COUNT
+#define PACKET_BUFFER_SHORT_COUNT       ( 16 )
+#endif
+
+#ifndef PACKET_BUFFER_FULL_COUNT
+#define PACKET_BUFFER_FULL_COUNT        ( 8 )
+#endif
+
+#define PACKET_BUFFER_REPORT_SIZE       ( 1 + 8 * PACKET_BUFFER_POOLS )
+
 /*================================ typedef ==================================*/
 
-#define PACKET_BUFFER_SIZE				( 16 )
+typedef struct {
+    packet_buffer_t*  entries;
+    uint8_t*          buffers;
+    packet_buffer_t** free;         ///< Free entries, taken from the top
+    uint8_t  size;                  ///< Bytes of each buffer
+    uint8_t  count;                 ///< Entries of the pool
+    uint8_t  available;             ///< Entries in the free stack
+    uint8_t  high;                  ///< Most entries taken at once
+    uint32_t failures;              ///< Times the pool was found empty
+} packet_buffer_pool_t;
+
+typedef struct {
+    packet_buffer_pool_t pools[PACKET_BUFFER_POOLS];
+
+    packet_buffer_t  short_entries[PACKET_BUFFER_SHORT_COUNT];
+    uint8_t          short_buffers[PACKET_BUFFER_SHORT_COUNT][PACKET_BUFFER_SHORT_SIZE];
+    packet_buffer_t* short_free[PACKET_BUFFER_SHORT_COUNT];
+
+    packet_buffer_t  full_entries[PACKET_BUFFER_FULL_COUNT];
+    uint8_t          full_buffers[PACKET_BUFFER_FULL_COUNT][PACKET_BUFFER_FULL_SIZE];
+    packet_buffer_t* full_free[PACKET_BUFFER_FULL_COUNT];
+
+    // Report in progress
+    bool     reporting;
+    uint8_t  message[PACKET_BUFFER_REPORT_SIZE];
+    uint8_t  length;
+} packet_buffer_vars_t;
 
 /*=============================== variables =================================*/
 
-static packet_buffer_t packet_buffer[PACKET_BUFFER_SIZE];
+static packet_buffer_vars_t packet_buffer_vars;
 
 /*=============================== prototypes ================================*/
 
-static void packet_buffer_reset(packet_buffer_t* queue_entry);
+static void packet_buffer_pool_init(uint8_t index, packet_buffer_t* entries, uint8_t* buffers, packet_buffer_t** stack, uint8_t size, uint8_t count);
+static void packet_buffer_reset(packet_buffer_t* packet_buffer);
+static void packet_buffer_request(void);
+static void packet_buffer_report(void);
 
 /*================================= public ==================================*/
 
 void packet_buffer_init(void) {
-    packet_buffer_t* scratch = NULL;
+    // Initialize the memory of the variables
+    memset(&packet_buffer_vars, 0, sizeof(packet_buffer_vars_t));
 
-    // Initialize the queue entries
-    for (uint32_t i = 0; i < PACKET_BUFFER_SIZE; i++) {
-        scratch = &packet_buffer[i];
-        packet_buffer_reset(scratch);
+    // Initialize the pools, from the smallest buffers to the largest
+    packet_buffer_pool_init(0, packet_buffer_vars.short_entries, &packet_buffer_vars.short_buffers[0][0],
+                            packet_buffer_vars.short_free, PACKET_BUFFER_SHORT_SIZE, PACKET_BUFFER_SHORT_COUNT);
+    packet_buffer_pool_init(1, packet_buffer_vars.full_entries, &packet_buffer_vars.full_buffers[0][0],
+                            packet_buffer_vars.full_free, PACKET_BUFFER_FULL_SIZE, PACKET_BUFFER_FULL_COUNT);
+
+    // Register the serial callback that reports the pools
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_BUFFER, packet_buffer_request, TASK_PRIO_MIN);
+}
+
+void packet_buffer_reset_stats(void) {
+    packet_buffer_pool_t* pool;
+
+    // The high-water marks start again from the entries taken now
+    for (uint8_t i = 0; i < PACKET_BUFFER_POOLS; i++) {
+        pool = &packet_buffer_vars.pools[i];
+        pool->high = pool->count - pool->available;
+        pool->failures = 0;
     }
 }
 
-packet_buffer_t* packet_buffer_get(void) {
-    packet_buffer_t* scratch = NULL;
+packet_buffer_t* packet_buffer_get(uint8_t size) {
+    packet_buffer_pool_t* pool;
+    packet_buffer_t* packet_buffer = NULL;
+    uint8_t taken;
+    bool disabled;
 
     // Disable interrupts
-    cpu_disable_interrupts();
-
-    // Loop through the array to find an empty space
-    for (uint32_t i = 0; i < PACKET_BUFFER_SIZE; i++) {
-        // Updated the queue entry
-        scratch = &packet_buffer[i];
-        if (scratch->status == PACKET_STATUS_FREE) {
-            scratch->status = PACKET_STATUS_TAKEN;
-            break;
+    disabled = cpu_disable_interrupts();
+
+    // Take the top of the smallest pool that fits, or of a larger one if
+    // that one is empty
+    for (uint8_t i = 0; i < PACKET_BUFFER_POOLS && packet_buffer == NULL; i++) {
+        pool = &packet_buffer_vars.pools[i];
+        if (size > pool->size) {
+            continue;
         }
-    }
 
-    // If the queue is full
-    if (scratch == NULL) {
-        leds_error_on();
-        while (true);
+        if (pool->available == 0) {
+            pool->failures++;
+            continue;
+        }
+
+        packet_buffer = pool->free[--pool->available];
+        packet_buffer->refs = 1;
+
+        taken = pool->count - pool->available;
+        if (taken > pool->high) {
+            pool->high = taken;
+        }
     }
 
-    // Enable the interrupts
-    cpu_enable_interrupts();
+    // Restore the interrupts, they stay disabled if the caller had them so
+    cpu_restore_interrupts(disabled);
 
-    // Return the queue entry
-    return scratch;
+    // Return the queue entry, NULL if all the pools that fit are empty
+    return packet_buffer;
+}
+
+packet_buffer_t* packet_buffer_retain(packet_buffer_t* packet_buffer) {
+    packet_buffer_t* retained = NULL;
+    bool disabled;
+
+    if (packet_buffer != NULL) {
+        // Disable interrupts
+        disabled = cpu_disable_interrupts();
+
+        // Add a holder, unless the buffer is free or has all it can count
+        if (packet_buffer->refs > 0 && packet_buffer->refs < UINT8_MAX) {
+            packet_buffer->refs++;
+            retained = packet_buffer;
+        }
+
+        // Restore the interrupts
+        cpu_restore_interrupts(disabled);
+    }
+
+    // Return the queue entry, NULL if it could not be retained
+    return retained;
 }
 
 void packet_buffer_release(packet_buffer_t* packet_buffer) {
+    packet_buffer_pool_t* pool;
+    bool disabled;
+
     if (packet_buffer != NULL) {
         // Disable interrupts
-        cpu_disable_interrupts();
+        disabled = cpu_disable_interrupts();
+
+        // Drop a holder, and when it was the last one reset the queue entry
+        // and put it back on the top of its pool
+        if (packet_buffer->refs > 0 && --packet_buffer->refs == 0) {
+            pool = &packet_buffer_vars.pools[packet_buffer->pool];
+            packet_buffer_reset(packet_buffer);
+            pool->free[pool->available++] = packet_buffer;
+        }
 
-        // Reset the queue entry
-        packet_buffer_reset(packet_buffer);
+        // Restore the interrupts
+        cpu_restore_interrupts(disabled);
+    }
+}
 
-        // Enable interrupts
-        cpu_enable_interrupts();
+bool packet_buffer_slice(packet_buffer_t* packet_buffer, uint8_t offset, uint8_t length, packet_slice_t* slice) {
+    // Check that the slice lies within the frame
+    if (packet_buffer == NULL || slice == NULL ||
+        (uint16_t) offset + length > packet_buffer->length) {
+        return false;
+    }
+
+    // The slice holds the buffer as long as it is not released
+    if (packet_buffer_retain(packet_buffer) == NULL) {
+        return false;
+    }
+
+    slice->packet_buffer = packet_buffer;
+    slice->data   = &packet_buffer->payload[offset];
+    slice->length = length;
+
+    return true;
+}
+
+void packet_slice_release(packet_slice_t* slice) {
+    if (slice != NULL && slice->packet_buffer != NULL) {
+        packet_buffer_release(slice->packet_buffer);
+
+        slice->packet_buffer = NULL;
+        slice->data   = NULL;
+        slice->length = 0;
     }
 }
 
 /*================================ private ==================================*/
 
+static void packet_buffer_pool_init(uint8_t index, packet_buffer_t* entries, uint8_t* buffers, packet_buffer_t** stack, uint8_t size, uint8_t count) {
+    packet_buffer_pool_t* pool = &packet_buffer_vars.pools[index];
+    packet_buffer_t* scratch = NULL;
+
+    pool->entries = entries;
+    pool->buffers = buffers;
+    pool->free    = stack;
+    pool->size    = size;
+    pool->count   = count;
+
+    // Initialize the queue entries, all of them free
+    for (uint8_t i = 0; i < count; i++) {
+        scratch = &entries[i];
+        scratch->pool   = index;
+        scratch->buffer = &buffers[i * size];
+        packet_buffer_reset(scratch);
+
+        stack[count - 1 - i] = scratch;
+    }
+    pool->available = count;
+}
+
 static void packet_buffer_reset(packet_buffer_t* packet_buffer) {
-    packet_buffer->status = PACKET_STATUS_FREE;
+    packet_buffer->refs = 0;
 
     packet_buffer->payload = packet_buffer->buffer;
     packet_buffer->length  = 0;
@@ -95,5 +241,55 @@ static void packet_buffer_reset(packet_buffer_t* packet_buffer) {
     packet_buffer->lqi     = 0;
     packet_buffer->crc     = 0;
 
-    packet_buffer->size    = sizeof(packet_buffer->buffer);
+    packet_buffer->size    = packet_buffer_vars.pools[packet_buffer->pool].size;
+}
+
+static void packet_buffer_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+    packet_buffer_pool_t* pool;
+    uint8_t* message = packet_buffer_vars.message;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A report in progress goes on, otherwise start one
+    if (packet_buffer_vars.reporting) {
+        return;
+    }
+
+    // Take the pools as they are now
+    packet_buffer_vars.length = 0;
+    message[packet_buffer_vars.length++] = PACKET_BUFFER_POOLS;
+    for (uint8_t i = 0; i < PACKET_BUFFER_POOLS; i++) {
+        pool = &packet_buffer_vars.pools[i];
+        message[packet_buffer_vars.length++] = pool->size;
+        message[packet_buffer_vars.length++] = pool->count;
+        message[packet_buffer_vars.length++] = pool->count - pool->available;
+        message[packet_buffer_vars.length++] = pool->high;
+        packet_buffer_vars.length += serial_put_le(&message[packet_buffer_vars.length], pool->failures, 4);
+    }
+
+    // Clear them if requested
+    if (serial_packet.length > 0 && buffer[0] != 0) {
+        packet_buffer_reset_stats();
+    }
+
+    packet_buffer_vars.reporting = true;
+
+    packet_buffer_report();
+}
+
+static void packet_buffer_report(void) {
+    // Try again later if the serial queue is full
+    if (!serial_push_msg_retry(SERIAL_MOTE2PC_BUFFER, packet_buffer_vars.message, packet_buffer_vars.length, packet_buffer_report)) {
+        return;
+    }
+
+    // The report is over
+    packet_buffer_vars.reporting = false;
 }
@@ -0,0 +1,177 @@
+/**
+ * @file       power.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Power mode of the CPU while the scheduler has nothing to run.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "power.h"
+
+#include "serial.h"
+
+#include "bsp_timer.h"
+#include "radio_timer.h"
+
+/*================================ define ===================================*/
+
+#define POWER_REPORT_SIZE               ( 1 + 4 + 4 + 8 * POWER_MODES )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint32_t count;                 ///< Times the mode was entered
+    uint32_t ticks;                 ///< Ticks spent in the mode
+} power_stats_t;
+
+typedef struct {
+    power_stats_t stats[POWER_MODES];
+    uint32_t demoted;               ///< Sleeps kept shallower by the peripherals
+    bsp_timer_width_t anchor;       ///< Start of the statistics
+
+    // Report in progress
+    bool     reporting;
+    uint8_t  message[POWER_REPORT_SIZE];
+    uint8_t  length;
+} power_vars_t;
+
+/*=============================== variables =================================*/
+
+static power_vars_t power_vars;
+
+/*=============================== prototypes ================================*/
+
+static cpu_power_t power_select(void);
+static void power_request(void);
+static void power_report(void);
+
+/*================================= public ==================================*/
+
+void power_init(void) {
+    // Initialize the memory of the variables
+    memset(&power_vars, 0, sizeof(power_vars_t));
+
+    // The statistics start now
+    power_vars.anchor = bsp_timer_get();
+
+    // Register the serial callback that reports the statistics
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_POWER, power_request, TASK_PRIO_MIN);
+}
+
+void power_reset(void) {
+    // Clear the statistics and start them again
+    memset(power_vars.stats, 0, sizeof(power_vars.stats));
+    power_vars.demoted = 0;
+    power_vars.anchor = bsp_timer_get();
+}
+
+void power_idle(void) {
+    bsp_timer_width_t start;
+    cpu_power_t mode;
+
+    // Called with the interrupts disabled, a pending one still wakes up
+    mode = power_select();
+
+    // Wake up early enough to have the clocks running when the timer is due
+    if (mode == CPU_POWER_PM2) {
+        bsp_timer_wakeup(POWER_PM2_WAKEUP_TICKS);
+    } else if (mode == CPU_POWER_PM1) {
+        bsp_timer_wakeup(POWER_PM1_WAKEUP_TICKS);
+    }
+
+    // Sleep and account for the time spent in the mode
+    start = bsp_timer_get();
+    cpu_sleep(mode);
+    power_vars.stats[mode].count++;
+    power_vars.stats[mode].ticks += bsp_timer_get() - start;
+
+    // The radio timer stops in PM1 and PM2, start it again from the sleep timer
+    if (mode != CPU_POWER_PM0) {
+        radio_timer_sync();
+    }
+}
+
+/*================================ private ==================================*/
+
+static cpu_power_t power_select(void) {
+    bsp_timer_width_t compare;
+    cpu_power_t mode = CPU_POWER_PM0;
+    cpu_power_t allowed;
+    int32_t remaining;
+
+    // Without a timer to wake up only the peripherals can, so stay in PM0
+    if (POWER_MODE_MAX == CPU_POWER_PM0 || !bsp_timer_get_compare(&compare)) {
+        return CPU_POWER_PM0;
+    }
+
+    // The deepest mode that can wake up before the timer is due
+    remaining = (int32_t) (compare - bsp_timer_get());
+    if (POWER_MODE_MAX >= CPU_POWER_PM2 && remaining >= POWER_PM2_MIN_TICKS) {
+        mode = CPU_POWER_PM2;
+    } else if (remaining >= POWER_PM1_MIN_TICKS) {
+        mode = CPU_POWER_PM1;
+    }
+
+    // The serial port and the radio may need the clocks
+    allowed = (serial_is_busy() ? CPU_POWER_PM0 : cpu_power_max());
+    if (mode > allowed) {
+        power_vars.demoted++;
+        mode = allowed;
+    }
+
+    return mode;
+}
+
+static void power_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+    uint8_t* message = power_vars.message;
+    bsp_timer_width_t now;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A report in progress goes on, otherwise start one
+    if (power_vars.reporting) {
+        return;
+    }
+
+    // Take the statistics as they are now
+    now = bsp_timer_get();
+    power_vars.length = 0;
+    message[power_vars.length++] = POWER_MODES;
+    power_vars.length += serial_put_le(&message[power_vars.length], now - power_vars.anchor, 4);
+    power_vars.length += serial_put_le(&message[power_vars.length], power_vars.demoted, 4);
+    for (uint8_t i = 0; i < POWER_MODES; i++) {
+        power_vars.length += serial_put_le(&message[power_vars.length], power_vars.stats[i].count, 4);
+        power_vars.length += serial_put_le(&message[power_vars.length], power_vars.stats[i].ticks, 4);
+    }
+
+    // Clear them if requested
+    if (serial_packet.length > 0 && buffer[0] != 0) {
+        power_reset();
+    }
+
+    power_vars.reporting = true;
+
+    power_report();
+}
+
+static void power_report(void) {
+    // Try again later if the serial queue is full
+    if (!serial_push_msg_retry(SERIAL_MOTE2PC_POWER, power_vars.message, power_vars.length, power_report)) {
+        return;
+    }
+
+    // The report is over
+    power_vars.reporting = false;
+}
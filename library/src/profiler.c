@@ -0,0 +1,254 @@
+/**
+ * @file       profiler.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Execution time of the tasks run by the scheduler.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+#include "serial.h"
+
+#include "cpu.h"
+
+/*================================ define ===================================*/
+
+#define PROFILER_TICKS_PER_SECOND       ( 32768 )
+
+// Width of the first bin of the histogram, 1/8 of a tick
+#define PROFILER_BIN_DIVIDER            ( 8 )
+
+#define PROFILER_CALIBRATION_ROUNDS     ( 8 )
+
+#define PROFILER_ENTRY_SIZE             ( 1 + 1 + 4 + 4 + 4 + 4 + 4 + 2 * PROFILER_HISTOGRAM_BINS )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    task_cb_t callback;
+    uint32_t  count;
+    uint32_t  min;
+    uint32_t  max;
+    uint64_t  total;
+    uint16_t  histogram[PROFILER_HISTOGRAM_BINS];
+} profiler_entry_t;
+
+typedef struct {
+    profiler_entry_t entries[PROFILER_MAX_TASKS];
+    uint8_t  used;                  ///< Entries that hold a callback
+    uint32_t untracked;             ///< Tasks that found the table full
+
+    uint32_t frequency;             ///< Cycles per second
+    uint32_t overhead;              ///< Cycles of reading the counter twice
+    uint32_t bin_width;             ///< Cycles in the first bin
+
+    // Dump in progress
+    bool     dumping;
+    bool     dump_reset;
+    uint8_t  dump_entries;          ///< Entries announced in the header
+    int16_t  dump_next;             ///< Next entry, -1 for the header
+    uint8_t  message[PROFILER_ENTRY_SIZE];
+} profiler_vars_t;
+
+/*=============================== variables =================================*/
+
+static profiler_vars_t profiler_vars;
+
+/*=============================== prototypes ================================*/
+
+static profiler_entry_t* profiler_find(task_cb_t callback);
+static uint8_t profiler_bin(uint32_t cycles);
+static void profiler_request(void);
+static void profiler_dump(void);
+
+/*================================= public ==================================*/
+
+void profiler_init(void) {
+    uint32_t start, cycles;
+
+    // Initialize the memory of the variables
+    memset(&profiler_vars, 0, sizeof(profiler_vars_t));
+
+    // Scale the histogram to the counter of the platform
+    profiler_vars.frequency = cpu_cycles_frequency();
+    profiler_vars.bin_width = profiler_vars.frequency / (PROFILER_TICKS_PER_SECOND * PROFILER_BIN_DIVIDER);
+    if (profiler_vars.bin_width == 0) {
+        profiler_vars.bin_width = 1;
+    }
+
+    // Measure the cost of timing an empty task, which is not accounted
+    profiler_vars.overhead = UINT32_MAX;
+    for (uint8_t i = 0; i < PROFILER_CALIBRATION_ROUNDS; i++) {
+        start = cpu_cycles_get();
+        cycles = cpu_cycles_get() - start;
+        if (cycles < profiler_vars.overhead) {
+            profiler_vars.overhead = cycles;
+        }
+    }
+
+    // Register the serial callback that dumps the tables
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_PROFILE, profiler_request, TASK_PRIO_MIN);
+}
+
+void profiler_reset(void) {
+    // Clear the tables but keep the calibration
+    memset(profiler_vars.entries, 0, sizeof(profiler_vars.entries));
+    profiler_vars.used = 0;
+    profiler_vars.untracked = 0;
+}
+
+uint32_t profiler_start(void) {
+    return cpu_cycles_get();
+}
+
+void profiler_stop(task_cb_t callback, uint32_t start) {
+    profiler_entry_t* entry;
+    uint32_t cycles;
+    uint8_t bin;
+
+    // The counter wraps around, the difference does not
+    cycles = cpu_cycles_get() - start;
+    cycles = (cycles > profiler_vars.overhead ? cycles - profiler_vars.overhead : 0);
+
+    entry = profiler_find(callback);
+    if (entry == NULL) {
+        profiler_vars.untracked++;
+        return;
+    }
+
+    // Update the statistics of the callback
+    if (entry->count == 0 || cycles < entry->min) {
+        entry->min = cycles;
+    }
+    if (cycles > entry->max) {
+        entry->max = cycles;
+    }
+    entry->count++;
+    entry->total += cycles;
+
+    bin = profiler_bin(cycles);
+    if (entry->histogram[bin] < UINT16_MAX) {
+        entry->histogram[bin]++;
+    }
+}
+
+/*================================ private ==================================*/
+
+static profiler_entry_t* profiler_find(task_cb_t callback) {
+    profiler_entry_t* entry;
+
+    // Look for the callback among the ones seen so far
+    for (uint8_t i = 0; i < profiler_vars.used; i++) {
+        entry = &profiler_vars.entries[i];
+        if (entry->callback == callback) {
+            return entry;
+        }
+    }
+
+    // Otherwise take a new entry, if there is one
+    if (profiler_vars.used == PROFILER_MAX_TASKS) {
+        return NULL;
+    }
+
+    entry = &profiler_vars.entries[profiler_vars.used++];
+    entry->callback = callback;
+
+    return entry;
+}
+
+static uint8_t profiler_bin(uint32_t cycles) {
+    uint32_t units;
+    uint8_t bin = 0;
+
+    // Bin i holds durations below 2^i units of 1/8 of a tick
+    units = cycles / profiler_vars.bin_width;
+    while (units > 0 && bin < PROFILER_HISTOGRAM_BINS - 1) {
+        units >>= 1;
+        bin++;
+    }
+
+    return bin;
+}
+
+static void profiler_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A dump in progress goes on, otherwise start one
+    if (profiler_vars.dumping) {
+        return;
+    }
+
+    profiler_vars.dumping = true;
+    profiler_vars.dump_reset = (serial_packet.length > 0 && buffer[0] != 0);
+    profiler_vars.dump_entries = profiler_vars.used;
+    profiler_vars.dump_next = -1;
+
+    profiler_dump();
+}
+
+static void profiler_dump(void) {
+    profiler_entry_t* entry;
+    uint8_t* message = profiler_vars.message;
+    uint32_t average;
+    uint8_t length;
+
+    while (profiler_vars.dump_next < profiler_vars.dump_entries) {
+        length = 0;
+
+        if (profiler_vars.dump_next < 0) {
+            // The header tells how to read the entries
+            message[length++] = PROFILER_MSG_HEADER;
+            length += serial_put_le(&message[length], profiler_vars.frequency, 4);
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) profiler_init, 4);
+            message[length++] = profiler_vars.dump_entries;
+            length += serial_put_le(&message[length], profiler_vars.untracked, 4);
+            message[length++] = PROFILER_HISTOGRAM_BINS;
+        } else {
+            // One entry per message
+            entry = &profiler_vars.entries[profiler_vars.dump_next];
+            average = (entry->count > 0 ? (uint32_t) (entry->total / entry->count) : 0);
+
+            message[length++] = PROFILER_MSG_ENTRY;
+            message[length++] = (uint8_t) profiler_vars.dump_next;
+            length += serial_put_le(&message[length], (uint32_t) (uintptr_t) entry->callback, 4);
+            length += serial_put_le(&message[length], entry->count, 4);
+            length += serial_put_le(&message[length], entry->min, 4);
+            length += serial_put_le(&message[length], average, 4);
+            length += serial_put_le(&message[length], entry->max, 4);
+            for (uint8_t i = 0; i < PROFILER_HISTOGRAM_BINS; i++) {
+                length += serial_put_le(&message[length], entry->histogram[i], 2);
+            }
+        }
+
+        // Try again later if the serial queue is full
+        if (!serial_push_msg_retry(SERIAL_MOTE2PC_PROFILE, message, length, profiler_dump)) {
+            return;
+        }
+
+        profiler_vars.dump_next++;
+    }
+
+    // The dump is over
+    if (profiler_vars.dump_reset) {
+        profiler_reset();
+    }
+    profiler_vars.dumping = false;
+}
+
+#endif /* PROFILER_ENABLED */
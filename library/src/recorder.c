@@ -0,0 +1,311 @@
+/**
+ * @file       recorder.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Compact log of the radio and timer events that feed the MAC.
+ *
+ *             The records are written from the interrupts into a circular
+ *             buffer and a low priority task sends them to the computer.
+ *             When the buffer is full the records are dropped and counted,
+ *             the count goes out in a LOST record once there is room again.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "recorder.h"
+#include "serial.h"
+
+#include "bsp_timer.h"
+#include "cpu.h"
+
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+// Size of the circular buffer (power of two)
+#define RECORDER_BUFFER_SIZE            ( 512 )
+#define RECORDER_BUFFER_MASK            ( RECORDER_BUFFER_SIZE - 1 )
+
+// Records per serial message, small enough to fit the serial buffer even
+// if every byte needs to be escaped
+#define RECORDER_CHUNK_SIZE             ( 56 )
+
+#define RECORDER_DELTA_MAX              ( 0xFFFF )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    bool active;
+    bool flush_pending;
+    bool flush_all;
+
+    bsp_timer_width_t last;         ///< Time of the last record
+    uint16_t lost;                  ///< Records dropped since the last one
+
+    volatile uint16_t head;         ///< Written by the interrupts
+    volatile uint16_t tail;         ///< Read by the flush task
+    uint8_t buffer[RECORDER_BUFFER_SIZE];
+
+    uint8_t chunk[RECORDER_CHUNK_SIZE];
+} recorder_vars_t;
+
+/*=============================== variables =================================*/
+
+static recorder_vars_t recorder_vars;
+
+/*=============================== prototypes ================================*/
+
+static void recorder_push(recorder_type_t type, const uint8_t* body, uint8_t length);
+static uint8_t recorder_header(uint8_t* record, recorder_type_t type, uint32_t delta);
+static uint8_t recorder_ticks(uint8_t* record, bsp_timer_width_t ticks);
+static uint8_t recorder_size(uint16_t position);
+static void recorder_flush(void);
+
+/*================================= public ==================================*/
+
+void recorder_init(void) {
+    // Initialize the memory of the variables
+    memset(&recorder_vars, 0, sizeof(recorder_vars_t));
+}
+
+void recorder_start(uint8_t mac_type, uint8_t mac_slots) {
+    uint8_t record[1 + 4 + 2];
+    bsp_timer_width_t now;
+    uint8_t size = 0;
+
+    cpu_disable_interrupts();
+
+    // Drop whatever was left from a previous recording
+    recorder_vars.head = 0;
+    recorder_vars.tail = 0;
+    recorder_vars.lost = 0;
+
+    // Write the BEGIN record with the absolute time
+    now = bsp_timer_get();
+    size += recorder_header(&record[size], RECORDER_BEGIN, 0);
+    size += recorder_ticks(&record[size], now);
+    record[size++] = mac_type;
+    record[size++] = mac_slots;
+    memcpy(recorder_vars.buffer, record, size);
+    recorder_vars.head = size;
+    recorder_vars.last = now;
+
+    recorder_vars.active = true;
+
+    cpu_enable_interrupts();
+
+    // Send the BEGIN record right away, the computer aligns on it
+    recorder_vars.flush_all = true;
+    if (!recorder_vars.flush_pending) {
+        recorder_vars.flush_pending = true;
+        scheduler_push(recorder_flush, TASK_PRIO_MIN);
+    }
+}
+
+void recorder_stop(void) {
+    // Stop recording and send what is left
+    recorder_vars.active = false;
+    recorder_vars.flush_all = true;
+    recorder_flush();
+}
+
+void recorder_sfd(void) {
+    recorder_push(RECORDER_SFD, NULL, 0);
+}
+
+void recorder_rx_done(void) {
+    recorder_push(RECORDER_RX_DONE, NULL, 0);
+}
+
+void recorder_packet(const packet_buffer_t* packet_buffer) {
+    uint8_t body[3 + RECORDER_PACKET_PREFIX];
+    uint8_t length;
+
+    // Keep the start of the payload, where the MAC headers are
+    length = (packet_buffer->length > RECORDER_PACKET_PREFIX ? RECORDER_PACKET_PREFIX : packet_buffer->length);
+
+    body[0] = packet_buffer->length;
+    body[1] = (uint8_t) packet_buffer->rssi;
+    body[2] = (packet_buffer->crc ? 0x80 : 0x00) | (packet_buffer->lqi & 0x7F);
+    memcpy(&body[3], packet_buffer->payload, length);
+
+    recorder_push(RECORDER_PACKET, body, 3 + length);
+}
+
+void recorder_rssi(int8_t rssi) {
+    uint8_t body = (uint8_t) rssi;
+
+    recorder_push(RECORDER_RSSI, &body, 1);
+}
+
+void recorder_timer(uint8_t id) {
+    recorder_push(RECORDER_TIMER, &id, 1);
+}
+
+/*================================ private ==================================*/
+
+static void recorder_push(recorder_type_t type, const uint8_t* body, uint8_t length) {
+    uint8_t record[2 * (1 + 2 + 4) + RECORDER_RECORD_MAX];
+    bsp_timer_width_t now;
+    uint32_t delta;
+    uint16_t used;
+    uint8_t size = 0;
+    bool disabled;
+
+    if (!recorder_vars.active) {
+        return;
+    }
+
+    // Interrupts append records too, keep the mask of the caller
+    disabled = cpu_disable_interrupts();
+
+    now = bsp_timer_get();
+    delta = now - recorder_vars.last;
+
+    // Records too far apart from the last one carry the absolute time
+    if (delta > RECORDER_DELTA_MAX) {
+        size += recorder_header(&record[size], RECORDER_TIME, 0);
+        size += recorder_ticks(&record[size], now);
+        delta = 0;
+    }
+
+    // Tell how many records were dropped before this one
+    if (recorder_vars.lost > 0) {
+        size += recorder_header(&record[size], RECORDER_LOST, delta);
+        record[size++] = (recorder_vars.lost >> 0) & 0xFF;
+        record[size++] = (recorder_vars.lost >> 8) & 0xFF;
+        delta = 0;
+    }
+
+    // Append the record itself
+    size += recorder_header(&record[size], type, delta);
+    if (length > 0) {
+        memcpy(&record[size], body, length);
+        size += length;
+    }
+
+    used = recorder_vars.head - recorder_vars.tail;
+
+    if (RECORDER_BUFFER_SIZE - used < size) {
+        // Drop the record if the buffer is full
+        if (recorder_vars.lost < UINT16_MAX) {
+            recorder_vars.lost += 1;
+        }
+    } else {
+        // Copy the record to the buffer
+        for (uint8_t i = 0; i < size; i++) {
+            recorder_vars.buffer[(recorder_vars.head + i) & RECORDER_BUFFER_MASK] = record[i];
+        }
+        recorder_vars.head += size;
+        recorder_vars.last = now;
+        recorder_vars.lost = 0;
+
+        // Push a task to send the records once there are enough of them
+        if (!recorder_vars.flush_pending && used + size >= RECORDER_CHUNK_SIZE) {
+            recorder_vars.flush_pending = true;
+            scheduler_push(recorder_flush, TASK_PRIO_MIN);
+        }
+    }
+
+    cpu_restore_interrupts(disabled);
+}
+
+static uint8_t recorder_header(uint8_t* record, recorder_type_t type, uint32_t delta) {
+    // Short deltas fit in the first byte
+    if (delta < RECORDER_DELTA_LONG) {
+        record[0] = (type << RECORDER_TYPE_SHIFT) | delta;
+        return 1;
+    }
+
+    record[0] = (type << RECORDER_TYPE_SHIFT) | RECORDER_DELTA_LONG;
+    record[1] = (delta >> 0) & 0xFF;
+    record[2] = (delta >> 8) & 0xFF;
+    return 3;
+}
+
+static uint8_t recorder_ticks(uint8_t* record, bsp_timer_width_t ticks) {
+    record[0] = (ticks >>  0) & 0xFF;
+    record[1] = (ticks >>  8) & 0xFF;
+    record[2] = (ticks >> 16) & 0xFF;
+    record[3] = (ticks >> 24) & 0xFF;
+    return 4;
+}
+
+static uint8_t recorder_size(uint16_t position) {
+    uint8_t header, length, size = 1;
+
+    header = recorder_vars.buffer[position & RECORDER_BUFFER_MASK];
+    if ((header & RECORDER_DELTA_MASK) == RECORDER_DELTA_LONG) {
+        size += 2;
+    }
+
+    switch (header >> RECORDER_TYPE_SHIFT) {
+        case RECORDER_BEGIN:
+            size += 4 + 2;
+            break;
+        case RECORDER_TIME:
+            size += 4;
+            break;
+        case RECORDER_PACKET:
+            length = recorder_vars.buffer[(position + size) & RECORDER_BUFFER_MASK];
+            size += 3 + (length > RECORDER_PACKET_PREFIX ? RECORDER_PACKET_PREFIX : length);
+            break;
+        case RECORDER_RSSI:
+        case RECORDER_TIMER:
+            size += 1;
+            break;
+        case RECORDER_LOST:
+            size += 2;
+            break;
+        default:
+            break;
+    }
+
+    return size;
+}
+
+static void recorder_flush(void) {
+    uint16_t head, tail;
+    uint8_t length, size;
+
+    recorder_vars.flush_pending = false;
+
+    while (true) {
+        head = recorder_vars.head;
+        tail = recorder_vars.tail;
+
+        // Wait for a full message unless everything has to go out
+        if (head == tail ||
+            (!recorder_vars.flush_all && (uint16_t) (head - tail) < RECORDER_CHUNK_SIZE)) {
+            break;
+        }
+
+        // Take as many whole records as fit in a message
+        length = 0;
+        while (tail != head) {
+            size = recorder_size(tail);
+            if (length + size > RECORDER_CHUNK_SIZE) {
+                break;
+            }
+            for (uint8_t i = 0; i < size; i++) {
+                recorder_vars.chunk[length + i] = recorder_vars.buffer[(tail + i) & RECORDER_BUFFER_MASK];
+            }
+            length += size;
+            tail += size;
+        }
+
+        // Keep the records if the serial queue is full, they are sent with the next ones
+        if (!serial_push_msg(SERIAL_MOTE2PC_RECORD, recorder_vars.chunk, length)) {
+            break;
+        }
+        recorder_vars.tail = tail;
+    }
+
+    if (recorder_vars.head == recorder_vars.tail) {
+        recorder_vars.flush_all = false;
+    }
+}
@@ -22,12 +22,19 @@
 #include "hdlc.h"
 
 #include "scheduler.h"
+#include "virtual_timer.h"
 
 /*================================ define ===================================*/
 
 #define SERIAL_TX_BUFFER_SIZE       ( 128 )
 #define SERIAL_RX_BUFFER_SIZE		( 128 )
 
+// Number of messages waiting to be transmitted (power of two)
+#define SERIAL_TX_QUEUE_SIZE        ( 4 )
+
+// Ticks to wait for room in the transmit queue before trying again
+#define SERIAL_RETRY_TICKS          ( 33 )
+
 /*================================ typedef ==================================*/
 
 typedef enum {
@@ -43,6 +50,13 @@ typedef struct {
     task_prio_t task_prio;
 } serial_task_t;
 
+typedef struct {
+    uint8_t command;
+    uint8_t length;
+    uint8_t data[SERIAL_TX_BUFFER_SIZE];
+    packet_slice_t slice;           ///< Sent instead of the data if it holds a buffer
+} serial_msg_t;
+
 typedef struct {
     // General
     serial_status_t status;
@@ -53,6 +67,13 @@ typedef struct {
     // PC2MOTE tasks
     serial_task_t serial_task_pc2mote_start;
     serial_task_t serial_task_pc2mote_stop;
+    serial_task_t serial_task_pc2mote_latency;
+    serial_task_t serial_task_pc2mote_deadline;
+    serial_task_t serial_task_pc2mote_profile;
+    serial_task_t serial_task_pc2mote_trace;
+    serial_task_t serial_task_pc2mote_power;
+    serial_task_t serial_task_pc2mote_buffer;
+    serial_task_t serial_task_pc2mote_queue;
 
     // MOTE2PC tasks
     serial_task_t serial_task_mote2pc_data;
@@ -62,20 +83,20 @@ typedef struct {
     uint8_t* rx_data_ptr;
     uint8_t  rx_data_len;
 
-    // Transmit
-    uint8_t  tx_command;
-    uint8_t* tx_data_ptr;
-    uint8_t  tx_data_len;
+    // Transmit queue, filled by the tasks and emptied by the UART
+    serial_msg_t tx_queue[SERIAL_TX_QUEUE_SIZE];
+    volatile uint8_t tx_queue_head;
+    volatile uint8_t tx_queue_tail;
 
     // Receive buffer
     uint8_t  rx_buffer[HDLC_HEADER_SIZE + SERIAL_RX_BUFFER_SIZE + HDLC_FOOTER_SIZE];
     uint8_t* rx_buffer_ptr;
     uint8_t  rx_buffer_len;
 
-    // Transmit buffer
-    uint8_t  tx_buffer[HDLC_HEADER_SIZE + SERIAL_RX_BUFFER_SIZE + HDLC_FOOTER_SIZE];
+    // Transmit buffer, room for a message with every byte escaped
+    uint8_t  tx_buffer[HDLC_FRAME_SIZE_MAX(SERIAL_TX_BUFFER_SIZE)];
     uint8_t* tx_buffer_ptr;
-    uint8_t  tx_buffer_len;
+    uint16_t tx_buffer_len;
 } serial_vars_t;
 
 /*=============================== variables =================================*/
@@ -85,6 +106,7 @@ static serial_vars_t serial_vars;
 /*=============================== prototypes ================================*/
 
 static void serial_tx_init(void);
+static void serial_tx_start(void);
 static void serial_tx_byte(void);
 static void serial_tx_done(void);
 
@@ -125,6 +147,34 @@ void serial_register_pc2mote_cb(serial_pc2mote_t serial_pc2mote, serial_cb_t ser
             serial_vars.serial_task_pc2mote_stop.serial_cb = serial_cb;
             serial_vars.serial_task_pc2mote_stop.task_prio = task_prio;
             break;
+        case SERIAL_PC2MOTE_LATENCY:
+            serial_vars.serial_task_pc2mote_latency.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_latency.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_DEADLINE:
+            serial_vars.serial_task_pc2mote_deadline.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_deadline.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_PROFILE:
+            serial_vars.serial_task_pc2mote_profile.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_profile.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_TRACE:
+            serial_vars.serial_task_pc2mote_trace.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_trace.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_POWER:
+            serial_vars.serial_task_pc2mote_power.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_power.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_BUFFER:
+            serial_vars.serial_task_pc2mote_buffer.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_buffer.task_prio = task_prio;
+            break;
+        case SERIAL_PC2MOTE_QUEUE:
+            serial_vars.serial_task_pc2mote_queue.serial_cb = serial_cb;
+            serial_vars.serial_task_pc2mote_queue.task_prio = task_prio;
+            break;
         default:
             break;
     }
@@ -154,16 +204,72 @@ void serial_reset(void) {
     uart_deinit();
 }
 
-void serial_push_msg(uint8_t command, uint8_t* data, uint8_t size) {
+bool serial_push_msg(uint8_t command, uint8_t* data, uint8_t size) {
+    serial_msg_t* msg;
+
+    // Check that there is room in the transmit queue
+    if ((uint8_t) (serial_vars.tx_queue_tail - serial_vars.tx_queue_head) >= SERIAL_TX_QUEUE_SIZE) {
+        return false;
+    }
+
+    // Store the HDLC command
+    msg = &serial_vars.tx_queue[serial_vars.tx_queue_tail % SERIAL_TX_QUEUE_SIZE];
+    msg->command = command;
+
+    // Copy the data and check buffer overflow
+    msg->length = (size > SERIAL_TX_BUFFER_SIZE ? SERIAL_TX_BUFFER_SIZE : size);
+    if (data != NULL) {
+        memcpy(msg->data, data, msg->length);
+    }
+    serial_vars.tx_queue_tail += 1;
+
+    // Push a task to the scheduler to init the transmission, otherwise the
+    // message goes out when the current one is done
+    if (serial_vars.status != SERIAL_STATUS_TX) {
+        scheduler_push(serial_tx_init, TASK_PRIO_MIN);
+    }
+
+    return true;
+}
+
+bool serial_push_msg_retry(uint8_t command, uint8_t* data, uint8_t size, task_cb_t retry_cb) {
+    // Call back later to try again if the transmit queue is full
+    if (!serial_push_msg(command, data, size)) {
+        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, SERIAL_RETRY_TICKS, retry_cb, TASK_PRIO_MIN);
+        return false;
+    }
+
+    return true;
+}
+
+bool serial_push_slice(uint8_t command, packet_buffer_t* packet_buffer, uint8_t offset, uint8_t size) {
+    serial_msg_t* msg;
+
+    // Check that there is room in the transmit queue
+    if ((uint8_t) (serial_vars.tx_queue_tail - serial_vars.tx_queue_head) >= SERIAL_TX_QUEUE_SIZE) {
+        return false;
+    }
+
     // Store the HDLC command
-    serial_vars.tx_command = command;
+    msg = &serial_vars.tx_queue[serial_vars.tx_queue_tail % SERIAL_TX_QUEUE_SIZE];
+    msg->command = command;
+
+    // Hold the bytes in the packet buffer instead of copying them, they are
+    // read when the message is encoded
+    size = (size > SERIAL_TX_BUFFER_SIZE ? SERIAL_TX_BUFFER_SIZE : size);
+    if (!packet_buffer_slice(packet_buffer, offset, size, &msg->slice)) {
+        return false;
+    }
+    msg->length = 0;
+    serial_vars.tx_queue_tail += 1;
 
-    // Store the variables and check buffer overflow
-    serial_vars.tx_data_ptr = data;
-    serial_vars.tx_data_len = (size > SERIAL_TX_BUFFER_SIZE ? SERIAL_TX_BUFFER_SIZE : size);
+    // Push a task to the scheduler to init the transmission, otherwise the
+    // message goes out when the current one is done
+    if (serial_vars.status != SERIAL_STATUS_TX) {
+        scheduler_push(serial_tx_init, TASK_PRIO_MIN);
+    }
 
-    // Push a task to the scheduler to init the transmission
-    scheduler_push(serial_tx_init, TASK_PRIO_MIN);
+    return true;
 }
 
 void serial_parse_msg(serial_packet_t* serial_packet) {
@@ -194,12 +300,21 @@ void serial_parse_msg(serial_packet_t* serial_packet) {
     serial_vars.status = SERIAL_STATUS_READY;
 }
 
+uint8_t serial_put_le(uint8_t* buffer, uint32_t value, uint8_t size) {
+    // Least significant byte first
+    for (uint8_t i = 0; i < size; i++) {
+        buffer[i] = (value >> (8 * i)) & 0xFF;
+    }
+
+    return size;
+}
+
 /*================================ private ==================================*/
 
 static void serial_rx_init(void) {
     // Initialize the receive pointer and size
     serial_vars.rx_buffer_ptr = serial_vars.rx_buffer;
-    serial_vars.rx_buffer_len = 1;
+    serial_vars.rx_buffer_len = 0;
 
     // Initialize the HDLC frame
     hdlc_open_rx(serial_vars.rx_buffer_ptr, &serial_vars.rx_buffer_len);
@@ -254,6 +369,34 @@ static void serial_rx_done(void) {
                     serial_cb = serial_vars.serial_task_pc2mote_stop.serial_cb;
                     task_prio = serial_vars.serial_task_pc2mote_stop.task_prio;
                     break;
+                case SERIAL_PC2MOTE_LATENCY:
+                    serial_cb = serial_vars.serial_task_pc2mote_latency.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_latency.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_DEADLINE:
+                    serial_cb = serial_vars.serial_task_pc2mote_deadline.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_deadline.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_PROFILE:
+                    serial_cb = serial_vars.serial_task_pc2mote_profile.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_profile.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_TRACE:
+                    serial_cb = serial_vars.serial_task_pc2mote_trace.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_trace.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_POWER:
+                    serial_cb = serial_vars.serial_task_pc2mote_power.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_power.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_BUFFER:
+                    serial_cb = serial_vars.serial_task_pc2mote_buffer.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_buffer.task_prio;
+                    break;
+                case SERIAL_PC2MOTE_QUEUE:
+                    serial_cb = serial_vars.serial_task_pc2mote_queue.serial_cb;
+                    task_prio = serial_vars.serial_task_pc2mote_queue.task_prio;
+                    break;
                 default:
                     while (true);
                     break;
@@ -271,11 +414,26 @@ static void serial_rx_done(void) {
 }
 
 static void serial_tx_init(void) {
+    // Check that nothing is being transmitted and a message is waiting
+    if (serial_vars.status == SERIAL_STATUS_TX ||
+        serial_vars.tx_queue_head == serial_vars.tx_queue_tail) {
+        return;
+    }
+
+    serial_tx_start();
+}
+
+static void serial_tx_start(void) {
+    serial_msg_t* msg;
     uint16_t node_address;
+    uint8_t i;
 
     // Disable UART interrupts
     uart_disable_interrupts();
 
+    // Take the first message from the queue
+    msg = &serial_vars.tx_queue[serial_vars.tx_queue_head % SERIAL_TX_QUEUE_SIZE];
+
     // Initialize the transmit pointer and size
     serial_vars.tx_buffer_ptr = serial_vars.tx_buffer;
     serial_vars.tx_buffer_len = 0;
@@ -284,21 +442,31 @@ static void serial_tx_init(void) {
     hdlc_open_tx(serial_vars.tx_buffer_ptr, &serial_vars.tx_buffer_len);
 
     // Copy the command
-    hdlc_put_tx(serial_vars.tx_command);
+    hdlc_put_tx(msg->command);
 
     // Copy the node address
     node_address = serial_vars.eui16;
     hdlc_put_tx((node_address >> 8) & 0xFF);
     hdlc_put_tx((node_address >> 0) & 0xFF);
 
-    // Copy the payload data
-    while (serial_vars.tx_data_len--) {
-        hdlc_put_tx(*serial_vars.tx_data_ptr++);
+    // Copy the payload data, from the packet buffer if the message holds one
+    if (msg->slice.packet_buffer != NULL) {
+        for (i = 0; i < msg->slice.length; i++) {
+            hdlc_put_tx(msg->slice.data[i]);
+        }
+        packet_slice_release(&msg->slice);
+    } else {
+        for (i = 0; i < msg->length; i++) {
+            hdlc_put_tx(msg->data[i]);
+        }
     }
 
     // Finalize the HDLC frame
     hdlc_close_tx();
 
+    // Release the queue entry
+    serial_vars.tx_queue_head += 1;
+
     // Enable UART interrupts
     uart_enable_interrupts();
 
@@ -320,6 +488,12 @@ static void serial_tx_byte(void) {
 }
 
 static void serial_tx_done(void) {
+    // If more messages are waiting, transmit the next one right away
+    if (serial_vars.tx_queue_head != serial_vars.tx_queue_tail) {
+        serial_tx_start();
+        return;
+    }
+
     // Change to idle status
     serial_vars.status = SERIAL_STATUS_READY;
 }
@@ -0,0 +1,378 @@
+/**
+ * @file       timer_wheel.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Hierarchical timing wheel for large numbers of timers.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "timer_wheel.h"
+#include "virtual_timer.h"
+
+#include "bsp_timer.h"
+
+/*================================ define ===================================*/
+
+// The ticks of the wheel wrap around with the sleep timer
+#define TIMER_WHEEL_TICK_MASK           ( 0xFFFFFFFF >> TIMER_WHEEL_TICK_SHIFT )
+#define TIMER_WHEEL_SLOT_MASK           ( TIMER_WHEEL_SLOTS - 1 )
+
+// Ticks of the wheel that each level covers
+#define TIMER_WHEEL_RANGE(level)        ( (uint32_t) 1 << (TIMER_WHEEL_SLOT_BITS * ((level) + 1)) )
+
+// Timers moving down a level wait in a list after the slots
+#define TIMER_WHEEL_SLOT_PENDING        ( TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS )
+#define TIMER_WHEEL_SLOT_NONE           ( 0xFFFF )
+
+// Ticks of the sleep timer before its expiry that the virtual timer can
+// still be stopped, it may fire up to BSP_TIMER_MINIMUM_TICKS early
+#define TIMER_WHEEL_STOP_MARGIN         ( 2 * BSP_TIMER_MINIMUM_TICKS )
+
+#define TIMER_WHEEL_PRIORITY            ( TASK_PRIO_MED )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    timer_wheel_timer_t* slots[TIMER_WHEEL_SLOT_PENDING + 1];
+    uint64_t occupied[TIMER_WHEEL_LEVELS];  ///< Slots of each level that hold timers
+    uint32_t running;
+
+    uint32_t current;               ///< Next tick of the wheel to handle
+    bool     handling;              ///< The current tick is handled in several runs
+
+    // Virtual timer that wakes the wheel up
+    virtual_timer_id_t vtimer_id;
+    bool     armed;
+    uint32_t armed_tick;            ///< Tick of the wheel it expires at
+} timer_wheel_vars_t;
+
+/*=============================== variables =================================*/
+
+static timer_wheel_vars_t timer_wheel_vars;
+
+/*=============================== prototypes ================================*/
+
+static void timer_wheel_advance(void);
+static void timer_wheel_schedule(void);
+static bool timer_wheel_next(uint32_t* tick);
+
+static void timer_wheel_insert(timer_wheel_timer_t* timer);
+static void timer_wheel_link(timer_wheel_timer_t* timer, uint16_t slot);
+static void timer_wheel_unlink(timer_wheel_timer_t* timer);
+
+static uint32_t timer_wheel_now(void);
+static bool timer_wheel_after(uint32_t a, uint32_t b);
+static uint8_t timer_wheel_first(uint64_t occupied, uint8_t from);
+
+/*================================= public ==================================*/
+
+void timer_wheel_init(void) {
+    // Initialize the memory of the variables
+    memset(&timer_wheel_vars, 0, sizeof(timer_wheel_vars_t));
+
+    // The wheel starts at the current tick
+    timer_wheel_vars.current = timer_wheel_now();
+}
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, task_t* task) {
+    memset(timer, 0, sizeof(timer_wheel_timer_t));
+    timer->task = task;
+    timer->slot = TIMER_WHEEL_SLOT_NONE;
+}
+
+void timer_wheel_start(timer_wheel_timer_t* timer, bsp_timer_width_t ticks) {
+    timer_wheel_start_at(timer, bsp_timer_get() + ticks);
+}
+
+void timer_wheel_start_at(timer_wheel_timer_t* timer, bsp_timer_width_t expiry) {
+    uint32_t tick;
+
+    // A running timer starts again
+    timer_wheel_stop(timer);
+
+    // An empty wheel catches up with the sleep timer
+    if (timer_wheel_vars.running == 0 && !timer_wheel_vars.handling) {
+        timer_wheel_vars.current = timer_wheel_now();
+    }
+
+    // Round the expiry up to a tick of the wheel, so that it is never early,
+    // and expire right away the ones that already passed
+    tick = (expiry + (1 << TIMER_WHEEL_TICK_SHIFT) - 1) >> TIMER_WHEEL_TICK_SHIFT;
+    if (timer_wheel_after(timer_wheel_vars.current, tick)) {
+        tick = timer_wheel_vars.current;
+    }
+
+    timer->expiry = tick;
+    timer_wheel_insert(timer);
+    timer_wheel_vars.running++;
+
+    // Wake up earlier if it is the first timer to handle
+    timer_wheel_schedule();
+}
+
+void timer_wheel_stop(timer_wheel_timer_t* timer) {
+    // A timer that expired or was stopped is left alone, the wheel may wake
+    // up for nothing but it does not have to look for its next timer
+    if (timer->slot != TIMER_WHEEL_SLOT_NONE) {
+        timer_wheel_unlink(timer);
+        timer_wheel_vars.running--;
+    }
+}
+
+bool timer_wheel_is_running(const timer_wheel_timer_t* timer) {
+    return (timer->slot != TIMER_WHEEL_SLOT_NONE);
+}
+
+uint32_t timer_wheel_get_running(void) {
+    return timer_wheel_vars.running;
+}
+
+/*================================ private ==================================*/
+
+static void timer_wheel_advance(void) {
+    timer_wheel_timer_t* timer;
+    uint32_t now = timer_wheel_now();
+    uint32_t next;
+    uint16_t handled = 0;
+    uint16_t slot;
+    uint8_t level;
+
+    // The virtual timer expired, or the wheel pushed itself
+    timer_wheel_vars.armed = false;
+
+    while (true) {
+        if (!timer_wheel_vars.handling) {
+            // Jump to the next tick with timers, if it is already due
+            if (!timer_wheel_next(&next)) {
+                timer_wheel_vars.current = now;
+                break;
+            }
+            if (timer_wheel_after(next, now)) {
+                break;
+            }
+            timer_wheel_vars.current = next;
+            timer_wheel_vars.handling = true;
+
+            // Take the timers of the slots of the higher levels that start
+            // at this tick, from the top one down
+            for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+                if ((timer_wheel_vars.current & (TIMER_WHEEL_RANGE(level - 1) - 1)) != 0) {
+                    continue;
+                }
+
+                slot = level * TIMER_WHEEL_SLOTS +
+                       ((timer_wheel_vars.current >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK);
+                while ((timer = timer_wheel_vars.slots[slot]) != NULL) {
+                    timer_wheel_unlink(timer);
+                    timer_wheel_link(timer, TIMER_WHEEL_SLOT_PENDING);
+                }
+            }
+        }
+
+        // Move them down to the level that reaches their expiry
+        while ((timer = timer_wheel_vars.slots[TIMER_WHEEL_SLOT_PENDING]) != NULL &&
+               handled < TIMER_WHEEL_BUDGET) {
+            timer_wheel_unlink(timer);
+            timer_wheel_insert(timer);
+            handled++;
+        }
+
+        // Push the tasks of the timers that expire at this tick
+        slot = timer_wheel_vars.current & TIMER_WHEEL_SLOT_MASK;
+        while ((timer = timer_wheel_vars.slots[slot]) != NULL &&
+               handled < TIMER_WHEEL_BUDGET) {
+            timer_wheel_unlink(timer);
+            timer_wheel_vars.running--;
+            scheduler_push_task(timer->task);
+            handled++;
+        }
+
+        // Leave the rest to the next run and let the other tasks go first
+        if (handled == TIMER_WHEEL_BUDGET) {
+            // Or at the next tick if the scheduler is full
+            if (!scheduler_push(timer_wheel_advance, TIMER_WHEEL_PRIORITY)) {
+                timer_wheel_vars.armed_tick = (now + 1) & TIMER_WHEEL_TICK_MASK;
+                timer_wheel_vars.vtimer_id = virtual_timer_start_at(timer_wheel_vars.armed_tick << TIMER_WHEEL_TICK_SHIFT, timer_wheel_advance, TIMER_WHEEL_PRIORITY);
+                timer_wheel_vars.armed = true;
+            }
+            return;
+        }
+
+        // The tick is over
+        timer_wheel_vars.handling = false;
+        timer_wheel_vars.current = (timer_wheel_vars.current + 1) & TIMER_WHEEL_TICK_MASK;
+    }
+
+    // Wake up at the next tick with timers
+    timer_wheel_schedule();
+}
+
+static void timer_wheel_schedule(void) {
+    bsp_timer_width_t expiry;
+    uint32_t tick;
+    bool pending;
+
+    // The wheel pushed itself to handle the rest of a tick
+    if (timer_wheel_vars.handling) {
+        return;
+    }
+
+    pending = timer_wheel_next(&tick);
+
+    // It already wakes up at the right tick
+    if (timer_wheel_vars.armed && pending && timer_wheel_vars.armed_tick == tick) {
+        return;
+    }
+
+    if (timer_wheel_vars.armed) {
+        // A virtual timer that expired may hold another timer already, so
+        // the one about to expire is left to wake the wheel up, which then
+        // looks for its next tick
+        expiry = timer_wheel_vars.armed_tick << TIMER_WHEEL_TICK_SHIFT;
+        if ((int32_t) (expiry - bsp_timer_get()) <= TIMER_WHEEL_STOP_MARGIN) {
+            return;
+        }
+
+        virtual_timer_stop(timer_wheel_vars.vtimer_id);
+        timer_wheel_vars.armed = false;
+    }
+
+    // Without timers the wheel does not wake up
+    if (!pending) {
+        return;
+    }
+
+    timer_wheel_vars.vtimer_id = virtual_timer_start_at(tick << TIMER_WHEEL_TICK_SHIFT, timer_wheel_advance, TIMER_WHEEL_PRIORITY);
+    timer_wheel_vars.armed = true;
+    timer_wheel_vars.armed_tick = tick;
+}
+
+static bool timer_wheel_next(uint32_t* tick) {
+    uint32_t current = timer_wheel_vars.current;
+    uint32_t candidate;
+    uint32_t start;
+    uint32_t best = TIMER_WHEEL_TICK_MASK;
+    uint8_t distance;
+    bool found = false;
+
+    // The lowest level holds the timers of the next 64 ticks, from the
+    // slot of the current one
+    distance = timer_wheel_first(timer_wheel_vars.occupied[0], current & TIMER_WHEEL_SLOT_MASK);
+    if (distance < TIMER_WHEEL_SLOTS) {
+        best = distance;
+        found = true;
+    }
+
+    // The higher levels move their timers down at the start of their slots,
+    // from the next one unless the current tick starts one
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        start = current >> (TIMER_WHEEL_SLOT_BITS * level);
+        if ((current & (TIMER_WHEEL_RANGE(level - 1) - 1)) != 0) {
+            start++;
+        }
+
+        distance = timer_wheel_first(timer_wheel_vars.occupied[level], start & TIMER_WHEEL_SLOT_MASK);
+        if (distance < TIMER_WHEEL_SLOTS) {
+            candidate = (start + distance) << (TIMER_WHEEL_SLOT_BITS * level);
+            candidate = (candidate - current) & TIMER_WHEEL_TICK_MASK;
+            if (candidate < best) {
+                best = candidate;
+                found = true;
+            }
+        }
+    }
+
+    *tick = (current + best) & TIMER_WHEEL_TICK_MASK;
+
+    return found;
+}
+
+static void timer_wheel_insert(timer_wheel_timer_t* timer) {
+    uint32_t current = timer_wheel_vars.current;
+    uint32_t delta;
+    uint8_t level = 0;
+    uint8_t index;
+
+    // The lowest level that reaches the expiry
+    delta = (timer->expiry - current) & TIMER_WHEEL_TICK_MASK;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= TIMER_WHEEL_RANGE(level)) {
+        level++;
+    }
+
+    // Further than the top level reaches, it waits a whole turn of it
+    if (delta >= TIMER_WHEEL_RANGE(level)) {
+        index = (current >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+    } else {
+        index = (timer->expiry >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+    }
+
+    timer_wheel_link(timer, level * TIMER_WHEEL_SLOTS + index);
+}
+
+static void timer_wheel_link(timer_wheel_timer_t* timer, uint16_t slot) {
+    timer_wheel_timer_t* head = timer_wheel_vars.slots[slot];
+
+    // Put it first in the slot
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = head;
+    if (head != NULL) {
+        head->prev = timer;
+    }
+    timer_wheel_vars.slots[slot] = timer;
+
+    if (slot < TIMER_WHEEL_SLOT_PENDING) {
+        timer_wheel_vars.occupied[slot / TIMER_WHEEL_SLOTS] |= (uint64_t) 1 << (slot % TIMER_WHEEL_SLOTS);
+    }
+}
+
+static void timer_wheel_unlink(timer_wheel_timer_t* timer) {
+    uint16_t slot = timer->slot;
+
+    // Take it out of the list of its slot
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        timer_wheel_vars.slots[slot] = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+
+    timer->slot = TIMER_WHEEL_SLOT_NONE;
+    timer->next = NULL;
+    timer->prev = NULL;
+
+    if (slot < TIMER_WHEEL_SLOT_PENDING && timer_wheel_vars.slots[slot] == NULL) {
+        timer_wheel_vars.occupied[slot / TIMER_WHEEL_SLOTS] &= ~((uint64_t) 1 << (slot % TIMER_WHEEL_SLOTS));
+    }
+}
+
+static uint32_t timer_wheel_now(void) {
+    return bsp_timer_get() >> TIMER_WHEEL_TICK_SHIFT;
+}
+
+static bool timer_wheel_after(uint32_t a, uint32_t b) {
+    // The difference in the top bits tells the sign across the wrap around
+    return ((int32_t) ((a - b) << TIMER_WHEEL_TICK_SHIFT) > 0);
+}
+
+static uint8_t timer_wheel_first(uint64_t occupied, uint8_t from) {
+    // Distance from the slot to the first one that holds timers
+    if (from != 0) {
+        occupied = (occupied >> from) | (occupied << (TIMER_WHEEL_SLOTS - from));
+    }
+
+    if (occupied == 0) {
+        return TIMER_WHEEL_SLOTS;
+    } else if ((uint32_t) occupied != 0) {
+        return __builtin_ctz((uint32_t) occupied);
+    } else {
+        return 32 + __builtin_ctz((uint32_t) (occupied >> 32));
+    }
+}
@@ -0,0 +1,195 @@
+/**
+ * @file       trace.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Timeline of the MAC kept in RAM, instead of the debug pins.
+ *
+ *             The circular buffer always keeps the latest records, older
+ *             ones are overwritten and counted until the buffer is drained.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "trace.h"
+
+#if (TRACE_LEVEL > TRACE_LEVEL_NONE)
+
+#include "serial.h"
+
+#include "bsp_timer.h"
+#include "cpu.h"
+
+#include "scheduler.h"
+
+/*================================ define ===================================*/
+
+// Records in the circular buffer (power of two)
+#define TRACE_BUFFER_SIZE               ( 64 )
+#define TRACE_BUFFER_MASK               ( TRACE_BUFFER_SIZE - 1 )
+
+// Records per serial message, small enough to fit the serial buffer even
+// if every byte needs to be escaped
+#define TRACE_CHUNK_RECORDS             ( 5 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint32_t time;
+    uint32_t arg;
+    uint8_t  event;
+    uint8_t  phase;
+} trace_record_t;
+
+typedef struct {
+    trace_record_t buffer[TRACE_BUFFER_SIZE];
+    uint16_t head;                  ///< Records written
+    uint16_t tail;                  ///< Records read
+    uint32_t overwritten;           ///< Records lost since the last drain
+
+    // Drain in progress
+    bool     draining;
+    bool     pending;               ///< The message could not be sent yet
+    uint16_t drain_left;            ///< Records left of the ones requested
+    uint8_t  message[2 + TRACE_CHUNK_RECORDS * TRACE_RECORD_SIZE];
+    uint8_t  length;
+} trace_vars_t;
+
+/*=============================== variables =================================*/
+
+static trace_vars_t trace_vars;
+
+/*=============================== prototypes ================================*/
+
+static void trace_request(void);
+static void trace_drain(void);
+
+/*================================= public ==================================*/
+
+void trace_init(void) {
+    // Initialize the memory of the variables
+    memset(&trace_vars, 0, sizeof(trace_vars_t));
+
+    // Register the serial callback that drains the buffer
+    serial_register_pc2mote_cb(SERIAL_PC2MOTE_TRACE, trace_request, TASK_PRIO_MIN);
+}
+
+void trace_push(trace_phase_t phase, trace_event_t event, uint32_t arg) {
+    trace_record_t* record;
+    bool disabled;
+
+    // Interrupts push records too, keep the mask of the caller
+    disabled = cpu_disable_interrupts();
+
+    // Overwrite the oldest record if the buffer is full
+    if ((uint16_t) (trace_vars.head - trace_vars.tail) == TRACE_BUFFER_SIZE) {
+        trace_vars.tail++;
+        trace_vars.overwritten++;
+    }
+
+    record = &trace_vars.buffer[trace_vars.head & TRACE_BUFFER_MASK];
+    record->time  = bsp_timer_get();
+    record->arg   = arg;
+    record->event = event;
+    record->phase = phase;
+    trace_vars.head++;
+
+    cpu_restore_interrupts(disabled);
+}
+
+/*================================ private ==================================*/
+
+static void trace_request(void) {
+    static uint8_t buffer[16];
+    static serial_packet_t serial_packet;
+
+    // Setup the serial packet
+    serial_packet.data = buffer;
+    serial_packet.length = sizeof(buffer);
+
+    // Parse the serial message
+    serial_parse_msg(&serial_packet);
+
+    // A drain in progress goes on, otherwise start one
+    if (trace_vars.draining) {
+        return;
+    }
+
+    // Drain the records that are in the buffer now, not the ones that
+    // the drain itself produces
+    cpu_disable_interrupts();
+    trace_vars.drain_left = trace_vars.head - trace_vars.tail;
+    cpu_enable_interrupts();
+
+    trace_vars.draining = true;
+    trace_vars.pending = false;
+
+    trace_drain();
+}
+
+static void trace_drain(void) {
+    trace_record_t* record;
+    uint8_t* message = trace_vars.message;
+    uint8_t count;
+
+    while (trace_vars.draining) {
+        // Take the next records out of the buffer
+        if (!trace_vars.pending) {
+            trace_vars.length = 0;
+
+            cpu_disable_interrupts();
+
+            count = (uint16_t) (trace_vars.head - trace_vars.tail);
+            if (count > trace_vars.drain_left) {
+                count = trace_vars.drain_left;
+            }
+            if (count > TRACE_CHUNK_RECORDS) {
+                count = TRACE_CHUNK_RECORDS;
+            }
+
+            if (count > 0) {
+                message[trace_vars.length++] = TRACE_MSG_RECORDS;
+                message[trace_vars.length++] = count;
+                for (uint8_t i = 0; i < count; i++) {
+                    record = &trace_vars.buffer[trace_vars.tail & TRACE_BUFFER_MASK];
+                    trace_vars.length += serial_put_le(&message[trace_vars.length], record->time, 4);
+                    trace_vars.length += serial_put_le(&message[trace_vars.length], record->arg, 4);
+                    message[trace_vars.length++] = record->event;
+                    message[trace_vars.length++] = record->phase;
+                    trace_vars.tail++;
+                }
+                trace_vars.drain_left -= count;
+            } else {
+                // Records that were overwritten while draining are not sent
+                trace_vars.drain_left = 0;
+
+                // Close the drain with the time, to align the records
+                message[trace_vars.length++] = TRACE_MSG_END;
+                trace_vars.length += serial_put_le(&message[trace_vars.length], trace_vars.overwritten, 4);
+                trace_vars.length += serial_put_le(&message[trace_vars.length], bsp_timer_get(), 4);
+                trace_vars.length += serial_put_le(&message[trace_vars.length], (uint32_t) (uintptr_t) trace_init, 4);
+                trace_vars.overwritten = 0;
+            }
+
+            cpu_enable_interrupts();
+
+            trace_vars.pending = true;
+        }
+
+        // Try again later if the serial queue is full
+        if (!serial_push_msg_retry(SERIAL_MOTE2PC_TRACE, message, trace_vars.length, trace_drain)) {
+            return;
+        }
+        trace_vars.pending = false;
+
+        // The drain is over once the end has been sent
+        if (message[0] == TRACE_MSG_END) {
+            trace_vars.draining = false;
+        }
+    }
+}
+
+#endif /* TRACE_LEVEL > TRACE_LEVEL_NONE */
@@ -12,16 +12,27 @@
 /*================================ include ==================================*/
 
 #include "virtual_timer.h"
+#include "latency.h"
+#include "recorder.h"
+#include "trace.h"
 
 #include "board.h"
 #include "bsp_timer.h"
+#include "cpu.h"
 #include "leds.h"
 
 /*================================ define ===================================*/
 
-#define VIRTUAL_TIMER_MAX_TICKS                 ( 0xFFFFFFFF )
-#define VIRTUAL_TIMER_MAX_TIMERS                ( 16 )
-#define VIRTUAL_TIMER_MAX_TIMERS_ERROR          ( 255 )
+// An identifier holds the index of the timer and its generation, which
+// changes each time the timer is started, so that stopping a timer that
+// already expired cannot stop the one that took its place
+#define VIRTUAL_TIMER_INDEX_BITS        ( 8 )
+#define VIRTUAL_TIMER_INDEX_MASK        ( (1 << VIRTUAL_TIMER_INDEX_BITS) - 1 )
+#define VIRTUAL_TIMER_ID(index, gen)    ( (virtual_timer_id_t) (((gen) << VIRTUAL_TIMER_INDEX_BITS) | (index)) )
+
+#if VIRTUAL_TIMER_MAX_TIMERS > (1 << VIRTUAL_TIMER_INDEX_BITS)
+#error "VIRTUAL_TIMER_MAX_TIMERS does not fit in the index of an identifier"
+#endif
 
 /*================================ typedef ==================================*/
 
@@ -30,10 +41,32 @@ typedef enum {
     VIRTUAL_TIMER_MODE_ON  = 0x01
 } virtual_timer_mode_t;
 
+typedef struct {
+    virtual_timer_width_t expiry;   ///< Copy of the expiry of the timer
+    uint16_t              index;
+} virtual_timer_entry_t;
+
 typedef struct {
     virtual_timer_mode_t  mode;
     virtual_timer_t       buffer[VIRTUAL_TIMER_MAX_TIMERS];
-    virtual_timer_width_t timeout;
+    uint8_t               generation[VIRTUAL_TIMER_MAX_TIMERS];
+
+    // Running timers, the one that expires first at the top
+    virtual_timer_entry_t heap[VIRTUAL_TIMER_MAX_TIMERS];
+    uint16_t              position[VIRTUAL_TIMER_MAX_TIMERS];   ///< Index of each timer in the heap
+    uint16_t              running;
+
+    // Stopped timers, taken from the top
+    uint16_t              free[VIRTUAL_TIMER_MAX_TIMERS];
+    uint16_t              stopped;
+
+    // Due timers that wait for their fine tick, the first one at the start
+    uint16_t              waiting[VIRTUAL_TIMER_MAX_TIMERS];
+    uint16_t              waits;
+
+    // Callbacks run in the interrupt
+    uint32_t              cycles_per_us;
+    uint32_t              overruns;     ///< Times one took longer than its budget
 } virtual_timer_vars_t;
 
 /*=============================== variables =================================*/
@@ -42,8 +75,23 @@ static virtual_timer_vars_t virtual_timer_vars;
 
 /*=============================== prototypes ================================*/
 
+static virtual_timer_id_t virtual_timer_arm(const virtual_timer_t* timer);
 static void virtual_timer_interrupt(void);
-static void virtual_timer_reset(virtual_timer_id_t vtimer_id);
+static void virtual_timer_schedule(void);
+static void virtual_timer_push(virtual_timer_t* timer);
+static void virtual_timer_wait(uint16_t index);
+static void virtual_timer_unwait(uint16_t index);
+static void virtual_timer_fine_interrupt(void);
+static void virtual_timer_fine_schedule(void);
+static void virtual_timer_run(virtual_timer_t* timer);
+static void virtual_timer_reset(uint16_t index);
+static radio_timer_width_t virtual_timer_fine(uint16_t index);
+
+static bool virtual_timer_before(const virtual_timer_entry_t* a, const virtual_timer_entry_t* b);
+static void virtual_timer_heap_place(uint16_t index, virtual_timer_entry_t entry);
+static void virtual_timer_heap_up(uint16_t index);
+static void virtual_timer_heap_down(uint16_t index);
+static void virtual_timer_heap_remove(uint16_t index);
 
 /*================================= public ==================================*/
 
@@ -51,124 +99,492 @@ void virtual_timer_init(void) {
     // Initialize the memory of the variables
     memset(&virtual_timer_vars, 0, sizeof(virtual_timer_vars_t));
 
-    // Initialize the vtimer entries
-    for (uint8_t i = 0; i < VIRTUAL_TIMER_MAX_TIMERS; i++) {
-        virtual_timer_reset(i);
+    // Initialize the vtimer entries, the lowest index is taken first
+    for (uint16_t i = VIRTUAL_TIMER_MAX_TIMERS; i > 0; i--) {
+        virtual_timer_reset(i - 1);
     }
 
     // Initially, the virtual timer is off
     virtual_timer_vars.mode = VIRTUAL_TIMER_MODE_OFF;
+
+    // The budgets of the callbacks run in the interrupt are in microseconds
+    virtual_timer_vars.cycles_per_us = cpu_cycles_frequency() / 1000000;
 }
 
 virtual_timer_id_t virtual_timer_start(virtual_timer_type_t type, virtual_timer_width_t ticks, task_cb_t callback, task_prio_t priority) {
-    virtual_timer_id_t id;
+    virtual_timer_t timer;
+
+    // Push the callback with its priority
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = type;
+    timer.ticks    = ticks;
+    timer.expiry   = bsp_timer_get() + ticks;
+    timer.callback = callback;
+    timer.priority = priority;
+
+    return virtual_timer_arm(&timer);
+}
+
+virtual_timer_id_t virtual_timer_start_task(virtual_timer_type_t type, virtual_timer_width_t ticks, task_t* task) {
+    virtual_timer_t timer;
+
+    // Push the descriptor, it holds the priority
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = type;
+    timer.ticks    = ticks;
+    timer.expiry   = bsp_timer_get() + ticks;
+    timer.priority = task->priority;
+    timer.task     = task;
+
+    return virtual_timer_arm(&timer);
+}
+
+virtual_timer_id_t virtual_timer_start_deadline(virtual_timer_type_t type, virtual_timer_width_t ticks, task_cb_t callback, virtual_timer_width_t slack) {
+    virtual_timer_t timer;
+
+    // Push the callback to start at most slack ticks after the expiry
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = type;
+    timer.ticks    = ticks;
+    timer.expiry   = bsp_timer_get() + ticks;
+    timer.callback = callback;
+    timer.priority = TASK_PRIO_MAX;
+    timer.edf      = true;
+    timer.slack    = slack;
+
+    return virtual_timer_arm(&timer);
+}
+
+virtual_timer_id_t virtual_timer_start_at(virtual_timer_width_t expiry, task_cb_t callback, task_prio_t priority) {
+    virtual_timer_t timer;
+
+    // Push the callback with its priority at the given tick
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = VIRTUAL_TIMER_TYPE_ONE_SHOT;
+    timer.expiry   = expiry;
+    timer.callback = callback;
+    timer.priority = priority;
+
+    return virtual_timer_arm(&timer);
+}
+
+virtual_timer_id_t virtual_timer_start_deadline_at(virtual_timer_width_t expiry, task_cb_t callback, virtual_timer_width_t slack) {
+    virtual_timer_t timer;
+
+    // Push the callback at the given tick to start at most slack ticks later
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = VIRTUAL_TIMER_TYPE_ONE_SHOT;
+    timer.expiry   = expiry;
+    timer.callback = callback;
+    timer.priority = TASK_PRIO_MAX;
+    timer.edf      = true;
+    timer.slack    = slack;
+
+    return virtual_timer_arm(&timer);
+}
+
+virtual_timer_id_t virtual_timer_start_isr_at(radio_timer_width_t at, virtual_timer_isr_cb_t isr_callback, uint16_t budget, task_cb_t callback, virtual_timer_width_t slack) {
+    virtual_timer_t timer;
+    virtual_timer_width_t now;
+
+    // Run the callback in the interrupt at the given fine tick, then push the
+    // task, if any, to start at most slack ticks later
+    memset(&timer, 0, sizeof(virtual_timer_t));
+    timer.type     = VIRTUAL_TIMER_TYPE_ONE_SHOT;
+
+    // The sleep timer expires on the tick the fine tick falls in
+    now = bsp_timer_get();
+    timer.expiry   = now + (((int32_t) (at - RADIO_TIMER_TICKS(now))) >> RADIO_TIMER_SHIFT);
+    timer.fine     = at & RADIO_TIMER_FINE_MASK;
+    timer.isr      = isr_callback;
+    timer.budget   = budget;
+    timer.callback = callback;
+    timer.priority = TASK_PRIO_MAX;
+    timer.edf      = true;
+    timer.slack    = slack;
+
+    return virtual_timer_arm(&timer);
+}
+
+void virtual_timer_stop(virtual_timer_id_t vtimer_id) {
+    uint16_t index = vtimer_id & VIRTUAL_TIMER_INDEX_MASK;
+    bool disabled;
+    bool first;
+
+    disabled = cpu_disable_interrupts();
+
+    // A timer that already expired or was stopped is left alone, even if
+    // it has been started again since
+    if (index >= VIRTUAL_TIMER_MAX_TIMERS ||
+        VIRTUAL_TIMER_ID(index, virtual_timer_vars.generation[index]) != vtimer_id) {
+        cpu_restore_interrupts(disabled);
+        return;
+    }
 
-    // Find an unused timer
-    for (id = 0; id < VIRTUAL_TIMER_MAX_TIMERS &&
-        virtual_timer_vars.buffer[id].status != VIRTUAL_TIMER_STATUS_STOPPED; id++);
-
-    // If a position is available register the timer, otherwise return error
-    if (id < VIRTUAL_TIMER_MAX_TIMERS) {
-        // Update the timer variables
-        virtual_timer_vars.buffer[id].status     = VIRTUAL_TIMER_STATUS_RUNNING;
-        virtual_timer_vars.buffer[id].type       = type;
-        virtual_timer_vars.buffer[id].ticks      = ticks;
-        virtual_timer_vars.buffer[id].ticks_left = ticks;
-        virtual_timer_vars.buffer[id].callback   = callback;
-        virtual_timer_vars.buffer[id].priority   = priority;
-
-        // If the virtual timer is not running or the expire time is shorter, reconfigure it
-        if (virtual_timer_vars.mode == VIRTUAL_TIMER_MODE_OFF ||
-            virtual_timer_vars.buffer[id].ticks_left < virtual_timer_vars.timeout) {
-
-            // Update the current timeout
-            virtual_timer_vars.timeout = virtual_timer_vars.buffer[id].ticks_left;
-
-            // If the timer is not running, start it
-            if (virtual_timer_vars.mode == VIRTUAL_TIMER_MODE_OFF) {
-                // Start the bsp_timer
-                bsp_timer_set_cb(virtual_timer_interrupt);
-                bsp_timer_enable_interrupts();
-
-                // Set the virtual timer to on
-                virtual_timer_vars.mode = VIRTUAL_TIMER_MODE_ON;
-            }
-
-            // Schedule a system timer
-            bsp_timer_start(virtual_timer_vars.timeout);
+    if (virtual_timer_vars.buffer[index].status == VIRTUAL_TIMER_STATUS_RUNNING) {
+        first = (virtual_timer_vars.position[index] == 0);
+
+        virtual_timer_heap_remove(index);
+        virtual_timer_reset(index);
+
+        // Only the first timer sets when the sleep timer fires
+        if (first) {
+            virtual_timer_schedule();
+        }
+    } else if (virtual_timer_vars.buffer[index].status == VIRTUAL_TIMER_STATUS_WAITING) {
+        first = (virtual_timer_vars.waiting[0] == index);
+
+        virtual_timer_unwait(index);
+        virtual_timer_reset(index);
+
+        // Only the first timer sets when the radio timer fires
+        if (first) {
+            virtual_timer_fine_schedule();
         }
-    } else {
+    }
+
+    cpu_restore_interrupts(disabled);
+}
+
+uint32_t virtual_timer_get_overruns(void) {
+    return virtual_timer_vars.overruns;
+}
+
+/*================================ private ==================================*/
+
+static virtual_timer_id_t virtual_timer_arm(const virtual_timer_t* timer) {
+    virtual_timer_entry_t entry;
+    virtual_timer_id_t id;
+    uint16_t index;
+    bool disabled;
+
+    disabled = cpu_disable_interrupts();
+
+    // All the timers are running
+    if (virtual_timer_vars.stopped == 0) {
         leds_error_on();
         while(true);
     }
 
+    // Take a stopped timer and register it, a timer due in the past
+    // expires right away
+    index = virtual_timer_vars.free[--virtual_timer_vars.stopped];
+    virtual_timer_vars.buffer[index]        = *timer;
+    virtual_timer_vars.buffer[index].status = VIRTUAL_TIMER_STATUS_RUNNING;
+
+    // Give it a new identifier, the generation 0 is never used so that an
+    // identifier left at 0 does not stop anything
+    if (++virtual_timer_vars.generation[index] == 0) {
+        virtual_timer_vars.generation[index] = 1;
+    }
+    id = VIRTUAL_TIMER_ID(index, virtual_timer_vars.generation[index]);
+
+    // Add it to the heap
+    entry.expiry = virtual_timer_vars.buffer[index].expiry;
+    entry.index  = index;
+    virtual_timer_heap_place(virtual_timer_vars.running++, entry);
+    virtual_timer_heap_up(virtual_timer_vars.position[index]);
+
+    // If it expires before the others, reconfigure the sleep timer
+    if (virtual_timer_vars.position[index] == 0) {
+        virtual_timer_schedule();
+    }
+
+    cpu_restore_interrupts(disabled);
+
     return id;
 }
 
-void virtual_timer_stop(virtual_timer_id_t vtimer_id) {
-    virtual_timer_reset(vtimer_id);
+static void virtual_timer_interrupt(void) {
+    virtual_timer_t timer;
+    virtual_timer_width_t now;
+    uint16_t pending;
+    uint16_t index;
+    bool disabled;
+
+    // Start the radio timer again from the sleep timer, so that the drift
+    // between their crystals does not build up between the fine ticks of
+    // the timers and their ticks
+    radio_timer_sync();
+
+    now = bsp_timer_get();
+
+    // Handle at most as many timers as are running, so a periodic one that
+    // is behind cannot hold the interrupt, the rest fire on the next one
+    for (pending = virtual_timer_vars.running; pending > 0; pending--) {
+        disabled = cpu_disable_interrupts();
+
+        // The rest of the timers are not due yet, the sleep timer cannot be
+        // set closer than its minimum so those within it are due now
+        if (virtual_timer_vars.running == 0 ||
+            (int32_t) (virtual_timer_vars.heap[0].expiry - now) >= BSP_TIMER_MINIMUM_TICKS) {
+            cpu_restore_interrupts(disabled);
+            break;
+        }
+
+        // Take the first timer and, before the interrupts are enabled again,
+        // move its expiry one period if it is periodic or remove it otherwise,
+        // so that a radio interrupt that stops it in between finds it either
+        // running at its next expiry or already stopped
+        index = virtual_timer_vars.heap[0].index;
+        timer = virtual_timer_vars.buffer[index];
+        if (timer.isr != NULL) {
+            // It may be handled up to BSP_TIMER_MINIMUM_TICKS early, the
+            // radio timer runs it at its fine tick
+            virtual_timer_heap_remove(index);
+            virtual_timer_wait(index);
+            cpu_restore_interrupts(disabled);
+            continue;
+        } else if (timer.type == VIRTUAL_TIMER_TYPE_PERIODIC) {
+            virtual_timer_vars.buffer[index].expiry += timer.ticks;
+            virtual_timer_vars.heap[0].expiry = virtual_timer_vars.buffer[index].expiry;
+            virtual_timer_heap_down(0);
+        } else if (timer.type == VIRTUAL_TIMER_TYPE_ONE_SHOT) {
+            virtual_timer_heap_remove(index);
+            virtual_timer_reset(index);
+        } else {
+            leds_error_on();
+            while(true);
+        }
+
+        cpu_restore_interrupts(disabled);
+
+        // Push it to the scheduler
+        recorder_timer(index);
+        TRACE_TASK(TRACE_INSTANT, TRACE_EVENT_TIMER, index);
+        virtual_timer_push(&timer);
+    }
+
+    // Set the sleep timer to the next expiry
+    disabled = cpu_disable_interrupts();
+    virtual_timer_schedule();
+    cpu_restore_interrupts(disabled);
 }
 
-/*================================ private ==================================*/
+static void virtual_timer_schedule(void) {
+    int32_t ticks;
 
-static void virtual_timer_interrupt(void) {
-    virtual_timer_id_t id;
-    virtual_timer_width_t ticks;
-
-    // Initialize the variable to its maximum value
-    ticks = VIRTUAL_TIMER_MAX_TICKS;
-
-    // Update the timers
-    for (id = 0; id < VIRTUAL_TIMER_MAX_TIMERS; id++) {
-        // If the timer is running
-        if (virtual_timer_vars.buffer[id].status == VIRTUAL_TIMER_STATUS_RUNNING) {
-            // Update the number of ticks left
-            if (virtual_timer_vars.buffer[id].ticks_left  > virtual_timer_vars.timeout) {
-                virtual_timer_vars.buffer[id].ticks_left -= virtual_timer_vars.timeout;
-            } else {
-                virtual_timer_vars.buffer[id].ticks_left = 0;
-            }
-
-            // If the timer has expired, push it to the scheduler and decide what's next
-            if (virtual_timer_vars.buffer[id].ticks_left == 0) {
-                scheduler_push(virtual_timer_vars.buffer[id].callback, virtual_timer_vars.buffer[id].priority);
-                // If the timer is periodic, restart the number of ticks left, otherwise remove it
-                if (virtual_timer_vars.buffer[id].type == VIRTUAL_TIMER_TYPE_PERIODIC) {
-                    virtual_timer_vars.buffer[id].ticks_left = virtual_timer_vars.buffer[id].ticks;
-                } else if (virtual_timer_vars.buffer[id].type == VIRTUAL_TIMER_TYPE_ONE_SHOT) {
-                    virtual_timer_reset(id);
-                } else {
-                    leds_error_on();
-                    while(true);
-                }
-            }
+    // If there is no timer running, stop the sleep timer
+    if (virtual_timer_vars.running == 0) {
+        if (virtual_timer_vars.mode == VIRTUAL_TIMER_MODE_ON) {
+            virtual_timer_vars.mode = VIRTUAL_TIMER_MODE_OFF;
+            bsp_timer_stop();
+        }
+        return;
+    }
+
+    // If the sleep timer is not running, start it
+    if (virtual_timer_vars.mode == VIRTUAL_TIMER_MODE_OFF) {
+        bsp_timer_set_cb(virtual_timer_interrupt);
+        bsp_timer_enable_interrupts();
+
+        virtual_timer_vars.mode = VIRTUAL_TIMER_MODE_ON;
+    }
+
+    // Schedule a system timer for the first expiry, right away if it is late
+    ticks = (int32_t) (virtual_timer_vars.heap[0].expiry - bsp_timer_get());
+    bsp_timer_start(ticks > 0 ? (bsp_timer_width_t) ticks : 0);
+}
+
+static void virtual_timer_push(virtual_timer_t* timer) {
+    task_post_t post;
+
+    // Push the descriptor or the callback, with its deadline if it has one
+    memset(&post, 0, sizeof(task_post_t));
+    post.task     = timer->task;
+    post.callback = timer->callback;
+    post.priority = timer->priority;
+    post.edf      = timer->edf;
+    post.deadline = timer->expiry + timer->slack;
+
+#if LATENCY_ENABLED
+    // Let the scheduler measure how late the callback runs
+    post.timed    = true;
+    post.due      = latency_due(timer->expiry);
+#endif
+
+    scheduler_post(&post);
+}
+
+static void virtual_timer_wait(uint16_t index) {
+    uint16_t position;
+
+    virtual_timer_vars.buffer[index].status = VIRTUAL_TIMER_STATUS_WAITING;
+
+    // Keep the waiting timers in the order of their fine tick
+    for (position = virtual_timer_vars.waits; position > 0; position--) {
+        if ((int32_t) (virtual_timer_fine(index) - virtual_timer_fine(virtual_timer_vars.waiting[position - 1])) >= 0) {
+            break;
         }
+        virtual_timer_vars.waiting[position] = virtual_timer_vars.waiting[position - 1];
+    }
+    virtual_timer_vars.waiting[position] = index;
+    virtual_timer_vars.waits++;
+
+    // If it is due before the others, reconfigure the radio timer
+    if (position == 0) {
+        virtual_timer_fine_schedule();
+    }
+}
+
+static void virtual_timer_unwait(uint16_t index) {
+    uint16_t position;
+
+    // Close the gap it leaves, keeping the order of the others
+    for (position = 0; virtual_timer_vars.waiting[position] != index; position++);
+    for (virtual_timer_vars.waits--; position < virtual_timer_vars.waits; position++) {
+        virtual_timer_vars.waiting[position] = virtual_timer_vars.waiting[position + 1];
+    }
+}
+
+static void virtual_timer_fine_interrupt(void) {
+    virtual_timer_t timer;
+    radio_timer_width_t now;
+    uint16_t pending;
+    uint16_t index;
+    bool disabled;
+
+    now = radio_timer_get();
+
+    for (pending = virtual_timer_vars.waits; pending > 0; pending--) {
+        disabled = cpu_disable_interrupts();
+
+        // The rest of the timers are not due yet
+        if (virtual_timer_vars.waits == 0 ||
+            (int32_t) (virtual_timer_fine(virtual_timer_vars.waiting[0]) - now) > 0) {
+            cpu_restore_interrupts(disabled);
+            break;
+        }
+
+        // Take the first timer and stop it before the interrupts are enabled
+        // again, it only runs once
+        index = virtual_timer_vars.waiting[0];
+        timer = virtual_timer_vars.buffer[index];
+        virtual_timer_unwait(index);
+        virtual_timer_reset(index);
+
+        cpu_restore_interrupts(disabled);
+
+        // Run it here
+        recorder_timer(index);
+        TRACE_TASK(TRACE_INSTANT, TRACE_EVENT_TIMER, index);
+        virtual_timer_run(&timer);
     }
 
-    // Calculate the next expire timer
-    for (id = 0; id < VIRTUAL_TIMER_MAX_TIMERS; id++) {
-        if (virtual_timer_vars.buffer[id].status == VIRTUAL_TIMER_STATUS_RUNNING &&
-            virtual_timer_vars.buffer[id].ticks_left < ticks) {
-            ticks = virtual_timer_vars.buffer[id].ticks_left;
+    // Set the radio timer to the next fine tick
+    disabled = cpu_disable_interrupts();
+    virtual_timer_fine_schedule();
+    cpu_restore_interrupts(disabled);
+}
+
+static void virtual_timer_fine_schedule(void) {
+    // If there is no timer waiting, stop the radio timer
+    if (virtual_timer_vars.waits == 0) {
+        radio_timer_stop();
+        return;
+    }
+
+    // Set the compare for the first fine tick, right away if it is late
+    radio_timer_set_cb(virtual_timer_fine_interrupt);
+    radio_timer_start(virtual_timer_fine(virtual_timer_vars.waiting[0]));
+}
+
+static void virtual_timer_run(virtual_timer_t* timer) {
+    uint32_t start;
+    uint32_t elapsed;
+
+    // Run the callback and account for it if it takes longer than its budget
+    start = cpu_cycles_get();
+    timer->isr();
+    elapsed = cpu_cycles_get() - start;
+    if (elapsed > timer->budget * virtual_timer_vars.cycles_per_us) {
+        virtual_timer_vars.overruns++;
+    }
+
+    // Push the task that follows it, if any
+    if (timer->callback != NULL) {
+        virtual_timer_push(timer);
+    }
+}
+
+static void virtual_timer_reset(uint16_t index) {
+    virtual_timer_t* timer = &virtual_timer_vars.buffer[index];
+
+    // Clear the timer
+    memset(timer, 0, sizeof(virtual_timer_t));
+    timer->status   = VIRTUAL_TIMER_STATUS_STOPPED;
+    timer->type     = VIRTUAL_TIMER_TYPE_NONE;
+    timer->priority = TASK_PRIO_NONE;
+
+    // Give it back to the stopped ones
+    virtual_timer_vars.free[virtual_timer_vars.stopped++] = index;
+}
+
+static radio_timer_width_t virtual_timer_fine(uint16_t index) {
+    // Fine tick at which the callback in the interrupt runs
+    return RADIO_TIMER_TICKS(virtual_timer_vars.buffer[index].expiry) + virtual_timer_vars.buffer[index].fine;
+}
+
+static bool virtual_timer_before(const virtual_timer_entry_t* a, const virtual_timer_entry_t* b) {
+    int32_t difference;
+
+    // Earlier expiry first, the same one in identifier order
+    difference = (int32_t) (a->expiry - b->expiry);
+
+    return (difference < 0 || (difference == 0 && a->index < b->index));
+}
+
+static void virtual_timer_heap_place(uint16_t index, virtual_timer_entry_t entry) {
+    virtual_timer_vars.heap[index] = entry;
+    virtual_timer_vars.position[entry.index] = index;
+}
+
+static void virtual_timer_heap_up(uint16_t index) {
+    virtual_timer_entry_t entry = virtual_timer_vars.heap[index];
+    uint16_t parent;
+
+    // Move the timer up while it expires before its parent
+    while (index > 0) {
+        parent = (index - 1) / 2;
+        if (!virtual_timer_before(&entry, &virtual_timer_vars.heap[parent])) {
+            break;
         }
+        virtual_timer_heap_place(index, virtual_timer_vars.heap[parent]);
+        index = parent;
     }
 
-    // If there is no next expire timer
-    if (ticks == VIRTUAL_TIMER_MAX_TICKS) {
-        virtual_timer_vars.mode = VIRTUAL_TIMER_MODE_OFF;
-        bsp_timer_stop();
-    } else {
-        // Schedule a system timer
-        virtual_timer_vars.timeout = ticks;
-        bsp_timer_start(virtual_timer_vars.timeout);
+    virtual_timer_heap_place(index, entry);
+}
+
+static void virtual_timer_heap_down(uint16_t index) {
+    virtual_timer_entry_t entry = virtual_timer_vars.heap[index];
+    uint16_t child;
+
+    // Move the timer down while one of its children expires before it
+    while ((child = 2 * index + 1) < virtual_timer_vars.running) {
+        if (child + 1 < virtual_timer_vars.running &&
+            virtual_timer_before(&virtual_timer_vars.heap[child + 1], &virtual_timer_vars.heap[child])) {
+            child++;
+        }
+        if (!virtual_timer_before(&virtual_timer_vars.heap[child], &entry)) {
+            break;
+        }
+        virtual_timer_heap_place(index, virtual_timer_vars.heap[child]);
+        index = child;
     }
+
+    virtual_timer_heap_place(index, entry);
 }
 
-static void virtual_timer_reset(virtual_timer_id_t vtimer_id) {
-    virtual_timer_vars.buffer[vtimer_id].status     = VIRTUAL_TIMER_STATUS_STOPPED;
-    virtual_timer_vars.buffer[vtimer_id].type       = VIRTUAL_TIMER_TYPE_NONE;
-    virtual_timer_vars.buffer[vtimer_id].ticks      = 0;
-    virtual_timer_vars.buffer[vtimer_id].ticks_left = 0;
-    virtual_timer_vars.buffer[vtimer_id].callback   = NULL;
-    virtual_timer_vars.buffer[vtimer_id].priority   = TASK_PRIO_NONE;
+static void virtual_timer_heap_remove(uint16_t index) {
+    uint16_t position = virtual_timer_vars.position[index];
+    virtual_timer_entry_t last;
+
+    // Put the last timer in its place and restore the order around it
+    last = virtual_timer_vars.heap[--virtual_timer_vars.running];
+    if (last.index != index) {
+        virtual_timer_heap_place(position, last);
+        virtual_timer_heap_up(position);
+        virtual_timer_heap_down(virtual_timer_vars.position[last.index]);
+    }
 }
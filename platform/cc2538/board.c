@@ -22,6 +22,7 @@
 #include "ieee-addr.h"
 #include "leds.h"
 #include "radio.h"
+#include "radio_timer.h"
 #include "random.h"
 #include "uart.h"
 
@@ -72,6 +73,7 @@ void board_init(void) {
 
     // Initialize the bsp and radio timers
     bsp_timer_init();
+    radio_timer_init();
 
     // Initialize the communication interfaces
     uart_init();
@@ -17,12 +17,13 @@
 
 /*================================ define ===================================*/
 
-#define BSP_TIMER_MINIMUM_TICKS         ( 5 )
-
 /*================================ typedef ==================================*/
 
 typedef struct {
     bsp_timer_cb_t callback;
+    bsp_timer_width_t compare;      ///< When the callback is due
+    bool armed;                     ///< The callback is due at compare
+    bool waking;                    ///< The interrupt fires before compare
 } bsp_timer_vars_t;
 
 /*=============================== variables =================================*/
@@ -71,6 +72,11 @@ void bsp_timer_start(bsp_timer_width_t delay_ticks) {
     // Get the current number of ticks
     current_ticks = SleepModeTimerCountGet();
 
+    // Remember when the callback is due
+    bsp_timer_vars.compare = current_ticks + delay_ticks;
+    bsp_timer_vars.armed = true;
+    bsp_timer_vars.waking = false;
+
     if (delay_ticks < BSP_TIMER_MINIMUM_TICKS) {
         IntPendSet(INT_SMTIM);
     } else {
@@ -80,6 +86,9 @@ void bsp_timer_start(bsp_timer_width_t delay_ticks) {
 }
 
 void bsp_timer_stop(void) {
+    bsp_timer_vars.armed = false;
+    bsp_timer_vars.waking = false;
+
     bsp_timer_cancel_cb();
     bsp_timer_disable_interrupts();
 }
@@ -108,6 +117,26 @@ bool bsp_timer_expired(bsp_timer_width_t future) {
     }
 }
 
+bool bsp_timer_get_compare(bsp_timer_width_t* compare) {
+    // Tell when the callback is due, if it is
+    if (!bsp_timer_vars.armed) {
+        return false;
+    }
+
+    *compare = bsp_timer_vars.compare;
+
+    return true;
+}
+
+void bsp_timer_wakeup(bsp_timer_width_t ticks) {
+    // Fire the interrupt ahead of time only to wake up the CPU, the
+    // callback still runs when it is due
+    if (bsp_timer_vars.armed && !bsp_timer_vars.waking) {
+        bsp_timer_vars.waking = true;
+        SleepModeTimerCompareSet(bsp_timer_vars.compare - ticks);
+    }
+}
+
 /*================================ private ==================================*/
 
 /*=============================== interrupt =================================*/
@@ -116,6 +145,19 @@ void bsp_timer_interrupt(void) {
     // Clear the pending interrupt
     IntPendClear(INT_SMTIM);
 
+    // Woken up ahead of time, set the compare back to when the callback is
+    // due, unless that is too close to be set, then the callback runs now,
+    // at most BSP_TIMER_MINIMUM_TICKS early, instead of busy-waiting in the
+    // interrupt for the compare
+    if (bsp_timer_vars.waking) {
+        bsp_timer_vars.waking = false;
+        if ((int32_t) (bsp_timer_vars.compare - SleepModeTimerCountGet()) >= BSP_TIMER_MINIMUM_TICKS) {
+            SleepModeTimerCompareSet(bsp_timer_vars.compare);
+            return;
+        }
+    }
+    bsp_timer_vars.armed = false;
+
     // Execute the callback function
     if (bsp_timer_vars.callback != NULL) {
         bsp_timer_vars.callback();
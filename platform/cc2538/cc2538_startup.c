@@ -62,6 +62,8 @@ void rf_core_interrupt(void)        __attribute__ ((weak, alias("default_handler
 void rf_error_interrupt(void)       __attribute__ ((weak, alias("default_handler")));
 void bsp_timer_interrupt(void)      __attribute__ ((weak, alias("default_handler")));
 void radio_timer_interrupt(void)    __attribute__ ((weak, alias("default_handler")));
+void udma_interrupt(void)           __attribute__ ((weak, alias("default_handler")));
+void udma_error_interrupt(void)     __attribute__ ((weak, alias("default_handler")));
 void watchdog_interrupt(void)       __attribute__ ((weak, alias("default_handler")));
 void timer0a_interrupt(void)        __attribute__ ((weak, alias("default_handler")));
 void timer0b_interrupt(void)        __attribute__ ((weak, alias("default_handler")));
@@ -142,8 +144,8 @@ void (* const vector_table[])(void) = {
    0, 0, 0, 0, 0, 0, 0,                                 // 53-59 Reserved
    default_handler,                                     // 60 USB
    0,                                                   // 61 Reserved
-   default_handler,                                     // 62 uDMA
-   default_handler,                                     // 63 uDMA Error
+   udma_interrupt,                                      // 62 uDMA
+   udma_error_interrupt,                                // 63 uDMA Error
 #ifndef CC2538_USE_ALTERNATE_INTERRUPT_MAP
    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                        // 64-73 Reserved
    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                        // 74-83 Reserved
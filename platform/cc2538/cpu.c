@@ -17,6 +17,13 @@
 
 /*================================ define ===================================*/
 
+// Cortex-M3 debug registers that enable the DWT cycle counter
+#define CPU_DEMCR                       ( 0xE000EDFC )
+#define CPU_DEMCR_TRCENA                ( 1 << 24 )
+#define CPU_DWT_CTRL                    ( 0xE0001000 )
+#define CPU_DWT_CTRL_CYCCNTENA          ( 1 << 0 )
+#define CPU_DWT_CYCCNT                  ( 0xE0001004 )
+
 /*================================ typedef ==================================*/
 
 /*=============================== variables =================================*/
@@ -25,20 +32,68 @@
 
 static void cpu_gpio_init(void);
 static void cpu_clocks_init(void);
+static void cpu_cycles_init(void);
+static void cpu_clocks_restore(void);
 
 /*================================= public ==================================*/
 
 void cpu_init(void) {
     cpu_gpio_init();
     cpu_clocks_init();
+    cpu_cycles_init();
 }
 
 void cpu_wait(void) {
     SysCtrlSleep();
 }
 
-void cpu_sleep(void) {
+void cpu_sleep(cpu_power_t mode) {
+    if (mode == CPU_POWER_PM0) {
+        SysCtrlSleep();
+        return;
+    }
+
+    /**
+     * Run from the 16 MHz RC oscillator while the 32 MHz crystal is down,
+     * the sleep timer keeps running from the 32 kHz crystal
+     */
+    SysCtrlClockSet(true, true, SYS_CTRL_SYSDIV_16MHZ);
+    SysCtrlIOClockSet(SYS_CTRL_SYSDIV_16MHZ);
+
+    // Make sure the last compare value has been loaded in the sleep timer
+    while (!(HWREG(SMWDTHROSC_STLOAD) & SMWDTHROSC_STLOAD_STLOAD));
+
+    // Enter the power mode until the next interrupt
+    SysCtrlPowerModeSet(mode == CPU_POWER_PM1 ? SYS_CTRL_PM_1 : SYS_CTRL_PM_2);
     SysCtrlDeepSleep();
+    SysCtrlPowerModeSet(SYS_CTRL_PM_NOACTION);
+
+    cpu_clocks_restore();
+}
+
+cpu_power_t cpu_power_max(void) {
+    // The radio needs the 32 MHz crystal while it receives or transmits
+    if (HWREG(RFCORE_XREG_RXENABLE) != 0 ||
+        (HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)) {
+        return CPU_POWER_PM0;
+    }
+
+    // The MAC timer stops as well, let it run the compare that is set
+    if (HWREG(RFCORE_SFR_MTIRQM) != 0) {
+        return CPU_POWER_PM0;
+    }
+
+    // The uDMA stops as well, let it finish moving a frame
+    if (HWREG(UDMA_ENASET) != 0) {
+        return CPU_POWER_PM0;
+    }
+
+    // The UART stops in PM1 and PM2, let it send what it has
+    if (UARTBusy(UART0_BASE)) {
+        return CPU_POWER_PM0;
+    }
+
+    return CPU_POWER_PM2;
 }
 
 void cpu_reset(void) {
@@ -49,14 +104,59 @@ void cpu_enable_interrupts(void) {
     IntMasterEnable();
 }
 
-void cpu_disable_interrupts(void) {
-    IntMasterDisable();
+bool cpu_disable_interrupts(void) {
+    // Tell whether they were already disabled
+    return IntMasterDisable();
+}
+
+void cpu_restore_interrupts(bool disabled) {
+    // Only enable them if they were enabled before
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+cpu_interrupt_t cpu_interrupt_get(void) {
+    uint32_t ipsr;
+
+    // The IPSR holds the number of the exception being served
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+
+    switch (ipsr & 0x1FF) {
+        case 0:
+            return CPU_INTERRUPT_NONE;
+        case INT_SMTIM:
+            return CPU_INTERRUPT_TIMER;
+        case INT_RFCORERTX:
+        case INT_RFCOREERR:
+        case INT_UDMA:
+        case INT_UDMAERR:
+        case INT_MACTIMR:
+            return CPU_INTERRUPT_RADIO;
+        case INT_UART0:
+            return CPU_INTERRUPT_UART;
+        case INT_GPIOA:
+        case INT_GPIOB:
+        case INT_GPIOC:
+        case INT_GPIOD:
+            return CPU_INTERRUPT_GPIO;
+        default:
+            return CPU_INTERRUPT_OTHER;
+    }
 }
 
 void cpu_delay_us(uint32_t delay_us) {
     SysCtrlDelay(delay_us);
 }
 
+uint32_t cpu_cycles_get(void) {
+    return HWREG(CPU_DWT_CYCCNT);
+}
+
+uint32_t cpu_cycles_frequency(void) {
+    return SysCtrlClockGet();
+}
+
 /*================================ private ==================================*/
 
 static void cpu_gpio_init(void) {
@@ -98,3 +198,32 @@ static void cpu_clocks_init(void) {
      */
     while (!((HWREG(SYS_CTRL_CLOCK_STA)) & (SYS_CTRL_CLOCK_STA_XOSC_STB)));
 }
+
+static void cpu_clocks_restore(void) {
+    uint32_t ticks;
+
+    /**
+     * Switch back to the 32 MHz crystal, which powers up again on wake up,
+     * and wait until it becomes stable
+     */
+    SysCtrlClockSet(true, false, SYS_CTRL_SYSDIV_32MHZ);
+    SysCtrlIOClockSet(SYS_CTRL_SYSDIV_32MHZ);
+    while (!((HWREG(SYS_CTRL_CLOCK_STA)) & (SYS_CTRL_CLOCK_STA_XOSC_STB)));
+
+    /**
+     * The sleep timer value is only valid after a rising edge of the
+     * 32 kHz clock following the wake up
+     */
+    ticks = HWREG(SMWDTHROSC_ST0);
+    while (HWREG(SMWDTHROSC_ST0) == ticks);
+}
+
+static void cpu_cycles_init(void) {
+    /**
+     * Enable the trace unit and start the DWT cycle counter,
+     * it runs at the system clock and wraps around every 134 seconds
+     */
+    HWREG(CPU_DEMCR) |= CPU_DEMCR_TRCENA;
+    HWREG(CPU_DWT_CYCCNT) = 0;
+    HWREG(CPU_DWT_CTRL) |= CPU_DWT_CTRL_CYCCNTENA;
+}
@@ -44,6 +44,12 @@ void gpio_init(void) {
     GPIOPortIntRegister(GPIO_B_BASE, gpio_b_interrupt);
     GPIOPortIntRegister(GPIO_C_BASE, gpio_c_interrupt);
     GPIOPortIntRegister(GPIO_D_BASE, gpio_d_interrupt);
+
+    // The ports share the lowest priority, so they cannot preempt each other
+    IntPrioritySet(INT_GPIOA, (7 << 5));
+    IntPrioritySet(INT_GPIOB, (7 << 5));
+    IntPrioritySet(INT_GPIOC, (7 << 5));
+    IntPrioritySet(INT_GPIOD, (7 << 5));
 }
 
 void gpio_config_output(uint8_t port, uint8_t pin) {
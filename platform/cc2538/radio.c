@@ -13,8 +13,11 @@
 
 #include "cc2538_include.h"
 
+#include "cpu.h"
 #include "debug.h"
+#include "latency.h"
 #include "radio.h"
+#include "recorder.h"
 
 /*================================ define ===================================*/
 
@@ -43,6 +46,20 @@
 #define CC2538_RF_CCA_BUSY                      ( 0x00 )
 #define CC2538_RF_CCA_THRESHOLD                 ( 0xF8 )
 
+// Defines for the uDMA, the software channel moves the frames to and from the FIFOs
+#define CC2538_RF_UDMA_CHANNEL                  ( UDMA_CH30_SW )
+#define CC2538_RF_UDMA_CONTROL                  ( UDMA_SIZE_8 | UDMA_ARB_128 )
+
+// Defines for the RF errors that are reported
+#define CC2538_RF_ERRORS                        ( RFCORE_SFR_RFERRF_STROBEERR | \
+                                                  RFCORE_SFR_RFERRF_TXUNDERF | \
+                                                  RFCORE_SFR_RFERRF_TXOVERF | \
+                                                  RFCORE_SFR_RFERRF_RXUNDERF | \
+                                                  RFCORE_SFR_RFERRF_RXOVERF )
+
+// Check whether a transmission is on the air
+#define CC2538_RF_TX_ACTIVE()                   ( HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE )
+
 // Defines for the CSP (Command Strobe Processor)
 #define CC2538_RF_CSP_OP_ISRXON                 ( 0xE3 )
 #define CC2538_RF_CSP_OP_ISTXON                 ( 0xE9 )
@@ -80,17 +97,44 @@
 
 /*================================ typedef ==================================*/
 
+typedef enum {
+    RADIO_UDMA_IDLE = 0x00,
+    RADIO_UDMA_RX   = 0x01,
+    RADIO_UDMA_TX   = 0x02
+} radio_udma_transfer_t;
+
+typedef struct {
+    radio_udma_transfer_t transfer;     ///< What the channel is moving
+    packet_buffer_t* packet_buffer;     ///< Buffer the frame is read to
+    radio_packet_cb_t packet_cb;        ///< Called once the frame is in it
+    uint8_t length;
+    bool transmit;                      ///< Send once the frame is in the FIFO
+} radio_udma_vars_t;
+
 /*=============================== variables =================================*/
 
 radio_vars_t radio_vars;
 
+static radio_udma_vars_t radio_udma_vars;
+
+// Control table of the uDMA, only the primary structures of the channels,
+// the linker script places it at the start of SRAM1, which is aligned to 1 KB
+static tDMAControlTable radio_udma_table[32] __attribute__ ((section(".udma"), aligned(1024)));
+
 /*=============================== prototypes ================================*/
 
+static void radio_off(void);
+static void radio_report(radio_error_t error);
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb);
+static void radio_udma_start(radio_udma_transfer_t transfer, void* source, void* destination, uint8_t length, uint32_t control);
+static void radio_udma_done(bool success);
+
 /*================================= public ==================================*/
 
 void radio_init(void) {
     /* Initialize the memory of the radio variables */
     memset(&radio_vars, 0, sizeof(radio_vars_t));
+    memset(&radio_udma_vars, 0, sizeof(radio_udma_vars_t));
 
     /* Enable peripheral except in deep sleep modes (e.g. LPM1, LPM2, LPM3) */
     SysCtrlPeripheralEnable(SYS_CTRL_PERIPH_RFC);
@@ -153,77 +197,85 @@ void radio_init(void) {
     HWREG(RFCORE_XREG_TXPOWER)   = CC2538_RF_TX_POWER_DEFAULT;
     HWREG(RFCORE_XREG_FREQCTRL)  = CC2538_RF_CHANNEL_MIN;
 
+    /* Enable the uDMA and its software channel for the FIFOs */
+    uDMAEnable();
+    uDMAControlBaseSet(radio_udma_table);
+    uDMAChannelAssign(CC2538_RF_UDMA_CHANNEL);
+    uDMAChannelAttributeDisable(CC2538_RF_UDMA_CHANNEL, UDMA_ATTR_ALL);
+
+    /* The uDMA interrupts finish the work of the radio, they share its priority */
+    IntPrioritySet(INT_UDMA, (5 << 5));
+    IntPrioritySet(INT_UDMAERR, (5 << 5));
+    IntEnable(INT_UDMA);
+    IntEnable(INT_UDMAERR);
+
     /* Update the radio state */
     radio_vars.current_state = RADIO_OFF;
 }
 
 void radio_idle(void) {
-    /* Wait for ongoing TX to complete (e.g. this could be an outgoing ACK) */
-    while (HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)
-        ;
-
-    /* Don't turn off if we are off as this will trigger a Strobe Error */
-    if (HWREG(RFCORE_XREG_RXENABLE) != 0) {
-        /* Turn off the radio */
-        CC2538_RF_CSP_ISRFOFF();
+    /* Go idle once an ongoing TX ends (e.g. this could be an outgoing ACK) */
+    if (CC2538_RF_TX_ACTIVE()) {
+        radio_vars.idle_pending = true;
+        return;
     }
 
-    /* Update the radio state */
-    radio_vars.current_state = RADIO_IDLE;
+    /* Turn off the radio now */
+    radio_off();
 }
 
 void radio_receive(void) {
     /* Flush the RX buffer */
     CC2538_RF_CSP_ISFLUSHRX();
 
-    /* Set the radio state to receive */
+    /* Set the radio state to receive, it listens after the turnaround */
+    radio_vars.idle_pending = false;
     radio_vars.current_state = RADIO_RX_ENABLING;
 
     /* Enable receive mode */
     CC2538_RF_CSP_ISRXON();
-
-    /* Busy-wait until radio really listening */
-    while(!((HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_RX_ACTIVE)))
-        ;
-
-    /* Set the radio state to receive */
-    radio_vars.current_state = RADIO_RX_ENABLED;
 }
 
 void radio_transmit(void) {
+    bool disabled;
+
     /* Make sure we are not transmitting already */
-    while(HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)
-        ;
+    if (CC2538_RF_TX_ACTIVE()) {
+        radio_report(RADIO_ERROR_BUSY);
+        return;
+    }
 
-    /* Set the radio state to transmit */
+    /* Set the radio state to transmit, it sends after the turnaround */
+    radio_vars.idle_pending = false;
     radio_vars.current_state = RADIO_TX_ENABLING;
 
-    /* Enable transmit mode */
-    CC2538_RF_CSP_ISTXON();
-
-    /* Busy-wait until radio really transmitting */
-    while(!((HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)))
-        ;
-
-    /* Set the radio state to transmit */
-    radio_vars.current_state = RADIO_TX_ENABLED;
+    /* Enable transmit mode, or let the uDMA interrupt do it once the whole packet is in the TX buffer */
+    disabled = cpu_disable_interrupts();
+    if (radio_udma_vars.transfer == RADIO_UDMA_TX) {
+        radio_udma_vars.transmit = true;
+    } else {
+        CC2538_RF_CSP_ISTXON();
+    }
+    cpu_restore_interrupts(disabled);
 }
 
 void radio_reset(void) {
-    /* Wait for ongoing TX to complete (e.g. this could be an outgoing ACK) */
-    while (HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)
-        ;
-
-    /* Flush the RX and TX buffers */
-    CC2538_RF_CSP_ISFLUSHRX();
-    CC2538_RF_CSP_ISFLUSHTX();
+    /* Stop the uDMA so that it does not refill the buffers, a packet being read is dropped */
+    uDMAChannelDisable(CC2538_RF_UDMA_CHANNEL);
+    radio_udma_vars.transfer = RADIO_UDMA_IDLE;
+    radio_udma_vars.transmit = false;
 
     /* Don't turn off if we are off since this will trigger a Strobe Error */
-    if (HWREG(RFCORE_XREG_RXENABLE) != 0) {
-        /* Turn off the radio */
+    radio_vars.idle_pending = false;
+    if (HWREG(RFCORE_XREG_RXENABLE) != 0 || CC2538_RF_TX_ACTIVE()) {
+        /* Turn off the radio, this aborts an ongoing TX */
         CC2538_RF_CSP_ISRFOFF();
     }
 
+    /* Flush the RX and TX buffers */
+    CC2538_RF_CSP_ISFLUSHRX();
+    CC2538_RF_CSP_ISFLUSHTX();
+
     /* Update the radio state */
     radio_vars.current_state = RADIO_OFF;
 }
@@ -238,6 +290,10 @@ void radio_set_tx_cb(radio_cb_t tx_init_cb, radio_cb_t tx_done_cb) {
     radio_vars.tx_done = tx_done_cb;
 }
 
+void radio_set_error_cb(radio_error_cb_t error_cb) {
+    radio_vars.error = error_cb;
+}
+
 void radio_cancel_rx_cb(void) {
     radio_vars.rx_init = NULL;
     radio_vars.rx_done = NULL;
@@ -255,16 +311,16 @@ void radio_enable_interrupts(void) {
     /* Enable RF interrupts 1, TXDONE only */
     HWREG(RFCORE_XREG_RFIRQM1) |= ((0x02) << RFCORE_XREG_RFIRQM1_RFIRQM_S) & RFCORE_XREG_RFIRQM1_RFIRQM_M;
 
-    /* Enable RF error interrupts */
-    // HWREG(RFCORE_XREG_RFERRM) = RFCORE_XREG_RFERRM_RFERRM_M;
+    /* Enable RF error interrupts, strobe errors and FIFO overflows and underflows only */
+    HWREG(RFCORE_XREG_RFERRM) = CC2538_RF_ERRORS;
 
-    /* Set the RF interrupt interrupt priority */
-    IntPrioritySet(INT_RFCORERTX, (6 << 5));
-    // IntPrioritySet(INT_RFCOREERR, (7 << 5));
+    /* Set the RF interrupt priority, above the UART and the sleep timer */
+    IntPrioritySet(INT_RFCORERTX, (5 << 5));
+    IntPrioritySet(INT_RFCOREERR, (5 << 5));
 
     /* Enable radio interrupts */
     IntEnable(INT_RFCORERTX);
-    // IntEnable(INT_RFCOREERR);
+    IntEnable(INT_RFCOREERR);
 }
 
 void radio_disable_interrupts(void) {
@@ -274,9 +330,12 @@ void radio_disable_interrupts(void) {
     /* Disable RF interrupts 1, TXDONE only */
     HWREG(RFCORE_XREG_RFIRQM1) = 0;
 
+    /* Disable RF error interrupts */
+    HWREG(RFCORE_XREG_RFERRM) = 0;
+
     /* Disable the radio interrupts */
     IntDisable(INT_RFCORERTX);
-    // IntDisable(INT_RFCOREERR);
+    IntDisable(INT_RFCOREERR);
 }
 
 void radio_set_channel(uint8_t channel) {
@@ -294,12 +353,14 @@ void radio_set_power(uint8_t power) {
     HWREG(RFCORE_XREG_TXPOWER) = power;
 }
 
-/* Gets a packet from the radio buffer */
-void radio_get_packet(packet_buffer_t* packet_buffer) {
+/* Gets a packet from the radio buffer, the uDMA interrupt calls packet_cb once it is in the buffer */
+void radio_get_packet(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
     uint8_t packet_length;
-    uint8_t scratch;
 
-    if (radio_vars.current_state != RADIO_RX_DONE) {
+    /* Make sure there is a packet and the uDMA is not moving another one */
+    if (radio_vars.current_state != RADIO_RX_DONE ||
+        radio_udma_vars.transfer != RADIO_UDMA_IDLE) {
+        radio_lost(packet_buffer, packet_cb);
         return;
     }
 
@@ -312,6 +373,7 @@ void radio_get_packet(packet_buffer_t* packet_buffer) {
         /* Flush the RX buffer */
         CC2538_RF_CSP_ISFLUSHRX();
 
+        radio_lost(packet_buffer, packet_cb);
         return;
     }
 
@@ -323,43 +385,30 @@ void radio_get_packet(packet_buffer_t* packet_buffer) {
         /* Flush the RX buffer */
         CC2538_RF_CSP_ISFLUSHRX();
 
+        radio_lost(packet_buffer, packet_cb);
         return;
     }
 
-    /* Copy the RX buffer to the buffer (except for the CRC) */
-    for (uint8_t i = 0; i < packet_length; i++) {
-        packet_buffer->payload[i] = HWREG(RFCORE_SFR_RFDATA);
-    }
-
-    /* Update the packet length */
-    packet_buffer->length = packet_length;
-
-    /* Update the packet RSSI */
-    packet_buffer->rssi = ((int8_t) (HWREG(RFCORE_SFR_RFDATA)) - CC2538_RF_RSSI_OFFSET);
-
-    /* Update the packet CRC and RSSI */
-    scratch            = HWREG(RFCORE_SFR_RFDATA);
-    packet_buffer->crc = scratch & CC2538_RF_CRC_BITMASK;
-    packet_buffer->lqi = scratch & CC2538_RF_LQI_BITMASK;
-
-    /* Flush the RX buffer */
-    CC2538_RF_CSP_ISFLUSHRX();
-
-    /* Set the radio state to idle */
-    radio_vars.current_state = RADIO_IDLE;
+    /* Copy the RX buffer to the buffer (except for the CRC) with the uDMA */
+    radio_udma_vars.packet_buffer = packet_buffer;
+    radio_udma_vars.packet_cb     = packet_cb;
+    radio_udma_vars.length        = packet_length;
+    radio_udma_start(RADIO_UDMA_RX, (void*) RFCORE_SFR_RFDATA, packet_buffer->payload, packet_length,
+                     UDMA_SRC_INC_NONE | UDMA_DST_INC_8);
 }
 
 /* Puts a packet to the radio buffer */
-void radio_put_packet(packet_buffer_t* packet_buffer) {
+radio_error_t radio_put_packet(packet_buffer_t* packet_buffer) {
     uint8_t packet_length;
 
-    /* Make sure previous transmission is not still in progress */
-    while (HWREG(RFCORE_XREG_FSMSTAT1) & RFCORE_XREG_FSMSTAT1_TX_ACTIVE)
-        ;
+    /* Make sure previous transmission is not still in progress, nor the uDMA moving a previous packet */
+    if (CC2538_RF_TX_ACTIVE() || radio_udma_vars.transfer != RADIO_UDMA_IDLE) {
+        return RADIO_ERROR_BUSY;
+    }
 
     /* Check if the radio state is correct */
     if (radio_vars.current_state != RADIO_IDLE) {
-        return;
+        return RADIO_ERROR_STATE;
     }
 
     /* Account for the CRC bytes */
@@ -368,7 +417,7 @@ void radio_put_packet(packet_buffer_t* packet_buffer) {
     /* Check if packet is too long */
     if ((packet_length >  CC2538_RF_MAX_PACKET_LEN) ||
         (packet_length <= CC2538_RF_MIN_PACKET_LEN)) {
-        return;
+        return RADIO_ERROR_LENGTH;
     }
 
     /* Flush the TX buffer */
@@ -377,24 +426,159 @@ void radio_put_packet(packet_buffer_t* packet_buffer) {
     /* Append the PHY length to the TX buffer */
     HWREG(RFCORE_SFR_RFDATA) = packet_length;
 
-    /* Append the packet payload to the TX buffer */
-    for (uint8_t i = 0; i < packet_length; i++) {
-        HWREG(RFCORE_SFR_RFDATA) = packet_buffer->buffer[i];
-    }
+    /* Append the packet payload to the TX buffer with the uDMA, radio_transmit sends once it is done */
+    radio_udma_start(RADIO_UDMA_TX, packet_buffer->buffer, (void*) RFCORE_SFR_RFDATA, packet_length,
+                     UDMA_SRC_INC_8 | UDMA_DST_INC_NONE);
+
+    return RADIO_SUCCESS;
 }
 
-void radio_read_rssi(int8_t* rssi) {
-    // Wait until the RSSI is valid
-    while(!(HWREG(RFCORE_XREG_RSSISTAT) & RFCORE_XREG_RSSISTAT_RSSI_VALID));
+radio_error_t radio_read_rssi(int8_t* rssi) {
+    radio_error_t error = RADIO_SUCCESS;
 
-    // Read the RSSI value
-    *rssi = ((int8_t) (HWREG(RFCORE_XREG_RSSI)) - CC2538_RF_RSSI_OFFSET);
+    // Read the RSSI value, which is valid once the receiver has settled
+    if (HWREG(RFCORE_XREG_RSSISTAT) & RFCORE_XREG_RSSISTAT_RSSI_VALID) {
+        *rssi = ((int8_t) (HWREG(RFCORE_XREG_RSSI)) - CC2538_RF_RSSI_OFFSET);
+    } else {
+        *rssi = RADIO_RSSI_INVALID;
+        error = RADIO_ERROR_RSSI;
+    }
+
+    // Record the RSSI value
+    recorder_rssi(*rssi);
+
+    return error;
+}
+
+bsp_timer_width_t radio_get_sfd(void) {
+    return radio_vars.sfd;
 }
 
 /*================================ private ==================================*/
 
+static void radio_off(void) {
+    radio_vars.idle_pending = false;
+
+    /* Don't turn off if we are off as this will trigger a Strobe Error */
+    if (HWREG(RFCORE_XREG_RXENABLE) != 0) {
+        /* Turn off the radio */
+        CC2538_RF_CSP_ISRFOFF();
+    }
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_IDLE;
+}
+
+static void radio_report(radio_error_t error) {
+    if (radio_vars.error != NULL) {
+        radio_vars.error(error);
+    }
+}
+
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
+    /* Tell the MAC that the buffer holds no packet */
+    packet_buffer->length = 0;
+    packet_buffer->crc    = 0;
+    if (packet_cb != NULL) {
+        packet_cb(packet_buffer);
+    }
+}
+
+static void radio_udma_start(radio_udma_transfer_t transfer, void* source, void* destination, uint8_t length, uint32_t control) {
+    radio_udma_vars.transfer = transfer;
+
+    /* Program the primary structure of the channel */
+    uDMAChannelControlSet(CC2538_RF_UDMA_CHANNEL | UDMA_PRI_SELECT, CC2538_RF_UDMA_CONTROL | control);
+    uDMAChannelTransferSet(CC2538_RF_UDMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_AUTO,
+                           source, destination, length);
+
+    /* Start the transfer, the channel is disabled again when it finishes */
+    uDMAChannelEnable(CC2538_RF_UDMA_CHANNEL);
+    uDMAChannelRequest(CC2538_RF_UDMA_CHANNEL);
+}
+
+static void radio_udma_done(bool success) {
+    packet_buffer_t* packet_buffer = radio_udma_vars.packet_buffer;
+    radio_udma_transfer_t transfer = radio_udma_vars.transfer;
+    uint8_t scratch;
+
+    radio_udma_vars.transfer = RADIO_UDMA_IDLE;
+
+    if (transfer == RADIO_UDMA_RX) {
+        /* The transfer failed, flush the RX buffer and drop the packet */
+        if (!success) {
+            CC2538_RF_CSP_ISFLUSHRX();
+            radio_lost(packet_buffer, radio_udma_vars.packet_cb);
+            return;
+        }
+
+        /* Update the packet length */
+        packet_buffer->length = radio_udma_vars.length;
+
+        /* Update the packet RSSI */
+        packet_buffer->rssi = ((int8_t) (HWREG(RFCORE_SFR_RFDATA)) - CC2538_RF_RSSI_OFFSET);
+
+        /* Update the packet CRC and LQI */
+        scratch            = HWREG(RFCORE_SFR_RFDATA);
+        packet_buffer->crc = scratch & CC2538_RF_CRC_BITMASK;
+        packet_buffer->lqi = scratch & CC2538_RF_LQI_BITMASK;
+
+        /* Record the packet */
+        recorder_packet(packet_buffer);
+
+        /* Flush the RX buffer */
+        CC2538_RF_CSP_ISFLUSHRX();
+
+        /* Set the radio state to idle, unless the MAC has moved on */
+        if (radio_vars.current_state == RADIO_RX_DONE) {
+            radio_vars.current_state = RADIO_IDLE;
+        }
+
+        /* Hand the packet to the MAC */
+        if (radio_udma_vars.packet_cb != NULL) {
+            radio_udma_vars.packet_cb(packet_buffer);
+        }
+    } else if (transfer == RADIO_UDMA_TX) {
+        /* The transfer failed, the packet in the TX buffer is not whole */
+        if (!success) {
+            CC2538_RF_CSP_ISFLUSHTX();
+            radio_udma_vars.transmit = false;
+            radio_vars.current_state = RADIO_ERROR;
+            radio_report(RADIO_ERROR_TX_UNDERFLOW);
+            return;
+        }
+
+        /* Send the packet if radio_transmit was called while it was being moved */
+        if (radio_udma_vars.transmit) {
+            radio_udma_vars.transmit = false;
+            CC2538_RF_CSP_ISTXON();
+        }
+    }
+}
+
+void udma_interrupt(void) {
+    /* Clear the completion of the software channel */
+    uDMAIntClear(uDMAIntStatus());
+
+    /* The transfer failed if it left items to move */
+    radio_udma_done(uDMAChannelSizeGet(CC2538_RF_UDMA_CHANNEL | UDMA_PRI_SELECT) == 0);
+}
+
+void udma_error_interrupt(void) {
+    /* Stop the channel and drop what it was moving */
+    uDMAErrorStatusClear();
+    uDMAChannelDisable(CC2538_RF_UDMA_CHANNEL);
+    radio_udma_done(false);
+}
+
 void rf_core_interrupt(void) {
     uint32_t irq_status0, irq_status1;
+#if LATENCY_ENABLED
+    uint32_t start;
+
+    // The SFD latency is counted from the entry of the interrupt
+    start = cpu_cycles_get();
+#endif
 
     debug_isr_on();
 
@@ -408,12 +592,21 @@ void rf_core_interrupt(void) {
 
     /* STATUS0 Register: Start of frame event */
     if ((irq_status0 & RFCORE_SFR_RFIRQF0_SFD) == RFCORE_SFR_RFIRQF0_SFD) {
-        if (radio_vars.current_state == RADIO_RX_ENABLED &&
+        // Timestamp the frame, the interrupt is taken within the same tick
+        radio_vars.sfd = bsp_timer_get();
+
+        if ((radio_vars.current_state == RADIO_RX_ENABLING ||
+             radio_vars.current_state == RADIO_RX_ENABLED) &&
             radio_vars.rx_init != NULL) {
             radio_vars.current_state = RADIO_RX_RECEIVING;
+            recorder_sfd();
+#if LATENCY_ENABLED
+            latency_sfd(start);
+#endif
             radio_vars.rx_init();
         }
-        else if (radio_vars.current_state == RADIO_TX_ENABLED &&
+        else if ((radio_vars.current_state == RADIO_TX_ENABLING ||
+                  radio_vars.current_state == RADIO_TX_ENABLED) &&
                  radio_vars.tx_init != NULL) {
             radio_vars.current_state = RADIO_TX_TRANSMITTING;
             radio_vars.tx_init();
@@ -428,6 +621,7 @@ void rf_core_interrupt(void) {
         if (radio_vars.current_state == RADIO_RX_RECEIVING &&
             radio_vars.rx_done != NULL) {
             radio_vars.current_state = RADIO_RX_DONE;
+            recorder_rx_done();
             radio_vars.rx_done();
         }
         else {
@@ -450,6 +644,11 @@ void rf_core_interrupt(void) {
         else {
             // radio_idle();
         }
+
+        /* Go idle if it was requested during the transmission */
+        if (radio_vars.idle_pending) {
+            radio_off();
+        }
     }
 
     debug_isr_off();
@@ -458,10 +657,37 @@ void rf_core_interrupt(void) {
 void rf_error_interrupt(void) {
     uint32_t irq_error;
 
+    debug_isr_on();
+
     /* Read RFERR_STATUS */
     irq_error = HWREG(RFCORE_SFR_RFERRF);
 
-    /* Clear interrupt flags and mask */
+    /* Clear interrupt flags */
     HWREG(RFCORE_SFR_RFERRF) = 0;
-    HWREG(RFCORE_XREG_RFERRM) = 0;
+
+    /* RX FIFO error, the frame being received is lost */
+    if (irq_error & (RFCORE_SFR_RFERRF_RXOVERF | RFCORE_SFR_RFERRF_RXUNDERF)) {
+        CC2538_RF_CSP_ISFLUSHRX();
+        radio_vars.current_state = RADIO_ERROR;
+        radio_report((irq_error & RFCORE_SFR_RFERRF_RXOVERF) ? RADIO_ERROR_RX_OVERFLOW : RADIO_ERROR_RX_UNDERFLOW);
+    }
+
+    /* TX FIFO error, the frame being sent is lost */
+    if (irq_error & (RFCORE_SFR_RFERRF_TXOVERF | RFCORE_SFR_RFERRF_TXUNDERF)) {
+        CC2538_RF_CSP_ISFLUSHTX();
+        radio_vars.current_state = RADIO_ERROR;
+        radio_report((irq_error & RFCORE_SFR_RFERRF_TXOVERF) ? RADIO_ERROR_TX_OVERFLOW : RADIO_ERROR_TX_UNDERFLOW);
+    }
+
+    /* Command strobe error */
+    if (irq_error & RFCORE_SFR_RFERRF_STROBEERR) {
+        radio_report(RADIO_ERROR_STROBE);
+    }
+
+    /* Go idle if it was requested during a transmission that failed */
+    if (radio_vars.idle_pending && !CC2538_RF_TX_ACTIVE()) {
+        radio_off();
+    }
+
+    debug_isr_off();
 }
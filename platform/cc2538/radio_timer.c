@@ -0,0 +1,257 @@
+/**
+ * @file       radio_timer.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "cc2538_include.h"
+
+#include "radio_timer.h"
+
+/*================================ define ===================================*/
+
+// Cycles of 32 MHz between overflows, 1/1024 s or 32 ticks of the sleep timer
+#define RADIO_TIMER_PERIOD              ( 31250 )
+#define RADIO_TIMER_PERIOD_FINE         ( RADIO_TIMER_TICKS(32) )
+
+// Multiplexed registers of the MAC timer
+#define RADIO_TIMER_SEL_COUNTER         ( 0 )
+#define RADIO_TIMER_SEL_PERIOD          ( 2 )
+#define RADIO_TIMER_SEL_COMPARE1        ( 3 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    radio_timer_width_t anchor;     ///< Fine tick at which the MAC timer started
+    bool                starting;   ///< Started again, the anchor is not known yet
+    radio_timer_cb_t    callback;
+    radio_timer_width_t at;         ///< Fine tick at which the callback is due
+    bool                armed;
+} radio_timer_vars_t;
+
+/*=============================== variables =================================*/
+
+static radio_timer_vars_t radio_timer_vars;
+
+/*=============================== prototypes ================================*/
+
+static void radio_timer_started(void);
+static void radio_timer_arm(void);
+static void radio_timer_read(uint32_t* overflows, uint32_t* cycles);
+
+/*================================= public ==================================*/
+
+void radio_timer_init(void) {
+    // Initialize the memory of the radio_timer variables
+    memset(&radio_timer_vars, 0, sizeof(radio_timer_vars_t));
+
+    // The compare runs the callbacks at the priority of the radio
+    IntPrioritySet(INT_MACTIMR, (5 << 5));
+    IntEnable(INT_MACTIMR);
+
+    // Start the MAC timer, the radio clock is already enabled
+    radio_timer_sync();
+}
+
+void radio_timer_sync(void) {
+    bool disabled;
+
+    disabled = IntMasterDisable();
+
+    // Stop the MAC timer right away and clear its counters
+    HWREG(RFCORE_SFR_MTCTRL) = RFCORE_SFR_MTCTRL_LATCH_MODE;
+    HWREG(RFCORE_SFR_MTMSEL) = (RADIO_TIMER_SEL_COUNTER << RFCORE_SFR_MTMSEL_MTMOVFSEL_S) |
+                               (RADIO_TIMER_SEL_COUNTER << RFCORE_SFR_MTMSEL_MTMSEL_S);
+    HWREG(RFCORE_SFR_MTM0) = 0;
+    HWREG(RFCORE_SFR_MTM1) = 0;
+    HWREG(RFCORE_SFR_MTMOVF0) = 0;
+    HWREG(RFCORE_SFR_MTMOVF1) = 0;
+    HWREG(RFCORE_SFR_MTMOVF2) = 0;
+
+    // Overflow every RADIO_TIMER_PERIOD cycles
+    HWREG(RFCORE_SFR_MTMSEL) = (RADIO_TIMER_SEL_PERIOD << RFCORE_SFR_MTMSEL_MTMSEL_S);
+    HWREG(RFCORE_SFR_MTM0) = RADIO_TIMER_PERIOD & 0xFF;
+    HWREG(RFCORE_SFR_MTM1) = RADIO_TIMER_PERIOD >> 8;
+
+    // Start it on the next tick of the sleep timer, reading MTM0 latches the
+    // rest of the counters
+    HWREG(RFCORE_SFR_MTCTRL) = RFCORE_SFR_MTCTRL_LATCH_MODE | RFCORE_SFR_MTCTRL_SYNC | RFCORE_SFR_MTCTRL_RUN;
+
+    // Until it does, a compare is set as if it started on the tick after
+    // this one, which is never earlier than it does
+    radio_timer_vars.anchor   = RADIO_TIMER_TICKS(SleepModeTimerCountGet() + 1);
+    radio_timer_vars.starting = true;
+
+    // A compare set before counts from the previous start, set it again
+    if (radio_timer_vars.armed) {
+        radio_timer_arm();
+    }
+
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+radio_timer_width_t radio_timer_get(void) {
+    uint32_t overflows;
+    uint32_t cycles;
+
+    // Until the MAC timer starts the time is the tick of the sleep timer
+    radio_timer_started();
+    if (radio_timer_vars.starting) {
+        return RADIO_TIMER_TICKS(SleepModeTimerCountGet());
+    }
+
+    radio_timer_read(&overflows, &cycles);
+
+    return radio_timer_vars.anchor + overflows * RADIO_TIMER_PERIOD_FINE +
+           cycles * RADIO_TIMER_PERIOD_FINE / RADIO_TIMER_PERIOD;
+}
+
+void radio_timer_set_cb(radio_timer_cb_t callback) {
+    radio_timer_vars.callback = callback;
+}
+
+void radio_timer_start(radio_timer_width_t at) {
+    bool disabled;
+
+    disabled = IntMasterDisable();
+
+    // Remember when the callback is due and set the compare for it
+    radio_timer_vars.at    = at;
+    radio_timer_vars.armed = true;
+    radio_timer_arm();
+
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+void radio_timer_stop(void) {
+    bool disabled;
+
+    disabled = IntMasterDisable();
+
+    // Mask the compare and drop the interrupt it may have raised
+    radio_timer_vars.armed = false;
+    HWREG(RFCORE_SFR_MTIRQM) = 0;
+    HWREG(RFCORE_SFR_MTIRQF) = 0;
+    IntPendClear(INT_MACTIMR);
+
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+/*================================ private ==================================*/
+
+static void radio_timer_started(void) {
+    uint32_t ticks;
+    uint32_t overflows;
+    uint32_t cycles;
+    bool disabled;
+
+    // The anchor is known, or the MAC timer has not started yet
+    if (!radio_timer_vars.starting ||
+        !(HWREG(RFCORE_SFR_MTCTRL) & RFCORE_SFR_MTCTRL_STATE)) {
+        return;
+    }
+
+    disabled = IntMasterDisable();
+
+    // Take the tick at which it started from the ticks it has counted since,
+    // again if the sleep timer ticks in between
+    do {
+        ticks = SleepModeTimerCountGet();
+        radio_timer_read(&overflows, &cycles);
+    } while (ticks != SleepModeTimerCountGet());
+
+    ticks -= overflows * 32 + cycles * 32 / RADIO_TIMER_PERIOD;
+    radio_timer_vars.anchor   = RADIO_TIMER_TICKS(ticks);
+    radio_timer_vars.starting = false;
+
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+static void radio_timer_arm(void) {
+    radio_timer_width_t offset;
+    uint32_t overflows;
+    uint32_t cycles;
+
+    // Fine ticks from the start of the current period of the MAC timer
+    radio_timer_started();
+    radio_timer_read(&overflows, &cycles);
+    offset = radio_timer_vars.at - (radio_timer_vars.anchor + overflows * RADIO_TIMER_PERIOD_FINE);
+
+    if (offset < RADIO_TIMER_PERIOD_FINE) {
+        // Compare on the first cycle of the fine tick
+        cycles = (offset * RADIO_TIMER_PERIOD + RADIO_TIMER_PERIOD_FINE - 1) / RADIO_TIMER_PERIOD_FINE;
+        HWREG(RFCORE_SFR_MTMSEL) = (RADIO_TIMER_SEL_COMPARE1 << RFCORE_SFR_MTMSEL_MTMSEL_S);
+        HWREG(RFCORE_SFR_MTM0) = cycles & 0xFF;
+        HWREG(RFCORE_SFR_MTM1) = cycles >> 8;
+        HWREG(RFCORE_SFR_MTIRQM) = RFCORE_SFR_MTIRQM_MACTIMER_COMPARE1M;
+    } else {
+        // It falls in a later period, check again when this one overflows
+        HWREG(RFCORE_SFR_MTIRQM) = RFCORE_SFR_MTIRQM_MACTIMER_OVF_PERM;
+    }
+
+    // The fine tick may have passed, or passed while the compare was set
+    if ((int32_t) (radio_timer_vars.at - radio_timer_get()) <= 0) {
+        IntPendSet(INT_MACTIMR);
+    }
+}
+
+static void radio_timer_read(uint32_t* overflows, uint32_t* cycles) {
+    bool disabled;
+
+    // The counters are latched together, keep an interrupt from reading them
+    // in between
+    disabled = IntMasterDisable();
+
+    HWREG(RFCORE_SFR_MTMSEL) = (RADIO_TIMER_SEL_COUNTER << RFCORE_SFR_MTMSEL_MTMOVFSEL_S) |
+                               (RADIO_TIMER_SEL_COUNTER << RFCORE_SFR_MTMSEL_MTMSEL_S);
+    *cycles  = HWREG(RFCORE_SFR_MTM0);
+    *cycles |= HWREG(RFCORE_SFR_MTM1) << 8;
+    *overflows  = HWREG(RFCORE_SFR_MTMOVF0);
+    *overflows |= HWREG(RFCORE_SFR_MTMOVF1) << 8;
+    *overflows |= HWREG(RFCORE_SFR_MTMOVF2) << 16;
+
+    if (!disabled) {
+        IntMasterEnable();
+    }
+}
+
+/*=============================== interrupt =================================*/
+
+void radio_timer_interrupt(void) {
+    // Clear the flags of the MAC timer
+    HWREG(RFCORE_SFR_MTIRQF) = 0;
+
+    // Stopped in the meantime
+    if (!radio_timer_vars.armed) {
+        return;
+    }
+
+    // An overflow or a compare of a start that was ahead of time, set it
+    // again for the fine tick
+    if ((int32_t) (radio_timer_vars.at - radio_timer_get()) > 0) {
+        radio_timer_arm();
+        return;
+    }
+
+    // The fine tick has come, execute the callback function
+    radio_timer_vars.armed = false;
+    HWREG(RFCORE_SFR_MTIRQM) = 0;
+    if (radio_timer_vars.callback != NULL) {
+        radio_timer_vars.callback();
+    }
+}
@@ -109,8 +109,8 @@ void uart_enable_interrupts(void) {
     // Enable the UART peripheral interrupts
     UARTIntEnable(UART_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
 
-    // Set the UART peripheral interrupt priority
-    IntPrioritySet(UART_INTERRUPT, (5 << 5));
+    // Set the UART peripheral interrupt priority, below the radio
+    IntPrioritySet(UART_INTERRUPT, (6 << 5));
 
     // Enable the UART global interrupt
     IntEnable(UART_INTERRUPT);
@@ -0,0 +1,67 @@
+/**
+ * @file       board.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "board.h"
+#include "bsp_timer.h"
+#include "cpu.h"
+#include "debug.h"
+#include "flash.h"
+#include "gpio.h"
+#include "ieee-addr.h"
+#include "leds.h"
+#include "radio.h"
+#include "radio_timer.h"
+#include "random.h"
+#include "uart.h"
+
+#include "types.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void board_init(void) {
+    // Initialize the CPU
+    cpu_init();
+
+    // Initialize the board subsystems
+    gpio_init();
+    leds_init();
+    debug_init();
+
+    // Initialize the random module
+    random_init();
+
+    // Initialize the IEEE address
+    ieee_addr_init();
+
+    // Initialize the IEEE 802.15.4 radio
+    radio_init();
+
+    // Initialize the bsp and radio timers
+    bsp_timer_init();
+    radio_timer_init();
+
+    // Initialize the communication interfaces
+    uart_init();
+}
+
+/*================================ private ==================================*/
@@ -0,0 +1,118 @@
+/**
+ * @file       debug.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "debug.h"
+
+/*================================ define ===================================*/
+
+#define DEBUG_CLOCKS            ( 1 << 0 )
+#define DEBUG_SYSTEM            ( 1 << 1 )
+#define DEBUG_RADIO             ( 1 << 2 )
+#define DEBUG_ERROR             ( 1 << 3 )
+#define DEBUG_USER              ( 1 << 4 )
+#define DEBUG_ISR               ( 1 << 5 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint8_t pins;
+} debug_vars_t;
+
+/*=============================== variables =================================*/
+
+static debug_vars_t debug_vars;
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void debug_init(void) {
+    // Initialize the memory of the debug variables
+    memset(&debug_vars, 0, sizeof(debug_vars_t));
+}
+
+void debug_clocks_on(void) {
+    debug_vars.pins |= DEBUG_CLOCKS;
+}
+
+void debug_clocks_off(void) {
+    debug_vars.pins &= ~DEBUG_CLOCKS;
+}
+
+void debug_clocks_toggle(void) {
+    debug_vars.pins ^= DEBUG_CLOCKS;
+}
+
+void debug_system_on(void) {
+    debug_vars.pins |= DEBUG_SYSTEM;
+}
+
+void debug_system_off(void) {
+    debug_vars.pins &= ~DEBUG_SYSTEM;
+}
+
+void debug_system_toggle(void) {
+    debug_vars.pins ^= DEBUG_SYSTEM;
+}
+
+void debug_radio_on(void) {
+    debug_vars.pins |= DEBUG_RADIO;
+}
+
+void debug_radio_off(void) {
+    debug_vars.pins &= ~DEBUG_RADIO;
+}
+
+void debug_radio_toggle(void) {
+    debug_vars.pins ^= DEBUG_RADIO;
+}
+
+void debug_error_on(void) {
+    debug_vars.pins |= DEBUG_ERROR;
+}
+
+void debug_error_off(void) {
+    debug_vars.pins &= ~DEBUG_ERROR;
+}
+
+void debug_error_toggle(void) {
+    debug_vars.pins ^= DEBUG_ERROR;
+}
+
+void debug_user_on(void) {
+    debug_vars.pins |= DEBUG_USER;
+}
+
+void debug_user_off(void) {
+    debug_vars.pins &= ~DEBUG_USER;
+}
+
+void debug_user_toggle(void) {
+    debug_vars.pins ^= DEBUG_USER;
+}
+
+void debug_isr_on(void) {
+    debug_vars.pins |= DEBUG_ISR;
+}
+
+void debug_isr_off(void) {
+    debug_vars.pins &= ~DEBUG_ISR;
+}
+
+void debug_isr_toggle(void) {
+    debug_vars.pins ^= DEBUG_ISR;
+}
+
+/*================================ private ==================================*/
@@ -0,0 +1,34 @@
+/**
+ * @file       flash.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "flash.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void flash_erase_page(uint32_t address) {
+    // There is no persistent flash to erase on the host
+}
+
+/*================================ private ==================================*/
+
+/*=============================== interrupt =================================*/
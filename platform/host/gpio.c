@@ -0,0 +1,100 @@
+/**
+ * @file       gpio.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "gpio.h"
+
+/*================================ define ===================================*/
+
+#define GPIO_PORTS              ( 4 )
+#define GPIO_PINS               ( 8 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint8_t         output[GPIO_PORTS];
+    uint8_t         value[GPIO_PORTS];
+    uint8_t         interrupt[GPIO_PORTS];
+    gpio_callback_t callbacks[GPIO_PORTS][GPIO_PINS];
+} gpio_vars_t;
+
+/*=============================== variables =================================*/
+
+static gpio_vars_t gpio_vars;
+
+/*=============================== prototypes ================================*/
+
+static uint8_t gpio_get_index(uint8_t pin);
+
+/*================================= public ==================================*/
+
+void gpio_init(void) {
+    // Initialize the memory of the gpio variables
+    memset(&gpio_vars, 0, sizeof(gpio_vars_t));
+}
+
+void gpio_config_output(uint8_t port, uint8_t pin) {
+    gpio_vars.output[port & 0x03] |= pin;
+}
+
+void gpio_config_input(uint8_t port, uint8_t pin, uint8_t edge) {
+    gpio_vars.output[port & 0x03] &= ~pin;
+}
+
+void gpio_register_callback(uint8_t port, uint8_t pin, gpio_callback_t callback) {
+    gpio_vars.callbacks[port & 0x03][gpio_get_index(pin)] = callback;
+}
+
+void gpio_clear_callback(uint8_t port, uint8_t pin) {
+    gpio_vars.callbacks[port & 0x03][gpio_get_index(pin)] = NULL;
+}
+
+void gpio_enable_interrupt(uint8_t port, uint8_t pin) {
+    gpio_vars.interrupt[port & 0x03] |= pin;
+}
+
+void gpio_disable_interrupt(uint8_t port, uint8_t pin) {
+    gpio_vars.interrupt[port & 0x03] &= ~pin;
+}
+
+void gpio_on(uint8_t port, uint8_t pin) {
+    gpio_vars.value[port & 0x03] |= pin;
+}
+
+void gpio_off(uint8_t port, uint8_t pin) {
+    gpio_vars.value[port & 0x03] &= ~pin;
+}
+
+void gpio_toggle(uint8_t port, uint8_t pin) {
+    gpio_vars.value[port & 0x03] ^= pin;
+}
+
+bool gpio_read(uint8_t port, uint8_t pin) {
+    return ((gpio_vars.value[port & 0x03] & pin) != 0);
+}
+
+/*================================ private ==================================*/
+
+static uint8_t gpio_get_index(uint8_t pin) {
+    uint8_t index = 0;
+
+    // Convert the pin mask to the index of its lowest pin
+    while (index < (GPIO_PINS - 1) && (pin & (1 << index)) == 0) {
+        index++;
+    }
+
+    return index;
+}
+
+/*=============================== interrupt =================================*/
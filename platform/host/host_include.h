@@ -0,0 +1,55 @@
+/**
+ * @file       host_include.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Interface of the drivers shared by the host platforms.
+ *
+ *             The posix and sim platforms run the firmware on the host and
+ *             only differ in how time passes and in what a node is, so the
+ *             drivers that do not touch the sleep timer, the radio, the CPU
+ *             or the UART are shared and take those from the platform: the
+ *             posix emulation core or the simulation kernel.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef HOST_INCLUDE_
+#define HOST_INCLUDE_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+/*================================ define ===================================*/
+
+#define HOST_TICKS_PER_SECOND           ( 32768ULL )
+#define HOST_NS_PER_SECOND              ( 1000000000ULL )
+
+// Texas Instruments OUI, as found in the CC2538 information page
+#define HOST_EUI64_OUI                  { 0x00, 0x12, 0x4B, 0x00 }
+
+/*================================ typedef ==================================*/
+
+typedef void (* host_isr_t)(void);
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+uint64_t host_time_get(void);
+void host_error(const char* reason);
+
+uint16_t host_seed(void);
+void host_eui64(uint8_t* address);
+
+void host_mactimer_init(host_isr_t isr);
+void host_mactimer_set(uint64_t time_ns);
+void host_mactimer_cancel(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* HOST_INCLUDE_ */
@@ -0,0 +1,51 @@
+/**
+ * @file       ieee-addr.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "ieee-addr.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint8_t eui64_addr[8];
+} ieee_addr_vars_t;
+
+/*=============================== variables =================================*/
+
+static ieee_addr_vars_t ieee_addr_vars;
+
+/*=============================== prototypes ================================*/
+
+static void ieee_addr_init_eui64(uint8_t* address);
+
+/*================================= public ==================================*/
+
+void ieee_addr_init(void) {
+    ieee_addr_init_eui64(ieee_addr_vars.eui64_addr);
+}
+
+void ieee_addr_get_eui16(uint16_t* address) {
+    *address = (ieee_addr_vars.eui64_addr[6] << 8) | (ieee_addr_vars.eui64_addr[7] << 0);
+}
+
+/*================================ private ==================================*/
+
+static void ieee_addr_init_eui64(uint8_t* address) {
+    // The platform gives each node its own address
+    host_eui64(address);
+}
+
+/*=============================== interrupt =================================*/
@@ -0,0 +1,113 @@
+/**
+ * @file       leds.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "leds.h"
+
+/*================================ define ===================================*/
+
+#define LEDS_SYSTEM             ( 1 << 0 )
+#define LEDS_RADIO              ( 1 << 1 )
+#define LEDS_ERROR              ( 1 << 2 )
+#define LEDS_USER               ( 1 << 3 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint8_t leds;
+} leds_vars_t;
+
+/*=============================== variables =================================*/
+
+static leds_vars_t leds_vars;
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void leds_init(void) {
+    // Initialize the memory of the leds variables
+    memset(&leds_vars, 0, sizeof(leds_vars_t));
+}
+
+void leds_all_on(void) {
+    leds_system_on();
+    leds_error_on();
+    leds_radio_on();
+    leds_user_on();
+}
+
+void leds_all_off(void) {
+    leds_system_off();
+    leds_error_off();
+    leds_radio_off();
+    leds_user_off();
+}
+
+void leds_system_on(void) {
+    leds_vars.leds |= LEDS_SYSTEM;
+}
+
+void leds_system_off(void) {
+    leds_vars.leds &= ~LEDS_SYSTEM;
+}
+
+void leds_system_toggle(void) {
+    leds_vars.leds ^= LEDS_SYSTEM;
+}
+
+void leds_radio_on(void) {
+    leds_vars.leds |= LEDS_RADIO;
+}
+
+void leds_radio_off(void) {
+    leds_vars.leds &= ~LEDS_RADIO;
+}
+
+void leds_radio_toggle(void) {
+    leds_vars.leds ^= LEDS_RADIO;
+}
+
+void leds_error_on(void) {
+    leds_vars.leds |= LEDS_ERROR;
+
+    // The error LED always precedes a lock-up, so stop the node instead
+    host_error("error led on");
+}
+
+void leds_error_off(void) {
+    leds_vars.leds &= ~LEDS_ERROR;
+}
+
+void leds_error_toggle(void) {
+    if (leds_vars.leds & LEDS_ERROR) {
+        leds_error_off();
+    } else {
+        leds_error_on();
+    }
+}
+
+void leds_user_on(void) {
+    leds_vars.leds |= LEDS_USER;
+}
+
+void leds_user_off(void) {
+    leds_vars.leds &= ~LEDS_USER;
+}
+
+void leds_user_toggle(void) {
+    leds_vars.leds ^= LEDS_USER;
+}
+
+/*================================ private ==================================*/
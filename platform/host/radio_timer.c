@@ -0,0 +1,110 @@
+/**
+ * @file       radio_timer.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "radio_timer.h"
+
+/*================================ define ===================================*/
+
+#define RADIO_TIMER_PER_SECOND          ( HOST_TICKS_PER_SECOND << RADIO_TIMER_SHIFT )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    radio_timer_cb_t callback;
+    bool             armed;
+} radio_timer_vars_t;
+
+/*=============================== variables =================================*/
+
+static radio_timer_vars_t radio_timer_vars;
+
+/*=============================== prototypes ================================*/
+
+static uint64_t radio_timer_to_time(radio_timer_width_t fine);
+
+void radio_timer_interrupt(void);
+
+/*================================= public ==================================*/
+
+void radio_timer_init(void) {
+    // Initialize the memory of the radio_timer variables
+    memset(&radio_timer_vars, 0, sizeof(radio_timer_vars_t));
+
+    // Register the compare interrupt handler
+    host_mactimer_init(radio_timer_interrupt);
+}
+
+void radio_timer_sync(void) {
+    // The emulated time goes on while sleeping
+}
+
+radio_timer_width_t radio_timer_get(void) {
+    uint64_t time, seconds, fraction;
+
+    // Split to avoid overflowing the 64-bit intermediate product
+    time     = host_time_get();
+    seconds  = time / HOST_NS_PER_SECOND;
+    fraction = time % HOST_NS_PER_SECOND;
+
+    return (radio_timer_width_t) ((seconds * RADIO_TIMER_PER_SECOND) +
+                                  (fraction * RADIO_TIMER_PER_SECOND) / HOST_NS_PER_SECOND);
+}
+
+void radio_timer_set_cb(radio_timer_cb_t callback) {
+    radio_timer_vars.callback = callback;
+}
+
+void radio_timer_start(radio_timer_width_t at) {
+    int32_t remaining;
+
+    radio_timer_vars.armed = true;
+
+    // Set the compare for the fine tick, right away if it has passed
+    remaining = (int32_t) (at - radio_timer_get());
+    if (remaining <= 0) {
+        host_mactimer_set(host_time_get());
+    } else {
+        host_mactimer_set(host_time_get() + radio_timer_to_time(remaining));
+    }
+}
+
+void radio_timer_stop(void) {
+    radio_timer_vars.armed = false;
+
+    // Disarm the compare so that a stale match does not fire later
+    host_mactimer_cancel();
+}
+
+/*================================ private ==================================*/
+
+static uint64_t radio_timer_to_time(radio_timer_width_t fine) {
+    // Round up so that the fine tick has come at that time
+    return ((uint64_t) fine * HOST_NS_PER_SECOND + RADIO_TIMER_PER_SECOND - 1) / RADIO_TIMER_PER_SECOND;
+}
+
+/*=============================== interrupt =================================*/
+
+void radio_timer_interrupt(void) {
+    // Stopped in the meantime
+    if (!radio_timer_vars.armed) {
+        return;
+    }
+
+    // Execute the callback function
+    radio_timer_vars.armed = false;
+    if (radio_timer_vars.callback != NULL) {
+        radio_timer_vars.callback();
+    }
+}
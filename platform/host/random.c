@@ -0,0 +1,74 @@
+/**
+ * @file       random.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "host_include.h"
+
+#include "random.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint16_t shift_reg;
+} random_vars_t;
+
+/*=============================== variables =================================*/
+
+static random_vars_t random_vars;
+
+/*=============================== prototypes ================================*/
+
+static uint16_t random_seed(void);
+
+/*================================= public ==================================*/
+
+void random_init(void) {
+    // Initialize the memory of the random variables
+    memset(&random_vars, 0, sizeof(random_vars_t));
+
+    // Initialize the shift register
+    random_vars.shift_reg = random_seed();
+}
+
+uint16_t random_get(void) {
+    uint16_t random_value = 0;
+
+    // Galois shift register with taps: 16, 14, 13, 11
+    // Characteristic polynomial: x^16 + x^14 + x^13 + x^11 + 1
+    for (uint8_t i = 0; i < 16; i++) {
+        random_value |= (random_vars.shift_reg & 0x01) << i;
+        random_vars.shift_reg = (random_vars.shift_reg >> 1)
+                ^ (-(int16_t) (random_vars.shift_reg & 1) & 0xB400);
+    }
+
+    return random_value;
+}
+
+/*================================ private ==================================*/
+
+static uint16_t random_seed(void) {
+    uint16_t seed;
+
+    // The platform gives each node its own seed
+    seed = host_seed();
+
+    // The shift register does not work with these seeds (0x0000 and 0x8003)
+    if (seed == 0x0000 || seed == 0x8003) {
+        seed = 0xACE1;
+    }
+
+    return seed;
+}
+
+/*=============================== interrupt =================================*/
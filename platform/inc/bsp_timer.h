@@ -18,6 +18,9 @@
 
 /*================================ define ===================================*/
 
+// Shortest delay of the compare, a shorter one fires the interrupt right away
+#define BSP_TIMER_MINIMUM_TICKS         ( 5 )
+
 /*================================ typedef ==================================*/
 
 typedef void (* bsp_timer_cb_t)(void);
@@ -38,6 +41,8 @@ void bsp_timer_start(bsp_timer_width_t delay_ticks);
 void bsp_timer_stop(void);
 bsp_timer_width_t bsp_timer_get(void);
 bool bsp_timer_expired(bsp_timer_width_t future);
+bool bsp_timer_get_compare(bsp_timer_width_t* compare);
+void bsp_timer_wakeup(bsp_timer_width_t ticks);
 
 /*================================= public ==================================*/
 
@@ -20,6 +20,24 @@
 
 /*================================ typedef ==================================*/
 
+// Interrupt being served, each one may preempt the ones of lower priority
+// but not the ones under the same value, which share a priority
+typedef enum {
+    CPU_INTERRUPT_NONE  = 0x00,
+    CPU_INTERRUPT_TIMER = 0x01,
+    CPU_INTERRUPT_RADIO = 0x02,
+    CPU_INTERRUPT_UART  = 0x03,
+    CPU_INTERRUPT_GPIO  = 0x04,
+    CPU_INTERRUPT_OTHER = 0x05      ///< Any other, it must not push tasks
+} cpu_interrupt_t;
+
+// Power modes, deeper ones save more but take longer to wake up from
+typedef enum {
+    CPU_POWER_PM0 = 0x00,           ///< Clock gated, any interrupt wakes up
+    CPU_POWER_PM1 = 0x01,           ///< Oscillators off, the sleep timer wakes up
+    CPU_POWER_PM2 = 0x02            ///< And the digital core powered down
+} cpu_power_t;
+
 /*=============================== variables =================================*/
 
 /*=============================== prototypes ================================*/
@@ -27,14 +45,20 @@
 void cpu_init(void);
 
 void cpu_wait(void);
-void cpu_sleep(void);
+void cpu_sleep(cpu_power_t mode);
+cpu_power_t cpu_power_max(void);
 void cpu_reset(void);
 
 void cpu_enable_interrupts(void);
-void cpu_disable_interrupts(void);
+bool cpu_disable_interrupts(void);
+void cpu_restore_interrupts(bool disabled);
+cpu_interrupt_t cpu_interrupt_get(void);
 
 void cpu_delay_us(uint32_t delay_us);
 
+uint32_t cpu_cycles_get(void);
+uint32_t cpu_cycles_frequency(void);
+
 /*================================= public ==================================*/
 
 /*================================ private ==================================*/
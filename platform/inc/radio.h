@@ -3,7 +3,27 @@
  * @author     Pere Tuset-Peiro (peretuset@openmote.com)
  * @version    v0.1
  * @date       May 2015
- * @brief
+ * @brief      Driver of the IEEE 802.15.4 transceiver.
+ *
+ *             The radio does not wait for itself: radio_receive and
+ *             radio_transmit start the turnaround and return, the radio is
+ *             listening or sending once it is over, and the SFD and the end
+ *             of the frame are signalled by the callbacks. radio_idle turns
+ *             the radio off once a transmission on the air ends, after its
+ *             done callback. What the radio cannot do is reported with an
+ *             error code, returned or passed to the error callback when it
+ *             happens in the radio, e.g. a FIFO that overflows; a frame being
+ *             received or sent is then lost and the radio stays in the
+ *             RADIO_ERROR state until it is put back to idle.
+ *
+ *             radio_get_packet does not wait for the frame either: it starts
+ *             to read the frame received into a buffer and the packet
+ *             callback gets the buffer once the frame is in it, from an
+ *             interrupt; on the CC2538 the uDMA reads it and the callback
+ *             runs in the interrupt of the uDMA. If the frame cannot be read
+ *             the callback gets the buffer with a length and a CRC of zero.
+ *             radio_reset drops a frame that is being read, without calling
+ *             its callback.
  *
  * @copyright  Copyright 2015, OpenMote Technologies, S.L.
  *             This file is licensed under the GNU General Public License v2.
@@ -15,13 +35,32 @@
 /*================================ include ==================================*/
 
 #include "types.h"
+#include "bsp_timer.h"
 #include "packet_buffer.h"
 
 /*================================ define ===================================*/
 
+// The RSSI while it cannot be read, below any valid value
+#define RADIO_RSSI_INVALID              ( INT8_MIN )
+
 /*================================ typedef ==================================*/
 
+typedef enum {
+    RADIO_SUCCESS            = 0x00,
+    RADIO_ERROR_BUSY         = 0x01, ///< A transmission is still on the air
+    RADIO_ERROR_STATE        = 0x02, ///< The radio is not idle
+    RADIO_ERROR_LENGTH       = 0x03, ///< The frame does not fit in a PHY frame
+    RADIO_ERROR_STROBE       = 0x04, ///< A command strobe could not be run
+    RADIO_ERROR_RX_OVERFLOW  = 0x05,
+    RADIO_ERROR_RX_UNDERFLOW = 0x06,
+    RADIO_ERROR_TX_OVERFLOW  = 0x07,
+    RADIO_ERROR_TX_UNDERFLOW = 0x08,
+    RADIO_ERROR_RSSI         = 0x09  ///< The receiver has not settled yet
+} radio_error_t;
+
 typedef void (*radio_cb_t)(void);
+typedef void (*radio_error_cb_t)(radio_error_t error);
+typedef void (*radio_packet_cb_t)(packet_buffer_t* packet_buffer);
 
 typedef enum {
     RADIO_OFF             = 0x00,
@@ -44,6 +83,9 @@ typedef struct {
     radio_cb_t tx_init;
     radio_cb_t rx_done;
     radio_cb_t tx_done;
+    radio_error_cb_t error;
+    bool idle_pending;              ///< Go idle when the transmission ends
+    bsp_timer_width_t sfd;          ///< Tick of the sleep timer at the last SFD
 } radio_vars_t;
 
 /*=============================== variables =================================*/
@@ -58,6 +100,7 @@ void radio_reset(void);
 
 void radio_set_rx_cb(radio_cb_t rx_init_cb, radio_cb_t rx_done_cb);
 void radio_set_tx_cb(radio_cb_t tx_init_cb, radio_cb_t tx_done_cb);
+void radio_set_error_cb(radio_error_cb_t error_cb);
 
 void radio_cancel_rx_cb(void);
 void radio_cancel_tx_cb(void);
@@ -69,10 +112,12 @@ void radio_set_channel(uint8_t channel);
 
 void radio_set_power(uint8_t power);
 
-void radio_get_packet(packet_buffer_t* queue_entry);
-void radio_put_packet(packet_buffer_t* queue_entry);
+void radio_get_packet(packet_buffer_t* queue_entry, radio_packet_cb_t packet_cb);
+radio_error_t radio_put_packet(packet_buffer_t* queue_entry);
+
+radio_error_t radio_read_rssi(int8_t* rssi);
 
-void radio_read_rssi(int8_t* rssi);
+bsp_timer_width_t radio_get_sfd(void);
 
 /*================================= public ==================================*/
 
@@ -0,0 +1,69 @@
+/**
+ * @file       radio_timer.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      High resolution time from the MAC timer of the radio.
+ *
+ *             The time counts fine ticks, RADIO_TIMER_SHIFT bits below the
+ *             ticks of the sleep timer, so a fine tick is 1/32 of a tick,
+ *             0.95 us, and the tick T of the sleep timer is the fine tick
+ *             T << RADIO_TIMER_SHIFT. The fine ticks wrap after 68 minutes,
+ *             so only differences shorter than half of that can be compared.
+ *
+ *             radio_timer_start sets the compare of the MAC timer to a fine
+ *             tick, and its interrupt runs the callback once that tick has
+ *             come, right away if it has already passed. There is a single
+ *             compare, starting it again moves it.
+ *
+ *             The MAC timer stops when the CPU sleeps in PM1 or PM2, and its
+ *             crystal drifts from the one of the sleep timer, so
+ *             radio_timer_sync starts it again on the next tick of the sleep
+ *             timer and the time goes on from the sleep timer. It does not
+ *             wait for that tick, until then the time is the tick of the
+ *             sleep timer, and a compare that was set is set again.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef RADIO_TIMER_H_
+#define RADIO_TIMER_H_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+#include "bsp_timer.h"
+
+/*================================ define ===================================*/
+
+#define RADIO_TIMER_SHIFT               ( 5 )
+#define RADIO_TIMER_FINE_MASK           ( (1 << RADIO_TIMER_SHIFT) - 1 )
+
+// Fine ticks of a tick of the sleep timer and of a number of microseconds
+#define RADIO_TIMER_TICKS(ticks)        ( (radio_timer_width_t) (ticks) << RADIO_TIMER_SHIFT )
+#define RADIO_TIMER_US(us)              ( (radio_timer_width_t) (((uint64_t) (us) * (32768 << RADIO_TIMER_SHIFT) + 999999) / 1000000) )
+
+/*================================ typedef ==================================*/
+
+typedef uint32_t radio_timer_width_t;
+
+typedef void (* radio_timer_cb_t)(void);
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void radio_timer_init(void);
+void radio_timer_sync(void);
+radio_timer_width_t radio_timer_get(void);
+void radio_timer_set_cb(radio_timer_cb_t callback);
+void radio_timer_start(radio_timer_width_t at);
+void radio_timer_stop(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* RADIO_TIMER_H_ */
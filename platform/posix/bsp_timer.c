@@ -0,0 +1,155 @@
+/**
+ * @file       bsp_timer.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "posix_include.h"
+
+#include "bsp_timer.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    bsp_timer_cb_t callback;
+    bsp_timer_width_t compare;      ///< When the callback is due
+    bool armed;                     ///< The callback is due at compare
+} bsp_timer_vars_t;
+
+/*=============================== variables =================================*/
+
+static bsp_timer_vars_t bsp_timer_vars;
+
+/*=============================== prototypes ================================*/
+
+static void bsp_timer_compare(void);
+
+void bsp_timer_interrupt(void);
+
+/*================================= public ==================================*/
+
+void bsp_timer_init(void) {
+    // Initialize the memory of the bsp_timer variables
+    memset(&bsp_timer_vars, 0, sizeof(bsp_timer_vars_t));
+
+    // Register the sleep timer interrupt handler
+    posix_irq_register(POSIX_IRQ_SMTIM, bsp_timer_interrupt);
+}
+
+void bsp_timer_reset(void) {
+    bsp_timer_cancel_cb();
+    bsp_timer_disable_interrupts();
+}
+
+void bsp_timer_set_cb(bsp_timer_cb_t callback) {
+    bsp_timer_vars.callback = callback;
+}
+
+void bsp_timer_cancel_cb(void) {
+    bsp_timer_vars.callback = NULL;
+}
+
+void bsp_timer_enable_interrupts(void) {
+    posix_irq_enable(POSIX_IRQ_SMTIM);
+}
+
+void bsp_timer_disable_interrupts(void) {
+    posix_irq_disable(POSIX_IRQ_SMTIM);
+}
+
+void bsp_timer_start(bsp_timer_width_t delay_ticks) {
+    uint64_t current_ticks;
+
+    // Get the current number of ticks
+    current_ticks = posix_ticks_get();
+
+    // Remember when the callback is due
+    bsp_timer_vars.compare = (bsp_timer_width_t) (current_ticks + delay_ticks);
+    bsp_timer_vars.armed = true;
+
+    if (delay_ticks < BSP_TIMER_MINIMUM_TICKS) {
+        posix_irq_pend(POSIX_IRQ_SMTIM);
+    } else {
+        // Set the timer compare value
+        posix_event_set(POSIX_EVENT_SMTIM, posix_ticks_to_time(current_ticks + delay_ticks), bsp_timer_compare);
+    }
+}
+
+void bsp_timer_stop(void) {
+    bsp_timer_vars.armed = false;
+
+    bsp_timer_cancel_cb();
+    bsp_timer_disable_interrupts();
+
+    // Disarm the compare channel so that a stale match does not fire later
+    posix_event_cancel(POSIX_EVENT_SMTIM);
+    posix_irq_clear(POSIX_IRQ_SMTIM);
+}
+
+bsp_timer_width_t bsp_timer_get(void) {
+    bsp_timer_width_t current_ticks;
+
+    // Get the current number of ticks
+    current_ticks = (bsp_timer_width_t) posix_ticks_get();
+
+    return current_ticks;
+}
+
+bool bsp_timer_expired(bsp_timer_width_t future) {
+    bsp_timer_width_t current;
+    int32_t remaining;
+
+    current = (bsp_timer_width_t) posix_ticks_get();
+
+    remaining = (int32_t) (future - current);
+
+    if (remaining > 0) {
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool bsp_timer_get_compare(bsp_timer_width_t* compare) {
+    // Tell when the callback is due, if it is
+    if (!bsp_timer_vars.armed) {
+        return false;
+    }
+
+    *compare = bsp_timer_vars.compare;
+
+    return true;
+}
+
+void bsp_timer_wakeup(bsp_timer_width_t ticks) {
+    // Waking up takes no emulated time, the interrupt fires when it is due
+}
+
+/*================================ private ==================================*/
+
+static void bsp_timer_compare(void) {
+    // The compare value has matched the tick counter
+    posix_irq_pend(POSIX_IRQ_SMTIM);
+}
+
+/*=============================== interrupt =================================*/
+
+void bsp_timer_interrupt(void) {
+    // Clear the pending interrupt
+    posix_irq_clear(POSIX_IRQ_SMTIM);
+    bsp_timer_vars.armed = false;
+
+    // Execute the callback function
+    if (bsp_timer_vars.callback != NULL) {
+        bsp_timer_vars.callback();
+    }
+}
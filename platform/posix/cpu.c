@@ -0,0 +1,99 @@
+/**
+ * @file       cpu.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <time.h>
+
+#include "posix_include.h"
+
+#include "cpu.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void cpu_init(void) {
+    posix_init();
+}
+
+void cpu_wait(void) {
+    posix_wait();
+}
+
+void cpu_sleep(cpu_power_t mode) {
+    // Waking up from any power mode takes no emulated time
+    posix_wait();
+}
+
+cpu_power_t cpu_power_max(void) {
+    // The emulated peripherals do not depend on the clocks
+    return CPU_POWER_PM2;
+}
+
+void cpu_reset(void) {
+    posix_reset();
+}
+
+void cpu_enable_interrupts(void) {
+    posix_irq_master_enable();
+}
+
+bool cpu_disable_interrupts(void) {
+    // Tell whether they were already disabled
+    return posix_irq_master_disable();
+}
+
+void cpu_restore_interrupts(bool disabled) {
+    // Only enable them if they were enabled before
+    if (!disabled) {
+        posix_irq_master_enable();
+    }
+}
+
+cpu_interrupt_t cpu_interrupt_get(void) {
+    switch (posix_irq_active()) {
+        case POSIX_IRQ_SMTIM:
+            return CPU_INTERRUPT_TIMER;
+        case POSIX_IRQ_RF:
+        case POSIX_IRQ_MACTIMR:
+            return CPU_INTERRUPT_RADIO;
+        case POSIX_IRQ_UART:
+            return CPU_INTERRUPT_UART;
+        default:
+            return CPU_INTERRUPT_NONE;
+    }
+}
+
+void cpu_delay_us(uint32_t delay_us) {
+    posix_spin((uint64_t) delay_us * POSIX_NS_PER_US);
+}
+
+uint32_t cpu_cycles_get(void) {
+    struct timespec now;
+
+    // The host clock in nanoseconds stands for the cycle counter
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t) ((uint64_t) now.tv_sec * POSIX_NS_PER_SECOND + (uint64_t) now.tv_nsec);
+}
+
+uint32_t cpu_cycles_frequency(void) {
+    return (uint32_t) POSIX_NS_PER_SECOND;
+}
+
+/*================================ private ==================================*/
@@ -0,0 +1,483 @@
+/**
+ * @file       posix.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Emulation core shared by the POSIX platform drivers.
+ *
+ *             The emulated time only advances when the firmware waits for
+ *             an interrupt (cpu_wait) or busy-waits on the hardware (spin),
+ *             so the code between two waits executes in zero emulated time.
+ *             The OPENDQ_SPEED environment variable sets how the emulated
+ *             time maps to the host time (1 = real time, 0 = as fast as
+ *             possible) and OPENDQ_DURATION stops the process after the
+ *             given number of emulated seconds.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <errno.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "posix_include.h"
+#include "host_include.h"
+
+/*================================ define ===================================*/
+
+#define POSIX_SPEED_DEFAULT             ( 1.0 )
+#define POSIX_TIME_NONE                 ( UINT64_MAX )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    bool             active;
+    uint64_t         time;
+    posix_event_cb_t callback;
+} posix_event_entry_t;
+
+typedef struct {
+    int           fd;
+    posix_fd_cb_t callback;
+} posix_fd_entry_t;
+
+typedef struct {
+    // Emulated time and its mapping to the host time
+    uint64_t time;
+    uint64_t time_limit;
+    uint64_t time_anchor;
+    uint64_t real_anchor;
+    double   speed;
+    // Interrupt controller
+    bool        master_enabled;
+    bool        in_isr;
+    posix_irq_t isr_active;         ///< Interrupt being served, if in_isr
+    uint32_t    irq_enabled;
+    uint32_t    irq_pending;
+    posix_isr_t isr[POSIX_IRQ_COUNT];
+    // Hardware events and file descriptors
+    posix_event_entry_t event[POSIX_EVENT_COUNT];
+    posix_fd_entry_t    fd[POSIX_FD_MAX];
+    uint8_t             fd_count;
+} posix_vars_t;
+
+/*=============================== variables =================================*/
+
+static posix_vars_t posix_vars;
+
+// Captured before main so that cpu_reset can restart the process
+static char** posix_argv;
+
+/*=============================== prototypes ================================*/
+
+static void posix_args(int argc, char** argv, char** envp);
+static uint64_t posix_real_get(void);
+static void posix_time_set(uint64_t time_ns);
+static uint64_t posix_event_next(void);
+static void posix_event_fire(uint64_t limit_ns);
+static bool posix_fd_poll(uint64_t timeout_ns);
+static void posix_irq_dispatch(void);
+static void posix_mactimer_compare(void);
+
+/*================================= public ==================================*/
+
+void posix_init(void) {
+    char* env;
+
+    // Initialize the memory of the posix variables
+    memset(&posix_vars, 0, sizeof(posix_vars_t));
+
+    // Configure the mapping between emulated and host time
+    env = getenv("OPENDQ_SPEED");
+    posix_vars.speed = (env != NULL ? atof(env) : POSIX_SPEED_DEFAULT);
+    if (posix_vars.speed < 0) {
+        posix_vars.speed = POSIX_SPEED_DEFAULT;
+    }
+    posix_vars.time_anchor = 0;
+    posix_vars.real_anchor = posix_real_get();
+
+    // Configure the emulation duration, if any
+    env = getenv("OPENDQ_DURATION");
+    if (env != NULL && atof(env) > 0) {
+        posix_vars.time_limit = (uint64_t) (atof(env) * POSIX_NS_PER_SECOND);
+    }
+}
+
+void posix_reset(void) {
+    // Flush the pending output and restart the executable
+    fflush(NULL);
+    if (posix_argv != NULL) {
+        execv("/proc/self/exe", posix_argv);
+    }
+
+    // If the restart fails there is nothing else to do
+    _exit(EXIT_FAILURE);
+}
+
+uint64_t posix_time_get(void) {
+    return posix_vars.time;
+}
+
+void posix_time_sync(uint64_t real_anchor_ns, double speed) {
+    uint64_t real;
+
+    // The emulated time starts at the given host time and runs at the given
+    // speed, so that several processes share the same emulated time
+    posix_vars.time_anchor = 0;
+    posix_vars.real_anchor = real_anchor_ns;
+    posix_vars.speed = speed;
+
+    real = posix_real_get();
+    if (real > real_anchor_ns) {
+        posix_time_set((uint64_t) ((real - real_anchor_ns) * speed));
+    }
+}
+
+uint64_t posix_ticks_get(void) {
+    uint64_t seconds, fraction;
+
+    // Split to avoid overflowing the 64-bit intermediate product
+    seconds  = posix_vars.time / POSIX_NS_PER_SECOND;
+    fraction = posix_vars.time % POSIX_NS_PER_SECOND;
+
+    return (seconds * POSIX_TICKS_PER_SECOND) +
+           (fraction * POSIX_TICKS_PER_SECOND) / POSIX_NS_PER_SECOND;
+}
+
+uint64_t posix_ticks_to_time(uint64_t ticks) {
+    uint64_t seconds, fraction;
+
+    seconds  = ticks / POSIX_TICKS_PER_SECOND;
+    fraction = ticks % POSIX_TICKS_PER_SECOND;
+
+    // Round up so that the tick counter has reached the value at that time
+    return (seconds * POSIX_NS_PER_SECOND) +
+           (fraction * POSIX_NS_PER_SECOND + POSIX_TICKS_PER_SECOND - 1) / POSIX_TICKS_PER_SECOND;
+}
+
+void posix_spin(uint64_t duration_ns) {
+    posix_spin_until(posix_vars.time + duration_ns);
+}
+
+void posix_spin_until(uint64_t time_ns) {
+    // Fire the hardware events that happen while busy-waiting
+    posix_event_fire(time_ns);
+
+    // Advance the time to the end of the busy-wait
+    if (posix_vars.time < time_ns) {
+        posix_time_set(time_ns);
+    }
+
+    posix_irq_dispatch();
+}
+
+void posix_wait(void) {
+    uint64_t next, timeout, real, time;
+    bool input;
+
+    // An interrupt that is already pending wakes up the CPU immediately
+    if (posix_vars.irq_pending & posix_vars.irq_enabled) {
+        posix_irq_dispatch();
+        return;
+    }
+
+    // Find the next hardware event
+    next = posix_event_next();
+
+    // Calculate how long the host has to wait for the next event
+    if (next == POSIX_TIME_NONE) {
+        timeout = POSIX_TIME_NONE;
+    } else if (posix_vars.speed == 0) {
+        timeout = 0;
+    } else {
+        real = posix_vars.real_anchor + (uint64_t) ((next - posix_vars.time_anchor) / posix_vars.speed);
+        time = posix_real_get();
+        timeout = (real > time ? real - time : 0);
+    }
+
+    // Wait for the next event or for input from the host
+    input = posix_fd_poll(timeout);
+
+    // Update the emulated time
+    if (posix_vars.speed == 0) {
+        if (!input && next != POSIX_TIME_NONE) {
+            posix_time_set(next);
+        }
+    } else {
+        time = posix_vars.time_anchor + (uint64_t) ((posix_real_get() - posix_vars.real_anchor) * posix_vars.speed);
+        if (time > next) {
+            time = next;
+        }
+        if (time > posix_vars.time) {
+            posix_time_set(time);
+        }
+    }
+
+    // Fire the hardware events and execute the interrupts
+    posix_event_fire(posix_vars.time);
+    posix_irq_dispatch();
+}
+
+void posix_irq_register(posix_irq_t irq, posix_isr_t isr) {
+    posix_vars.isr[irq] = isr;
+}
+
+void posix_irq_enable(posix_irq_t irq) {
+    posix_vars.irq_enabled |= (1 << irq);
+}
+
+void posix_irq_disable(posix_irq_t irq) {
+    posix_vars.irq_enabled &= ~(1 << irq);
+}
+
+void posix_irq_pend(posix_irq_t irq) {
+    posix_vars.irq_pending |= (1 << irq);
+}
+
+void posix_irq_clear(posix_irq_t irq) {
+    posix_vars.irq_pending &= ~(1 << irq);
+}
+
+void posix_irq_master_enable(void) {
+    posix_vars.master_enabled = true;
+
+    // Pending interrupts are taken as soon as they are unmasked
+    posix_irq_dispatch();
+}
+
+bool posix_irq_master_disable(void) {
+    bool disabled = !posix_vars.master_enabled;
+
+    posix_vars.master_enabled = false;
+
+    return disabled;
+}
+
+posix_irq_t posix_irq_active(void) {
+    return (posix_vars.in_isr ? posix_vars.isr_active : POSIX_IRQ_COUNT);
+}
+
+void posix_event_set(posix_event_t event, uint64_t time_ns, posix_event_cb_t callback) {
+    posix_vars.event[event].active   = true;
+    posix_vars.event[event].time     = time_ns;
+    posix_vars.event[event].callback = callback;
+}
+
+void posix_event_cancel(posix_event_t event) {
+    posix_vars.event[event].active = false;
+}
+
+void posix_fd_register(int fd, posix_fd_cb_t callback) {
+    if (posix_vars.fd_count < POSIX_FD_MAX) {
+        posix_vars.fd[posix_vars.fd_count].fd       = fd;
+        posix_vars.fd[posix_vars.fd_count].callback = callback;
+        posix_vars.fd_count++;
+    }
+}
+
+/*============================= host interface ==============================*/
+
+uint64_t host_time_get(void) {
+    return posix_vars.time;
+}
+
+void host_error(const char* reason) {
+    // The firmware has locked up, stop the process to leave a core behind
+    fprintf(stderr, "posix: %s at %llu ticks\n", reason, (unsigned long long) posix_ticks_get());
+    abort();
+}
+
+uint16_t host_seed(void) {
+    char* env;
+
+    // Use the seed from the environment to make runs reproducible
+    env = getenv("OPENDQ_SEED");
+    if (env != NULL) {
+        return (uint16_t) strtoul(env, NULL, 0);
+    }
+
+    return (uint16_t) (time(NULL) ^ (getpid() << 4));
+}
+
+void host_eui64(uint8_t* address) {
+    const uint8_t oui[4] = HOST_EUI64_OUI;
+    unsigned long long eui64;
+    uint32_t pid;
+    char* env;
+
+    // The address can be set from the environment (e.g. OPENDQ_EUI64=00124b0000000001)
+    env = getenv("OPENDQ_EUI64");
+    if (env != NULL) {
+        eui64 = strtoull(env, NULL, 16);
+        for (uint8_t i = 0; i < 8; i++) {
+            address[i] = (eui64 >> (56 - 8 * i)) & 0xFF;
+        }
+        return;
+    }
+
+    // Otherwise derive it from the process identifier
+    pid = (uint32_t) getpid();
+    memcpy(address, oui, sizeof(oui));
+    for (uint8_t i = 4; i < 8; i++) {
+        address[i] = (pid >> (56 - 8 * i)) & 0xFF;
+    }
+}
+
+void host_mactimer_init(host_isr_t isr) {
+    posix_irq_register(POSIX_IRQ_MACTIMR, isr);
+    posix_irq_enable(POSIX_IRQ_MACTIMR);
+}
+
+void host_mactimer_set(uint64_t time_ns) {
+    // A compare value that has already passed matches right away
+    if (time_ns <= posix_vars.time) {
+        posix_irq_pend(POSIX_IRQ_MACTIMR);
+    } else {
+        posix_event_set(POSIX_EVENT_MACTIMR, time_ns, posix_mactimer_compare);
+    }
+}
+
+void host_mactimer_cancel(void) {
+    // Disarm the compare so that a stale match does not fire later
+    posix_event_cancel(POSIX_EVENT_MACTIMR);
+    posix_irq_clear(POSIX_IRQ_MACTIMR);
+}
+
+/*================================ private ==================================*/
+
+__attribute__((constructor))
+static void posix_args(int argc, char** argv, char** envp) {
+    posix_argv = argv;
+}
+
+static uint64_t posix_real_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * POSIX_NS_PER_SECOND + (uint64_t) now.tv_nsec;
+}
+
+static void posix_time_set(uint64_t time_ns) {
+    posix_vars.time = time_ns;
+
+    // Stop the emulation once the configured duration has elapsed
+    if (posix_vars.time_limit != 0 && posix_vars.time >= posix_vars.time_limit) {
+        fflush(NULL);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+static uint64_t posix_event_next(void) {
+    uint64_t next = POSIX_TIME_NONE;
+
+    for (uint8_t i = 0; i < POSIX_EVENT_COUNT; i++) {
+        if (posix_vars.event[i].active && posix_vars.event[i].time < next) {
+            next = posix_vars.event[i].time;
+        }
+    }
+
+    return next;
+}
+
+static void posix_event_fire(uint64_t limit_ns) {
+    posix_event_entry_t* event;
+    uint64_t next;
+
+    // Fire the events in time order, one at a time as they may add new ones
+    while ((next = posix_event_next()) <= limit_ns) {
+        for (event = &posix_vars.event[0]; event < &posix_vars.event[POSIX_EVENT_COUNT]; event++) {
+            if (event->active && event->time == next) {
+                break;
+            }
+        }
+
+        // Advance the time to the event and fire it
+        if (next > posix_vars.time) {
+            posix_time_set(next);
+        }
+        event->active = false;
+        if (event->callback != NULL) {
+            event->callback();
+        }
+
+        // Execute the interrupts as they would preempt a busy-wait
+        posix_irq_dispatch();
+    }
+}
+
+static bool posix_fd_poll(uint64_t timeout_ns) {
+    struct timeval timeout, *timeout_ptr = NULL;
+    fd_set fds;
+    int max_fd = -1;
+    int result;
+
+    // Nothing to wait for, the firmware is locked
+    if (posix_vars.fd_count == 0 && timeout_ns == POSIX_TIME_NONE) {
+        fprintf(stderr, "posix: no pending events, stopping\n");
+        fflush(NULL);
+        exit(EXIT_FAILURE);
+    }
+
+    // Build the set of file descriptors to wait for
+    FD_ZERO(&fds);
+    for (uint8_t i = 0; i < posix_vars.fd_count; i++) {
+        FD_SET(posix_vars.fd[i].fd, &fds);
+        if (posix_vars.fd[i].fd > max_fd) {
+            max_fd = posix_vars.fd[i].fd;
+        }
+    }
+
+    if (timeout_ns != POSIX_TIME_NONE) {
+        timeout.tv_sec  = timeout_ns / POSIX_NS_PER_SECOND;
+        timeout.tv_usec = (timeout_ns % POSIX_NS_PER_SECOND) / POSIX_NS_PER_US;
+        timeout_ptr = &timeout;
+    }
+
+    result = select(max_fd + 1, &fds, NULL, NULL, timeout_ptr);
+    if (result <= 0) {
+        return false;
+    }
+
+    // Notify the drivers that have input available
+    for (uint8_t i = 0; i < posix_vars.fd_count; i++) {
+        if (FD_ISSET(posix_vars.fd[i].fd, &fds) && posix_vars.fd[i].callback != NULL) {
+            posix_vars.fd[i].callback(posix_vars.fd[i].fd);
+        }
+    }
+
+    return true;
+}
+
+static void posix_irq_dispatch(void) {
+    uint32_t active;
+    uint8_t irq;
+
+    // Interrupts do not nest and are masked by the master enable
+    if (!posix_vars.master_enabled || posix_vars.in_isr) {
+        return;
+    }
+
+    // Execute the pending interrupts by priority
+    while ((active = (posix_vars.irq_pending & posix_vars.irq_enabled)) != 0) {
+        for (irq = 0; (active & (1 << irq)) == 0; irq++);
+
+        posix_vars.irq_pending &= ~(1 << irq);
+
+        if (posix_vars.isr[irq] != NULL) {
+            posix_vars.in_isr = true;
+            posix_vars.isr_active = (posix_irq_t) irq;
+            posix_vars.isr[irq]();
+            posix_vars.in_isr = false;
+        }
+    }
+}
+
+static void posix_mactimer_compare(void) {
+    // The compare value has matched the fine ticks
+    posix_irq_pend(POSIX_IRQ_MACTIMR);
+}
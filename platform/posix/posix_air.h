@@ -0,0 +1,62 @@
+/**
+ * @file       posix_air.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Messages between the emulated radios and the air broker.
+ *
+ *             Every process connects to the broker through a UNIX socket
+ *             (SOCK_SEQPACKET), one message per packet. The times are
+ *             nanoseconds of emulated time, which is shared by all the
+ *             processes: it starts at the epoch of the broker and runs at
+ *             the speed that the broker sets.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef POSIX_AIR_H_
+#define POSIX_AIR_H_
+
+/*================================ include ==================================*/
+
+#include <stdint.h>
+
+/*================================ define ===================================*/
+
+#define POSIX_AIR_SOCKET_DEFAULT        "/tmp/opendq-air"
+
+#define POSIX_AIR_PAYLOAD_MAX           ( 127 )
+
+/*================================ typedef ==================================*/
+
+typedef enum {
+    POSIX_AIR_HELLO   = 0x01,       ///< Process to broker: a radio has started
+    POSIX_AIR_WELCOME = 0x02,       ///< Broker to process: epoch, speed and identifier
+    POSIX_AIR_TX      = 0x03,       ///< Process to broker: a frame goes on the air
+    POSIX_AIR_FRAME   = 0x04,       ///< Broker to process: a frame is on the air
+    POSIX_AIR_END     = 0x05        ///< Broker to process: a frame is over
+} posix_air_type_t;
+
+typedef struct {
+    uint8_t  type;                  ///< posix_air_type_t
+    uint8_t  channel;               ///< IEEE 802.15.4 channel
+    uint8_t  length;                ///< Length of the PSDU, including the CRC
+    uint8_t  corrupted;             ///< The frame overlapped another one (END)
+    uint32_t id;                    ///< Frame identifier, or radio identifier (WELCOME)
+    uint64_t sfd;                   ///< Time of the SFD, or epoch of the broker (WELCOME)
+    uint64_t end;                   ///< Time of the end of the frame
+    double   speed;                 ///< Emulated time per host time (WELCOME)
+    uint32_t pid;                   ///< Process identifier (HELLO)
+    uint8_t  payload[POSIX_AIR_PAYLOAD_MAX];
+} posix_air_msg_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* POSIX_AIR_H_ */
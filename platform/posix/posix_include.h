@@ -0,0 +1,84 @@
+/**
+ * @file       posix_include.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Emulation core shared by the POSIX platform drivers.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef POSIX_INCLUDE_
+#define POSIX_INCLUDE_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+/*================================ define ===================================*/
+
+#define POSIX_TICKS_PER_SECOND          ( 32768ULL )
+#define POSIX_NS_PER_SECOND             ( 1000000000ULL )
+#define POSIX_NS_PER_US                 ( 1000ULL )
+
+#define POSIX_FD_MAX                    ( 4 )
+
+/*================================ typedef ==================================*/
+
+typedef void (* posix_isr_t)(void);
+typedef void (* posix_event_cb_t)(void);
+typedef void (* posix_fd_cb_t)(int fd);
+
+// Emulated interrupt lines, ordered by priority as on the CC2538 NVIC
+typedef enum {
+    POSIX_IRQ_RF      = 0x00,
+    POSIX_IRQ_MACTIMR = 0x01,
+    POSIX_IRQ_UART    = 0x02,
+    POSIX_IRQ_SMTIM   = 0x03,
+    POSIX_IRQ_COUNT   = 0x04
+} posix_irq_t;
+
+// Emulated hardware event sources, each one with a single outstanding event
+typedef enum {
+    POSIX_EVENT_SMTIM   = 0x00,
+    POSIX_EVENT_RF      = 0x01,
+    POSIX_EVENT_MACTIMR = 0x02,
+    POSIX_EVENT_COUNT   = 0x03
+} posix_event_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void posix_init(void);
+void posix_reset(void);
+
+uint64_t posix_time_get(void);
+void posix_time_sync(uint64_t real_anchor_ns, double speed);
+uint64_t posix_ticks_get(void);
+uint64_t posix_ticks_to_time(uint64_t ticks);
+
+void posix_spin(uint64_t duration_ns);
+void posix_spin_until(uint64_t time_ns);
+void posix_wait(void);
+
+void posix_irq_register(posix_irq_t irq, posix_isr_t isr);
+void posix_irq_enable(posix_irq_t irq);
+void posix_irq_disable(posix_irq_t irq);
+void posix_irq_pend(posix_irq_t irq);
+void posix_irq_clear(posix_irq_t irq);
+void posix_irq_master_enable(void);
+bool posix_irq_master_disable(void);
+posix_irq_t posix_irq_active(void);
+
+void posix_event_set(posix_event_t event, uint64_t time_ns, posix_event_cb_t callback);
+void posix_event_cancel(posix_event_t event);
+
+void posix_fd_register(int fd, posix_fd_cb_t callback);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* POSIX_INCLUDE_ */
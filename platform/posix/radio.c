@@ -0,0 +1,681 @@
+/**
+ * @file       radio.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Emulated IEEE 802.15.4 transceiver with CC2538 timing.
+ *
+ *             On its own the transceiver hears nothing. If OPENDQ_AIR names
+ *             the socket of an air broker (see projects/Air), the frames are
+ *             exchanged with the other processes connected to it: the broker
+ *             announces every frame before its SFD and tells whether it
+ *             collided once it is over, and the RSSI reads the energy of the
+ *             frames on the channel.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "posix_include.h"
+#include "posix_air.h"
+
+#include "cpu.h"
+#include "debug.h"
+#include "latency.h"
+#include "radio.h"
+#include "recorder.h"
+
+/*================================ define ===================================*/
+
+// Defines for the channel
+#define POSIX_RF_CHANNEL_MIN                    ( 11 )
+#define POSIX_RF_CHANNEL_MAX                    ( 26 )
+
+// Defines for the RSSI
+#define POSIX_RF_RSSI_NOISE_FLOOR               ( -100 )
+#define POSIX_RF_RSSI_FRAME                     ( -50 )
+#define POSIX_RF_LQI_FRAME                      ( 106 )
+
+// Defines for the packet
+#define POSIX_RF_MAX_PACKET_LEN                 ( 127 )
+#define POSIX_RF_MIN_PACKET_LEN                 ( 3 )
+
+// Defines for the timing (250 kbps O-QPSK, 32 us per byte)
+#define POSIX_RF_BYTE_NS                        ( 32 * POSIX_NS_PER_US )
+#define POSIX_RF_SHR_BYTES                      ( 5 )
+#define POSIX_RF_TURNAROUND_NS                  ( 192 * POSIX_NS_PER_US )
+
+// Defines for the interrupt flags
+#define POSIX_RF_IRQ_SFD                        ( 1 << 0 )
+#define POSIX_RF_IRQ_RXPKTDONE                  ( 1 << 1 )
+#define POSIX_RF_IRQ_TXDONE                     ( 1 << 2 )
+
+// Frames from the air that are remembered, for the RSSI and the receiver
+#define POSIX_RF_AIR_FRAMES                     ( 8 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint32_t id;
+    uint8_t  channel;
+    uint8_t  length;
+    bool     corrupted;
+    bool     over;
+    uint64_t sfd;
+    uint64_t end;
+    uint8_t  payload[POSIX_RF_MAX_PACKET_LEN];
+} radio_air_frame_t;
+
+typedef struct {
+    uint8_t  channel;
+    uint8_t  power;
+    uint8_t  irq_status;
+    uint32_t sfd_cycles;            ///< Cycle count when the SFD was raised
+    int8_t   rssi;
+    // Transmit FIFO and status
+    bool     tx_active;
+    uint64_t tx_end;
+    uint8_t  tx_buffer[POSIX_RF_MAX_PACKET_LEN];
+    uint8_t  tx_length;
+    // Receive FIFO and status
+    bool     rx_active;
+    uint8_t  rx_buffer[POSIX_RF_MAX_PACKET_LEN];
+    uint8_t  rx_length;
+    int8_t   rx_rssi;
+    bool     rx_crc;
+    uint8_t  rx_lqi;
+    uint64_t rx_start;
+    // Connection to the air broker and frames heard from it
+    int      air_fd;
+    radio_air_frame_t  air_frames[POSIX_RF_AIR_FRAMES];
+    uint8_t            air_next;
+    radio_air_frame_t* air_lock;
+    bool               air_locked;
+} radio_phy_vars_t;
+
+/*=============================== variables =================================*/
+
+radio_vars_t radio_vars;
+
+static radio_phy_vars_t radio_phy_vars;
+
+/*=============================== prototypes ================================*/
+
+static void radio_off(void);
+static void radio_report(radio_error_t error);
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb);
+static void radio_tx_sfd(void);
+static void radio_tx_end(void);
+
+static void radio_air_open(void);
+static void radio_air_send(uint64_t sfd_time);
+static void radio_air_input(int fd);
+static void radio_air_lock(void);
+static void radio_air_unlock(void);
+static void radio_air_sfd(void);
+static void radio_air_end(void);
+
+void rf_core_interrupt(void);
+
+/*================================= public ==================================*/
+
+void radio_init(void) {
+    /* Initialize the memory of the radio variables */
+    memset(&radio_vars, 0, sizeof(radio_vars_t));
+    memset(&radio_phy_vars, 0, sizeof(radio_phy_vars_t));
+
+    /* Set default channel and RSSI */
+    radio_phy_vars.channel = POSIX_RF_CHANNEL_MIN;
+    radio_phy_vars.rssi    = POSIX_RF_RSSI_NOISE_FLOOR;
+
+    /* Register the radio interrupt handler */
+    posix_irq_register(POSIX_IRQ_RF, rf_core_interrupt);
+
+    /* Connect to the air broker, if any */
+    radio_air_open();
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_OFF;
+}
+
+void radio_idle(void) {
+    /* Go idle once an ongoing TX ends (e.g. this could be an outgoing ACK) */
+    if (radio_phy_vars.tx_active) {
+        radio_vars.idle_pending = true;
+        return;
+    }
+
+    /* Turn off the receiver now */
+    radio_off();
+}
+
+void radio_receive(void) {
+    /* Flush the RX buffer */
+    radio_phy_vars.rx_length = 0;
+
+    /* Set the radio state to receive */
+    radio_vars.idle_pending = false;
+    radio_vars.current_state = RADIO_RX_ENABLING;
+
+    /* The radio listens once the receiver has settled */
+    radio_phy_vars.rx_active = true;
+    radio_phy_vars.rx_start = posix_time_get() + POSIX_RF_TURNAROUND_NS;
+
+    /* Catch a frame from the air that has not started yet */
+    radio_air_lock();
+}
+
+void radio_transmit(void) {
+    uint64_t sfd_time;
+
+    /* Make sure we are not transmitting already */
+    if (radio_phy_vars.tx_active) {
+        radio_report(RADIO_ERROR_BUSY);
+        return;
+    }
+
+    /* Set the radio state to transmit */
+    radio_vars.idle_pending = false;
+    radio_vars.current_state = RADIO_TX_ENABLING;
+
+    /* The transceiver is half-duplex, stop receiving from the air */
+    if (radio_phy_vars.air_fd >= 0) {
+        radio_phy_vars.rx_active = false;
+        radio_air_unlock();
+    }
+
+    /* Start sending the TX buffer, if there is anything to send */
+    if (radio_phy_vars.tx_length > 0) {
+        sfd_time = posix_time_get() + POSIX_RF_TURNAROUND_NS + POSIX_RF_SHR_BYTES * POSIX_RF_BYTE_NS;
+        radio_phy_vars.tx_active = true;
+        radio_phy_vars.tx_end = sfd_time + (1 + radio_phy_vars.tx_length) * POSIX_RF_BYTE_NS;
+        posix_event_set(POSIX_EVENT_RF, sfd_time, radio_tx_sfd);
+
+        /* Put the frame on the air */
+        radio_air_send(sfd_time);
+    }
+
+    /* Set the radio state to transmit */
+    radio_vars.current_state = RADIO_TX_ENABLED;
+}
+
+void radio_reset(void) {
+    /* An ongoing TX is aborted */
+    radio_vars.idle_pending = false;
+    radio_phy_vars.tx_active = false;
+
+    /* Flush the RX and TX buffers */
+    radio_phy_vars.rx_length = 0;
+    radio_phy_vars.tx_length = 0;
+
+    /* Turn off the receiver */
+    radio_phy_vars.rx_active = false;
+    posix_event_cancel(POSIX_EVENT_RF);
+    radio_air_unlock();
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_OFF;
+}
+
+void radio_set_rx_cb(radio_cb_t rx_init_cb, radio_cb_t rx_done_cb) {
+    radio_vars.rx_init = rx_init_cb;
+    radio_vars.rx_done = rx_done_cb;
+}
+
+void radio_set_tx_cb(radio_cb_t tx_init_cb, radio_cb_t tx_done_cb) {
+    radio_vars.tx_init = tx_init_cb;
+    radio_vars.tx_done = tx_done_cb;
+}
+
+void radio_set_error_cb(radio_error_cb_t error_cb) {
+    radio_vars.error = error_cb;
+}
+
+void radio_cancel_rx_cb(void) {
+    radio_vars.rx_init = NULL;
+    radio_vars.rx_done = NULL;
+}
+
+void radio_cancel_tx_cb(void) {
+    radio_vars.tx_init = NULL;
+    radio_vars.tx_done = NULL;
+}
+
+void radio_enable_interrupts(void) {
+    /* Enable radio interrupts */
+    posix_irq_enable(POSIX_IRQ_RF);
+}
+
+void radio_disable_interrupts(void) {
+    /* Disable the radio interrupts */
+    posix_irq_disable(POSIX_IRQ_RF);
+}
+
+void radio_set_channel(uint8_t channel) {
+    /* Check that the channel is within bounds */
+    if (channel >= POSIX_RF_CHANNEL_MIN && channel <= POSIX_RF_CHANNEL_MAX) {
+        radio_phy_vars.channel = channel;
+    }
+}
+
+void radio_set_power(uint8_t power) {
+    /* Set the radio transmit power */
+    radio_phy_vars.power = power;
+}
+
+/* Gets a packet from the radio buffer */
+void radio_get_packet(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
+    uint8_t packet_length;
+
+    if (radio_vars.current_state != RADIO_RX_DONE) {
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Check the packet length (first byte) */
+    packet_length = radio_phy_vars.rx_length;
+
+    /* Check if packet is too long or too short */
+    if ((packet_length > POSIX_RF_MAX_PACKET_LEN) ||
+        (packet_length <= POSIX_RF_MIN_PACKET_LEN)) {
+        /* Flush the RX buffer */
+        radio_phy_vars.rx_length = 0;
+
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Account for the CRC bytes */
+    packet_length -= 2;
+
+    /* Check if the packet fits in the buffer */
+    if (packet_length > packet_buffer->size) {
+        /* Flush the RX buffer */
+        radio_phy_vars.rx_length = 0;
+
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Copy the RX buffer to the buffer (except for the CRC) */
+    memcpy(packet_buffer->payload, radio_phy_vars.rx_buffer, packet_length);
+
+    /* Update the packet length, RSSI, CRC and LQI */
+    packet_buffer->length = packet_length;
+    packet_buffer->rssi   = radio_phy_vars.rx_rssi;
+    packet_buffer->crc    = (radio_phy_vars.rx_crc ? 0x80 : 0x00);
+    packet_buffer->lqi    = radio_phy_vars.rx_lqi;
+
+    /* Record the packet */
+    recorder_packet(packet_buffer);
+
+    /* Flush the RX buffer */
+    radio_phy_vars.rx_length = 0;
+
+    /* Set the radio state to idle */
+    radio_vars.current_state = RADIO_IDLE;
+
+    /* Hand the packet to the MAC, it is copied right away */
+    if (packet_cb != NULL) {
+        packet_cb(packet_buffer);
+    }
+}
+
+/* Puts a packet to the radio buffer */
+radio_error_t radio_put_packet(packet_buffer_t* packet_buffer) {
+    uint8_t packet_length;
+
+    /* Make sure previous transmission is not still in progress */
+    if (radio_phy_vars.tx_active) {
+        return RADIO_ERROR_BUSY;
+    }
+
+    /* Check if the radio state is correct */
+    if (radio_vars.current_state != RADIO_IDLE) {
+        return RADIO_ERROR_STATE;
+    }
+
+    /* Account for the CRC bytes */
+    packet_length = packet_buffer->length + 2;
+
+    /* Check if packet is too long */
+    if ((packet_length >  POSIX_RF_MAX_PACKET_LEN) ||
+        (packet_length <= POSIX_RF_MIN_PACKET_LEN)) {
+        return RADIO_ERROR_LENGTH;
+    }
+
+    /* Copy the packet payload to the TX buffer, the CRC is appended on air */
+    memcpy(radio_phy_vars.tx_buffer, packet_buffer->payload, packet_buffer->length);
+    radio_phy_vars.tx_length = packet_length;
+
+    return RADIO_SUCCESS;
+}
+
+radio_error_t radio_read_rssi(int8_t* rssi) {
+    radio_air_frame_t* frame;
+    uint64_t now;
+
+    // The RSSI is valid once the receiver has settled
+    now = posix_time_get();
+    if (!radio_phy_vars.rx_active || now < radio_phy_vars.rx_start) {
+        *rssi = RADIO_RSSI_INVALID;
+        recorder_rssi(*rssi);
+        return RADIO_ERROR_RSSI;
+    }
+
+    // Read the RSSI value
+    *rssi = radio_phy_vars.rssi;
+
+    // There is energy on the channel while a frame is on the air
+    for (uint8_t i = 0; i < POSIX_RF_AIR_FRAMES; i++) {
+        frame = &radio_phy_vars.air_frames[i];
+        if (frame->id != 0 && frame->channel == radio_phy_vars.channel &&
+            frame->sfd - POSIX_RF_SHR_BYTES * POSIX_RF_BYTE_NS <= now && now < frame->end) {
+            *rssi = POSIX_RF_RSSI_FRAME;
+        }
+    }
+
+    // Record the RSSI value
+    recorder_rssi(*rssi);
+
+    return RADIO_SUCCESS;
+}
+
+bsp_timer_width_t radio_get_sfd(void) {
+    return radio_vars.sfd;
+}
+
+/*================================ private ==================================*/
+
+static void radio_off(void) {
+    radio_vars.idle_pending = false;
+
+    /* Turn off the receiver, this aborts any ongoing reception */
+    if (radio_phy_vars.rx_active) {
+        radio_phy_vars.rx_active = false;
+        posix_event_cancel(POSIX_EVENT_RF);
+        radio_air_unlock();
+    }
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_IDLE;
+}
+
+static void radio_report(radio_error_t error) {
+    if (radio_vars.error != NULL) {
+        radio_vars.error(error);
+    }
+}
+
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
+    /* Tell the MAC that the buffer holds no packet */
+    packet_buffer->length = 0;
+    packet_buffer->crc    = 0;
+    if (packet_cb != NULL) {
+        packet_cb(packet_buffer);
+    }
+}
+
+static void radio_tx_sfd(void) {
+    /* The SFD has been sent, schedule the end of the frame */
+    posix_event_set(POSIX_EVENT_RF, radio_phy_vars.tx_end, radio_tx_end);
+
+    // Timestamp the frame, the interrupt may be taken later
+    radio_vars.sfd = bsp_timer_get();
+
+    radio_phy_vars.irq_status |= POSIX_RF_IRQ_SFD;
+    posix_irq_pend(POSIX_IRQ_RF);
+}
+
+static void radio_tx_end(void) {
+    /* The frame has been sent and the TX buffer is empty */
+    radio_phy_vars.tx_active = false;
+    radio_phy_vars.tx_length = 0;
+
+    radio_phy_vars.irq_status |= POSIX_RF_IRQ_TXDONE;
+    posix_irq_pend(POSIX_IRQ_RF);
+}
+
+static void radio_air_open(void) {
+    struct sockaddr_un address;
+    posix_air_msg_t msg;
+    char* env;
+    int fd;
+
+    radio_phy_vars.air_fd = -1;
+
+    // The radio is on its own unless there is an air broker
+    env = getenv("OPENDQ_AIR");
+    if (env == NULL) {
+        return;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, (*env != '\0' ? env : POSIX_AIR_SOCKET_DEFAULT), sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+        fprintf(stderr, "posix: unable to connect to the air on %s\n", address.sun_path);
+        exit(EXIT_FAILURE);
+    }
+
+    // Introduce the radio and adopt the emulated time of the broker
+    memset(&msg, 0, sizeof(msg));
+    msg.type = POSIX_AIR_HELLO;
+    msg.pid  = (uint32_t) getpid();
+    if (send(fd, &msg, sizeof(msg), 0) != sizeof(msg) ||
+        recv(fd, &msg, sizeof(msg), 0) != sizeof(msg) || msg.type != POSIX_AIR_WELCOME) {
+        fprintf(stderr, "posix: unable to join the air on %s\n", address.sun_path);
+        exit(EXIT_FAILURE);
+    }
+    posix_time_sync(msg.sfd, msg.speed);
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    posix_fd_register(fd, radio_air_input);
+    radio_phy_vars.air_fd = fd;
+}
+
+static void radio_air_send(uint64_t sfd_time) {
+    posix_air_msg_t msg;
+
+    if (radio_phy_vars.air_fd < 0) {
+        return;
+    }
+
+    // The CRC is appended by the receivers
+    memset(&msg, 0, sizeof(msg));
+    msg.type    = POSIX_AIR_TX;
+    msg.channel = radio_phy_vars.channel;
+    msg.length  = radio_phy_vars.tx_length;
+    msg.sfd     = sfd_time;
+    msg.end     = radio_phy_vars.tx_end;
+    memcpy(msg.payload, radio_phy_vars.tx_buffer, radio_phy_vars.tx_length - 2);
+
+    send(radio_phy_vars.air_fd, &msg, sizeof(msg), 0);
+}
+
+static void radio_air_input(int fd) {
+    radio_air_frame_t* frame;
+    posix_air_msg_t msg;
+    ssize_t length;
+
+    while ((length = recv(fd, &msg, sizeof(msg), 0)) == sizeof(msg)) {
+        if (msg.type == POSIX_AIR_FRAME) {
+            // Remember the frame in place of the oldest one
+            frame = &radio_phy_vars.air_frames[radio_phy_vars.air_next];
+            radio_phy_vars.air_next = (radio_phy_vars.air_next + 1) % POSIX_RF_AIR_FRAMES;
+            if (frame == radio_phy_vars.air_lock) {
+                radio_air_unlock();
+            }
+
+            frame->id        = msg.id;
+            frame->channel   = msg.channel;
+            frame->length    = msg.length;
+            frame->corrupted = false;
+            frame->over      = false;
+            frame->sfd       = msg.sfd;
+            frame->end       = msg.end;
+            memcpy(frame->payload, msg.payload, msg.length - 2);
+
+            radio_air_lock();
+        } else if (msg.type == POSIX_AIR_END) {
+            for (uint8_t i = 0; i < POSIX_RF_AIR_FRAMES; i++) {
+                frame = &radio_phy_vars.air_frames[i];
+                if (frame->id != msg.id) {
+                    continue;
+                }
+
+                frame->corrupted = msg.corrupted;
+                frame->over      = true;
+
+                // Finish the reception of the frame the receiver is locked on
+                if (frame == radio_phy_vars.air_lock && radio_phy_vars.air_locked) {
+                    posix_event_set(POSIX_EVENT_RF, frame->end, radio_air_end);
+                }
+            }
+        }
+    }
+
+    // The broker is gone, and so is the air
+    if (length == 0) {
+        fprintf(stderr, "posix: the air is gone, stopping\n");
+        fflush(NULL);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+static void radio_air_lock(void) {
+    radio_air_frame_t* frame;
+    radio_air_frame_t* first = NULL;
+
+    // Nothing to do unless listening and not receiving a frame yet
+    if (!radio_phy_vars.rx_active || radio_phy_vars.air_locked) {
+        return;
+    }
+
+    // Look for the first frame whose SFD comes once the receiver is on
+    for (uint8_t i = 0; i < POSIX_RF_AIR_FRAMES; i++) {
+        frame = &radio_phy_vars.air_frames[i];
+        if (frame->id != 0 && frame->channel == radio_phy_vars.channel &&
+            frame->sfd >= radio_phy_vars.rx_start &&
+            (first == NULL || frame->sfd < first->sfd)) {
+            first = frame;
+        }
+    }
+
+    if (first != NULL && first != radio_phy_vars.air_lock) {
+        radio_phy_vars.air_lock = first;
+        posix_event_set(POSIX_EVENT_RF, first->sfd, radio_air_sfd);
+    }
+}
+
+static void radio_air_unlock(void) {
+    if (radio_phy_vars.air_lock != NULL) {
+        radio_phy_vars.air_lock = NULL;
+        radio_phy_vars.air_locked = false;
+        posix_event_cancel(POSIX_EVENT_RF);
+    }
+}
+
+static void radio_air_sfd(void) {
+    radio_air_frame_t* frame = radio_phy_vars.air_lock;
+
+    // The receiver is locked on the frame until it is over
+    radio_phy_vars.air_locked = true;
+    if (frame->over) {
+        posix_event_set(POSIX_EVENT_RF, frame->end, radio_air_end);
+    }
+
+    // The SFD latency is counted from here
+    radio_phy_vars.sfd_cycles = cpu_cycles_get();
+    radio_vars.sfd = bsp_timer_get();
+
+    radio_phy_vars.irq_status |= POSIX_RF_IRQ_SFD;
+    posix_irq_pend(POSIX_IRQ_RF);
+}
+
+static void radio_air_end(void) {
+    radio_air_frame_t* frame = radio_phy_vars.air_lock;
+
+    // Move the frame to the RX buffer
+    memcpy(radio_phy_vars.rx_buffer, frame->payload, frame->length - 2);
+    radio_phy_vars.rx_length = frame->length;
+    radio_phy_vars.rx_rssi   = POSIX_RF_RSSI_FRAME;
+    radio_phy_vars.rx_lqi    = POSIX_RF_LQI_FRAME;
+    radio_phy_vars.rx_crc    = !frame->corrupted;
+
+    // The receiver keeps listening for the frames that start afterwards
+    radio_phy_vars.air_lock   = NULL;
+    radio_phy_vars.air_locked = false;
+    radio_phy_vars.rx_start   = frame->end;
+
+    radio_phy_vars.irq_status |= POSIX_RF_IRQ_RXPKTDONE;
+    posix_irq_pend(POSIX_IRQ_RF);
+}
+
+/*=============================== interrupt =================================*/
+
+void rf_core_interrupt(void) {
+    uint8_t irq_status;
+
+    debug_isr_on();
+
+    /* Read and clear the interrupt flags */
+    irq_status = radio_phy_vars.irq_status;
+    radio_phy_vars.irq_status = 0;
+    posix_irq_clear(POSIX_IRQ_RF);
+
+    /* Start of frame event */
+    if (irq_status & POSIX_RF_IRQ_SFD) {
+        if ((radio_vars.current_state == RADIO_RX_ENABLING ||
+             radio_vars.current_state == RADIO_RX_ENABLED) &&
+            radio_vars.rx_init != NULL) {
+            radio_vars.current_state = RADIO_RX_RECEIVING;
+            recorder_sfd();
+#if LATENCY_ENABLED
+            latency_sfd(radio_phy_vars.sfd_cycles);
+#endif
+            radio_vars.rx_init();
+        }
+        else if ((radio_vars.current_state == RADIO_TX_ENABLING ||
+                  radio_vars.current_state == RADIO_TX_ENABLED) &&
+                 radio_vars.tx_init != NULL) {
+            radio_vars.current_state = RADIO_TX_TRANSMITTING;
+            radio_vars.tx_init();
+        }
+    }
+
+    /* End of received frame event */
+    if (irq_status & POSIX_RF_IRQ_RXPKTDONE) {
+        if (radio_vars.current_state == RADIO_RX_RECEIVING &&
+            radio_vars.rx_done != NULL) {
+            radio_vars.current_state = RADIO_RX_DONE;
+            recorder_rx_done();
+            radio_vars.rx_done();
+        }
+    }
+
+    /* End of transmitted frame event */
+    if (irq_status & POSIX_RF_IRQ_TXDONE) {
+        if (radio_vars.current_state == RADIO_TX_TRANSMITTING &&
+            radio_vars.tx_done != NULL) {
+            radio_vars.current_state = RADIO_TX_DONE;
+            radio_vars.tx_done();
+        }
+
+        /* Go idle if it was requested during the transmission */
+        if (radio_vars.idle_pending) {
+            radio_off();
+        }
+    }
+
+    debug_isr_off();
+}
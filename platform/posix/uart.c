@@ -0,0 +1,249 @@
+/**
+ * @file       uart.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "posix_include.h"
+
+#include "uart.h"
+
+/*================================ define ===================================*/
+
+#define UART_RX_BUFFER_SIZE     ( 256 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uart_cb_t uart_rx_cb;
+    uart_cb_t uart_tx_cb;
+    // Host side of the UART
+    int fd;
+    int fd_slave;
+    // Interrupt emulation
+    bool enabled;
+    bool tx_active;
+    bool tx_pending;
+    // Receive buffer
+    uint8_t  rx_buffer[UART_RX_BUFFER_SIZE];
+    uint16_t rx_head;
+    uint16_t rx_count;
+} uart_vars_t;
+
+/*=============================== variables =================================*/
+
+static uart_vars_t uart_vars;
+
+/*=============================== prototypes ================================*/
+
+static int uart_open(void);
+static void uart_input(int fd);
+
+void uart0_interrupt(void);
+
+/*================================= public ==================================*/
+
+/**
+ * Initialize the UART interface
+ */
+void uart_init(void) {
+    // Initialize the memory of the uart variables
+    memset(&uart_vars, 0, sizeof(uart_vars_t));
+    uart_vars.fd_slave = -1;
+
+    // Open the host side of the UART
+    uart_vars.fd = uart_open();
+    if (uart_vars.fd < 0) {
+        fprintf(stderr, "posix: unable to open the uart\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Register the UART interrupt handler and input
+    posix_irq_register(POSIX_IRQ_UART, uart0_interrupt);
+    posix_fd_register(uart_vars.fd, uart_input);
+}
+
+/**
+ * Deinitialize the UART interface
+ */
+void uart_deinit(void) {
+    // Keep the host side open, it survives cpu_reset
+    uart_vars.enabled = false;
+}
+
+void uart_enable_interrupts(void) {
+    // Enable the UART peripheral interrupts
+    uart_vars.enabled = true;
+
+    // Enable the UART global interrupt
+    posix_irq_enable(POSIX_IRQ_UART);
+}
+
+void uart_disable_interrupts(void) {
+    // Disable the UART peripheral interrupts
+    uart_vars.enabled = false;
+
+    // Disable the UART global interrupt
+    posix_irq_disable(POSIX_IRQ_UART);
+}
+
+void uart_register_rx_cb(uart_cb_t callback) {
+    uart_vars.uart_rx_cb = callback;
+}
+
+void uart_register_tx_cb(uart_cb_t callback) {
+    uart_vars.uart_tx_cb = callback;
+}
+
+void uart_cancel_rx_cb(void) {
+    uart_vars.uart_rx_cb = NULL;
+}
+
+void uart_cancel_tx_cb(void) {
+    uart_vars.uart_tx_cb = NULL;
+}
+
+void uart_send_byte(uint8_t byte) {
+    // Write the byte to the host, drop it if nobody is reading
+    if (write(uart_vars.fd, &byte, 1) < 0) {
+        // The host side is full or closed
+    }
+
+    if (!uart_vars.enabled) {
+        return;
+    }
+
+    /**
+     * The end of transmission interrupt is taken right away, as the
+     * firmware busy-waits on it (e.g. serial_is_busy). Bytes sent from
+     * the callback are chained here instead of recursing.
+     */
+    if (uart_vars.tx_active) {
+        uart_vars.tx_pending = true;
+        return;
+    }
+
+    uart_vars.tx_active = true;
+    do {
+        uart_vars.tx_pending = false;
+        if (uart_vars.uart_tx_cb != NULL) {
+            uart_vars.uart_tx_cb();
+        }
+    } while (uart_vars.tx_pending && uart_vars.enabled);
+    uart_vars.tx_active = false;
+}
+
+uint8_t uart_receive_byte(void) {
+    uint8_t byte = 0;
+
+    // Pop a byte from the receive buffer
+    if (uart_vars.rx_count > 0) {
+        byte = uart_vars.rx_buffer[uart_vars.rx_head];
+        uart_vars.rx_head = (uart_vars.rx_head + 1) % UART_RX_BUFFER_SIZE;
+        uart_vars.rx_count--;
+    }
+
+    return byte;
+}
+
+/*================================ private ==================================*/
+
+static int uart_open(void) {
+    struct termios config;
+    char buffer[16];
+    char* env;
+    int fd;
+
+    // Reuse the UART kept open across a cpu_reset
+    env = getenv("OPENDQ_UART_FD");
+    if (env != NULL) {
+        fd = atoi(env);
+        if (fcntl(fd, F_GETFD) >= 0) {
+            if (grantpt(fd) == 0 && ptsname(fd) != NULL) {
+                uart_vars.fd_slave = open(ptsname(fd), O_RDWR | O_NOCTTY | O_CLOEXEC);
+            }
+            return fd;
+        }
+    }
+
+    // Use the device or FIFO given in the environment
+    env = getenv("OPENDQ_UART");
+    if (env != NULL) {
+        fd = open(env, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        return fd;
+    }
+
+    // Otherwise create a pseudo-terminal
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        return -1;
+    }
+
+    // Configure the pseudo-terminal as a raw serial port
+    tcgetattr(fd, &config);
+    cfmakeraw(&config);
+    tcsetattr(fd, TCSANOW, &config);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // Hold the slave side so that the master does not hang up
+    uart_vars.fd_slave = open(ptsname(fd), O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+    fprintf(stderr, "posix: uart on %s\n", ptsname(fd));
+
+    // Keep the UART across a cpu_reset
+    snprintf(buffer, sizeof(buffer), "%d", fd);
+    setenv("OPENDQ_UART_FD", buffer, 1);
+
+    return fd;
+}
+
+static void uart_input(int fd) {
+    uint16_t tail;
+    uint8_t byte;
+
+    // Move the bytes available from the host to the receive buffer
+    while (uart_vars.rx_count < UART_RX_BUFFER_SIZE && read(fd, &byte, 1) == 1) {
+        tail = (uart_vars.rx_head + uart_vars.rx_count) % UART_RX_BUFFER_SIZE;
+        uart_vars.rx_buffer[tail] = byte;
+        uart_vars.rx_count++;
+    }
+
+    if (uart_vars.rx_count > 0) {
+        posix_irq_pend(POSIX_IRQ_UART);
+    }
+}
+
+/*=============================== interrupt =================================*/
+
+void uart0_interrupt(void) {
+    uint16_t rx_count;
+
+    // Clear the pending interrupt
+    posix_irq_clear(POSIX_IRQ_UART);
+
+    // Process the RX interrupt once per received byte
+    while (uart_vars.rx_count > 0) {
+        rx_count = uart_vars.rx_count;
+
+        if (uart_vars.uart_rx_cb != NULL) {
+            uart_vars.uart_rx_cb();
+        }
+
+        // A byte that is not read is overwritten by the next one
+        if (uart_vars.rx_count == rx_count) {
+            uart_receive_byte();
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file       cpu.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_include.h"
+
+#include "cpu.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+void cpu_init(void) {
+    // The simulation kernel sets up the node before it boots
+}
+
+void cpu_wait(void) {
+    sim_wait();
+}
+
+void cpu_sleep(cpu_power_t mode) {
+    // Waking up from any power mode takes no emulated time
+    sim_wait();
+}
+
+cpu_power_t cpu_power_max(void) {
+    // The emulated peripherals do not depend on the clocks
+    return CPU_POWER_PM2;
+}
+
+void cpu_reset(void) {
+    sim_reset();
+}
+
+void cpu_enable_interrupts(void) {
+    sim_irq_master_enable();
+}
+
+bool cpu_disable_interrupts(void) {
+    // Tell whether they were already disabled
+    return sim_irq_master_disable();
+}
+
+void cpu_restore_interrupts(bool disabled) {
+    // Only enable them if they were enabled before
+    if (!disabled) {
+        sim_irq_master_enable();
+    }
+}
+
+cpu_interrupt_t cpu_interrupt_get(void) {
+    switch (sim_irq_active()) {
+        case SIM_IRQ_SMTIM:
+            return CPU_INTERRUPT_TIMER;
+        case SIM_IRQ_RF:
+        case SIM_IRQ_MACTIMR:
+            return CPU_INTERRUPT_RADIO;
+        case SIM_IRQ_UART:
+            return CPU_INTERRUPT_UART;
+        default:
+            return CPU_INTERRUPT_NONE;
+    }
+}
+
+void cpu_delay_us(uint32_t delay_us) {
+    sim_spin((uint64_t) delay_us * SIM_NS_PER_US);
+}
+
+uint32_t cpu_cycles_get(void) {
+    // The simulated CPU only spends time busy-waiting, in nanoseconds
+    return (uint32_t) sim_time_get();
+}
+
+uint32_t cpu_cycles_frequency(void) {
+    return (uint32_t) SIM_NS_PER_SECOND;
+}
+
+/*================================ private ==================================*/
@@ -0,0 +1,381 @@
+/**
+ * @file       radio.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Simulated IEEE 802.15.4 transceiver with CC2538 timing.
+ *
+ *             Frames are handed to the simulated channel, which decides
+ *             what every other node receives and raises the same SFD,
+ *             RX done and TX done interrupts as the CC2538 RF core.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_include.h"
+
+#include "debug.h"
+#include "latency.h"
+#include "radio.h"
+#include "recorder.h"
+
+/*================================ define ===================================*/
+
+// Defines for the channel
+#define SIM_RF_CHANNEL_MIN                      ( 11 )
+#define SIM_RF_CHANNEL_MAX                      ( 26 )
+
+// Time for the receiver to settle, in nanoseconds
+#define SIM_RF_TURNAROUND_NS                    ( 192 * SIM_NS_PER_US )
+
+// Defines for the packet
+#define SIM_RF_MAX_PACKET_LEN                   ( 127 )
+#define SIM_RF_MIN_PACKET_LEN                   ( 3 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uint8_t  channel;
+    uint8_t  power;
+    uint64_t rx_settled;            ///< Time at which the receiver has settled
+    // Transmit FIFO and status
+    uint64_t tx_end;
+    uint8_t  tx_buffer[SIM_RF_MAX_PACKET_LEN];
+    uint8_t  tx_length;
+} radio_phy_vars_t;
+
+/*=============================== variables =================================*/
+
+radio_vars_t radio_vars;
+
+static radio_phy_vars_t radio_phy_vars;
+
+/*=============================== prototypes ================================*/
+
+static bool radio_tx_active(void);
+static void radio_off(void);
+static void radio_report(radio_error_t error);
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb);
+
+void rf_core_interrupt(void);
+
+/*================================= public ==================================*/
+
+void radio_init(void) {
+    /* Initialize the memory of the radio variables */
+    memset(&radio_vars, 0, sizeof(radio_vars_t));
+    memset(&radio_phy_vars, 0, sizeof(radio_phy_vars_t));
+
+    /* Set default channel */
+    radio_phy_vars.channel = SIM_RF_CHANNEL_MIN;
+
+    /* Register the radio interrupt handler */
+    sim_irq_register(SIM_IRQ_RF, rf_core_interrupt);
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_OFF;
+}
+
+void radio_idle(void) {
+    /* Go idle once an ongoing TX ends (e.g. this could be an outgoing ACK) */
+    if (radio_tx_active()) {
+        radio_vars.idle_pending = true;
+        return;
+    }
+
+    /* Turn off the receiver now */
+    radio_off();
+}
+
+void radio_receive(void) {
+    /* Set the radio state to receive */
+    radio_vars.idle_pending = false;
+    radio_vars.current_state = RADIO_RX_ENABLING;
+
+    /* Enable receive mode, the channel hears frames once it has settled */
+    sim_radio_on(radio_phy_vars.channel);
+    radio_phy_vars.rx_settled = sim_time_get() + SIM_RF_TURNAROUND_NS;
+}
+
+void radio_transmit(void) {
+    /* Make sure we are not transmitting already */
+    if (radio_tx_active()) {
+        radio_report(RADIO_ERROR_BUSY);
+        return;
+    }
+
+    /* Set the radio state to transmit */
+    radio_vars.idle_pending = false;
+    radio_vars.current_state = RADIO_TX_ENABLING;
+
+    /* Hand the TX buffer to the channel, which accounts for the turnaround */
+    if (radio_phy_vars.tx_length > 0) {
+        radio_phy_vars.tx_end = sim_radio_transmit(radio_phy_vars.tx_buffer,
+                                                   radio_phy_vars.tx_length,
+                                                   radio_phy_vars.channel);
+        radio_phy_vars.tx_length = 0;
+    }
+
+    /* Set the radio state to transmit */
+    radio_vars.current_state = RADIO_TX_ENABLED;
+}
+
+void radio_reset(void) {
+    /* The channel cannot abort an ongoing TX, the radio forgets about it */
+    radio_vars.idle_pending = false;
+    radio_phy_vars.tx_end = 0;
+
+    /* Flush the TX buffer */
+    radio_phy_vars.tx_length = 0;
+
+    /* Turn off the receiver */
+    sim_radio_off();
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_OFF;
+}
+
+void radio_set_rx_cb(radio_cb_t rx_init_cb, radio_cb_t rx_done_cb) {
+    radio_vars.rx_init = rx_init_cb;
+    radio_vars.rx_done = rx_done_cb;
+}
+
+void radio_set_tx_cb(radio_cb_t tx_init_cb, radio_cb_t tx_done_cb) {
+    radio_vars.tx_init = tx_init_cb;
+    radio_vars.tx_done = tx_done_cb;
+}
+
+void radio_set_error_cb(radio_error_cb_t error_cb) {
+    radio_vars.error = error_cb;
+}
+
+void radio_cancel_rx_cb(void) {
+    radio_vars.rx_init = NULL;
+    radio_vars.rx_done = NULL;
+}
+
+void radio_cancel_tx_cb(void) {
+    radio_vars.tx_init = NULL;
+    radio_vars.tx_done = NULL;
+}
+
+void radio_enable_interrupts(void) {
+    /* Enable radio interrupts */
+    sim_irq_enable(SIM_IRQ_RF);
+}
+
+void radio_disable_interrupts(void) {
+    /* Disable the radio interrupts */
+    sim_irq_disable(SIM_IRQ_RF);
+}
+
+void radio_set_channel(uint8_t channel) {
+    /* Check that the channel is within bounds */
+    if (channel >= SIM_RF_CHANNEL_MIN && channel <= SIM_RF_CHANNEL_MAX) {
+        radio_phy_vars.channel = channel;
+    }
+}
+
+void radio_set_power(uint8_t power) {
+    /* Set the radio transmit power */
+    radio_phy_vars.power = power;
+}
+
+/* Gets a packet from the radio buffer */
+void radio_get_packet(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
+    const sim_radio_frame_t* frame;
+    uint8_t packet_length;
+
+    if (radio_vars.current_state != RADIO_RX_DONE) {
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Check the packet length (first byte) */
+    frame = sim_radio_frame_get();
+    packet_length = frame->length;
+
+    /* Check if packet is too long or too short */
+    if ((packet_length > SIM_RF_MAX_PACKET_LEN) ||
+        (packet_length <= SIM_RF_MIN_PACKET_LEN)) {
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Account for the CRC bytes */
+    packet_length -= 2;
+
+    /* Check if the packet fits in the buffer */
+    if (packet_length > packet_buffer->size) {
+        radio_lost(packet_buffer, packet_cb);
+        return;
+    }
+
+    /* Copy the RX buffer to the buffer (except for the CRC) */
+    memcpy(packet_buffer->payload, frame->buffer, packet_length);
+
+    /* Update the packet length, RSSI, CRC and LQI */
+    packet_buffer->length = packet_length;
+    packet_buffer->rssi   = frame->rssi;
+    packet_buffer->crc    = (frame->crc ? 0x80 : 0x00);
+    packet_buffer->lqi    = frame->lqi;
+
+    /* Record the packet */
+    recorder_packet(packet_buffer);
+
+    /* Set the radio state to idle */
+    radio_vars.current_state = RADIO_IDLE;
+
+    /* Hand the packet to the MAC, it is copied right away */
+    if (packet_cb != NULL) {
+        packet_cb(packet_buffer);
+    }
+}
+
+/* Puts a packet to the radio buffer */
+radio_error_t radio_put_packet(packet_buffer_t* packet_buffer) {
+    uint8_t packet_length;
+
+    /* Make sure previous transmission is not still in progress */
+    if (radio_tx_active()) {
+        return RADIO_ERROR_BUSY;
+    }
+
+    /* Check if the radio state is correct */
+    if (radio_vars.current_state != RADIO_IDLE) {
+        return RADIO_ERROR_STATE;
+    }
+
+    /* Account for the CRC bytes */
+    packet_length = packet_buffer->length + 2;
+
+    /* Check if packet is too long */
+    if ((packet_length >  SIM_RF_MAX_PACKET_LEN) ||
+        (packet_length <= SIM_RF_MIN_PACKET_LEN)) {
+        return RADIO_ERROR_LENGTH;
+    }
+
+    /* Copy the packet payload to the TX buffer, the CRC is appended on air */
+    memcpy(radio_phy_vars.tx_buffer, packet_buffer->payload, packet_buffer->length);
+    radio_phy_vars.tx_length = packet_length;
+
+    return RADIO_SUCCESS;
+}
+
+radio_error_t radio_read_rssi(int8_t* rssi) {
+    radio_error_t error = RADIO_SUCCESS;
+
+    // Read the RSSI value, which is valid once the receiver has settled
+    if (sim_time_get() >= radio_phy_vars.rx_settled) {
+        *rssi = sim_radio_rssi(radio_phy_vars.channel);
+    } else {
+        *rssi = RADIO_RSSI_INVALID;
+        error = RADIO_ERROR_RSSI;
+    }
+
+    // Record the RSSI value
+    recorder_rssi(*rssi);
+
+    return error;
+}
+
+bsp_timer_width_t radio_get_sfd(void) {
+    return radio_vars.sfd;
+}
+
+/*================================ private ==================================*/
+
+static bool radio_tx_active(void) {
+    /* The ongoing transmission has not ended yet */
+    return (radio_phy_vars.tx_end > sim_time_get());
+}
+
+static void radio_off(void) {
+    radio_vars.idle_pending = false;
+
+    /* Turn off the receiver, this aborts any ongoing reception */
+    sim_radio_off();
+
+    /* Update the radio state */
+    radio_vars.current_state = RADIO_IDLE;
+}
+
+static void radio_report(radio_error_t error) {
+    if (radio_vars.error != NULL) {
+        radio_vars.error(error);
+    }
+}
+
+static void radio_lost(packet_buffer_t* packet_buffer, radio_packet_cb_t packet_cb) {
+    /* Tell the MAC that the buffer holds no packet */
+    packet_buffer->length = 0;
+    packet_buffer->crc    = 0;
+    if (packet_cb != NULL) {
+        packet_cb(packet_buffer);
+    }
+}
+
+/*=============================== interrupt =================================*/
+
+void rf_core_interrupt(void) {
+    uint8_t irq_status;
+
+    debug_isr_on();
+
+    /* Read and clear the interrupt flags */
+    irq_status = sim_radio_irq_get();
+    sim_irq_clear(SIM_IRQ_RF);
+
+    /* Start of frame event */
+    if (irq_status & SIM_RADIO_IRQ_SFD) {
+        // Timestamp the frame, the interrupt is taken at the SFD
+        radio_vars.sfd = bsp_timer_get();
+
+        if ((radio_vars.current_state == RADIO_RX_ENABLING ||
+             radio_vars.current_state == RADIO_RX_ENABLED) &&
+            radio_vars.rx_init != NULL) {
+            radio_vars.current_state = RADIO_RX_RECEIVING;
+            recorder_sfd();
+#if LATENCY_ENABLED
+            // The cycle counter of the simulator is its time in nanoseconds
+            latency_sfd((uint32_t) sim_radio_sfd_time());
+#endif
+            radio_vars.rx_init();
+        }
+        else if ((radio_vars.current_state == RADIO_TX_ENABLING ||
+                  radio_vars.current_state == RADIO_TX_ENABLED) &&
+                 radio_vars.tx_init != NULL) {
+            radio_vars.current_state = RADIO_TX_TRANSMITTING;
+            radio_vars.tx_init();
+        }
+    }
+
+    /* End of received frame event */
+    if (irq_status & SIM_RADIO_IRQ_RXPKTDONE) {
+        if (radio_vars.current_state == RADIO_RX_RECEIVING &&
+            radio_vars.rx_done != NULL) {
+            radio_vars.current_state = RADIO_RX_DONE;
+            recorder_rx_done();
+            radio_vars.rx_done();
+        }
+    }
+
+    /* End of transmitted frame event */
+    if (irq_status & SIM_RADIO_IRQ_TXDONE) {
+        if (radio_vars.current_state == RADIO_TX_TRANSMITTING &&
+            radio_vars.tx_done != NULL) {
+            radio_vars.current_state = RADIO_TX_DONE;
+            radio_vars.tx_done();
+        }
+
+        /* Go idle if it was requested during the transmission */
+        if (radio_vars.idle_pending) {
+            radio_off();
+        }
+    }
+
+    debug_isr_off();
+}
@@ -0,0 +1,56 @@
+/**
+ * @file       sim_image.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Descriptor that lets the simulator instantiate this image.
+ *
+ *             Once linked, the .data and .bss sections of the image are
+ *             renamed to sim_data_<image> and sim_bss_<image> so that the
+ *             simulator can save and restore them for every node.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_include.h"
+
+/*================================ define ===================================*/
+
+#ifndef SIM_IMAGE
+#error "SIM_IMAGE not defined."
+#endif
+
+#define SIM_STRING(x)                   SIM_STRING_(x)
+#define SIM_STRING_(x)                  #x
+#define SIM_SYMBOL(prefix, x)           SIM_SYMBOL_(prefix, x)
+#define SIM_SYMBOL_(prefix, x)          prefix##x
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+// Section boundaries, provided by the linker of the simulator
+extern uint8_t SIM_SYMBOL(__start_sim_data_, SIM_IMAGE)[];
+extern uint8_t SIM_SYMBOL(__stop_sim_data_, SIM_IMAGE)[];
+extern uint8_t SIM_SYMBOL(__start_sim_bss_, SIM_IMAGE)[];
+extern uint8_t SIM_SYMBOL(__stop_sim_bss_, SIM_IMAGE)[];
+
+/*=============================== prototypes ================================*/
+
+int main(void);
+
+/*================================= public ==================================*/
+
+const sim_image_t SIM_SYMBOL(sim_image_, SIM_IMAGE) = {
+    .name       = SIM_STRING(SIM_IMAGE),
+    .main       = main,
+    .data_start = SIM_SYMBOL(__start_sim_data_, SIM_IMAGE),
+    .data_end   = SIM_SYMBOL(__stop_sim_data_, SIM_IMAGE),
+    .bss_start  = SIM_SYMBOL(__start_sim_bss_, SIM_IMAGE),
+    .bss_end    = SIM_SYMBOL(__stop_sim_bss_, SIM_IMAGE)
+};
+
+/*================================ private ==================================*/
@@ -0,0 +1,114 @@
+/**
+ * @file       sim_include.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Simulation kernel interface used by the sim platform drivers.
+ *
+ *             The drivers are linked into a firmware image that runs as
+ *             one of many nodes inside the discrete-event simulator, so
+ *             every call refers to the node that is currently executing.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef SIM_INCLUDE_
+#define SIM_INCLUDE_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+/*================================ define ===================================*/
+
+#define SIM_TICKS_PER_SECOND            ( 32768ULL )
+#define SIM_NS_PER_SECOND               ( 1000000000ULL )
+#define SIM_NS_PER_US                   ( 1000ULL )
+
+#define SIM_RADIO_FRAME_MAX             ( 127 )
+
+// Radio interrupt flags raised by the simulated channel
+#define SIM_RADIO_IRQ_SFD               ( 1 << 0 )
+#define SIM_RADIO_IRQ_RXPKTDONE         ( 1 << 1 )
+#define SIM_RADIO_IRQ_TXDONE            ( 1 << 2 )
+
+/*================================ typedef ==================================*/
+
+typedef void (* sim_isr_t)(void);
+
+// Simulated interrupt lines, ordered by priority as on the CC2538 NVIC
+typedef enum {
+    SIM_IRQ_RF      = 0x00,
+    SIM_IRQ_MACTIMR = 0x01,
+    SIM_IRQ_UART    = 0x02,
+    SIM_IRQ_SMTIM   = 0x03,
+    SIM_IRQ_COUNT   = 0x04
+} sim_irq_t;
+
+/**
+ * Frame delivered by the simulated channel at the end of a reception,
+ * the length accounts for the two CRC bytes as in the CC2538 RX FIFO
+ */
+typedef struct {
+    uint8_t length;
+    int8_t  rssi;
+    bool    crc;
+    uint8_t lqi;
+    uint8_t buffer[SIM_RADIO_FRAME_MAX];
+} sim_radio_frame_t;
+
+/**
+ * Firmware image descriptor, the only global symbol left in an image
+ * once it has been prepared for the simulator
+ */
+typedef struct {
+    const char* name;
+    int (* main)(void);
+    uint8_t* data_start;
+    uint8_t* data_end;
+    uint8_t* bss_start;
+    uint8_t* bss_end;
+} sim_image_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void sim_reset(void);
+void sim_wait(void);
+void sim_spin(uint64_t duration_ns);
+void sim_spin_until(uint64_t time_ns);
+
+uint64_t sim_time_get(void);
+uint64_t sim_ticks_get(void);
+uint64_t sim_ticks_to_time(uint64_t ticks);
+
+void sim_irq_register(sim_irq_t irq, sim_isr_t isr);
+void sim_irq_enable(sim_irq_t irq);
+void sim_irq_disable(sim_irq_t irq);
+void sim_irq_pend(sim_irq_t irq);
+void sim_irq_clear(sim_irq_t irq);
+void sim_irq_master_enable(void);
+bool sim_irq_master_disable(void);
+sim_irq_t sim_irq_active(void);
+
+void sim_timer_set(uint64_t time_ns);
+void sim_timer_cancel(void);
+
+void sim_radio_on(uint8_t channel);
+void sim_radio_off(void);
+uint64_t sim_radio_transmit(const uint8_t* buffer, uint8_t length, uint8_t channel);
+uint8_t sim_radio_irq_get(void);
+uint64_t sim_radio_sfd_time(void);
+const sim_radio_frame_t* sim_radio_frame_get(void);
+int8_t sim_radio_rssi(uint8_t channel);
+
+void sim_uart_write(uint8_t byte);
+bool sim_uart_read(uint8_t* byte);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* SIM_INCLUDE_ */
@@ -0,0 +1,139 @@
+/**
+ * @file       uart.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Simulated UART, connected to the host side of the simulator.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_include.h"
+
+#include "uart.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    uart_cb_t uart_rx_cb;
+    uart_cb_t uart_tx_cb;
+    // Interrupt emulation
+    bool enabled;
+    bool tx_active;
+    bool tx_pending;
+    // Last received byte
+    uint8_t rx_byte;
+} uart_vars_t;
+
+/*=============================== variables =================================*/
+
+static uart_vars_t uart_vars;
+
+/*=============================== prototypes ================================*/
+
+void uart0_interrupt(void);
+
+/*================================= public ==================================*/
+
+/**
+ * Initialize the UART interface
+ */
+void uart_init(void) {
+    // Initialize the memory of the uart variables
+    memset(&uart_vars, 0, sizeof(uart_vars_t));
+
+    // Register the UART interrupt handler
+    sim_irq_register(SIM_IRQ_UART, uart0_interrupt);
+}
+
+/**
+ * Deinitialize the UART interface
+ */
+void uart_deinit(void) {
+    uart_vars.enabled = false;
+}
+
+void uart_enable_interrupts(void) {
+    // Enable the UART peripheral interrupts
+    uart_vars.enabled = true;
+
+    // Enable the UART global interrupt
+    sim_irq_enable(SIM_IRQ_UART);
+}
+
+void uart_disable_interrupts(void) {
+    // Disable the UART peripheral interrupts
+    uart_vars.enabled = false;
+
+    // Disable the UART global interrupt
+    sim_irq_disable(SIM_IRQ_UART);
+}
+
+void uart_register_rx_cb(uart_cb_t callback) {
+    uart_vars.uart_rx_cb = callback;
+}
+
+void uart_register_tx_cb(uart_cb_t callback) {
+    uart_vars.uart_tx_cb = callback;
+}
+
+void uart_cancel_rx_cb(void) {
+    uart_vars.uart_rx_cb = NULL;
+}
+
+void uart_cancel_tx_cb(void) {
+    uart_vars.uart_tx_cb = NULL;
+}
+
+void uart_send_byte(uint8_t byte) {
+    // Hand the byte to the host side of the simulator
+    sim_uart_write(byte);
+
+    if (!uart_vars.enabled) {
+        return;
+    }
+
+    /**
+     * The end of transmission interrupt is taken right away, as the
+     * firmware busy-waits on it (e.g. serial_is_busy). Bytes sent from
+     * the callback are chained here instead of recursing.
+     */
+    if (uart_vars.tx_active) {
+        uart_vars.tx_pending = true;
+        return;
+    }
+
+    uart_vars.tx_active = true;
+    do {
+        uart_vars.tx_pending = false;
+        if (uart_vars.uart_tx_cb != NULL) {
+            uart_vars.uart_tx_cb();
+        }
+    } while (uart_vars.tx_pending && uart_vars.enabled);
+    uart_vars.tx_active = false;
+}
+
+uint8_t uart_receive_byte(void) {
+    return uart_vars.rx_byte;
+}
+
+/*================================ private ==================================*/
+
+/*=============================== interrupt =================================*/
+
+void uart0_interrupt(void) {
+    // Clear the pending interrupt
+    sim_irq_clear(SIM_IRQ_UART);
+
+    // Process the RX interrupt once per received byte
+    while (sim_uart_read(&uart_vars.rx_byte)) {
+        if (uart_vars.uart_rx_cb != NULL) {
+            uart_vars.uart_rx_cb();
+        }
+    }
+}
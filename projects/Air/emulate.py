@@ -0,0 +1,190 @@
+'''
+Runs a Gateway and many Nodes, built with TARGET=posix, as separate processes
+connected through the air broker, starts an experiment on the gateway as the
+OpenDQ application would, and summarizes the records that it sends back.
+'''
+
+# Generic imports
+import argparse
+import os
+import select
+import subprocess
+import sys
+import tempfile
+import time
+
+HDLC_FLAG = 0x7E
+HDLC_ESCAPE = 0x7D
+HDLC_ESCAPE_MASK = 0x20
+
+MAC_TYPES = {'fsa': 0x01, 'dq': 0x02}
+OUTCOMES = ['empty', 'collision', 'success']
+
+def crc16_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+CRC16_TABLE = crc16_table()
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc = (CRC16_TABLE[(byte ^ (crc >> 8)) & 0xFF] ^ (crc << 8)) & 0xFFFF
+    return crc
+
+def hdlcify(data):
+    crc = crc16(data)
+    data = bytearray(data) + bytearray([(crc >> 8) & 0xFF, crc & 0xFF])
+
+    output = bytearray([HDLC_FLAG])
+    for byte in data:
+        if byte in (HDLC_FLAG, HDLC_ESCAPE):
+            output += bytearray([HDLC_ESCAPE, byte ^ HDLC_ESCAPE_MASK])
+        else:
+            output.append(byte)
+    output.append(HDLC_FLAG)
+
+    return bytes(output)
+
+class Emulation():
+    def __init__(self, args):
+        self.args = args
+        self.processes = []
+        self.records = []
+        self.buffer = bytearray()
+        self.escaping = False
+
+    def start(self):
+        path = os.path.join(tempfile.mkdtemp(prefix = 'opendq-'), 'air')
+        projects = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+        # Start the broker and wait for its socket
+        command = [os.path.join(projects, 'Air', 'Air.elf'), '-s', path, '-x', str(self.args.speed)]
+        if self.args.trace:
+            command += ['-o', self.args.trace]
+        self.broker = subprocess.Popen(command)
+        while not os.path.exists(path):
+            time.sleep(0.01)
+
+        environment = dict(os.environ, OPENDQ_AIR = path, OPENDQ_SPEED = str(self.args.speed))
+
+        # Start the gateway and find its UART
+        gateway = subprocess.Popen([os.path.join(projects, 'Gateway', 'Gateway.elf')],
+                                   env = dict(environment, OPENDQ_SEED = '1', OPENDQ_EUI64 = '00124b0000000001'),
+                                   stderr = subprocess.PIPE)
+        self.processes.append(gateway)
+        uart = None
+        while uart is None:
+            line = gateway.stderr.readline().decode('ascii', 'replace')
+            if not line:
+                raise RuntimeError('the gateway did not start')
+            if line.startswith('posix: uart on '):
+                uart = line.split()[-1]
+        self.uart = os.open(uart, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+
+        # Start the nodes
+        for i in range(self.args.nodes):
+            node = subprocess.Popen([os.path.join(projects, 'Node', 'Node.elf')],
+                                    env = dict(environment, OPENDQ_SEED = str(i + 2),
+                                               OPENDQ_EUI64 = '00124b00%08x' % (i + 2)),
+                                    stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL)
+            self.processes.append(node)
+
+        # Give the nodes time to boot, then start the experiment
+        time.sleep(self.args.boot)
+        duration = min(int(self.args.duration * 1000), 0xFFFF)
+        command = bytearray([ord('A'), 0x00, 0x00, MAC_TYPES[self.args.mac], self.args.slots,
+                             (duration >> 8) & 0xFF, duration & 0xFF])
+        os.write(self.uart, hdlcify(command))
+
+    def run(self):
+        deadline = time.time() + self.args.duration / self.args.speed
+
+        while time.time() < deadline:
+            ready, _, _ = select.select([self.uart], [], [], 0.1)
+            if ready:
+                try:
+                    self._parse(os.read(self.uart, 4096))
+                except OSError:
+                    pass
+
+    def stop(self):
+        for process in self.processes:
+            process.terminate()
+        for process in self.processes:
+            process.wait()
+        self.broker.terminate()
+        self.broker.wait()
+
+    def report(self):
+        arp = dict((outcome, 0) for outcome in OUTCOMES)
+        data = dict((outcome, 0) for outcome in OUTCOMES)
+        senders = set()
+
+        for record in self.records:
+            # Command, address, MAC type, then the slot outcomes
+            if record[0] != ord('D') or len(record) < 8:
+                continue
+            if self.args.mac == 'dq':
+                states = record[4:7]
+                data_state = record[7]
+                for state in states:
+                    if state < len(OUTCOMES):
+                        arp[OUTCOMES[state]] += 1
+                address = record[20] | (record[21] << 8) if len(record) > 21 else 0
+            else:
+                data_state = record[5]
+                address = record[6] | (record[7] << 8)
+            if data_state < len(OUTCOMES):
+                data[OUTCOMES[data_state]] += 1
+                if OUTCOMES[data_state] == 'success':
+                    senders.add(address)
+
+        if self.args.mac == 'dq':
+            sys.stdout.write('arp:    %s\n' % ', '.join('%s %d' % (o, arp[o]) for o in OUTCOMES))
+        sys.stdout.write('data:   %s\n' % ', '.join('%s %d' % (o, data[o]) for o in OUTCOMES))
+        sys.stdout.write('served: %d nodes\n' % len(senders))
+
+    def _parse(self, data):
+        for byte in bytearray(data):
+            if byte == HDLC_FLAG:
+                if len(self.buffer) > 2 and crc16(self.buffer) == 0:
+                    self.records.append(bytes(self.buffer[:-2]))
+                self.buffer = bytearray()
+                self.escaping = False
+            elif byte == HDLC_ESCAPE:
+                self.escaping = True
+            else:
+                if self.escaping:
+                    byte ^= HDLC_ESCAPE_MASK
+                    self.escaping = False
+                self.buffer.append(byte)
+
+def main():
+    parser = argparse.ArgumentParser(description = 'OpenDQ process-per-node emulation')
+    parser.add_argument('-n', '--nodes', type = int, default = 10)
+    parser.add_argument('-m', '--mac', choices = sorted(MAC_TYPES), default = 'dq')
+    parser.add_argument('-k', '--slots', type = int, default = 8, help = 'FSA slots per frame')
+    parser.add_argument('-d', '--duration', type = float, default = 10.0, help = 'emulated seconds of experiment')
+    parser.add_argument('-x', '--speed', type = float, default = 1.0, help = 'emulated time per host time')
+    parser.add_argument('-b', '--boot', type = float, default = 1.0, help = 'host seconds for the processes to boot')
+    parser.add_argument('-o', '--trace', default = 'air.csv', help = 'trace of the frames')
+    args = parser.parse_args()
+
+    emulation = Emulation(args)
+    try:
+        emulation.start()
+        emulation.run()
+    finally:
+        emulation.stop()
+    emulation.report()
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,451 @@
+/**
+ * @file       main.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Air broker for Node and Gateway processes built with TARGET=posix.
+ *
+ *             Every process that is started with OPENDQ_AIR connects to the
+ *             broker, which sets the emulated time they share. The broker
+ *             announces every frame to the other processes before its SFD,
+ *             and once the frame is over it tells whether it overlapped
+ *             another frame on the same channel (collision). Each frame is
+ *             written to the trace as one line of CSV.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "posix_air.h"
+
+/*================================ define ===================================*/
+
+#define AIR_CLIENTS_MAX                 ( 1024 )
+#define AIR_FRAMES_MAX                  ( 256 )
+
+#define AIR_SPEED_DEFAULT               ( 1.0 )
+
+#define AIR_NS_PER_SECOND               ( 1000000000ULL )
+
+// Synchronization header (preamble and SFD) at 32 us per byte
+#define AIR_SHR_NS                      ( 5 * 32 * 1000ULL )
+
+#define AIR_TIME_NONE                   ( UINT64_MAX )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    int      fd;
+    uint32_t id;
+    uint32_t pid;
+} air_client_t;
+
+typedef struct {
+    bool     active;
+    uint32_t id;
+    uint32_t sender;
+    uint32_t pid;
+    uint8_t  channel;
+    uint8_t  length;
+    bool     corrupted;
+    uint64_t notice;
+    uint64_t sfd;
+    uint64_t end;
+} air_frame_t;
+
+typedef struct {
+    // Emulated time, shared with the processes
+    uint64_t epoch;
+    double   speed;
+    uint64_t limit;
+
+    int          listen_fd;
+    air_client_t clients[AIR_CLIENTS_MAX];
+    uint32_t     client_count;
+    uint32_t     client_ids;
+
+    air_frame_t frames[AIR_FRAMES_MAX];
+    uint32_t    frame_ids;
+
+    FILE* trace;
+
+    // Statistics
+    uint64_t transmissions;
+    uint64_t collisions;
+    uint64_t late;
+} air_vars_t;
+
+/*=============================== variables =================================*/
+
+static air_vars_t air_vars;
+
+static volatile sig_atomic_t air_stop;
+
+/*=============================== prototypes ================================*/
+
+static void air_usage(const char* name);
+static void air_signal(int signal);
+static uint64_t air_real_get(void);
+static uint64_t air_time_get(void);
+static void air_accept(void);
+static void air_receive(air_client_t* client);
+static void air_hello(air_client_t* client, const posix_air_msg_t* msg);
+static void air_transmit(air_client_t* client, const posix_air_msg_t* msg);
+static void air_broadcast(const posix_air_msg_t* msg, uint32_t except);
+static void air_close(uint32_t index);
+static uint64_t air_frames_end(uint64_t now);
+
+/*================================= public ==================================*/
+
+int main(int argc, char** argv) {
+    struct pollfd fds[AIR_CLIENTS_MAX + 1];
+    struct sockaddr_un address;
+    const char* path = POSIX_AIR_SOCKET_DEFAULT;
+    const char* trace = NULL;
+    uint64_t next, now;
+    int timeout, option;
+
+    // Initialize the memory of the broker variables
+    memset(&air_vars, 0, sizeof(air_vars_t));
+    air_vars.speed = AIR_SPEED_DEFAULT;
+
+    // Parse the command line
+    while ((option = getopt(argc, argv, "s:x:o:t:h")) != -1) {
+        switch (option) {
+            case 's':
+                path = optarg;
+                break;
+            case 'x':
+                air_vars.speed = strtod(optarg, NULL);
+                break;
+            case 'o':
+                trace = optarg;
+                break;
+            case 't':
+                air_vars.limit = (uint64_t) (strtod(optarg, NULL) * AIR_NS_PER_SECOND);
+                break;
+            default:
+                air_usage(argv[0]);
+                break;
+        }
+    }
+
+    // The processes run in real time, possibly slowed down or sped up
+    if (air_vars.speed <= 0) {
+        air_usage(argv[0]);
+    }
+
+    // Open the trace
+    if (trace != NULL) {
+        air_vars.trace = fopen(trace, "w");
+        if (air_vars.trace == NULL) {
+            fprintf(stderr, "air: unable to open %s\n", trace);
+            return EXIT_FAILURE;
+        }
+        fprintf(air_vars.trace, "frame,sender,pid,channel,length,notice_ns,start_ns,sfd_ns,end_ns,collided\n");
+    }
+
+    // Listen for the processes
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    unlink(address.sun_path);
+
+    air_vars.listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (air_vars.listen_fd < 0 ||
+        bind(air_vars.listen_fd, (struct sockaddr*) &address, sizeof(address)) < 0 ||
+        listen(air_vars.listen_fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "air: unable to listen on %s (%s)\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, air_signal);
+    signal(SIGTERM, air_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    // The emulated time starts now
+    air_vars.epoch = air_real_get();
+    fprintf(stderr, "air: listening on %s at speed %.3f\n", path, air_vars.speed);
+
+    while (!air_stop) {
+        // End the frames that are over and find when the next one is
+        now = air_time_get();
+        next = air_frames_end(now);
+
+        if (air_vars.limit != 0 && now >= air_vars.limit) {
+            break;
+        }
+
+        // Wait for the processes or for the end of the next frame
+        if (next == AIR_TIME_NONE) {
+            timeout = 100;
+        } else {
+            timeout = (int) ((next - now) / air_vars.speed / 1000000ULL);
+        }
+
+        fds[0].fd = air_vars.listen_fd;
+        fds[0].events = POLLIN;
+        for (uint32_t i = 0; i < air_vars.client_count; i++) {
+            fds[i + 1].fd = air_vars.clients[i].fd;
+            fds[i + 1].events = POLLIN;
+            fds[i + 1].revents = 0;
+        }
+
+        if (poll(fds, air_vars.client_count + 1, timeout) <= 0) {
+            continue;
+        }
+
+        // Serve the processes, from the last one as they may go away
+        for (uint32_t i = air_vars.client_count; i > 0; i--) {
+            if (fds[i].revents & POLLIN) {
+                air_receive(&air_vars.clients[i - 1]);
+            } else if (fds[i].revents & (POLLHUP | POLLERR)) {
+                air_close(i - 1);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            air_accept();
+        }
+    }
+
+    // Closing the socket stops the processes
+    while (air_vars.client_count > 0) {
+        air_close(air_vars.client_count - 1);
+    }
+    close(air_vars.listen_fd);
+    unlink(address.sun_path);
+
+    if (air_vars.trace != NULL) {
+        fclose(air_vars.trace);
+    }
+
+    fprintf(stderr, "air: %llu frames, %llu collided, %llu announced after their start\n",
+            (unsigned long long) air_vars.transmissions,
+            (unsigned long long) air_vars.collisions,
+            (unsigned long long) air_vars.late);
+
+    return EXIT_SUCCESS;
+}
+
+/*================================ private ==================================*/
+
+static void air_usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -s socket   Path of the socket (default %s)\n"
+            "  -x speed    Emulated time per host time, greater than 0 (default 1)\n"
+            "  -o file     Write the trace of the frames to this file\n"
+            "  -t seconds  Stop after the given emulated time (default none)\n",
+            name, POSIX_AIR_SOCKET_DEFAULT);
+    exit(EXIT_FAILURE);
+}
+
+static void air_signal(int signal) {
+    air_stop = true;
+}
+
+static uint64_t air_real_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * AIR_NS_PER_SECOND + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t air_time_get(void) {
+    return (uint64_t) ((air_real_get() - air_vars.epoch) * air_vars.speed);
+}
+
+static void air_accept(void) {
+    air_client_t* client;
+    int fd;
+
+    fd = accept4(air_vars.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    if (air_vars.client_count == AIR_CLIENTS_MAX) {
+        fprintf(stderr, "air: too many processes\n");
+        close(fd);
+        return;
+    }
+
+    // The process is not part of the air until it introduces itself
+    client = &air_vars.clients[air_vars.client_count++];
+    client->fd = fd;
+    client->id = 0;
+    client->pid = 0;
+}
+
+static void air_receive(air_client_t* client) {
+    posix_air_msg_t msg;
+    ssize_t length;
+
+    length = recv(client->fd, &msg, sizeof(msg), 0);
+    if (length <= 0) {
+        air_close(client - air_vars.clients);
+        return;
+    }
+    if (length != sizeof(msg)) {
+        return;
+    }
+
+    switch (msg.type) {
+        case POSIX_AIR_HELLO:
+            air_hello(client, &msg);
+            break;
+        case POSIX_AIR_TX:
+            air_transmit(client, &msg);
+            break;
+        default:
+            break;
+    }
+}
+
+static void air_hello(air_client_t* client, const posix_air_msg_t* msg) {
+    posix_air_msg_t reply;
+
+    client->id = ++air_vars.client_ids;
+    client->pid = msg->pid;
+
+    // Share the emulated time with the process
+    memset(&reply, 0, sizeof(reply));
+    reply.type  = POSIX_AIR_WELCOME;
+    reply.id    = client->id;
+    reply.sfd   = air_vars.epoch;
+    reply.speed = air_vars.speed;
+    send(client->fd, &reply, sizeof(reply), 0);
+}
+
+static void air_transmit(air_client_t* client, const posix_air_msg_t* msg) {
+    air_frame_t* frame = NULL;
+    air_frame_t* other;
+    posix_air_msg_t notice;
+
+    if (msg->length < 2 || msg->length > POSIX_AIR_PAYLOAD_MAX || msg->end <= msg->sfd) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < AIR_FRAMES_MAX && frame == NULL; i++) {
+        if (!air_vars.frames[i].active) {
+            frame = &air_vars.frames[i];
+        }
+    }
+    if (frame == NULL) {
+        fprintf(stderr, "air: too many frames on the air\n");
+        return;
+    }
+
+    frame->active    = true;
+    frame->id        = ++air_vars.frame_ids;
+    frame->sender    = client->id;
+    frame->pid       = client->pid;
+    frame->channel   = msg->channel;
+    frame->length    = msg->length;
+    frame->corrupted = false;
+    frame->notice    = air_time_get();
+    frame->sfd       = msg->sfd;
+    frame->end       = msg->end;
+
+    air_vars.transmissions++;
+    if (frame->notice > frame->sfd - AIR_SHR_NS) {
+        air_vars.late++;
+    }
+
+    // Frames on the same channel that overlap in time collide
+    for (uint32_t i = 0; i < AIR_FRAMES_MAX; i++) {
+        other = &air_vars.frames[i];
+        if (other->active && other != frame && other->channel == frame->channel &&
+            other->sfd - AIR_SHR_NS < frame->end && frame->sfd - AIR_SHR_NS < other->end) {
+            other->corrupted = true;
+            frame->corrupted = true;
+        }
+    }
+
+    // Announce the frame to everybody else
+    notice = *msg;
+    notice.type = POSIX_AIR_FRAME;
+    notice.id   = frame->id;
+    air_broadcast(&notice, client->id);
+}
+
+static void air_broadcast(const posix_air_msg_t* msg, uint32_t except) {
+    for (uint32_t i = 0; i < air_vars.client_count; i++) {
+        if (air_vars.clients[i].id != 0 && air_vars.clients[i].id != except) {
+            send(air_vars.clients[i].fd, msg, sizeof(*msg), MSG_NOSIGNAL);
+        }
+    }
+}
+
+static void air_close(uint32_t index) {
+    close(air_vars.clients[index].fd);
+
+    // Keep the clients packed
+    air_vars.clients[index] = air_vars.clients[--air_vars.client_count];
+}
+
+static uint64_t air_frames_end(uint64_t now) {
+    air_frame_t* frame;
+    posix_air_msg_t msg;
+    uint64_t next = AIR_TIME_NONE;
+
+    for (uint32_t i = 0; i < AIR_FRAMES_MAX; i++) {
+        frame = &air_vars.frames[i];
+        if (!frame->active) {
+            continue;
+        }
+
+        if (frame->end > now) {
+            if (frame->end < next) {
+                next = frame->end;
+            }
+            continue;
+        }
+
+        // The frame is over, tell the receivers whether it collided
+        memset(&msg, 0, sizeof(msg));
+        msg.type      = POSIX_AIR_END;
+        msg.channel   = frame->channel;
+        msg.length    = frame->length;
+        msg.corrupted = frame->corrupted;
+        msg.id        = frame->id;
+        msg.sfd       = frame->sfd;
+        msg.end       = frame->end;
+        air_broadcast(&msg, frame->sender);
+
+        if (frame->corrupted) {
+            air_vars.collisions++;
+        }
+
+        if (air_vars.trace != NULL) {
+            fprintf(air_vars.trace, "%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%u\n",
+                    frame->id, frame->sender, frame->pid, frame->channel, frame->length,
+                    (unsigned long long) frame->notice,
+                    (unsigned long long) (frame->sfd - AIR_SHR_NS),
+                    (unsigned long long) frame->sfd,
+                    (unsigned long long) frame->end,
+                    frame->corrupted);
+        }
+
+        frame->active = false;
+    }
+
+    return next;
+}
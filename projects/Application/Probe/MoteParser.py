@@ -1,5 +1,6 @@
 import time as time
 import struct as struct
+import subprocess as subprocess
 
 from PyDispatcher import dispatcher as dispatcher
 
@@ -11,10 +12,26 @@ MAC_TYPE_DQ = "DQ"
 
 class MoteParser(object):
     PARSER_PC2MOTE_START = 'A'
+    PARSER_PC2MOTE_BUFFER = 'B'
+    PARSER_PC2MOTE_LATENCY = 'L'
+    PARSER_PC2MOTE_DEADLINE = 'M'
     PARSER_PC2MOTE_STOP = 'O'
+    PARSER_PC2MOTE_PROFILE = 'P'
+    PARSER_PC2MOTE_QUEUE = 'Q'
+    PARSER_PC2MOTE_TRACE = 'T'
+    PARSER_PC2MOTE_POWER = 'W'
     
+    PARSER_MOTE2PC_BUFFER = 'B'
     PARSER_MOTE2PC_DATA = 'D'
+    PARSER_MOTE2PC_RECORD = 'E'
+    PARSER_MOTE2PC_FRAME = 'F'
+    PARSER_MOTE2PC_LATENCY = 'L'
+    PARSER_MOTE2PC_DEADLINE = 'M'
+    PARSER_MOTE2PC_PROFILE = 'P'
+    PARSER_MOTE2PC_QUEUE = 'Q'
+    PARSER_MOTE2PC_TRACE = 'T'
     PARSER_MOTE2PC_RESET = 'R'
+    PARSER_MOTE2PC_POWER = 'W'
     
     PARSER_MAC_NONE = '\x00'
     PARSER_MAC_FSA = '\x01'
@@ -22,6 +39,26 @@ class MoteParser(object):
     
     START_CMD = ['\x41', '\x00', '\x00']
     STOP_CMD = ['\x4F', '\x00', '\x00']
+    PROFILE_CMD = ['\x50', '\x00', '\x00']
+    TRACE_CMD = ['\x54', '\x00', '\x00']
+    LATENCY_CMD = ['\x4C', '\x00', '\x00']
+    POWER_CMD = ['\x57', '\x00', '\x00']
+    DEADLINE_CMD = ['\x4D', '\x00', '\x00']
+    BUFFER_CMD = ['\x42', '\x00', '\x00']
+    QUEUE_CMD = ['\x51', '\x00', '\x00']
+    
+    QUEUE_TICKS_PER_SECOND = 32768.0
+    
+    PROFILE_HEADER = '\x00'
+    PROFILE_ENTRY = '\x01'
+    PROFILE_TICKS_PER_SECOND = 32768.0
+    
+    LATENCY_HEADER = '\x00'
+    LATENCY_TIMER = '\x01'
+    LATENCY_SFD = '\x02'
+    
+    DEADLINE_HEADER = '\x00'
+    DEADLINE_ENTRY = '\x01'
     
     start_time = 0
     stop_time = 0
@@ -36,6 +73,20 @@ class MoteParser(object):
     parser = None
     parser_writer = None
     stats = None
+    
+    record_name = None
+    record_file = None
+    
+    trace_name = None
+    trace_file = None
+    
+    frame_name = None
+    frame_file = None
+    
+    profile_symbols = None
+    profile_header = None
+    latency_header = None
+    deadline_anchor = None
 
     def __init__(self, mote_connector = None):
         # Module name
@@ -62,6 +113,86 @@ class MoteParser(object):
         else:
             print "MoteParser: Error, wrong mac_type parameter."
             
+    def set_record(self, record_name = None):
+        # Ask the gateway to record the radio events to this file
+        self.record_name = record_name
+            
+    def set_trace(self, trace_name = None):
+        # Append the trace of the gateway to this file, see Trace/TraceDecoder.py
+        self.trace_name = trace_name
+        if (self.trace_name is not None):
+            self.trace_file = open(self.trace_name, 'ab')
+            
+    def set_frames(self, frame_name = None):
+        # Append the DATA frames that the gateway forwards to this file, each
+        # one after a byte with its length, see DQ_FORWARD_ENABLED in dq.c
+        self.frame_name = frame_name
+        if (self.frame_name is not None):
+            self.frame_file = open(self.frame_name, 'ab')
+            
+    def trace(self):
+        # Ask the gateway to drain its trace buffer
+        self._to_MoteConnector(self.TRACE_CMD[:])
+            
+    def set_profile(self, elf_name = None):
+        # Name the profiled tasks after the symbols of the gateway image
+        self.profile_symbols = {}
+        if (elf_name is None):
+            return
+        try:
+            output = subprocess.check_output(['nm', elf_name])
+        except (OSError, subprocess.CalledProcessError):
+            print("MoteParser: Error, unable to read the symbols of " + elf_name)
+            return
+        for line in output.splitlines():
+            fields = line.split()
+            if (len(fields) == 3 and fields[1] in 'tT'):
+                self.profile_symbols[int(fields[0], 16)] = fields[2]
+            
+    def profile(self, reset = False):
+        # Ask the gateway for the execution time of its tasks
+        command = self.PROFILE_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
+    def latency(self, reset = False):
+        # Ask the gateway how late its timers and radio interrupts run,
+        # the timers are named with the symbols given to set_profile
+        command = self.LATENCY_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
+    def deadline(self, reset = False):
+        # Ask the gateway how many deadline tasks started late, the
+        # tasks are named with the symbols given to set_profile
+        command = self.DEADLINE_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
+    def power(self, reset = False):
+        # Ask the gateway for the time spent in each power mode
+        command = self.POWER_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
+    def buffers(self, reset = False):
+        # Ask the gateway how full its packet buffers are
+        command = self.BUFFER_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
+    def queue(self, reset = False):
+        # Ask a node how its application queue is doing
+        command = self.QUEUE_CMD[:]
+        if (reset):
+            command.append('\x01')
+        self._to_MoteConnector(command)
+            
     def get_mac_stats(self):
         return self.stats
     
@@ -105,6 +236,11 @@ class MoteParser(object):
         # Append MAC duration to the command
         command.append(str(self.mac_duration))
         
+        # Ask the gateway to record the radio events
+        if (self.record_name is not None):
+            command.append('\x01')
+            self.record_file = open(self.record_name, 'ab')
+        
         # Obtain an appropriate dictionary
         self.dictionary = self.parser.get_dictionary()
         
@@ -157,7 +293,156 @@ class MoteParser(object):
             
             # Process the stats
             self.stats.process(data)
+        
+        # MOTE2PC_RECORD
+        elif (command == self.PARSER_MOTE2PC_RECORD):
+            # Append the records to the file, they are replayed with projects/Replay
+            if (self.record_file is not None):
+                self.record_file.write(payload)
+                self.record_file.flush()
+                
+        # MOTE2PC_PROFILE
+        elif (command == self.PARSER_MOTE2PC_PROFILE):
+            self._profile(payload)
+        
+        # MOTE2PC_LATENCY
+        elif (command == self.PARSER_MOTE2PC_LATENCY):
+            self._latency(payload)
+        
+        # MOTE2PC_DEADLINE
+        elif (command == self.PARSER_MOTE2PC_DEADLINE):
+            self._deadline(payload)
+        
+        # MOTE2PC_POWER
+        elif (command == self.PARSER_MOTE2PC_POWER):
+            self._power(payload)
+        
+        # MOTE2PC_BUFFER
+        elif (command == self.PARSER_MOTE2PC_BUFFER):
+            self._buffers(payload)
+        
+        # MOTE2PC_FRAME
+        elif (command == self.PARSER_MOTE2PC_FRAME):
+            if (self.frame_file is not None):
+                self.frame_file.write(chr(len(payload)) + payload)
+                self.frame_file.flush()
+        
+        # MOTE2PC_QUEUE
+        elif (command == self.PARSER_MOTE2PC_QUEUE):
+            self._queue(payload)
+        
+        # MOTE2PC_TRACE
+        elif (command == self.PARSER_MOTE2PC_TRACE):
+            if (self.trace_file is not None):
+                self.trace_file.write(payload)
+                self.trace_file.flush()
                 
         # Otherwise 
         else:
             print("MoteParser: PC2MOTE_ERROR")
+    
+    def _profile(self, payload = None):
+        # The header comes first, then one entry per task
+        if (payload[0] == self.PROFILE_HEADER):
+            frequency, anchor, entries, untracked, bins = struct.unpack('<IIBIB', payload[1:15])
+            self.profile_header = (frequency, anchor, bins)
+            print("MoteParser: %d tasks profiled, %d not tracked" % (entries, untracked))
+            print("%-24s %8s %10s %10s %10s %s" % ("task", "count", "min (us)", "avg (us)", "max (us)", "histogram"))
+        elif (payload[0] == self.PROFILE_ENTRY and self.profile_header is not None):
+            frequency, anchor, bins = self.profile_header
+            callback, count, minimum, average, maximum = struct.unpack('<IIIII', payload[2:22])
+            histogram = struct.unpack('<%dH' % bins, payload[22:22 + 2 * bins])
+            
+            # Find the callback relative to profiler_init, the image may be relocated
+            name = "0x%08x" % callback
+            if (self.profile_symbols):
+                base = [address for address, symbol in self.profile_symbols.items() if symbol == 'profiler_init']
+                if (base):
+                    address = (callback - anchor + base[0]) & 0xFFFFFFFF
+                    name = self.profile_symbols.get(address, name)
+            
+            # Times in microseconds, the histogram in fractions of a 32 kHz tick
+            scale = 1e6 / frequency
+            print("%-24s %8d %10.1f %10.1f %10.1f %s" % (name, count, minimum * scale, average * scale, maximum * scale, " ".join(str(h) for h in histogram)))
+    
+    def _power(self, payload = None):
+        # The time in each mode, the rest of the time the mote was active
+        modes = ord(payload[0])
+        elapsed, demoted = struct.unpack('<II', payload[1:9])
+        stats = struct.unpack('<%dI' % (2 * modes), payload[9:9 + 8 * modes])
+        active = elapsed - sum(stats[1::2])
+        print("MoteParser: %.3f s, %d sleeps kept shallower by the peripherals" % (elapsed / self.PROFILE_TICKS_PER_SECOND, demoted))
+        print("%-8s %10s %12s %8s" % ("mode", "count", "time (s)", "share"))
+        for mode in range(modes):
+            count, ticks = stats[2 * mode], stats[2 * mode + 1]
+            print("%-8s %10d %12.3f %7.1f%%" % ("PM%d" % mode, count, ticks / self.PROFILE_TICKS_PER_SECOND, 100.0 * ticks / max(elapsed, 1)))
+        print("%-8s %10s %12.3f %7.1f%%" % ("active", "-", active / self.PROFILE_TICKS_PER_SECOND, 100.0 * active / max(elapsed, 1)))
+    
+    def _buffers(self, payload = None):
+        # One entry per pool, from the smallest buffers to the largest
+        pools = ord(payload[0])
+        print("MoteParser: %d packet buffer pools" % pools)
+        print("%-8s %8s %8s %8s %10s" % ("size", "buffers", "taken", "most", "failures"))
+        for pool in range(pools):
+            size, count, taken, high, failures = struct.unpack('<BBBBI', payload[1 + 8 * pool:9 + 8 * pool])
+            print("%-8d %8d %8d %8d %10d" % (size, count, taken, high, failures))
+    
+    def _queue(self, payload = None):
+        # Counters of the application queue, the delays in ticks
+        depth, high, enqueued, sent, full, retries, failures, mean, longest = struct.unpack('<BBIIIIIII', payload[0:30])
+        print("MoteParser: %d payloads queued, %d at most" % (depth, high))
+        print("%10s %10s %10s %10s %10s %10s %10s" % ("enqueued", "sent", "full", "retries", "failures", "mean (ms)", "max (ms)"))
+        print("%10d %10d %10d %10d %10d %10.1f %10.1f" % (enqueued, sent, full, retries, failures,
+                                                         1000.0 * mean / self.QUEUE_TICKS_PER_SECOND,
+                                                         1000.0 * longest / self.QUEUE_TICKS_PER_SECOND))
+    
+    def _deadline(self, payload = None):
+        # The header comes first, then one message per task
+        if (payload[0] == self.DEADLINE_HEADER):
+            anchor, entries, untracked, lost = struct.unpack('<IBII', payload[1:14])
+            self.deadline_anchor = anchor
+            print("MoteParser: %d deadline tasks, %d not tracked, %d lost by the scheduler" % (entries, untracked, lost))
+            print("%-24s %8s %8s %12s" % ("task", "count", "misses", "worst (us)"))
+        elif (payload[0] == self.DEADLINE_ENTRY and self.deadline_anchor is not None):
+            callback, count, misses, worst = struct.unpack('<IIII', payload[2:18])
+            
+            # Find the callback relative to deadline_init, the image may be relocated
+            name = "0x%08x" % callback
+            if (self.profile_symbols):
+                base = [address for address, symbol in self.profile_symbols.items() if symbol == 'deadline_init']
+                if (base):
+                    address = (callback - self.deadline_anchor + base[0]) & 0xFFFFFFFF
+                    name = self.profile_symbols.get(address, name)
+            
+            print("%-24s %8d %8d %12.1f" % (name, count, misses, worst * 1e6 / self.PROFILE_TICKS_PER_SECOND))
+    
+    def _latency(self, payload = None):
+        # The header comes first, then one message per timer and the SFD
+        if (payload[0] == self.LATENCY_HEADER):
+            frequency, anchor, entries, untracked, bins = struct.unpack('<IIBIB', payload[1:15])
+            self.latency_header = (frequency, anchor, bins)
+            print("MoteParser: %d timers measured, %d not tracked" % (entries, untracked))
+            print("%-24s %6s %8s %10s %10s %10s %s" % ("timer", "early", "count", "min (us)", "avg (us)", "max (us)", "histogram"))
+        elif (payload[0] == self.LATENCY_TIMER and self.latency_header is not None):
+            frequency, anchor, bins = self.latency_header
+            callback, early, count, minimum, average, maximum = struct.unpack('<IIIIII', payload[2:26])
+            histogram = struct.unpack('<%dH' % bins, payload[26:26 + 2 * bins])
+            
+            # Find the callback relative to latency_init, the image may be relocated
+            name = "0x%08x" % callback
+            if (self.profile_symbols):
+                base = [address for address, symbol in self.profile_symbols.items() if symbol == 'latency_init']
+                if (base):
+                    address = (callback - anchor + base[0]) & 0xFFFFFFFF
+                    name = self.profile_symbols.get(address, name)
+            
+            # Times in microseconds, the histogram in fractions of a 32 kHz tick
+            scale = 1e6 / frequency
+            print("%-24s %6d %8d %10.1f %10.1f %10.1f %s" % (name, early, count, minimum * scale, average * scale, maximum * scale, " ".join(str(h) for h in histogram)))
+        elif (payload[0] == self.LATENCY_SFD and self.latency_header is not None):
+            frequency, anchor, bins = self.latency_header
+            count, minimum, average, maximum = struct.unpack('<IIII', payload[1:17])
+            histogram = struct.unpack('<%dH' % bins, payload[17:17 + 2 * bins])
+            
+            scale = 1e6 / frequency
+            print("%-24s %6s %8d %10.1f %10.1f %10.1f %s" % ("sfd to rx_init", "-", count, minimum * scale, average * scale, maximum * scale, " ".join(str(h) for h in histogram)))
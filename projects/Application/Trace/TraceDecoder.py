@@ -0,0 +1,156 @@
+import json as json
+import os as os
+import struct as struct
+import subprocess as subprocess
+import sys as sys
+
+class TraceDecoder(object):
+    """Converts the trace drained from one or more motes to Chrome trace JSON"""
+    
+    TRACE_MSG_RECORDS = 0x00
+    TRACE_MSG_END = 0x01
+    
+    TRACE_RECORD_SIZE = 10
+    TRACE_END_SIZE = 12
+    
+    TRACE_INSTANT = 0x00
+    TRACE_BEGIN = 0x01
+    TRACE_END = 0x02
+    
+    TRACE_EVENT_RADIO = 0x05
+    TRACE_EVENT_TASK = 0x06
+    TRACE_EVENT_TIMER = 0x07
+    
+    TICKS_PER_SECOND = 32768.0
+    TICKS_WRAP = 1 << 32
+    
+    # Name and track of each event
+    events = {
+        0x00: ("FBP", "slots"),
+        0x01: ("ARP", "slots"),
+        0x02: ("DATA", "slots"),
+        0x03: ("ACK", "slots"),
+        0x04: ("WOR", "slots"),
+        0x05: ("radio", "radio"),
+        0x06: ("task", "tasks"),
+        0x07: ("timer", "timers")
+    }
+    tracks = ["slots", "radio", "tasks", "timers"]
+    phases = {0x00: "i", 0x01: "B", 0x02: "E"}
+    
+    def __init__(self, elf_name = None):
+        self.trace_events = []
+        self.symbols = {}
+        self.anchor = None
+        
+        # Name the tasks after the symbols of the image
+        if (elf_name is not None):
+            output = subprocess.check_output(['nm', elf_name]).decode()
+            for line in output.splitlines():
+                fields = line.split()
+                if (len(fields) == 3 and fields[1] in 'tT'):
+                    self.symbols[fields[2]] = int(fields[0], 16)
+            self.addresses = dict((address, name) for name, address in self.symbols.items())
+    
+    def add(self, data = None, pid = 0, name = None):
+        # Every mote is a process with one thread per track
+        self.trace_events.append({"ph": "M", "name": "process_name", "pid": pid, "args": {"name": name}})
+        for tid, track in enumerate(self.tracks):
+            self.trace_events.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": tid, "args": {"name": track}})
+        
+        records, anchor = self._parse(bytearray(data))
+        
+        # Unwrap the time of the timer, which the records share
+        last = None
+        offset = 0
+        for ticks, arg, event, phase in records:
+            if (last is not None and ticks < last and last - ticks > self.TICKS_WRAP // 2):
+                offset += self.TICKS_WRAP
+            last = ticks
+            timestamp = (ticks + offset) * 1e6 / self.TICKS_PER_SECOND
+            self.trace_events.append(self._event(pid, timestamp, arg, event, phase, anchor))
+    
+    def write(self, file_name = None):
+        with open(file_name, 'w') as output:
+            json.dump({"traceEvents": self.trace_events, "displayTimeUnit": "ms"}, output)
+    
+    def _parse(self, data = None):
+        records = []
+        anchor = None
+        offset = 0
+        
+        # The messages of a drain follow each other, each one starts with its kind
+        while (offset < len(data)):
+            kind = data[offset]
+            if (kind == self.TRACE_MSG_RECORDS and offset + 2 <= len(data)):
+                count = data[offset + 1]
+                offset += 2
+                for i in range(count):
+                    if (offset + self.TRACE_RECORD_SIZE > len(data)):
+                        break
+                    ticks, arg, event, phase = struct.unpack('<IIBB', bytes(data[offset:offset + self.TRACE_RECORD_SIZE]))
+                    records.append((ticks, arg, event, phase))
+                    offset += self.TRACE_RECORD_SIZE
+            elif (kind == self.TRACE_MSG_END and offset + 1 + self.TRACE_END_SIZE <= len(data)):
+                overwritten, ticks, anchor = struct.unpack('<III', bytes(data[offset + 1:offset + 1 + self.TRACE_END_SIZE]))
+                if (overwritten > 0):
+                    print("TraceDecoder: %d records were overwritten before this drain" % overwritten)
+                offset += 1 + self.TRACE_END_SIZE
+            else:
+                print("TraceDecoder: Error, %d bytes left that cannot be parsed" % (len(data) - offset))
+                break
+        
+        return records, anchor
+    
+    def _event(self, pid = 0, timestamp = 0, arg = 0, event = 0, phase = 0, anchor = None):
+        name, track = self.events.get(event, ("event %d" % event, "slots"))
+        
+        # The radio tells whether it receives or transmits, the timers their identifier
+        if (event == self.TRACE_EVENT_RADIO):
+            name = ("TX" if arg else "RX")
+        elif (event == self.TRACE_EVENT_TIMER):
+            name = "timer %d" % arg
+        elif (event == self.TRACE_EVENT_TASK):
+            name = self._symbol(arg, anchor)
+        
+        trace_event = {"ph": self.phases.get(phase, "i"), "name": name, "pid": pid,
+                       "tid": self.tracks.index(track), "ts": timestamp}
+        if (phase == self.TRACE_INSTANT):
+            trace_event["s"] = "t"
+        return trace_event
+    
+    def _symbol(self, address = 0, anchor = None):
+        # The addresses are relative to trace_init, the image may be relocated
+        if (anchor is not None and 'trace_init' in self.symbols):
+            address = (address - anchor + self.symbols['trace_init']) & 0xFFFFFFFF
+            return self.addresses.get(address, "0x%08x" % address)
+        return "0x%08x" % address
+
+def main():
+    elf_name = None
+    output_name = "trace.json"
+    input_names = []
+    
+    # Usage: TraceDecoder.py [-e image.elf] [-o trace.json] mote.trace...
+    arguments = sys.argv[1:]
+    while (arguments):
+        argument = arguments.pop(0)
+        if (argument == '-e' and arguments):
+            elf_name = arguments.pop(0)
+        elif (argument == '-o' and arguments):
+            output_name = arguments.pop(0)
+        else:
+            input_names.append(argument)
+    
+    if (not input_names):
+        print("Usage: TraceDecoder.py [-e image.elf] [-o trace.json] mote.trace...")
+        sys.exit(1)
+    
+    decoder = TraceDecoder(elf_name = elf_name)
+    for pid, input_name in enumerate(input_names):
+        with open(input_name, 'rb') as input_file:
+            decoder.add(data = input_file.read(), pid = pid, name = os.path.basename(input_name))
+    decoder.write(output_name)
+
+if __name__ == "__main__":
+    main()
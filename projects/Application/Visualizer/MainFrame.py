@@ -1,3 +1,4 @@
+import os as os
 import sys as sys
 
 from PyQt4 import QtCore, QtGui
@@ -63,6 +64,9 @@ class MainFrame(QtGui.QWidget):
         # Configure the MoteParser
         self.mote_parser.set_mac_type(mac_type = self.mac_type, mac_slots = self.mac_slots, mac_duration = self.mac_duration)
         
+        # Record the radio events of the gateway to the file in OPENDQ_RECORD, if any
+        self.mote_parser.set_record(record_name = os.environ.get('OPENDQ_RECORD'))
+        
         # Start the MoteParser
         self.mote_parser.start()
     
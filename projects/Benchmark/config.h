@@ -0,0 +1,35 @@
+/**
+ * @file       config.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+/*================================ include ==================================*/
+
+/*================================ define ===================================*/
+
+// Enough virtual timers to measure how they scale, see virtual_timer.h
+#define VIRTUAL_TIMER_MAX_TIMERS        ( 64 )
+
+// As many full packet buffers as the other primitives have slots
+#define PACKET_BUFFER_FULL_COUNT        ( 16 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,605 @@
+/**
+ * @file       main.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Microbenchmarks of the library and scheduler primitives.
+ *
+ *             Each benchmark prepares the state it needs (e.g. a full task
+ *             buffer or 16 running timers), which is not measured, and then
+ *             measures a single run of the operation. The reported figures
+ *             are the median over many runs, without the measurement
+ *             overhead, divided by the number of operations in a run. The
+ *             instructions are counted with the hardware counters of the
+ *             computer when the kernel allows it. The bsp_timer, cpu and
+ *             leds calls are those of the posix platform.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "types.h"
+
+#include "board.h"
+#include "bsp_timer.h"
+#include "cpu.h"
+#include "posix_include.h"
+
+#include "crc16.h"
+#include "dq_core.h"
+#include "hdlc.h"
+#include "packet_buffer.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
+#include "virtual_timer.h"
+
+/*================================ define ===================================*/
+
+#define BENCHMARK_SAMPLES               ( 10000 )
+
+// Payload of a serial frame, which fits the serial buffers even if escaped
+#define BENCHMARK_PAYLOAD_LENGTH        ( 64 )
+#define BENCHMARK_FRAME_LENGTH          ( 2 * BENCHMARK_PAYLOAD_LENGTH + 8 )
+
+// Occupancy of the task buffer, the packet buffer and the timers
+#define BENCHMARK_SLOTS                 ( 16 )
+#define BENCHMARK_TYPICAL_TIMERS        ( 2 )
+#define BENCHMARK_MANY_TIMERS           ( VIRTUAL_TIMER_MAX_TIMERS )
+
+#define BENCHMARK_TIMER_TICKS           ( 1000 )
+
+// Timeouts of the nodes that the gateway tracks in the timer wheel
+#define BENCHMARK_WHEEL_TIMERS          ( 1000 )
+
+// Nodes whose queues are updated with the feedback of every frame
+#define BENCHMARK_DQ_NODES              ( 1000 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    const char* name;
+    void (* setup)(void);
+    void (* run)(void);
+    uint32_t ops;
+} benchmark_t;
+
+typedef struct {
+    double ns;
+    double instructions;
+} benchmark_result_t;
+
+typedef struct {
+    int      counter;
+    uint32_t samples;
+    uint64_t* ns;
+    uint64_t* instructions;
+
+    // Buffers shared by the benchmarks
+    uint8_t  payload[BENCHMARK_PAYLOAD_LENGTH];
+    uint8_t  frame[BENCHMARK_FRAME_LENGTH];
+    uint8_t  frame_length;
+    uint8_t  buffer[BENCHMARK_FRAME_LENGTH];
+    uint8_t  length;
+    uint16_t tx_length;
+    packet_buffer_t* packet;
+
+    // Queues of the nodes and feedback of the frame
+    dq_queue_t queues[BENCHMARK_DQ_NODES];
+    dq_action_t actions[BENCHMARK_DQ_NODES];
+    dq_feedback_t feedback;
+
+    // Timers of the wheel and the task they push
+    timer_wheel_timer_t wheel_timers[BENCHMARK_WHEEL_TIMERS + 1];
+    task_t wheel_task;
+} benchmark_vars_t;
+
+/*=============================== variables =================================*/
+
+static benchmark_vars_t benchmark_vars;
+
+/*=============================== prototypes ================================*/
+
+// Sleep timer interrupt handler of the platform
+void bsp_timer_interrupt(void);
+
+static void benchmark_usage(const char* name);
+static void benchmark_measure(const benchmark_t* benchmark, benchmark_result_t* result);
+static void benchmark_counter_open(void);
+static uint64_t benchmark_counter_read(void);
+static uint64_t benchmark_time_get(void);
+static uint64_t benchmark_median(uint64_t* values, uint32_t count);
+static int benchmark_compare(const void* a, const void* b);
+
+static void benchmark_none(void);
+static void benchmark_task(void);
+
+static void benchmark_payload_typical(void);
+static void benchmark_payload_escaped(void);
+static void benchmark_crc16_setup(void);
+static void benchmark_crc16_run(void);
+static void benchmark_hdlc_tx_run(void);
+static void benchmark_hdlc_rx_typical(void);
+static void benchmark_hdlc_rx_escaped(void);
+static void benchmark_hdlc_rx_run(void);
+
+static void benchmark_packet_empty(void);
+static void benchmark_packet_full(void);
+static void benchmark_packet_taken(void);
+static void benchmark_packet_get(void);
+static void benchmark_packet_release(void);
+
+static void benchmark_scheduler_empty(void);
+static void benchmark_scheduler_full(void);
+static void benchmark_scheduler_push(void);
+
+static void benchmark_timer_setup(uint8_t running, uint8_t expiring);
+static void benchmark_timer_typical(void);
+static void benchmark_timer_full(void);
+static void benchmark_timer_many(void);
+static void benchmark_timer_expire_typical(void);
+static void benchmark_timer_expire_full(void);
+static void benchmark_timer_expire_many(void);
+static void benchmark_timer_start(void);
+
+static void benchmark_wheel_setup(void);
+static void benchmark_wheel_start(void);
+static void benchmark_wheel_stop(void);
+static void benchmark_wheel_task(void* context);
+
+static void benchmark_dq_setup(void);
+static void benchmark_dq_step(void);
+static void benchmark_dq_step_batch(void);
+
+// Benchmarks, in the order they are run
+static const benchmark_t benchmarks[] = {
+    {"crc16_push",                            benchmark_crc16_setup,          benchmark_crc16_run,      BENCHMARK_PAYLOAD_LENGTH},
+    {"hdlc_put_tx (typical payload)",         benchmark_payload_typical,      benchmark_hdlc_tx_run,    BENCHMARK_PAYLOAD_LENGTH},
+    {"hdlc_put_tx (all bytes escaped)",       benchmark_payload_escaped,      benchmark_hdlc_tx_run,    BENCHMARK_PAYLOAD_LENGTH},
+    {"hdlc_put_rx (typical frame)",           benchmark_hdlc_rx_typical,      benchmark_hdlc_rx_run,    0},
+    {"hdlc_put_rx (all bytes escaped)",       benchmark_hdlc_rx_escaped,      benchmark_hdlc_rx_run,    0},
+    {"packet_buffer_get (empty pool)",        benchmark_packet_empty,         benchmark_packet_get,     1},
+    {"packet_buffer_get (15 of 16 taken)",    benchmark_packet_full,          benchmark_packet_get,     1},
+    {"packet_buffer_release",                 benchmark_packet_taken,         benchmark_packet_release, 1},
+    {"scheduler_push (empty queue)",          benchmark_scheduler_empty,      benchmark_scheduler_push, 1},
+    {"scheduler_push (15 of 16 queued)",      benchmark_scheduler_full,       benchmark_scheduler_push, 1},
+    {"virtual_timer_start (2 running)",       benchmark_timer_typical,        benchmark_timer_start,    1},
+    {"virtual_timer_start (15 running)",      benchmark_timer_full,           benchmark_timer_start,    1},
+    {"virtual_timer_start (63 running)",      benchmark_timer_many,           benchmark_timer_start,    1},
+    {"virtual_timer_interrupt (2 running)",   benchmark_timer_expire_typical, bsp_timer_interrupt,      1},
+    {"virtual_timer_interrupt (16 expiring)", benchmark_timer_expire_full,    bsp_timer_interrupt,      1},
+    {"virtual_timer_interrupt (64 running)",  benchmark_timer_expire_many,    bsp_timer_interrupt,      1},
+    {"timer_wheel_start (1000 running)",      benchmark_wheel_setup,          benchmark_wheel_start,    1},
+    {"timer_wheel_stop (1000 running)",       benchmark_wheel_setup,          benchmark_wheel_stop,     1},
+    {"dq_core_step (1000 nodes)",             benchmark_dq_setup,             benchmark_dq_step,        BENCHMARK_DQ_NODES},
+    {"dq_core_step_batch (1000 nodes)",       benchmark_dq_setup,             benchmark_dq_step_batch,  BENCHMARK_DQ_NODES},
+};
+
+/*================================= public ==================================*/
+
+int main(int argc, char** argv) {
+    static const benchmark_t overhead = {"overhead", benchmark_none, benchmark_none, 1};
+    benchmark_result_t base, result;
+    const char* history = NULL;
+    const char* label = "unknown";
+    FILE* file = NULL;
+    time_t now;
+    int option;
+
+    // Initialize the memory of the benchmark variables
+    memset(&benchmark_vars, 0, sizeof(benchmark_vars_t));
+    benchmark_vars.samples = BENCHMARK_SAMPLES;
+
+    // Parse the command line
+    while ((option = getopt(argc, argv, "n:o:l:h")) != -1) {
+        switch (option) {
+            case 'n':
+                benchmark_vars.samples = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                history = optarg;
+                break;
+            case 'l':
+                label = optarg;
+                break;
+            default:
+                benchmark_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (benchmark_vars.samples == 0) {
+        benchmark_usage(argv[0]);
+    }
+
+    // Initialize the parts of the board the primitives rely on
+    cpu_init();
+    bsp_timer_init();
+
+    benchmark_vars.ns = malloc(benchmark_vars.samples * sizeof(uint64_t));
+    benchmark_vars.instructions = malloc(benchmark_vars.samples * sizeof(uint64_t));
+    if (benchmark_vars.ns == NULL || benchmark_vars.instructions == NULL) {
+        fprintf(stderr, "benchmark: unable to allocate %u samples\n", benchmark_vars.samples);
+        return EXIT_FAILURE;
+    }
+
+    benchmark_counter_open();
+
+    // Open the history file and write the header if it is new
+    if (history != NULL) {
+        file = fopen(history, "a");
+        if (file == NULL) {
+            fprintf(stderr, "benchmark: unable to open %s\n", history);
+            return EXIT_FAILURE;
+        }
+        if (ftell(file) == 0) {
+            fprintf(file, "date,label,benchmark,ns_per_op,instructions_per_op\n");
+        }
+    }
+
+    // Measure the cost of measuring, which is removed from every benchmark
+    benchmark_measure(&overhead, &base);
+
+    now = time(NULL);
+
+    printf("%-40s %10s %10s\n", "benchmark", "ns/op", "instr/op");
+    for (uint32_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        const benchmark_t* benchmark = &benchmarks[i];
+        uint32_t ops;
+
+        benchmark_measure(benchmark, &result);
+
+        // The HDLC frames are as long as the setup made them
+        ops = (benchmark->ops != 0 ? benchmark->ops : benchmark_vars.frame_length);
+
+        result.ns = (result.ns > base.ns ? result.ns - base.ns : 0.0) / ops;
+        result.instructions = (result.instructions > base.instructions ?
+                               result.instructions - base.instructions : 0.0) / ops;
+
+        if (benchmark_vars.counter >= 0) {
+            printf("%-40s %10.2f %10.2f\n", benchmark->name, result.ns, result.instructions);
+        } else {
+            printf("%-40s %10.2f %10s\n", benchmark->name, result.ns, "-");
+        }
+
+        if (file != NULL) {
+            fprintf(file, "%ld,%s,%s,%.2f,", (long) now, label, benchmark->name, result.ns);
+            if (benchmark_vars.counter >= 0) {
+                fprintf(file, "%.2f", result.instructions);
+            }
+            fprintf(file, "\n");
+        }
+    }
+
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*================================ private ==================================*/
+
+static void benchmark_usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n samples  Runs of each benchmark (default %u)\n"
+            "  -o file     Append the results to this history file\n"
+            "  -l label    Label of the results in the history file\n",
+            name, BENCHMARK_SAMPLES);
+    exit(EXIT_FAILURE);
+}
+
+static void benchmark_measure(const benchmark_t* benchmark, benchmark_result_t* result) {
+    uint64_t time_start, time_end;
+    uint64_t counter_start, counter_end;
+
+    for (uint32_t i = 0; i < benchmark_vars.samples; i++) {
+        // Prepare the state, which is not measured
+        benchmark->setup();
+
+        time_start = benchmark_time_get();
+        counter_start = benchmark_counter_read();
+        benchmark->run();
+        counter_end = benchmark_counter_read();
+        time_end = benchmark_time_get();
+
+        benchmark_vars.ns[i] = time_end - time_start;
+        benchmark_vars.instructions[i] = counter_end - counter_start;
+    }
+
+    result->ns = (double) benchmark_median(benchmark_vars.ns, benchmark_vars.samples);
+    result->instructions = (double) benchmark_median(benchmark_vars.instructions, benchmark_vars.samples);
+}
+
+static void benchmark_counter_open(void) {
+    struct perf_event_attr attr;
+
+    // Count the instructions retired in user space by this process
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    benchmark_vars.counter = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (benchmark_vars.counter < 0) {
+        fprintf(stderr, "benchmark: instruction counter not available\n");
+        return;
+    }
+
+    ioctl(benchmark_vars.counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(benchmark_vars.counter, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static uint64_t benchmark_counter_read(void) {
+    uint64_t value = 0;
+
+    if (benchmark_vars.counter >= 0 &&
+        read(benchmark_vars.counter, &value, sizeof(value)) != sizeof(value)) {
+        value = 0;
+    }
+
+    return value;
+}
+
+static uint64_t benchmark_time_get(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t benchmark_median(uint64_t* values, uint32_t count) {
+    qsort(values, count, sizeof(uint64_t), benchmark_compare);
+
+    return values[count / 2];
+}
+
+static int benchmark_compare(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+
+    return (x > y) - (x < y);
+}
+
+static void benchmark_none(void) {
+}
+
+static void benchmark_task(void) {
+}
+
+static void benchmark_payload_typical(void) {
+    // An incrementing payload, with one flag and one escape character
+    for (uint32_t i = 0; i < BENCHMARK_PAYLOAD_LENGTH; i++) {
+        benchmark_vars.payload[i] = (uint8_t) i;
+    }
+
+    benchmark_vars.tx_length = 0;
+    hdlc_open_tx(benchmark_vars.buffer, &benchmark_vars.tx_length);
+}
+
+static void benchmark_payload_escaped(void) {
+    // A payload made only of flags
+    memset(benchmark_vars.payload, HDLC_FLAG, BENCHMARK_PAYLOAD_LENGTH);
+
+    benchmark_vars.tx_length = 0;
+    hdlc_open_tx(benchmark_vars.buffer, &benchmark_vars.tx_length);
+}
+
+static void benchmark_crc16_setup(void) {
+    benchmark_payload_typical();
+    crc16_init();
+}
+
+static void benchmark_crc16_run(void) {
+    for (uint32_t i = 0; i < BENCHMARK_PAYLOAD_LENGTH; i++) {
+        crc16_push(benchmark_vars.payload[i]);
+    }
+}
+
+static void benchmark_hdlc_tx_run(void) {
+    for (uint32_t i = 0; i < BENCHMARK_PAYLOAD_LENGTH; i++) {
+        hdlc_put_tx(benchmark_vars.payload[i]);
+    }
+}
+
+static void benchmark_hdlc_rx_typical(void) {
+    // Encode a typical frame, then open the receiver
+    benchmark_payload_typical();
+    benchmark_hdlc_tx_run();
+    hdlc_close_tx();
+    memcpy(benchmark_vars.frame, benchmark_vars.buffer, benchmark_vars.tx_length);
+    benchmark_vars.frame_length = benchmark_vars.tx_length;
+
+    benchmark_vars.length = 0;
+    hdlc_open_rx(benchmark_vars.buffer, &benchmark_vars.length);
+}
+
+static void benchmark_hdlc_rx_escaped(void) {
+    // Encode a frame where every byte is escaped, then open the receiver
+    benchmark_payload_escaped();
+    benchmark_hdlc_tx_run();
+    hdlc_close_tx();
+    memcpy(benchmark_vars.frame, benchmark_vars.buffer, benchmark_vars.tx_length);
+    benchmark_vars.frame_length = benchmark_vars.tx_length;
+
+    benchmark_vars.length = 0;
+    hdlc_open_rx(benchmark_vars.buffer, &benchmark_vars.length);
+}
+
+static void benchmark_hdlc_rx_run(void) {
+    // The receiver needs to see the opening flag first
+    hdlc_put_rx(HDLC_FLAG);
+    for (uint32_t i = 0; i < benchmark_vars.frame_length; i++) {
+        hdlc_put_rx(benchmark_vars.frame[i]);
+    }
+}
+
+static void benchmark_packet_empty(void) {
+    packet_buffer_init();
+}
+
+static void benchmark_packet_full(void) {
+    packet_buffer_init();
+    for (uint32_t i = 0; i < BENCHMARK_SLOTS - 1; i++) {
+        packet_buffer_get(PACKET_BUFFER_FULL_SIZE);
+    }
+}
+
+static void benchmark_packet_taken(void) {
+    packet_buffer_init();
+    benchmark_vars.packet = packet_buffer_get(PACKET_BUFFER_FULL_SIZE);
+}
+
+static void benchmark_packet_get(void) {
+    benchmark_vars.packet = packet_buffer_get(PACKET_BUFFER_FULL_SIZE);
+}
+
+static void benchmark_packet_release(void) {
+    packet_buffer_release(benchmark_vars.packet);
+}
+
+static void benchmark_scheduler_empty(void) {
+    scheduler_init();
+}
+
+static void benchmark_scheduler_full(void) {
+    // Queue tasks of higher priority, so that the new one goes last
+    scheduler_init();
+    for (uint32_t i = 0; i < BENCHMARK_SLOTS - 1; i++) {
+        scheduler_push(benchmark_task, TASK_PRIO_MAX);
+    }
+}
+
+static void benchmark_scheduler_push(void) {
+    scheduler_push(benchmark_task, TASK_PRIO_MIN);
+}
+
+static void benchmark_timer_setup(uint8_t running, uint8_t expiring) {
+    virtual_timer_width_t ticks;
+
+    // The expired timers are pushed to an empty scheduler
+    scheduler_init();
+    virtual_timer_init();
+
+    for (uint8_t i = 0; i < running; i++) {
+        ticks = (i < expiring ? BENCHMARK_TIMER_TICKS : BENCHMARK_TIMER_TICKS * (i + 2));
+        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, benchmark_task, TASK_PRIO_MED);
+    }
+
+    // Let the expiring ones fall due without the sleep timer firing, the
+    // benchmark calls its interrupt handler
+    if (expiring > 0) {
+        posix_event_cancel(POSIX_EVENT_SMTIM);
+        posix_spin(posix_ticks_to_time(BENCHMARK_TIMER_TICKS));
+    }
+}
+
+static void benchmark_timer_typical(void) {
+    benchmark_timer_setup(BENCHMARK_TYPICAL_TIMERS, 0);
+}
+
+static void benchmark_timer_full(void) {
+    benchmark_timer_setup(BENCHMARK_SLOTS - 1, 0);
+}
+
+static void benchmark_timer_many(void) {
+    benchmark_timer_setup(BENCHMARK_MANY_TIMERS - 1, 0);
+}
+
+static void benchmark_timer_expire_typical(void) {
+    benchmark_timer_setup(BENCHMARK_TYPICAL_TIMERS, 1);
+}
+
+static void benchmark_timer_expire_full(void) {
+    benchmark_timer_setup(BENCHMARK_SLOTS, BENCHMARK_SLOTS);
+}
+
+static void benchmark_timer_expire_many(void) {
+    benchmark_timer_setup(BENCHMARK_MANY_TIMERS, 1);
+}
+
+static void benchmark_timer_start(void) {
+    // Shorter than the running ones, so the bsp_timer is reprogrammed
+    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, BENCHMARK_TIMER_TICKS / 2, benchmark_task, TASK_PRIO_MED);
+}
+
+static void benchmark_wheel_setup(void) {
+    timer_wheel_timer_t* timers = benchmark_vars.wheel_timers;
+
+    // The wheel wakes up through a virtual timer
+    scheduler_init();
+    virtual_timer_init();
+    timer_wheel_init();
+
+    // Spread over the levels of the wheel, the last one stays stopped
+    scheduler_task_init(&benchmark_vars.wheel_task, benchmark_wheel_task, NULL, TASK_PRIO_MED);
+    for (uint32_t i = 0; i <= BENCHMARK_WHEEL_TIMERS; i++) {
+        timer_wheel_timer_init(&timers[i], &benchmark_vars.wheel_task);
+        if (i < BENCHMARK_WHEEL_TIMERS) {
+            timer_wheel_start(&timers[i], BENCHMARK_TIMER_TICKS * (i + 2));
+        }
+    }
+}
+
+static void benchmark_wheel_start(void) {
+    // Sooner than the running ones, so the wheel wakes up earlier
+    timer_wheel_start(&benchmark_vars.wheel_timers[BENCHMARK_WHEEL_TIMERS], BENCHMARK_TIMER_TICKS / 2);
+}
+
+static void benchmark_wheel_stop(void) {
+    timer_wheel_stop(&benchmark_vars.wheel_timers[BENCHMARK_WHEEL_TIMERS / 2]);
+}
+
+static void benchmark_wheel_task(void* context) {
+}
+
+static void benchmark_dq_setup(void) {
+    dq_queue_t* queue;
+
+    // One collided and one successful ARP and a successful DATA, so the CRQ and DTQ keep their length
+    benchmark_vars.feedback.arp_state[0]  = DQ_ARP_SUCCESS;
+    benchmark_vars.feedback.arp_random[0] = 1;
+    benchmark_vars.feedback.arp_state[1]  = DQ_ARP_COLLISION;
+    benchmark_vars.feedback.arp_random[1] = 0;
+    benchmark_vars.feedback.arp_state[2]  = DQ_ARP_EMPTY;
+    benchmark_vars.feedback.arp_random[2] = 0;
+    benchmark_vars.feedback.data_state    = DQ_DATA_SUCCESS;
+    benchmark_vars.feedback.crq_global    = 2;
+    benchmark_vars.feedback.dtq_global    = 3;
+
+    // Spread the nodes over the CRQ, the DTQ and the ARPs
+    for (uint32_t i = 0; i < BENCHMARK_DQ_NODES; i++) {
+        queue = &benchmark_vars.queues[i];
+        queue->crq_local  = 2;
+        queue->dtq_local  = 3;
+        queue->pcrq_local = i % 3;
+        queue->pdtq_local = (i / 3) % 4;
+        if (queue->pcrq_local == 0 && queue->pdtq_local == 0) {
+            dq_core_arp_set(queue, i % DQ_ARP_COUNT, i);
+        } else {
+            dq_core_arp_reset(queue);
+        }
+    }
+}
+
+static void benchmark_dq_step(void) {
+    for (uint32_t i = 0; i < BENCHMARK_DQ_NODES; i++) {
+        benchmark_vars.actions[i] = dq_core_step(&benchmark_vars.queues[i], &benchmark_vars.feedback);
+    }
+}
+
+static void benchmark_dq_step_batch(void) {
+    dq_core_step_batch(benchmark_vars.queues, benchmark_vars.actions, BENCHMARK_DQ_NODES, &benchmark_vars.feedback);
+}
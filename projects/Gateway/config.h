@@ -16,6 +16,48 @@
 
 /*================================ define ===================================*/
 
+// Time the tasks of the scheduler, see profiler.h
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED                ( 0 )
+#endif
+
+// Events kept in the trace buffer, see trace.h
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL                     ( 0 )
+#endif
+
+// Measure the delay of the timers and radio interrupts, see latency.h
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED                 ( 0 )
+#endif
+
+// Deepest power mode while idle, see power.h, the UART of the computer
+// cannot wake it up from the other ones
+#ifndef POWER_MODE_MAX
+#define POWER_MODE_MAX                  ( 0 )
+#endif
+
+// Virtual timers running at once, see virtual_timer.h, the gateway keeps
+// timers for the nodes it tracks
+#ifndef VIRTUAL_TIMER_MAX_TIMERS
+#define VIRTUAL_TIMER_MAX_TIMERS        ( 64 )
+#endif
+
+// Packet buffers of each size, see packet_buffer.h, the gateway holds the
+// frames of the nodes it serves
+#ifndef PACKET_BUFFER_SHORT_COUNT
+#define PACKET_BUFFER_SHORT_COUNT       ( 32 )
+#endif
+
+#ifndef PACKET_BUFFER_FULL_COUNT
+#define PACKET_BUFFER_FULL_COUNT        ( 16 )
+#endif
+
+// Forward the DATA frames received to the computer, see dq.c
+#ifndef DQ_FORWARD_ENABLED
+#define DQ_FORWARD_ENABLED              ( 0 )
+#endif
+
 #define MAC_DEVICE                      ( MAC_GATEWAY )
 
 /*================================ typedef ==================================*/
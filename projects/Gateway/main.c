@@ -59,6 +59,9 @@ void reset_cmd(void) {
 }
 
 void reset_cb(void) {
+    // Send the records that are left
+    recorder_stop();
+
     // Wait until UART finishes
     while(serial_is_busy())
         ;
@@ -95,6 +98,11 @@ void start_cb(void) {
     experiment_duration |= (*data++);
     experiment_duration *= 33;
 
+    // Record the radio events if the computer asks for it
+    if (serial_packet.length > 4 && *data++ != 0) {
+        recorder_start(mac_vars.mac_type, mac_vars.mac_slots);
+    }
+
     // Push the task to start
     scheduler_push(start_cmd, TASK_PRIO_MAX);
 
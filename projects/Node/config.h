@@ -18,6 +18,37 @@
 
 /*================================ define ===================================*/
 
+// Time the tasks of the scheduler, see profiler.h
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED                ( 0 )
+#endif
+
+// Events kept in the trace buffer, see trace.h
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL                     ( 0 )
+#endif
+
+// Measure the delay of the timers and radio interrupts, see latency.h
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED                 ( 0 )
+#endif
+
+// Deepest power mode while idle, see power.h
+#ifndef POWER_MODE_MAX
+#define POWER_MODE_MAX                  ( 2 )
+#endif
+
+// Ticks between the payloads that the node generates, 0 to keep its queue
+// full so that it always has one to send, see main.c and app_queue.h
+#ifndef APP_TRAFFIC_PERIOD
+#define APP_TRAFFIC_PERIOD              ( 0 )
+#endif
+
+// Bytes of each payload, the DQ and FSA DATA frames carry up to 116 and 118
+#ifndef APP_TRAFFIC_LENGTH
+#define APP_TRAFFIC_LENGTH              ( 116 )
+#endif
+
 #define MAC_DEVICE                      ( MAC_NODE )
 
 /*================================ typedef ==================================*/
@@ -11,6 +11,7 @@
 
 /*================================ include ==================================*/
 
+#include "config.h"
 #include "types.h"
 
 #include "board.h"
@@ -27,8 +28,14 @@
 
 /*=============================== variables =================================*/
 
+static uint16_t app_sequence;
+
 /*=============================== prototypes ================================*/
 
+static bool app_generate(void);
+static void app_generate_task(void);
+static void app_saturate(void);
+
 /*================================= public ==================================*/
 int main(void) {
     // Initialize the basic components
@@ -37,6 +44,14 @@ int main(void) {
     mac_init();
     scheduler_init();
 
+    // Generate the payloads of the application, see config.h
+    if (APP_TRAFFIC_PERIOD > 0) {
+        virtual_timer_start(VIRTUAL_TIMER_TYPE_PERIODIC, APP_TRAFFIC_PERIOD, app_generate_task, TASK_PRIO_MIN);
+    } else {
+        app_queue_set_cb(app_saturate);
+        app_saturate();
+    }
+
     // Push the WOR task to the scheduler
     wor_set_cb(mac_start);
     scheduler_push(wor_config, TASK_PRIO_MAX);
@@ -44,3 +59,28 @@ int main(void) {
     // Start the scheduler
     scheduler_start();
 }
+
+/*================================ private ==================================*/
+
+static bool app_generate(void) {
+    uint8_t payload[APP_TRAFFIC_LENGTH];
+
+    // The sequence number first, so that the computer can tell the payloads
+    // that were lost, then filler
+    payload[0] = (app_sequence >> 0) & 0xFF;
+    payload[1] = (app_sequence >> 8) & 0xFF;
+    memset(&payload[2], app_sequence & 0xFF, sizeof(payload) - 2);
+    app_sequence++;
+
+    return app_queue_enqueue(payload, sizeof(payload));
+}
+
+static void app_generate_task(void) {
+    app_generate();
+}
+
+static void app_saturate(void) {
+    // Keep the queue full, so that the node always has a payload to send
+    while (!app_queue_is_full() && app_generate())
+        ;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file       main.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Replays a log of gateway radio events against the Gateway.
+ *
+ *             Runs the Gateway image, built with TARGET=sim, alone on a
+ *             radio that plays back a log recorded by a gateway (on the
+ *             field or in the Simulator with -R), and reports the decisions
+ *             of the gateway and whether its timers still match the log.
+ *             The exit status is zero only if they do, so that the tool can
+ *             drive a bisection of the firmware.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "sim_kernel.h"
+#include "sim_host.h"
+#include "sim_replay.h"
+
+#include "recorder.h"
+
+/*================================ define ===================================*/
+
+#define REPLAY_MAC_FSA                  ( 0x01 )
+#define REPLAY_MAC_DQ                   ( 0x02 )
+
+#define REPLAY_CMD_DATA                 ( 'D' )
+#define REPLAY_CMD_RECORD               ( 'E' )
+
+#define REPLAY_DEFAULT_EXPERIMENT       ( 1 )
+#define REPLAY_DEFAULT_SEED             ( 1 )
+#define REPLAY_DEFAULT_LATENCY          ( 75 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+extern const sim_image_t sim_image_Gateway;
+
+static FILE* replay_decisions;
+static uint64_t replay_messages;
+
+static const char* replay_types[] = {
+    "begin", "time", "sfd", "rx_done", "packet", "rssi", "timer", "lost"
+};
+
+/*=============================== prototypes ================================*/
+
+static void replay_usage(const char* name);
+static uint8_t* replay_load(const char* path, size_t* length);
+static void replay_print(const uint8_t* data, size_t length);
+static void replay_message(uint8_t command, const uint8_t* data, uint16_t length);
+static double replay_ratio(uint64_t value, uint64_t total);
+static double replay_wall_time(void);
+static void replay_report(const char* path, uint32_t experiment, double wall_time);
+
+/*================================= public ==================================*/
+
+int main(int argc, char** argv) {
+    sim_host_config_t host_config;
+    const sim_replay_log_t* log;
+    uint32_t experiment = REPLAY_DEFAULT_EXPERIMENT;
+    uint64_t latency = REPLAY_DEFAULT_LATENCY;
+    bool print = false;
+    uint8_t* data;
+    size_t length;
+    double wall_time;
+    int option;
+
+    // Parse the command line
+    while ((option = getopt(argc, argv, "e:d:w:ph")) != -1) {
+        switch (option) {
+            case 'e':
+                experiment = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                replay_decisions = fopen(optarg, "w");
+                if (replay_decisions == NULL) {
+                    fprintf(stderr, "replay: unable to open %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'w':
+                latency = strtoull(optarg, NULL, 0);
+                break;
+            case 'p':
+                print = true;
+                break;
+            default:
+                replay_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (optind != argc - 1 || experiment == 0) {
+        replay_usage(argv[0]);
+    }
+
+    data = replay_load(argv[optind], &length);
+
+    // Only print the records of the log
+    if (print) {
+        replay_print(data, length);
+        return EXIT_SUCCESS;
+    }
+
+    // The gateway runs alone, both images are the gateway
+    sim_kernel_init(&sim_image_Gateway, &sim_image_Gateway, 0, REPLAY_DEFAULT_SEED);
+    sim.latency = latency * SIM_NS_PER_US;
+
+    if (!sim_replay_init(data, length, experiment)) {
+        fprintf(stderr, "replay: %s has %u experiments\n", argv[optind], sim_replay_log()->experiments);
+        exit(EXIT_FAILURE);
+    }
+    log = sim_replay_log();
+
+    // Start the recorded experiment and ask the gateway to record as well
+    host_config.mac_type = log->mac_type;
+    host_config.mac_slots = log->mac_slots;
+    host_config.frames = UINT64_MAX;
+    host_config.record = true;
+    host_config.callback = replay_message;
+    sim_host_init(&host_config);
+
+    // Run it until the log is over
+    wall_time = replay_wall_time();
+    sim_kernel_run(0);
+    wall_time = replay_wall_time() - wall_time;
+
+    if (replay_decisions != NULL) {
+        fclose(replay_decisions);
+    }
+
+    replay_report(argv[optind], experiment, wall_time);
+
+    return (sim_replay_stats()->diverged ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/*================================ private ==================================*/
+
+static void replay_usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options] log\n"
+            "  -e number   Experiment of the log to replay (default %u)\n"
+            "  -d file     Write the decisions of the gateway, one frame per line\n"
+            "  -w us       Time for the gateway to wake up and enter an interrupt (default %u)\n"
+            "  -p          Print the records of the log and exit\n",
+            name, REPLAY_DEFAULT_EXPERIMENT, REPLAY_DEFAULT_LATENCY);
+    exit(EXIT_FAILURE);
+}
+
+static uint8_t* replay_load(const char* path, size_t* length) {
+    uint8_t* data;
+    FILE* file;
+    long size;
+
+    file = fopen(path, "rb");
+    if (file == NULL || fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0) {
+        fprintf(stderr, "replay: unable to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    rewind(file);
+
+    data = malloc(size > 0 ? (size_t) size : 1);
+    if (data == NULL || fread(data, 1, (size_t) size, file) != (size_t) size) {
+        fprintf(stderr, "replay: unable to read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+
+    *length = (size_t) size;
+
+    return data;
+}
+
+static void replay_print(const uint8_t* data, size_t length) {
+    sim_replay_parser_t parser;
+    sim_replay_record_t record;
+
+    memset(&parser, 0, sizeof(sim_replay_parser_t));
+    parser.data = data;
+    parser.length = length;
+
+    // One record per line: ticks, type and body
+    while (sim_replay_parse(&parser, &record)) {
+        printf("%10" PRIu32 " %-8s", record.ticks, replay_types[record.type]);
+        switch (record.type) {
+            case RECORDER_BEGIN:
+                printf(" mac %u slots %u", record.body[4], record.body[5]);
+                break;
+            case RECORDER_PACKET:
+                printf(" length %u rssi %d crc %u lqi %u", record.body[0], (int8_t) record.body[1],
+                       record.body[2] >> 7, record.body[2] & 0x7F);
+                for (uint8_t i = 3; i < record.length; i++) {
+                    printf(" %02x", record.body[i]);
+                }
+                break;
+            case RECORDER_RSSI:
+                printf(" %d", (int8_t) record.body[0]);
+                break;
+            case RECORDER_TIMER:
+                printf(" %u", record.body[0]);
+                break;
+            case RECORDER_LOST:
+                printf(" %u", record.body[0] | (record.body[1] << 8));
+                break;
+            default:
+                break;
+        }
+        printf("\n");
+    }
+
+    if (parser.offset != parser.length) {
+        fprintf(stderr, "replay: %zu bytes left at the end of the log\n", parser.length - parser.offset);
+    }
+}
+
+static void replay_message(uint8_t command, const uint8_t* data, uint16_t length) {
+    switch (command) {
+        case REPLAY_CMD_RECORD:
+            sim_replay_record(data, length);
+            break;
+        case REPLAY_CMD_DATA:
+            // One line per message, the same firmware gives the same lines
+            if (replay_decisions != NULL) {
+                fprintf(replay_decisions, "%" PRIu64, replay_messages);
+                for (uint16_t i = 0; i < length; i++) {
+                    fprintf(replay_decisions, " %02x", data[i]);
+                }
+                fprintf(replay_decisions, "\n");
+            }
+            replay_messages++;
+            break;
+        default:
+            break;
+    }
+}
+
+static double replay_ratio(uint64_t value, uint64_t total) {
+    return (total == 0 ? 0.0 : (double) value / (double) total);
+}
+
+static double replay_wall_time(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static void replay_report(const char* path, uint32_t experiment, double wall_time) {
+    const sim_replay_log_t* log = sim_replay_log();
+    const sim_replay_stats_t* stats = sim_replay_stats();
+    const sim_host_stats_t* host = sim_host_stats();
+    uint64_t arp_total, data_total;
+    double duration;
+
+    arp_total = host->arp[SIM_HOST_EMPTY] + host->arp[SIM_HOST_COLLISION] + host->arp[SIM_HOST_SUCCESS];
+    data_total = host->data[SIM_HOST_EMPTY] + host->data[SIM_HOST_COLLISION] + host->data[SIM_HOST_SUCCESS];
+    duration = (double) log->duration / SIM_TICKS_PER_SECOND;
+
+    printf("log:          %s, experiment %u of %u, %s with %u slots, %.3f s\n",
+           path, experiment, log->experiments, (log->mac_type == REPLAY_MAC_DQ ? "dq" : "fsa"),
+           log->mac_slots, duration);
+    printf("records:      %u sfd, %u rx done, %u packets, %u rssi, %u timers, %u lost\n",
+           log->count[RECORDER_SFD], log->count[RECORDER_RX_DONE], log->count[RECORDER_PACKET],
+           log->count[RECORDER_RSSI], log->count[RECORDER_TIMER], log->lost);
+    printf("wall time:    %.3f s, %.0f times faster than real time\n",
+           wall_time, (wall_time > 0.0 ? duration / wall_time : 0.0));
+    printf("frames:       %" PRIu64 "\n", host->frames);
+
+    if (arp_total > 0) {
+        printf("arp:          success %" PRIu64 " (%.3f), empty %" PRIu64 " (%.3f), collision %" PRIu64 " (%.3f)\n",
+               host->arp[SIM_HOST_SUCCESS], replay_ratio(host->arp[SIM_HOST_SUCCESS], arp_total),
+               host->arp[SIM_HOST_EMPTY], replay_ratio(host->arp[SIM_HOST_EMPTY], arp_total),
+               host->arp[SIM_HOST_COLLISION], replay_ratio(host->arp[SIM_HOST_COLLISION], arp_total));
+    }
+
+    printf("data:         success %" PRIu64 " (%.3f), empty %" PRIu64 " (%.3f), collision %" PRIu64 " (%.3f)\n",
+           host->data[SIM_HOST_SUCCESS], replay_ratio(host->data[SIM_HOST_SUCCESS], data_total),
+           host->data[SIM_HOST_EMPTY], replay_ratio(host->data[SIM_HOST_EMPTY], data_total),
+           host->data[SIM_HOST_COLLISION], replay_ratio(host->data[SIM_HOST_COLLISION], data_total));
+    printf("radio:        %" PRIu64 " events injected, %" PRIu64 " not listened to\n",
+           stats->injected, stats->missed);
+    printf("rssi:         %" PRIu64 " reads from the log, %" PRIu64 " from the air\n",
+           stats->rssi_logged, stats->rssi_guessed);
+
+    if (stats->diverged) {
+        printf("timers:       %" PRIu64 " of %" PRIu64 " match, first divergence at expiration %" PRIu64
+               ": log timer %u at +%u ticks, replay timer %u at +%u ticks\n",
+               stats->timers_matched, stats->timers, stats->diverged_index,
+               stats->diverged_log[1], stats->diverged_log[0],
+               stats->diverged_replay[1], stats->diverged_replay[0]);
+    } else {
+        printf("timers:       %" PRIu64 " of %" PRIu64 " match\n", stats->timers_matched, stats->timers);
+    }
+
+    if (log->lost > 0) {
+        printf("warning:      the log lost records, the replay may diverge where it did\n");
+    }
+}
@@ -0,0 +1,529 @@
+/**
+ * @file       sim_replay.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Radio of the gateway driven by a log of recorded events.
+ *
+ *             It takes the place of the shared channel of the simulator:
+ *             the gateway runs alone and the SFD and RX done interrupts of
+ *             the log are raised at the time they were recorded, relative
+ *             to the BEGIN record, with the packet and RSSI samples of the
+ *             log. The gateway records its own events as well and its timer
+ *             expirations are compared against the ones in the log, the
+ *             first one that differs tells where the firmware diverged.
+ *             Recorded events fall half a tick after the tick in which they
+ *             were recorded, so that the timers of that tick go first. They
+ *             were recorded by the interrupt, so they are raised earlier by
+ *             the time to wake up if the gateway is asleep by then.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_replay.h"
+#include "sim_air.h"
+
+#include "recorder.h"
+
+/*================================ define ===================================*/
+
+// Defines for the timing (250 kbps O-QPSK, 32 us per byte), as sim_air.c
+#define SIM_REPLAY_BYTE_NS              ( 32 * SIM_NS_PER_US )
+#define SIM_REPLAY_SHR_BYTES            ( 5 )
+#define SIM_REPLAY_TURNAROUND_NS        ( 192 * SIM_NS_PER_US )
+
+// Half a tick, the recorded events land in the middle of their tick
+#define SIM_REPLAY_HALF_TICK_NS         ( SIM_NS_PER_SECOND / SIM_TICKS_PER_SECOND / 2 )
+
+// RSSI when nothing is in the log: noise floor, or a frame being received
+#define SIM_REPLAY_RSSI_NOISE           ( -100 )
+#define SIM_REPLAY_RSSI_FRAME           ( -60 )
+
+// RSSI samples up to a tick away from the read are taken as the same
+#define SIM_REPLAY_RSSI_TICKS           ( 1 )
+
+// Time to run after the last record of the log
+#define SIM_REPLAY_TAIL_NS              ( 100 * 1000 * SIM_NS_PER_US )
+
+// Event indexes that do not refer to a record of the log
+#define SIM_REPLAY_OWN                  ( UINT32_MAX )
+#define SIM_REPLAY_STOP                 ( UINT32_MAX - 1 )
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    sim_replay_log_t   log;
+    sim_replay_stats_t stats;
+
+    // Records of the experiment being replayed
+    sim_replay_record_t* records;
+    uint32_t record_count;
+    uint32_t air_next;              ///< Next SFD or RX done to inject
+    uint32_t rssi_next;             ///< Next RSSI sample
+    uint32_t timer_next;            ///< Next timer expiration to compare
+    uint32_t begin;                 ///< Time of the BEGIN record in the log
+
+    // Records that come from the gateway being replayed
+    sim_replay_parser_t parser;
+    bool     aligned;
+    int64_t  offset;                ///< Ticks of the replay minus ticks of the log
+
+    // Radio of the gateway
+    bool     listening;
+    bool     receiving;
+    int8_t   receiving_rssi;
+} sim_replay_vars_t;
+
+/*=============================== variables =================================*/
+
+static sim_replay_vars_t sim_replay_vars;
+
+/*=============================== prototypes ================================*/
+
+static void sim_replay_schedule(void);
+static bool sim_replay_defer(uint32_t index, sim_event_type_t type);
+static void sim_replay_raise(uint8_t irq);
+static const sim_replay_record_t* sim_replay_packet(uint32_t index);
+static void sim_replay_timer(const sim_replay_record_t* record);
+static uint64_t sim_replay_time(uint32_t ticks);
+
+/*================================= public ==================================*/
+
+bool sim_replay_parse(sim_replay_parser_t* parser, sim_replay_record_t* record) {
+    const uint8_t* data = &parser->data[parser->offset];
+    size_t left = parser->length - parser->offset;
+    uint32_t delta;
+    size_t size = 1;
+
+    if (left == 0) {
+        return false;
+    }
+
+    // Type and time since the previous record
+    record->type = data[0] >> RECORDER_TYPE_SHIFT;
+    delta = data[0] & RECORDER_DELTA_MASK;
+    if (delta == RECORDER_DELTA_LONG) {
+        if (left < 3) {
+            return false;
+        }
+        delta = data[1] | (data[2] << 8);
+        size += 2;
+    }
+
+    // Length of the body
+    switch (record->type) {
+        case RECORDER_BEGIN:
+            record->length = 4 + 2;
+            break;
+        case RECORDER_TIME:
+            record->length = 4;
+            break;
+        case RECORDER_PACKET:
+            if (left < size + 1) {
+                return false;
+            }
+            record->length = 3 + (data[size] > RECORDER_PACKET_PREFIX ? RECORDER_PACKET_PREFIX : data[size]);
+            break;
+        case RECORDER_RSSI:
+        case RECORDER_TIMER:
+            record->length = 1;
+            break;
+        case RECORDER_LOST:
+            record->length = 2;
+            break;
+        default:
+            record->length = 0;
+            break;
+    }
+    if (left < size + record->length) {
+        return false;
+    }
+    record->body = &data[size];
+
+    // The BEGIN and TIME records carry the absolute time
+    if (record->type == RECORDER_BEGIN || record->type == RECORDER_TIME) {
+        parser->ticks = record->body[0] | (record->body[1] << 8) |
+                        (record->body[2] << 16) | ((uint32_t) record->body[3] << 24);
+    } else {
+        parser->ticks += delta;
+    }
+    record->ticks = parser->ticks;
+
+    parser->offset += size + record->length;
+
+    return true;
+}
+
+bool sim_replay_init(const uint8_t* data, size_t length, uint32_t experiment) {
+    sim_replay_parser_t parser;
+    sim_replay_record_t record;
+    uint32_t size = 0;
+    bool found = false;
+
+    // Initialize the memory of the replay variables
+    memset(&sim_replay_vars, 0, sizeof(sim_replay_vars_t));
+
+    memset(&parser, 0, sizeof(sim_replay_parser_t));
+    parser.data = data;
+    parser.length = length;
+
+    while (sim_replay_parse(&parser, &record)) {
+        if (record.type == RECORDER_BEGIN) {
+            sim_replay_vars.log.experiments++;
+
+            // The experiment ends where the next one begins
+            if (found) {
+                break;
+            }
+            if (sim_replay_vars.log.experiments == experiment) {
+                found = true;
+                sim_replay_vars.begin = record.ticks;
+                sim_replay_vars.log.mac_type = record.body[4];
+                sim_replay_vars.log.mac_slots = record.body[5];
+            }
+        }
+
+        if (!found) {
+            continue;
+        }
+
+        // Keep the records of the experiment
+        if (sim_replay_vars.record_count == size) {
+            size = (size == 0 ? 1024 : 2 * size);
+            sim_replay_vars.records = realloc(sim_replay_vars.records, size * sizeof(sim_replay_record_t));
+            if (sim_replay_vars.records == NULL) {
+                fprintf(stderr, "replay: unable to allocate the log\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        sim_replay_vars.records[sim_replay_vars.record_count++] = record;
+
+        sim_replay_vars.log.count[record.type]++;
+        sim_replay_vars.log.duration = record.ticks - sim_replay_vars.begin;
+        if (record.type == RECORDER_LOST) {
+            sim_replay_vars.log.lost += record.body[0] | (record.body[1] << 8);
+        }
+    }
+
+    // Count the experiments that are left
+    while (sim_replay_parse(&parser, &record)) {
+        if (record.type == RECORDER_BEGIN) {
+            sim_replay_vars.log.experiments++;
+        }
+    }
+
+    return found;
+}
+
+void sim_replay_record(const uint8_t* data, uint16_t length) {
+    sim_replay_parser_t* parser = &sim_replay_vars.parser;
+    sim_replay_record_t record;
+
+    // Every message of the gateway holds whole records
+    parser->data = data;
+    parser->length = length;
+    parser->offset = 0;
+
+    while (sim_replay_parse(parser, &record)) {
+        switch (record.type) {
+            case RECORDER_BEGIN:
+                // Align the log with the gateway and start injecting it
+                if (!sim_replay_vars.aligned) {
+                    sim_replay_vars.aligned = true;
+                    sim_replay_vars.offset = (int64_t) record.ticks - (int64_t) sim_replay_vars.begin;
+                    sim_replay_schedule();
+                }
+                break;
+            case RECORDER_TIMER:
+                sim_replay_timer(&record);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+const sim_replay_log_t* sim_replay_log(void) {
+    return &sim_replay_vars.log;
+}
+
+const sim_replay_stats_t* sim_replay_stats(void) {
+    return &sim_replay_vars.stats;
+}
+
+/*============================ kernel interface =============================*/
+
+void sim_air_node_off(sim_node_t* node) {
+    sim_replay_vars.listening = false;
+    sim_replay_vars.receiving = false;
+}
+
+void sim_air_start(uint32_t index) {
+    // The log is over
+    if (index == SIM_REPLAY_STOP) {
+        sim_kernel_stop();
+    }
+}
+
+void sim_air_sfd(uint32_t index) {
+    const sim_replay_record_t* packet;
+
+    // The gateway sees its own SFD go out
+    if (index == SIM_REPLAY_OWN) {
+        sim_replay_raise(SIM_RADIO_IRQ_SFD);
+        return;
+    }
+
+    if (sim_replay_defer(index, SIM_EVENT_AIR_SFD)) {
+        return;
+    }
+
+    // A recorded frame starts, if the gateway is listening
+    if (sim_replay_vars.listening && !sim_replay_vars.receiving) {
+        packet = sim_replay_packet(index);
+        sim_replay_vars.receiving = true;
+        sim_replay_vars.receiving_rssi = (packet != NULL ? (int8_t) packet->body[1] : SIM_REPLAY_RSSI_FRAME);
+        sim_replay_raise(SIM_RADIO_IRQ_SFD);
+        sim_replay_vars.stats.injected++;
+    } else {
+        sim_replay_vars.stats.missed++;
+    }
+
+    sim_replay_schedule();
+}
+
+void sim_air_end(uint32_t index) {
+    sim_radio_frame_t* frame = &sim.nodes[SIM_GATEWAY].rx_frame;
+    const sim_replay_record_t* packet;
+    uint8_t length;
+
+    // The gateway sees the end of its transmission
+    if (index == SIM_REPLAY_OWN) {
+        sim_replay_raise(SIM_RADIO_IRQ_TXDONE);
+        return;
+    }
+
+    if (sim_replay_defer(index, SIM_EVENT_AIR_END)) {
+        return;
+    }
+
+    // A recorded frame ends, if the gateway has been receiving it
+    if (sim_replay_vars.listening && sim_replay_vars.receiving) {
+        // Rebuild the frame from the packet that the gateway read, the
+        // payload past the recorded prefix is zero
+        memset(frame, 0, sizeof(sim_radio_frame_t));
+        packet = sim_replay_packet(index);
+        if (packet != NULL) {
+            length = packet->length - 3;
+            frame->length = packet->body[0] + 2;
+            frame->rssi   = (int8_t) packet->body[1];
+            frame->crc    = (packet->body[2] & 0x80) != 0;
+            frame->lqi    = packet->body[2] & 0x7F;
+            memcpy(frame->buffer, &packet->body[3], length);
+        }
+
+        sim_replay_vars.receiving = false;
+        sim_replay_raise(SIM_RADIO_IRQ_RXPKTDONE);
+        sim_replay_vars.stats.injected++;
+    } else {
+        sim_replay_vars.stats.missed++;
+    }
+
+    sim_replay_schedule();
+}
+
+/*=========================== firmware interface ============================*/
+
+void sim_radio_on(uint8_t channel) {
+    sim_replay_vars.listening = true;
+}
+
+void sim_radio_off(void) {
+    sim_air_node_off(sim.current);
+}
+
+uint64_t sim_radio_transmit(const uint8_t* buffer, uint8_t length, uint8_t channel) {
+    uint64_t sfd, end;
+
+    // The transceiver is half-duplex
+    sim_air_node_off(sim.current);
+
+    // The frame goes out after the turnaround, nobody receives it
+    sfd = sim.time + SIM_REPLAY_TURNAROUND_NS + SIM_REPLAY_SHR_BYTES * SIM_REPLAY_BYTE_NS;
+    end = sfd + (1 + length) * SIM_REPLAY_BYTE_NS;
+    sim_event_push(SIM_EVENT_AIR_SFD, sfd, SIM_REPLAY_OWN, 0);
+    sim_event_push(SIM_EVENT_AIR_END, end, SIM_REPLAY_OWN, 0);
+
+    sim.current->tx_frames++;
+
+    return end;
+}
+
+uint8_t sim_radio_irq_get(void) {
+    uint8_t irq = sim.current->radio_irq;
+
+    // Reading the flags clears them
+    sim.current->radio_irq = 0;
+
+    return irq;
+}
+
+uint64_t sim_radio_sfd_time(void) {
+    return sim.current->radio_sfd;
+}
+
+const sim_radio_frame_t* sim_radio_frame_get(void) {
+    return &sim.current->rx_frame;
+}
+
+int8_t sim_radio_rssi(uint8_t channel) {
+    const sim_replay_record_t* record;
+    int64_t ticks;
+
+    // Time of the read in the log
+    ticks = (int64_t) sim_ticks_get() - sim_replay_vars.offset;
+
+    // Skip the samples that the gateway did not read this time
+    while (sim_replay_vars.rssi_next < sim_replay_vars.record_count) {
+        record = &sim_replay_vars.records[sim_replay_vars.rssi_next];
+        if (record->type == RECORDER_RSSI &&
+            (int64_t) record->ticks + SIM_REPLAY_RSSI_TICKS >= ticks) {
+            break;
+        }
+        sim_replay_vars.rssi_next++;
+    }
+
+    // Take the sample of the log if it was read at about the same time
+    if (sim_replay_vars.aligned && sim_replay_vars.rssi_next < sim_replay_vars.record_count) {
+        record = &sim_replay_vars.records[sim_replay_vars.rssi_next];
+        if ((int64_t) record->ticks <= ticks + SIM_REPLAY_RSSI_TICKS) {
+            sim_replay_vars.rssi_next++;
+            sim_replay_vars.stats.rssi_logged++;
+            return (int8_t) record->body[0];
+        }
+    }
+
+    // Otherwise tell whether a frame is being received
+    sim_replay_vars.stats.rssi_guessed++;
+    return (sim_replay_vars.receiving ? sim_replay_vars.receiving_rssi : SIM_REPLAY_RSSI_NOISE);
+}
+
+/*================================ private ==================================*/
+
+static void sim_replay_schedule(void) {
+    const sim_replay_record_t* record;
+    uint64_t time;
+
+    // Look for the next SFD or RX done of the log
+    while (sim_replay_vars.air_next < sim_replay_vars.record_count) {
+        record = &sim_replay_vars.records[sim_replay_vars.air_next++];
+        if (record->type != RECORDER_SFD && record->type != RECORDER_RX_DONE) {
+            continue;
+        }
+
+        // Events that fall behind the gateway happen right away, and the
+        // ones that find it asleep happen before it takes to wake up
+        time = sim_replay_time(record->ticks) + SIM_REPLAY_HALF_TICK_NS;
+        time = (time > sim.latency ? time - sim.latency : 0);
+        if (time < sim.time) {
+            time = sim.time;
+        }
+
+        sim_event_push(record->type == RECORDER_SFD ? SIM_EVENT_AIR_SFD : SIM_EVENT_AIR_END,
+                       time, sim_replay_vars.air_next - 1, 0);
+        return;
+    }
+
+    // Stop a while after the last record of the log
+    time = sim_replay_time(sim_replay_vars.begin + sim_replay_vars.log.duration) + SIM_REPLAY_TAIL_NS;
+    sim_event_push(SIM_EVENT_AIR_START, (time < sim.time ? sim.time : time), SIM_REPLAY_STOP, 0);
+}
+
+static bool sim_replay_defer(uint32_t index, sim_event_type_t type) {
+    uint64_t time;
+
+    // An event for a gateway that is awake goes in when it was recorded
+    time = sim_replay_time(sim_replay_vars.records[index].ticks) + SIM_REPLAY_HALF_TICK_NS;
+    if (sim.nodes[SIM_GATEWAY].status == SIM_NODE_WAITING || time <= sim.time) {
+        return false;
+    }
+
+    sim_event_push(type, time, index, 0);
+    return true;
+}
+
+static void sim_replay_raise(uint8_t irq) {
+    sim_node_t* node = &sim.nodes[SIM_GATEWAY];
+
+    // The gateway does not see the radio while it is off
+    if (node->status == SIM_NODE_OFF) {
+        return;
+    }
+
+    node->radio_irq |= irq;
+    if (irq & SIM_RADIO_IRQ_SFD) {
+        node->radio_sfd = sim_time_get();
+    }
+    node->irq_pending |= (1 << SIM_IRQ_RF);
+    sim_node_kick(node);
+}
+
+static const sim_replay_record_t* sim_replay_packet(uint32_t index) {
+    const sim_replay_record_t* record;
+
+    // The packet read by the gateway follows the RX done of its frame
+    for (uint32_t i = index + 1; i < sim_replay_vars.record_count; i++) {
+        record = &sim_replay_vars.records[i];
+        if (record->type == RECORDER_PACKET) {
+            return record;
+        }
+        if (record->type == RECORDER_SFD || record->type == RECORDER_RX_DONE) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void sim_replay_timer(const sim_replay_record_t* replayed) {
+    sim_replay_stats_t* stats = &sim_replay_vars.stats;
+    const sim_replay_record_t* record = NULL;
+    uint32_t ticks;
+
+    // Find the next timer expiration of the log
+    while (sim_replay_vars.timer_next < sim_replay_vars.record_count) {
+        record = &sim_replay_vars.records[sim_replay_vars.timer_next++];
+        if (record->type == RECORDER_TIMER) {
+            break;
+        }
+        record = NULL;
+    }
+
+    // The replay goes on past the end of the log
+    if (record == NULL) {
+        return;
+    }
+
+    // Compare the time since BEGIN and the timer
+    ticks = (uint32_t) ((int64_t) replayed->ticks - sim_replay_vars.offset);
+    if (ticks == record->ticks && replayed->body[0] == record->body[0]) {
+        stats->timers_matched++;
+    } else if (!stats->diverged) {
+        stats->diverged = true;
+        stats->diverged_index = stats->timers;
+        stats->diverged_log[0] = record->ticks - sim_replay_vars.begin;
+        stats->diverged_log[1] = record->body[0];
+        stats->diverged_replay[0] = ticks - sim_replay_vars.begin;
+        stats->diverged_replay[1] = replayed->body[0];
+    }
+    stats->timers++;
+}
+
+static uint64_t sim_replay_time(uint32_t ticks) {
+    int64_t replayed = (int64_t) ticks + sim_replay_vars.offset;
+
+    return (replayed < 0 ? 0 : sim_ticks_to_time((uint64_t) replayed));
+}
@@ -0,0 +1,80 @@
+/**
+ * @file       sim_replay.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Radio of the gateway driven by a log of recorded events.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef SIM_REPLAY_H_
+#define SIM_REPLAY_H_
+
+/*================================ include ==================================*/
+
+#include "sim_kernel.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/**
+ * Record of the log, see recorder.h for the layout of the body
+ */
+typedef struct {
+    uint8_t  type;                  ///< recorder_type_t
+    uint32_t ticks;                 ///< Absolute time on the device that recorded it
+    const uint8_t* body;
+    uint8_t  length;
+} sim_replay_record_t;
+
+/**
+ * Walks a log, which may come in pieces that hold whole records
+ */
+typedef struct {
+    const uint8_t* data;
+    size_t   length;
+    size_t   offset;
+    uint32_t ticks;
+} sim_replay_parser_t;
+
+typedef struct {
+    uint32_t experiments;           ///< Experiments (BEGIN records) in the log
+    uint8_t  mac_type;              ///< MAC of the replayed experiment
+    uint8_t  mac_slots;             ///< Slots of the replayed experiment
+    uint32_t duration;              ///< Ticks from BEGIN to the last record
+    uint32_t count[8];              ///< Records of the experiment by type
+    uint32_t lost;                  ///< Records the device could not keep
+} sim_replay_log_t;
+
+typedef struct {
+    uint64_t injected;              ///< Radio events delivered to the gateway
+    uint64_t missed;                ///< Radio events the gateway was not listening for
+    uint64_t rssi_logged;           ///< RSSI reads answered from the log
+    uint64_t rssi_guessed;          ///< RSSI reads answered from the state of the air
+    uint64_t timers;                ///< Timer expirations compared against the log
+    uint64_t timers_matched;        ///< Timer expirations that match the log
+    bool     diverged;              ///< The timers no longer match the log
+    uint64_t diverged_index;        ///< First timer expiration that does not match
+    uint32_t diverged_log[2];       ///< Ticks since BEGIN and timer in the log
+    uint32_t diverged_replay[2];    ///< Ticks since BEGIN and timer in the replay
+} sim_replay_stats_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+bool sim_replay_parse(sim_replay_parser_t* parser, sim_replay_record_t* record);
+
+bool sim_replay_init(const uint8_t* data, size_t length, uint32_t experiment);
+void sim_replay_record(const uint8_t* data, uint16_t length);
+const sim_replay_log_t* sim_replay_log(void);
+const sim_replay_stats_t* sim_replay_stats(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* SIM_REPLAY_H_ */
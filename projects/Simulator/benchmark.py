@@ -0,0 +1,164 @@
+'''
+Runs the FSA and DQ configurations of the results chapter on the simulator
+and compares them against the stored baselines.
+
+The throughput and the access delay are compared relative to the baseline
+(e.g. 0.1 is 10%), whereas the success, empty and collision ratios and the
+fairness index are compared in absolute terms (e.g. 0.05 is 5 points).
+The benchmark fails if any metric gets worse than the baseline by more than
+its tolerance. Improvements beyond the tolerance are reported but do not fail,
+use --update to store them as the new baselines.
+'''
+
+# Generic imports
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+# Metrics that are better when higher, better when lower, and how they compare
+HIGHER = ['throughput', 'success', 'fairness']
+LOWER = ['empty', 'collision', 'delay']
+RELATIVE = ['throughput', 'delay']
+
+class Benchmark():
+    def __init__(self, simulator, config_file):
+        self.simulator = simulator
+        self.config_file = config_file
+
+        with open(config_file) as f:
+            self.config = json.load(f)
+
+    def run(self, names = None):
+        results = []
+
+        for experiment in self.config['experiments']:
+            if names and experiment['name'] not in names:
+                continue
+
+            result = self._run_experiment(experiment)
+            result['name'] = experiment['name']
+            results.append(result)
+
+        return results
+
+    def check(self, results):
+        failures = []
+
+        for result in results:
+            experiment = self._find(result['name'])
+            baseline = experiment.get('baseline', {})
+
+            for metric in HIGHER + LOWER:
+                if metric not in baseline:
+                    continue
+
+                delta = self._delta(metric, result[metric], baseline[metric])
+                tolerance = self.config['tolerance'][metric]
+
+                if delta < -tolerance:
+                    status = 'FAIL'
+                    failures.append((result['name'], metric))
+                elif delta > tolerance:
+                    status = 'BETTER'
+                else:
+                    status = 'ok'
+
+                sys.stderr.write('%-10s %-10s %12.4f %12.4f  %s\n' %
+                                 (result['name'], metric, baseline[metric], result[metric], status))
+
+        return failures
+
+    def update(self, results):
+        for result in results:
+            experiment = self._find(result['name'])
+            experiment['baseline'] = dict((metric, round(result[metric], 4)) for metric in HIGHER + LOWER)
+
+        with open(self.config_file, 'w') as f:
+            json.dump(self.config, f, indent = 4, sort_keys = True)
+            f.write('\n')
+
+    def latex(self, results):
+        lines = []
+
+        lines.append('\\begin{tabular}{l r r r r r r}')
+        lines.append('Experiment & Throughput (pkt/s) & Success & Empty & Collision & Fairness & Delay (ms) \\\\')
+        lines.append('\\hline')
+        for result in results:
+            lines.append('%s & %.2f & %.2f\\%% & %.2f\\%% & %.2f\\%% & %.3f & %.1f \\\\' %
+                         (result['name'], result['throughput'], 100 * result['success'],
+                          100 * result['empty'], 100 * result['collision'],
+                          result['fairness'], result['delay']))
+        lines.append('\\end{tabular}')
+
+        return '\n'.join(lines) + '\n'
+
+    def _run_experiment(self, experiment):
+        command = [self.simulator, '-j',
+                   '-m', experiment['mac'],
+                   '-n', str(experiment['nodes']),
+                   '-k', str(experiment.get('slots', 1)),
+                   '-f', str(experiment.get('frames', self.config['frames'])),
+                   '-s', str(experiment.get('seed', self.config['seed']))]
+
+        output = subprocess.check_output(command)
+
+        return json.loads(output.decode('ascii'))
+
+    def _find(self, name):
+        for experiment in self.config['experiments']:
+            if experiment['name'] == name:
+                return experiment
+        raise KeyError(name)
+
+    def _delta(self, metric, value, baseline):
+        # Positive when the value is better than the baseline
+        if metric in RELATIVE:
+            delta = (value - baseline) / baseline if baseline != 0 else value - baseline
+        else:
+            delta = value - baseline
+
+        return delta if metric in HIGHER else -delta
+
+def main():
+    path = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description = 'OpenDQ MAC benchmark')
+    parser.add_argument('-s', '--simulator', default = os.path.join(path, 'Simulator.elf'))
+    parser.add_argument('-c', '--config', default = os.path.join(path, 'benchmark.json'))
+    parser.add_argument('-o', '--output', help = 'write the results as JSON to this file')
+    parser.add_argument('-t', '--table', help = 'write the results as a LaTeX table to this file')
+    parser.add_argument('-u', '--update', action = 'store_true', help = 'store the results as the new baselines')
+    parser.add_argument('names', nargs = '*', help = 'experiments to run (default all)')
+    args = parser.parse_args()
+
+    benchmark = Benchmark(args.simulator, args.config)
+    results = benchmark.run(args.names)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent = 4, sort_keys = True)
+            f.write('\n')
+    else:
+        for result in results:
+            sys.stdout.write(json.dumps(result, sort_keys = True) + '\n')
+
+    if args.table:
+        with open(args.table, 'w') as f:
+            f.write(benchmark.latex(results))
+
+    if args.update:
+        benchmark.update(results)
+        return 0
+
+    failures = benchmark.check(results)
+    if failures:
+        sys.stderr.write('%d metrics below tolerance: %s\n' %
+                         (len(failures), ', '.join('%s/%s' % failure for failure in failures)))
+        return 1
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,298 @@
+/**
+ * @file       main.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Discrete-event simulator of a Gateway and many Nodes.
+ *
+ *             Runs the Gateway and Node images, built with TARGET=sim, on a
+ *             shared radio channel and reports the same counters that the
+ *             gateway sends to the host after every frame. The radio events
+ *             of the gateway can be recorded to be replayed with Replay.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "sim_kernel.h"
+#include "sim_air.h"
+#include "sim_host.h"
+
+/*================================ define ===================================*/
+
+#define SIM_MAC_FSA                     ( 0x01 )
+#define SIM_MAC_DQ                      ( 0x02 )
+
+#define SIM_NS_PER_MS                   ( 1000000.0 )
+
+#define SIM_DEFAULT_NODES               ( 100 )
+#define SIM_DEFAULT_FRAMES              ( 1000 )
+#define SIM_DEFAULT_SLOTS               ( 8 )
+#define SIM_DEFAULT_SEED                ( 1 )
+#define SIM_DEFAULT_LATENCY             ( 75 )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+extern const sim_image_t sim_image_Gateway;
+extern const sim_image_t sim_image_Node;
+
+static FILE* sim_record_file;
+
+/*=============================== prototypes ================================*/
+
+static void sim_usage(const char* name);
+static void sim_record(uint8_t command, const uint8_t* data, uint16_t length);
+static double sim_ratio(uint64_t value, uint64_t total);
+static double sim_wall_time(void);
+static double sim_fairness(void);
+static void sim_report(double wall_time);
+static void sim_report_json(const char* mac, uint8_t slots, double wall_time);
+
+/*================================= public ==================================*/
+
+int main(int argc, char** argv) {
+    sim_air_config_t air_config;
+    sim_host_config_t host_config;
+    uint32_t nodes = SIM_DEFAULT_NODES;
+    uint64_t seed = SIM_DEFAULT_SEED;
+    uint64_t limit = 0;
+    uint64_t latency = SIM_DEFAULT_LATENCY;
+    bool json = false;
+    double wall_time;
+    int option;
+
+    // Default channel: nodes between 55 and 75 dB away from the gateway
+    air_config.loss_min = 55.0;
+    air_config.loss_max = 75.0;
+    air_config.capture = 3.0;
+    air_config.sensitivity = -97.0;
+    air_config.noise = -100.0;
+
+    // Default experiment: DQ for a thousand frames
+    host_config.mac_type = SIM_MAC_DQ;
+    host_config.mac_slots = SIM_DEFAULT_SLOTS;
+    host_config.frames = SIM_DEFAULT_FRAMES;
+    host_config.record = false;
+    host_config.callback = NULL;
+
+    // Parse the command line
+    while ((option = getopt(argc, argv, "m:n:f:k:s:l:c:w:t:R:jh")) != -1) {
+        switch (option) {
+            case 'm':
+                if (strcmp(optarg, "dq") == 0) {
+                    host_config.mac_type = SIM_MAC_DQ;
+                } else if (strcmp(optarg, "fsa") == 0) {
+                    host_config.mac_type = SIM_MAC_FSA;
+                } else {
+                    sim_usage(argv[0]);
+                }
+                break;
+            case 'n':
+                nodes = (uint32_t) strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                host_config.frames = strtoull(optarg, NULL, 0);
+                break;
+            case 'k':
+                host_config.mac_slots = (uint8_t) strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'l':
+                if (sscanf(optarg, "%lf:%lf", &air_config.loss_min, &air_config.loss_max) != 2) {
+                    sim_usage(argv[0]);
+                }
+                break;
+            case 'c':
+                air_config.capture = strtod(optarg, NULL);
+                break;
+            case 'w':
+                latency = strtoull(optarg, NULL, 0);
+                break;
+            case 't':
+                limit = (uint64_t) (strtod(optarg, NULL) * SIM_NS_PER_SECOND);
+                break;
+            case 'R':
+                sim_record_file = fopen(optarg, "wb");
+                if (sim_record_file == NULL) {
+                    fprintf(stderr, "sim: unable to open %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                host_config.record = true;
+                host_config.callback = sim_record;
+                break;
+            case 'j':
+                json = true;
+                break;
+            default:
+                sim_usage(argv[0]);
+                break;
+        }
+    }
+
+    // The addresses of the nodes are 16 bits and zero is the broadcast
+    if (nodes == 0 || nodes >= UINT16_MAX || host_config.mac_slots == 0 ||
+        air_config.loss_min > air_config.loss_max) {
+        sim_usage(argv[0]);
+    }
+
+    // Initialize the simulator
+    sim_kernel_init(&sim_image_Gateway, &sim_image_Node, nodes, seed);
+    sim.latency = latency * SIM_NS_PER_US;
+    sim_air_init(&air_config);
+    sim_host_init(&host_config);
+
+    // Run it until the frames are done or the time is over
+    wall_time = sim_wall_time();
+    sim_kernel_run(limit);
+    wall_time = sim_wall_time() - wall_time;
+
+    if (sim_record_file != NULL) {
+        fclose(sim_record_file);
+    }
+
+    if (json) {
+        sim_report_json(host_config.mac_type == SIM_MAC_DQ ? "dq" : "fsa",
+                        host_config.mac_slots, wall_time);
+    } else {
+        sim_report(wall_time);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*================================ private ==================================*/
+
+static void sim_usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -m dq|fsa   MAC protocol (default dq)\n"
+            "  -n nodes    Number of nodes besides the gateway (default %u)\n"
+            "  -f frames   Number of frames to simulate (default %u)\n"
+            "  -k slots    Number of FSA slots per frame (default %u)\n"
+            "  -s seed     Seed of the simulation (default %u)\n"
+            "  -l min:max  Range of the path loss to the gateway in dB (default 55:75)\n"
+            "  -c capture  SINR needed to decode a frame in dB (default 3)\n"
+            "  -w us       Time for a node to wake up and enter an interrupt (default %u)\n"
+            "  -t seconds  Limit of simulated time (default none)\n"
+            "  -R file     Record the radio events of the gateway to a file\n"
+            "  -j          Print the results as a single JSON object\n",
+            name, SIM_DEFAULT_NODES, SIM_DEFAULT_FRAMES, SIM_DEFAULT_SLOTS, SIM_DEFAULT_SEED,
+            SIM_DEFAULT_LATENCY);
+    exit(EXIT_FAILURE);
+}
+
+static void sim_record(uint8_t command, const uint8_t* data, uint16_t length) {
+    // Keep the records, they are a stream of whole records
+    if (command == 'E') {
+        fwrite(data, 1, length, sim_record_file);
+    }
+}
+
+static double sim_ratio(uint64_t value, uint64_t total) {
+    return (total == 0 ? 0.0 : (double) value / (double) total);
+}
+
+static double sim_wall_time(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static double sim_fairness(void) {
+    const sim_host_stats_t* host = sim_host_stats();
+    double sum = 0.0, squares = 0.0;
+    uint32_t nodes = sim.node_count - 1;
+
+    // Jain's index over the packets delivered by each node, the gateway
+    // is the first node
+    for (uint32_t i = 1; i < sim.node_count; i++) {
+        sum += (double) host->delivered[i];
+        squares += (double) host->delivered[i] * (double) host->delivered[i];
+    }
+
+    return (squares == 0.0 ? 0.0 : (sum * sum) / (nodes * squares));
+}
+
+static void sim_report(double wall_time) {
+    const sim_host_stats_t* host = sim_host_stats();
+    const sim_air_stats_t* air = sim_air_stats();
+    uint64_t arp_total, data_total;
+    uint32_t served = 0;
+    double elapsed;
+
+    arp_total = host->arp[SIM_HOST_EMPTY] + host->arp[SIM_HOST_COLLISION] + host->arp[SIM_HOST_SUCCESS];
+    data_total = host->data[SIM_HOST_EMPTY] + host->data[SIM_HOST_COLLISION] + host->data[SIM_HOST_SUCCESS];
+    elapsed = (double) (host->end_time - host->start_time) / SIM_NS_PER_SECOND;
+
+    // The gateway is the first node
+    for (uint32_t i = 1; i < sim.node_count; i++) {
+        if (host->delivered[i] > 0) {
+            served++;
+        }
+    }
+
+    printf("nodes:        %u\n", sim.node_count - 1);
+    printf("frames:       %" PRIu64 " in %.3f s simulated (%u experiments)\n",
+           host->frames, elapsed, host->starts);
+    printf("wall time:    %.3f s, %" PRIu64 " events, %" PRIu64 " state swaps\n",
+           wall_time, sim.events, sim.state_swaps);
+
+    if (arp_total > 0) {
+        printf("arp:          success %" PRIu64 " (%.3f), empty %" PRIu64 " (%.3f), collision %" PRIu64 " (%.3f)\n",
+               host->arp[SIM_HOST_SUCCESS], sim_ratio(host->arp[SIM_HOST_SUCCESS], arp_total),
+               host->arp[SIM_HOST_EMPTY], sim_ratio(host->arp[SIM_HOST_EMPTY], arp_total),
+               host->arp[SIM_HOST_COLLISION], sim_ratio(host->arp[SIM_HOST_COLLISION], arp_total));
+        printf("queues:       crq mean %.2f max %u, dtq mean %.2f max %u\n",
+               sim_ratio(host->crq_sum, host->frames), host->crq_max,
+               sim_ratio(host->dtq_sum, host->frames), host->dtq_max);
+    }
+
+    printf("data:         success %" PRIu64 " (%.3f), empty %" PRIu64 " (%.3f), collision %" PRIu64 " (%.3f)\n",
+           host->data[SIM_HOST_SUCCESS], sim_ratio(host->data[SIM_HOST_SUCCESS], data_total),
+           host->data[SIM_HOST_EMPTY], sim_ratio(host->data[SIM_HOST_EMPTY], data_total),
+           host->data[SIM_HOST_COLLISION], sim_ratio(host->data[SIM_HOST_COLLISION], data_total));
+    printf("served:       %u nodes, fairness %.3f\n", served, sim_fairness());
+    printf("delay:        mean %.3f ms, max %.3f ms\n",
+           sim_ratio(host->delay_sum, host->data[SIM_HOST_SUCCESS]) / SIM_NS_PER_MS,
+           (double) host->delay_max / SIM_NS_PER_MS);
+    printf("air:          %" PRIu64 " transmissions, %" PRIu64 " receptions, %" PRIu64 " corrupted, %" PRIu64 " captures\n",
+           air->transmissions, air->receptions, air->corruptions, air->captures);
+}
+
+static void sim_report_json(const char* mac, uint8_t slots, double wall_time) {
+    const sim_host_stats_t* host = sim_host_stats();
+    uint64_t data_total, success;
+    double elapsed;
+
+    data_total = host->data[SIM_HOST_EMPTY] + host->data[SIM_HOST_COLLISION] + host->data[SIM_HOST_SUCCESS];
+    success = host->data[SIM_HOST_SUCCESS];
+    elapsed = (double) (host->end_time - host->start_time) / SIM_NS_PER_SECOND;
+
+    // Throughput in DATA packets per second, delays in milliseconds
+    printf("{\"mac\": \"%s\", \"slots\": %u, \"nodes\": %u, \"frames\": %" PRIu64 ", "
+           "\"seconds\": %.6f, \"throughput\": %.6f, "
+           "\"success\": %.6f, \"empty\": %.6f, \"collision\": %.6f, "
+           "\"fairness\": %.6f, \"delay\": %.6f, \"delay_max\": %.6f, "
+           "\"wall_time\": %.3f}\n",
+           mac, slots, sim.node_count - 1, host->frames,
+           elapsed, (elapsed > 0.0 ? (double) success / elapsed : 0.0),
+           sim_ratio(success, data_total),
+           sim_ratio(host->data[SIM_HOST_EMPTY], data_total),
+           sim_ratio(host->data[SIM_HOST_COLLISION], data_total),
+           sim_fairness(),
+           sim_ratio(host->delay_sum, success) / SIM_NS_PER_MS,
+           (double) host->delay_max / SIM_NS_PER_MS,
+           wall_time);
+}
@@ -0,0 +1,402 @@
+/**
+ * @file       sim_air.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Shared radio channel of the simulator.
+ *
+ *             The nodes form a star around the gateway, each one with a
+ *             random path loss towards it, and two nodes hear each other
+ *             through the sum of their path losses. A receiver locks onto
+ *             the first frame whose SFD it detects, or onto the strongest
+ *             one if several SFDs arrive at once (capture effect). The frame
+ *             is decoded if its SINR never drops below the capture threshold,
+ *             otherwise it is delivered with a wrong CRC (collision). When
+ *             nothing is on the air the RSSI reads the noise floor (empty).
+ *             Frames go on the air 192 us after the radio is told to
+ *             transmit, like the CC2538 does; the driver itself waits for
+ *             the receiver to settle.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <math.h>
+
+#include "sim_air.h"
+
+/*================================ define ===================================*/
+
+// Defines for the timing (250 kbps O-QPSK, 32 us per byte)
+#define SIM_AIR_BYTE_NS                 ( 32 * SIM_NS_PER_US )
+#define SIM_AIR_SHR_BYTES               ( 5 )
+
+// Defines for the RX/TX turnaround of the transceiver
+#define SIM_AIR_TURNAROUND_NS           ( 192 * SIM_NS_PER_US )
+
+// Defines for the link quality reported with the frames
+#define SIM_AIR_LQI_GOOD                ( 108 )
+#define SIM_AIR_LQI_BAD                 ( 40 )
+
+/*================================ typedef ==================================*/
+
+struct sim_tx {
+    uint32_t    index;
+    uint32_t    active;             ///< Position in the list of frames on the air
+    uint32_t    next_free;
+    sim_node_t* sender;
+    uint64_t    sfd;
+    uint8_t     channel;
+    uint8_t     length;
+    uint8_t     buffer[SIM_RADIO_FRAME_MAX];
+};
+
+typedef struct {
+    sim_air_config_t config;
+    sim_air_stats_t  stats;
+
+    // Linear values of the configuration (mW)
+    double noise;
+    double sensitivity;
+    double capture;
+
+    // Frames on the air
+    sim_tx_t*  tx;
+    sim_tx_t** active;
+    uint32_t   active_count;
+    uint32_t   tx_free;
+
+    // Nodes with the receiver on
+    sim_node_t** listeners;
+    uint32_t     listener_count;
+
+    // Nodes that have to take a radio interrupt
+    sim_node_t** kick;
+    uint32_t     kick_count;
+} sim_air_vars_t;
+
+/*=============================== variables =================================*/
+
+static sim_air_vars_t sim_air_vars;
+
+/*=============================== prototypes ================================*/
+
+static double sim_air_power(const sim_node_t* sender, const sim_node_t* receiver);
+static double sim_air_interference(const sim_node_t* receiver);
+static void sim_air_lock(sim_node_t* receiver, sim_tx_t* tx, double power);
+static void sim_air_raise(sim_node_t* node, uint8_t irq);
+static void sim_air_kick(void);
+static int8_t sim_air_dbm(double power);
+
+/*================================= public ==================================*/
+
+void sim_air_init(const sim_air_config_t* config) {
+    sim_node_t* node;
+    double loss;
+    uint32_t count = sim.node_count;
+
+    // Initialize the memory of the channel variables
+    memset(&sim_air_vars, 0, sizeof(sim_air_vars_t));
+    sim_air_vars.config = *config;
+
+    // Convert the configuration to linear values
+    sim_air_vars.noise       = pow(10.0, config->noise / 10.0);
+    sim_air_vars.sensitivity = pow(10.0, config->sensitivity / 10.0);
+    sim_air_vars.capture     = pow(10.0, config->capture / 10.0);
+
+    // Allocate room for every node transmitting and listening at once
+    sim_air_vars.tx        = calloc(count, sizeof(sim_tx_t));
+    sim_air_vars.active    = calloc(count, sizeof(sim_tx_t*));
+    sim_air_vars.listeners = calloc(count, sizeof(sim_node_t*));
+    sim_air_vars.kick      = calloc(count, sizeof(sim_node_t*));
+    if (sim_air_vars.tx == NULL || sim_air_vars.active == NULL ||
+        sim_air_vars.listeners == NULL || sim_air_vars.kick == NULL) {
+        fprintf(stderr, "sim: unable to allocate the channel\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        sim_air_vars.tx[i].index = i;
+        sim_air_vars.tx[i].next_free = i + 1;
+    }
+
+    // Draw the path loss of every node towards the gateway
+    for (uint32_t i = 0; i < count; i++) {
+        node = &sim.nodes[i];
+        if (i == SIM_GATEWAY) {
+            loss = 0.0;
+        } else {
+            loss = config->loss_min + (config->loss_max - config->loss_min) *
+                   ((double) (sim_random() >> 11) / (double) (1ULL << 53));
+        }
+        node->gain = pow(10.0, -loss / 10.0);
+    }
+}
+
+void sim_air_node_off(sim_node_t* node) {
+    sim_node_t* last;
+
+    // Drop the frame being received, if any
+    node->rx_lock = NULL;
+
+    // Remove the node from the listeners
+    if (node->radio_listener >= 0) {
+        last = sim_air_vars.listeners[--sim_air_vars.listener_count];
+        sim_air_vars.listeners[node->radio_listener] = last;
+        last->radio_listener = node->radio_listener;
+        node->radio_listener = -1;
+    }
+}
+
+void sim_air_start(uint32_t index) {
+    sim_tx_t* tx = &sim_air_vars.tx[index];
+    sim_node_t* receiver;
+
+    // Put the frame on the air
+    tx->active = sim_air_vars.active_count;
+    sim_air_vars.active[sim_air_vars.active_count++] = tx;
+
+    // The new frame may corrupt the frames being received elsewhere
+    for (uint32_t i = 0; i < sim_air_vars.listener_count; i++) {
+        receiver = sim_air_vars.listeners[i];
+        if (receiver->rx_lock != NULL && !receiver->rx_corrupt &&
+            receiver->radio_channel == tx->channel &&
+            receiver->rx_power < sim_air_vars.capture * sim_air_interference(receiver)) {
+            receiver->rx_corrupt = true;
+        }
+    }
+}
+
+void sim_air_sfd(uint32_t index) {
+    sim_tx_t* tx = &sim_air_vars.tx[index];
+    sim_node_t* receiver;
+    double power;
+
+    // The sender sees its own SFD go out
+    sim_air_raise(tx->sender, SIM_RADIO_IRQ_SFD);
+
+    for (uint32_t i = 0; i < sim_air_vars.listener_count; i++) {
+        receiver = sim_air_vars.listeners[i];
+        if (receiver->radio_channel != tx->channel || sim.time < receiver->radio_settled) {
+            continue;
+        }
+
+        // The frame is too weak to be detected
+        power = sim_air_power(tx->sender, receiver);
+        if (power < sim_air_vars.sensitivity) {
+            continue;
+        }
+
+        if (receiver->rx_lock == NULL) {
+            sim_air_lock(receiver, tx, power);
+            sim_air_raise(receiver, SIM_RADIO_IRQ_SFD);
+        } else if (receiver->rx_lock->sfd == tx->sfd && power > receiver->rx_power) {
+            // A stronger frame starting at the same time captures the receiver
+            sim_air_lock(receiver, tx, power);
+            sim_air_vars.stats.captures++;
+        }
+    }
+
+    sim_air_kick();
+}
+
+void sim_air_end(uint32_t index) {
+    sim_tx_t* tx = &sim_air_vars.tx[index];
+    sim_tx_t* last;
+    sim_node_t* receiver;
+    sim_radio_frame_t* frame;
+
+    // Take the frame off the air
+    last = sim_air_vars.active[--sim_air_vars.active_count];
+    sim_air_vars.active[tx->active] = last;
+    last->active = tx->active;
+
+    // The sender sees the end of its transmission
+    sim_air_raise(tx->sender, SIM_RADIO_IRQ_TXDONE);
+
+    // Deliver the frame to the receivers locked onto it
+    for (uint32_t i = 0; i < sim_air_vars.listener_count; i++) {
+        receiver = sim_air_vars.listeners[i];
+        if (receiver->rx_lock != tx) {
+            continue;
+        }
+
+        frame = &receiver->rx_frame;
+        frame->length = tx->length;
+        frame->rssi   = sim_air_dbm(receiver->rx_power);
+        frame->crc    = !receiver->rx_corrupt;
+        frame->lqi    = (frame->crc ? SIM_AIR_LQI_GOOD : SIM_AIR_LQI_BAD);
+        memcpy(frame->buffer, tx->buffer, tx->length - 2);
+
+        if (frame->crc) {
+            sim_air_vars.stats.receptions++;
+        } else {
+            sim_air_vars.stats.corruptions++;
+        }
+
+        receiver->rx_lock = NULL;
+        sim_air_raise(receiver, SIM_RADIO_IRQ_RXPKTDONE);
+    }
+
+    // Release the frame before the nodes run, they may transmit again
+    tx->next_free = sim_air_vars.tx_free;
+    sim_air_vars.tx_free = tx->index;
+
+    sim_air_kick();
+}
+
+const sim_air_stats_t* sim_air_stats(void) {
+    return &sim_air_vars.stats;
+}
+
+/*=========================== firmware interface ============================*/
+
+void sim_radio_on(uint8_t channel) {
+    sim_node_t* node = sim.current;
+
+    // Changing the channel drops the frame being received, and the
+    // receiver settles again
+    if (node->radio_channel != channel) {
+        node->rx_lock = NULL;
+        node->radio_channel = channel;
+        node->radio_settled = sim.time + SIM_AIR_TURNAROUND_NS;
+    }
+
+    // Add the node to the listeners, it hears frames once it has settled
+    if (node->radio_listener < 0) {
+        node->radio_listener = sim_air_vars.listener_count;
+        sim_air_vars.listeners[sim_air_vars.listener_count++] = node;
+        node->radio_settled = sim.time + SIM_AIR_TURNAROUND_NS;
+    }
+}
+
+void sim_radio_off(void) {
+    sim_air_node_off(sim.current);
+}
+
+uint64_t sim_radio_transmit(const uint8_t* buffer, uint8_t length, uint8_t channel) {
+    sim_node_t* node = sim.current;
+    sim_tx_t* tx;
+    uint64_t start, end;
+
+    // The transceiver is half-duplex
+    sim_air_node_off(node);
+
+    // Prepare the frame, the CRC bytes are not copied
+    tx = &sim_air_vars.tx[sim_air_vars.tx_free];
+    sim_air_vars.tx_free = tx->next_free;
+    tx->sender  = node;
+    tx->channel = channel;
+    tx->length  = length;
+    memcpy(tx->buffer, buffer, length - 2);
+
+    // Schedule the start of the frame after the turnaround, then the SFD
+    // and the end of the frame (length byte + PSDU)
+    start   = sim.time + SIM_AIR_TURNAROUND_NS;
+    tx->sfd = start + SIM_AIR_SHR_BYTES * SIM_AIR_BYTE_NS;
+    end     = tx->sfd + (1 + length) * SIM_AIR_BYTE_NS;
+    sim_event_push(SIM_EVENT_AIR_START, start, tx->index, 0);
+    sim_event_push(SIM_EVENT_AIR_SFD, tx->sfd, tx->index, 0);
+    sim_event_push(SIM_EVENT_AIR_END, end, tx->index, 0);
+
+    sim_air_vars.stats.transmissions++;
+    node->tx_frames++;
+
+    return end;
+}
+
+uint8_t sim_radio_irq_get(void) {
+    uint8_t irq = sim.current->radio_irq;
+
+    // Reading the flags clears them
+    sim.current->radio_irq = 0;
+
+    return irq;
+}
+
+uint64_t sim_radio_sfd_time(void) {
+    return sim.current->radio_sfd;
+}
+
+const sim_radio_frame_t* sim_radio_frame_get(void) {
+    return &sim.current->rx_frame;
+}
+
+int8_t sim_radio_rssi(uint8_t channel) {
+    sim_node_t* node = sim.current;
+    double power = sim_air_vars.noise;
+
+    // Add up everything on the air on the channel
+    for (uint32_t i = 0; i < sim_air_vars.active_count; i++) {
+        if (sim_air_vars.active[i]->channel == channel &&
+            sim_air_vars.active[i]->sender != node) {
+            power += sim_air_power(sim_air_vars.active[i]->sender, node);
+        }
+    }
+
+    return sim_air_dbm(power);
+}
+
+/*================================ private ==================================*/
+
+static double sim_air_power(const sim_node_t* sender, const sim_node_t* receiver) {
+    // Frames are sent at 0 dBm (1 mW) and the links go through the gateway
+    return sender->gain * receiver->gain;
+}
+
+static double sim_air_interference(const sim_node_t* receiver) {
+    const sim_tx_t* tx;
+    double power = sim_air_vars.noise;
+
+    for (uint32_t i = 0; i < sim_air_vars.active_count; i++) {
+        tx = sim_air_vars.active[i];
+        if (tx != receiver->rx_lock && tx->channel == receiver->radio_channel &&
+            tx->sender != receiver) {
+            power += sim_air_power(tx->sender, receiver);
+        }
+    }
+
+    return power;
+}
+
+static void sim_air_lock(sim_node_t* receiver, sim_tx_t* tx, double power) {
+    receiver->rx_lock    = tx;
+    receiver->rx_power   = power;
+    receiver->rx_corrupt = (power < sim_air_vars.capture * sim_air_interference(receiver));
+}
+
+static void sim_air_raise(sim_node_t* node, uint8_t irq) {
+    // Nodes that are off do not see the radio
+    if (node->status == SIM_NODE_OFF) {
+        return;
+    }
+
+    node->radio_irq |= irq;
+    if (irq & SIM_RADIO_IRQ_SFD) {
+        node->radio_sfd = sim_time_get();
+    }
+    node->irq_pending |= (1 << SIM_IRQ_RF);
+    sim_air_vars.kick[sim_air_vars.kick_count++] = node;
+}
+
+static void sim_air_kick(void) {
+    uint32_t count = sim_air_vars.kick_count;
+
+    // The nodes run once the channel is settled, as they may change it
+    sim_air_vars.kick_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sim_node_kick(sim_air_vars.kick[i]);
+    }
+}
+
+static int8_t sim_air_dbm(double power) {
+    double dbm = 10.0 * log10(power);
+
+    if (dbm < INT8_MIN) {
+        return INT8_MIN;
+    }
+
+    return (int8_t) lround(dbm);
+}
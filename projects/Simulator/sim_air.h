@@ -0,0 +1,53 @@
+/**
+ * @file       sim_air.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Shared radio channel of the simulator.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef SIM_AIR_H_
+#define SIM_AIR_H_
+
+/*================================ include ==================================*/
+
+#include "sim_kernel.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+typedef struct {
+    double loss_min;                ///< Minimum path loss to the gateway (dB)
+    double loss_max;                ///< Maximum path loss to the gateway (dB)
+    double capture;                 ///< SINR needed to decode a frame (dB)
+    double sensitivity;             ///< Weakest frame that can be detected (dBm)
+    double noise;                   ///< Noise floor (dBm)
+} sim_air_config_t;
+
+typedef struct {
+    uint64_t transmissions;         ///< Frames put on the air
+    uint64_t receptions;            ///< Frames decoded with a correct CRC
+    uint64_t corruptions;           ///< Frames decoded with a wrong CRC
+    uint64_t captures;              ///< Receivers that switched to a stronger frame
+} sim_air_stats_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void sim_air_init(const sim_air_config_t* config);
+void sim_air_node_off(sim_node_t* node);
+void sim_air_start(uint32_t index);
+void sim_air_sfd(uint32_t index);
+void sim_air_end(uint32_t index);
+const sim_air_stats_t* sim_air_stats(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* SIM_AIR_H_ */
@@ -0,0 +1,407 @@
+/**
+ * @file       sim_host.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Host computer attached to the UART of the simulated gateway.
+ *
+ *             It plays the part of the Python application: it starts an
+ *             experiment on the gateway with the HDLC START command, decodes
+ *             the debug records that the gateway sends after every frame,
+ *             and starts a new experiment whenever the gateway resets at
+ *             the end of one, until the requested number of frames is done.
+ *             It can also ask the gateway to record its radio events, the
+ *             records are handed to the callback with the other messages.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "sim_host.h"
+
+#include "crc16.h"
+
+/*================================ define ===================================*/
+
+#define SIM_HOST_FLAG                   ( 0x7E )
+#define SIM_HOST_ESCAPE                 ( 0x7D )
+#define SIM_HOST_ESCAPE_MASK            ( 0x20 )
+
+#define SIM_HOST_CMD_START              ( 'A' )
+#define SIM_HOST_CMD_DATA               ( 'D' )
+#define SIM_HOST_CMD_RECORD             ( 'E' )
+#define SIM_HOST_CMD_RESET              ( 'R' )
+
+#define SIM_HOST_MAC_FSA                ( 0x01 )
+#define SIM_HOST_MAC_DQ                 ( 0x02 )
+
+// The longest experiment the gateway supports (x 33 ticks, ~65 seconds)
+#define SIM_HOST_DURATION               ( 0xFFFF )
+
+// Time for the gateway to boot before the experiment is started
+#define SIM_HOST_START_NS               ( 10 * 1000 * SIM_NS_PER_US )
+
+#define SIM_HOST_BUFFER_SIZE            ( 256 )
+
+/*================================ typedef ==================================*/
+
+/**
+ * Layout of dq_debug_serial_t as sent by the gateway
+ */
+typedef struct __attribute__((__packed__)) {
+    uint8_t  mac_type;
+    uint8_t  arp_state[3];
+    uint8_t  data_state;
+    int8_t   arp_rssi[3];
+    uint8_t  arp_total;
+    uint8_t  crq_wait;
+    uint8_t  dtq_wait;
+    uint16_t arp_random[3];
+    uint16_t data_address;
+    uint16_t crq_local;
+    uint16_t crq_global;
+    uint16_t pcrq_local;
+    uint16_t dtq_local;
+    uint16_t dtq_global;
+    uint16_t pdtq_local;
+} sim_host_dq_t;
+
+/**
+ * Layout of fsa_debug_serial_t as sent by the gateway
+ */
+typedef struct __attribute__((__packed__)) {
+    uint8_t  mac_type;
+    uint8_t  slot_count;
+    uint8_t  data_state;
+    uint16_t data_address;
+    int8_t   rssi_status;
+    uint8_t  fsa_total;
+} sim_host_fsa_t;
+
+typedef struct {
+    sim_host_config_t config;
+    sim_host_stats_t  stats;
+
+    // Bytes towards the gateway
+    uint8_t  tx_buffer[SIM_HOST_BUFFER_SIZE];
+    uint16_t tx_length;
+    uint16_t tx_index;
+
+    // Bytes from the gateway
+    uint8_t  rx_buffer[SIM_HOST_BUFFER_SIZE];
+    uint16_t rx_length;
+    bool     rx_escaping;
+
+    // The first DQ record of an experiment precedes any frame
+    bool     skip_record;
+
+    // Time of the first frame of the experiment and of the last packet
+    // received from each node, to measure the access delay
+    uint64_t epoch;
+    uint64_t* last_delivery;
+} sim_host_vars_t;
+
+/*=============================== variables =================================*/
+
+static sim_host_vars_t sim_host_vars;
+
+/*=============================== prototypes ================================*/
+
+static void sim_host_put(uint8_t byte);
+static void sim_host_frame(void);
+static void sim_host_dq(const uint8_t* data, uint16_t length);
+static void sim_host_fsa(const uint8_t* data, uint16_t length);
+static void sim_host_delivered(uint16_t address);
+
+/*================================= public ==================================*/
+
+void sim_host_init(const sim_host_config_t* config) {
+    uint8_t command[10];
+    uint8_t length = 0;
+    uint8_t byte;
+    uint16_t crc;
+
+    // Initialize the memory of the host variables
+    memset(&sim_host_vars, 0, sizeof(sim_host_vars_t));
+    sim_host_vars.config = *config;
+
+    sim_host_vars.stats.delivered = calloc(sim.node_count, sizeof(uint64_t));
+    sim_host_vars.last_delivery = calloc(sim.node_count, sizeof(uint64_t));
+    if (sim_host_vars.stats.delivered == NULL || sim_host_vars.last_delivery == NULL) {
+        fprintf(stderr, "sim: unable to allocate the host\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Build the START command: address, MAC type, slots, duration and
+    // whether to record the radio events
+    command[length++] = SIM_HOST_CMD_START;
+    command[length++] = 0x00;
+    command[length++] = 0x00;
+    command[length++] = config->mac_type;
+    command[length++] = config->mac_slots;
+    command[length++] = (SIM_HOST_DURATION >> 8) & 0xFF;
+    command[length++] = (SIM_HOST_DURATION >> 0) & 0xFF;
+    if (config->record) {
+        command[length++] = 0x01;
+    }
+
+    // Append the CRC, most significant byte first
+    crc16_init();
+    for (uint8_t i = 0; i < length; i++) {
+        crc16_push(command[i]);
+    }
+    crc = crc16_get();
+    command[length++] = (crc >> 8) & 0xFF;
+    command[length++] = (crc >> 0) & 0xFF;
+
+    // Frame it as HDLC
+    sim_host_vars.tx_buffer[sim_host_vars.tx_length++] = SIM_HOST_FLAG;
+    for (uint8_t i = 0; i < length; i++) {
+        byte = command[i];
+        if (byte == SIM_HOST_FLAG || byte == SIM_HOST_ESCAPE) {
+            sim_host_vars.tx_buffer[sim_host_vars.tx_length++] = SIM_HOST_ESCAPE;
+            byte ^= SIM_HOST_ESCAPE_MASK;
+        }
+        sim_host_vars.tx_buffer[sim_host_vars.tx_length++] = byte;
+    }
+    sim_host_vars.tx_buffer[sim_host_vars.tx_length++] = SIM_HOST_FLAG;
+
+    // Nothing is sent until the gateway boots
+    sim_host_vars.tx_index = sim_host_vars.tx_length;
+}
+
+void sim_host_boot(sim_node_t* node) {
+    if (node->index != SIM_GATEWAY) {
+        return;
+    }
+
+    // Discard what was left from the previous run of the gateway
+    sim_host_vars.rx_length = 0;
+    sim_host_vars.rx_escaping = false;
+    sim_host_vars.tx_index = sim_host_vars.tx_length;
+
+    // Start an experiment once the gateway is up
+    sim_event_push(SIM_EVENT_HOST, sim.time + SIM_HOST_START_NS, SIM_GATEWAY, 0);
+}
+
+void sim_host_event(uint32_t index) {
+    sim_node_t* gateway = &sim.nodes[SIM_GATEWAY];
+
+    // Send the START command to the gateway
+    sim_host_vars.tx_index = 0;
+    sim_host_vars.skip_record = true;
+    sim_host_vars.epoch = 0;
+    sim_host_vars.stats.starts++;
+
+    gateway->irq_pending |= (1 << SIM_IRQ_UART);
+    sim_node_kick(gateway);
+}
+
+const sim_host_stats_t* sim_host_stats(void) {
+    return &sim_host_vars.stats;
+}
+
+/*=========================== firmware interface ============================*/
+
+void sim_uart_write(uint8_t byte) {
+    // Only the gateway is attached to the host
+    if (sim.current->index == SIM_GATEWAY) {
+        sim_host_put(byte);
+    }
+}
+
+bool sim_uart_read(uint8_t* byte) {
+    if (sim.current->index != SIM_GATEWAY ||
+        sim_host_vars.tx_index == sim_host_vars.tx_length) {
+        return false;
+    }
+
+    *byte = sim_host_vars.tx_buffer[sim_host_vars.tx_index++];
+
+    return true;
+}
+
+/*================================ private ==================================*/
+
+static void sim_host_put(uint8_t byte) {
+    // A flag closes the current frame and opens the next one
+    if (byte == SIM_HOST_FLAG) {
+        if (sim_host_vars.rx_length > 0) {
+            sim_host_frame();
+        }
+        sim_host_vars.rx_length = 0;
+        sim_host_vars.rx_escaping = false;
+        return;
+    }
+
+    if (byte == SIM_HOST_ESCAPE) {
+        sim_host_vars.rx_escaping = true;
+        return;
+    }
+
+    if (sim_host_vars.rx_escaping) {
+        byte ^= SIM_HOST_ESCAPE_MASK;
+        sim_host_vars.rx_escaping = false;
+    }
+
+    if (sim_host_vars.rx_length < SIM_HOST_BUFFER_SIZE) {
+        sim_host_vars.rx_buffer[sim_host_vars.rx_length++] = byte;
+    }
+}
+
+static void sim_host_frame(void) {
+    const uint8_t* buffer = sim_host_vars.rx_buffer;
+    uint16_t length = sim_host_vars.rx_length;
+
+    // Command, address and CRC at least
+    if (length < 5) {
+        return;
+    }
+
+    // Check the CRC, which includes the two CRC bytes
+    crc16_init();
+    for (uint16_t i = 0; i < length; i++) {
+        crc16_push(buffer[i]);
+    }
+    if (!crc16_check()) {
+        return;
+    }
+
+    // Hand the message to whoever is interested
+    if (sim_host_vars.config.callback != NULL) {
+        sim_host_vars.config.callback(buffer[0], &buffer[3], length - 5);
+    }
+
+    switch (buffer[0]) {
+        case SIM_HOST_CMD_DATA:
+            if (sim_host_vars.config.mac_type == SIM_HOST_MAC_DQ) {
+                sim_host_dq(&buffer[3], length - 5);
+            } else {
+                sim_host_fsa(&buffer[3], length - 5);
+            }
+            break;
+        case SIM_HOST_CMD_RESET:
+            // The gateway resets and is started again once it boots
+            break;
+        default:
+            break;
+    }
+}
+
+static void sim_host_dq(const uint8_t* data, uint16_t length) {
+    sim_host_stats_t* stats = &sim_host_vars.stats;
+    sim_host_dq_t record;
+
+    if (length != sizeof(sim_host_dq_t)) {
+        return;
+    }
+    memcpy(&record, data, sizeof(sim_host_dq_t));
+
+    if (sim_host_vars.skip_record) {
+        sim_host_vars.skip_record = false;
+        return;
+    }
+
+    if (sim_host_vars.epoch == 0) {
+        sim_host_vars.epoch = sim.time;
+    }
+
+    // Account for the outcome of the three ARP slots and the DATA slot
+    for (uint8_t i = 0; i < 3; i++) {
+        if (record.arp_state[i] < SIM_HOST_OUTCOMES) {
+            stats->arp[record.arp_state[i]]++;
+        }
+    }
+    if (record.data_state < SIM_HOST_OUTCOMES) {
+        stats->data[record.data_state]++;
+    }
+    if (record.data_state == SIM_HOST_SUCCESS) {
+        sim_host_delivered(record.data_address);
+    }
+
+    // Account for the length of the queues
+    stats->crq_sum += record.crq_global;
+    stats->dtq_sum += record.dtq_global;
+    if (record.crq_global > stats->crq_max) {
+        stats->crq_max = record.crq_global;
+    }
+    if (record.dtq_global > stats->dtq_max) {
+        stats->dtq_max = record.dtq_global;
+    }
+
+    if (stats->frames == 0) {
+        stats->start_time = sim.time;
+    }
+    stats->end_time = sim.time;
+    stats->slots++;
+    stats->frames++;
+
+    if (stats->frames >= sim_host_vars.config.frames) {
+        sim_kernel_stop();
+    }
+}
+
+static void sim_host_fsa(const uint8_t* data, uint16_t length) {
+    sim_host_stats_t* stats = &sim_host_vars.stats;
+    sim_host_fsa_t record;
+
+    if (length != sizeof(sim_host_fsa_t)) {
+        return;
+    }
+    memcpy(&record, data, sizeof(sim_host_fsa_t));
+
+    if (sim_host_vars.epoch == 0) {
+        sim_host_vars.epoch = sim.time;
+    }
+
+    // Account for the outcome of the DATA slot
+    if (record.data_state < SIM_HOST_OUTCOMES) {
+        stats->data[record.data_state]++;
+    }
+    if (record.data_state == SIM_HOST_SUCCESS) {
+        sim_host_delivered(record.data_address);
+    }
+
+    if (stats->slots == 0) {
+        stats->start_time = sim.time;
+    }
+    stats->end_time = sim.time;
+    stats->slots++;
+
+    // The frame is over after its last slot
+    if (record.slot_count >= sim_host_vars.config.mac_slots) {
+        stats->frames++;
+        if (stats->frames >= sim_host_vars.config.frames) {
+            sim_kernel_stop();
+        }
+    }
+}
+
+static void sim_host_delivered(uint16_t address) {
+    sim_host_stats_t* stats = &sim_host_vars.stats;
+    uint64_t since, delay;
+    uint32_t index;
+
+    // Node addresses are their index plus one
+    if (address < 1 || address >= sim.node_count + 1) {
+        return;
+    }
+    index = address - 1;
+
+    // The access delay runs from the previous packet of the node, or from
+    // the first frame of the experiment if the node has not sent any yet
+    since = sim_host_vars.last_delivery[index];
+    if (since < sim_host_vars.epoch) {
+        since = sim_host_vars.epoch;
+    }
+    delay = sim.time - since;
+
+    stats->delivered[index]++;
+    stats->delay_sum += delay;
+    if (delay > stats->delay_max) {
+        stats->delay_max = delay;
+    }
+    sim_host_vars.last_delivery[index] = sim.time;
+}
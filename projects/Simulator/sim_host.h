@@ -0,0 +1,69 @@
+/**
+ * @file       sim_host.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Host computer attached to the UART of the simulated gateway.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef SIM_HOST_H_
+#define SIM_HOST_H_
+
+/*================================ include ==================================*/
+
+#include "sim_kernel.h"
+
+/*================================ define ===================================*/
+
+// Outcome of an ARP or DATA slot, as reported by the gateway
+#define SIM_HOST_EMPTY                  ( 0 )
+#define SIM_HOST_COLLISION              ( 1 )
+#define SIM_HOST_SUCCESS                ( 2 )
+#define SIM_HOST_OUTCOMES               ( 3 )
+
+/*================================ typedef ==================================*/
+
+typedef void (* sim_host_cb_t)(uint8_t command, const uint8_t* data, uint16_t length);
+
+typedef struct {
+    uint8_t  mac_type;              ///< MAC_TYPE_FSA or MAC_TYPE_DQ
+    uint8_t  mac_slots;             ///< Number of FSA slots per frame
+    uint64_t frames;                ///< Number of frames to simulate
+    bool     record;                ///< Ask the gateway to record the radio events
+    sim_host_cb_t callback;         ///< Receives every message of the gateway, if any
+} sim_host_config_t;
+
+typedef struct {
+    uint64_t frames;                ///< Frames reported by the gateway
+    uint64_t slots;                 ///< DATA slots reported by the gateway
+    uint64_t arp[SIM_HOST_OUTCOMES];    ///< ARP slots by outcome (DQ)
+    uint64_t data[SIM_HOST_OUTCOMES];   ///< DATA slots by outcome
+    uint64_t crq_sum;               ///< Sum of the CRQ length over the frames (DQ)
+    uint64_t dtq_sum;               ///< Sum of the DTQ length over the frames (DQ)
+    uint16_t crq_max;               ///< Longest CRQ (DQ)
+    uint16_t dtq_max;               ///< Longest DTQ (DQ)
+    uint32_t starts;                ///< Experiments started on the gateway
+    uint64_t start_time;            ///< Time of the first frame (ns)
+    uint64_t end_time;              ///< Time of the last frame (ns)
+    uint64_t* delivered;            ///< DATA packets received from each node
+    uint64_t delay_sum;             ///< Sum of the access delays (ns)
+    uint64_t delay_max;             ///< Longest access delay (ns)
+} sim_host_stats_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void sim_host_init(const sim_host_config_t* config);
+void sim_host_boot(sim_node_t* node);
+void sim_host_event(uint32_t index);
+const sim_host_stats_t* sim_host_stats(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* SIM_HOST_H_ */
@@ -0,0 +1,597 @@
+/**
+ * @file       sim_kernel.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Discrete-event kernel that runs many firmware images at once.
+ *
+ *             Every node runs the unmodified firmware as a coroutine on its
+ *             own stack. A node executes in zero simulated time until it
+ *             waits for an interrupt (cpu_wait) or busy-waits on the
+ *             hardware (spin), then the kernel moves on to the next event.
+ *             All nodes built from the same image share its code and
+ *             sections, so the state of the node about to run is swapped
+ *             into the image only when a different node last ran there.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include <sys/mman.h>
+
+#include "sim_kernel.h"
+#include "sim_air.h"
+#include "sim_host.h"
+
+#include "host_include.h"
+
+/*================================ define ===================================*/
+
+#define SIM_STACK_SIZE                  ( 64 * 1024 )
+#define SIM_HEAP_SIZE                   ( 1024 )
+
+// Nodes power up at random within the first WOR listen period
+#define SIM_BOOT_SPREAD_NS              ( SIM_NS_PER_SECOND )
+#define SIM_REBOOT_NS                   ( 1000 * SIM_NS_PER_US )
+
+/*================================ typedef ==================================*/
+
+/*=============================== variables =================================*/
+
+sim_kernel_t sim;
+
+static sim_slot_t sim_slots[2];
+static uint64_t sim_random_state;
+
+/*=============================== prototypes ================================*/
+
+static void sim_slot_init(sim_slot_t* slot, const sim_image_t* image);
+static void sim_slot_load(sim_node_t* node);
+
+static void sim_node_boot(sim_node_t* node);
+static void sim_node_entry(void);
+static void sim_node_resume(sim_node_t* node);
+static void sim_node_yield(sim_node_t* node, sim_node_state_t status);
+static void sim_irq_dispatch(sim_node_t* node);
+
+static bool sim_event_before(const sim_event_t* a, const sim_event_t* b);
+static bool sim_event_pop(sim_event_t* event);
+
+/*================================= public ==================================*/
+
+void sim_kernel_init(const sim_image_t* gateway, const sim_image_t* node, uint32_t node_count, uint64_t seed) {
+    sim_node_t* current;
+    uint8_t* stacks;
+
+    // Initialize the memory of the kernel variables
+    memset(&sim, 0, sizeof(sim_kernel_t));
+    sim_random_state = seed;
+
+    // Capture the pristine state of the images before anything runs
+    sim_slot_init(&sim_slots[0], gateway);
+    sim_slot_init(&sim_slots[1], node);
+
+    // Allocate the event heap
+    sim.heap_size = SIM_HEAP_SIZE;
+    sim.heap = malloc(sim.heap_size * sizeof(sim_event_t));
+
+    // Allocate the nodes and their stacks, the stacks are only backed by
+    // memory as far as they are used
+    sim.node_count = node_count + 1;
+    sim.nodes = calloc(sim.node_count, sizeof(sim_node_t));
+    stacks = mmap(NULL, (size_t) sim.node_count * SIM_STACK_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (sim.heap == NULL || sim.nodes == NULL || stacks == MAP_FAILED) {
+        fprintf(stderr, "sim: unable to allocate %u nodes\n", sim.node_count);
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t i = 0; i < sim.node_count; i++) {
+        current = &sim.nodes[i];
+        current->index = i;
+        current->address = (uint16_t) (i + 1);
+        current->seed = (uint16_t) sim_random();
+        current->slot = (i == SIM_GATEWAY ? &sim_slots[0] : &sim_slots[1]);
+        current->state = malloc(current->slot->data_size + current->slot->bss_size);
+        current->stack = stacks + (size_t) i * SIM_STACK_SIZE;
+        current->radio_listener = -1;
+        if (current->state == NULL) {
+            fprintf(stderr, "sim: unable to allocate %u nodes\n", sim.node_count);
+            exit(EXIT_FAILURE);
+        }
+
+        // The gateway powers up first, the nodes at random afterwards
+        if (i == SIM_GATEWAY) {
+            sim_event_push(SIM_EVENT_BOOT, 0, i, 0);
+        } else {
+            sim_event_push(SIM_EVENT_BOOT, sim_random() % SIM_BOOT_SPREAD_NS, i, 0);
+        }
+    }
+}
+
+void sim_kernel_run(uint64_t limit_ns) {
+    sim_event_t event;
+    sim_node_t* node;
+
+    sim.limit = limit_ns;
+
+    while (!sim.stop && sim_event_pop(&event)) {
+        // Stop once the configured time has elapsed
+        if (sim.limit != 0 && event.time > sim.limit) {
+            break;
+        }
+
+        // Advance the simulated time to the event
+        sim.time = event.time;
+        sim.events++;
+
+        switch (event.type) {
+            case SIM_EVENT_BOOT:
+                sim_node_boot(&sim.nodes[event.index]);
+                break;
+            case SIM_EVENT_TIMER:
+                // The compare value has matched the tick counter
+                node = &sim.nodes[event.index];
+                if (node->status != SIM_NODE_OFF && event.cookie == node->timer_cookie) {
+                    node->irq_pending |= (1 << SIM_IRQ_SMTIM);
+                    sim_node_kick(node);
+                }
+                break;
+            case SIM_EVENT_MACTIMR:
+                // The compare value has matched the fine ticks
+                node = &sim.nodes[event.index];
+                if (node->status != SIM_NODE_OFF && event.cookie == node->mactimer_cookie) {
+                    node->irq_pending |= (1 << SIM_IRQ_MACTIMR);
+                    sim_node_kick(node);
+                }
+                break;
+            case SIM_EVENT_WAKE:
+                // The busy-wait is over
+                node = &sim.nodes[event.index];
+                if ((node->status == SIM_NODE_SPINNING || node->status == SIM_NODE_WAKING) &&
+                    event.cookie == node->wake_cookie) {
+                    sim_node_resume(node);
+                }
+                break;
+            case SIM_EVENT_AIR_START:
+                sim_air_start(event.index);
+                break;
+            case SIM_EVENT_AIR_SFD:
+                sim_air_sfd(event.index);
+                break;
+            case SIM_EVENT_AIR_END:
+                sim_air_end(event.index);
+                break;
+            case SIM_EVENT_HOST:
+                sim_host_event(event.index);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void sim_kernel_stop(void) {
+    sim.stop = true;
+}
+
+void sim_event_push(sim_event_type_t type, uint64_t time_ns, uint32_t index, uint32_t cookie) {
+    sim_event_t event;
+    uint32_t child, parent;
+
+    // Grow the heap when it is full
+    if (sim.heap_count == sim.heap_size) {
+        sim.heap_size *= 2;
+        sim.heap = realloc(sim.heap, sim.heap_size * sizeof(sim_event_t));
+        if (sim.heap == NULL) {
+            fprintf(stderr, "sim: unable to grow the event heap\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    event.time   = time_ns;
+    event.order  = sim.order++;
+    event.index  = index;
+    event.cookie = cookie;
+    event.type   = type;
+
+    // Sift the event up from the bottom of the heap
+    child = sim.heap_count++;
+    while (child > 0) {
+        parent = (child - 1) / 2;
+        if (!sim_event_before(&event, &sim.heap[parent])) {
+            break;
+        }
+        sim.heap[child] = sim.heap[parent];
+        child = parent;
+    }
+    sim.heap[child] = event;
+}
+
+void sim_node_kick(sim_node_t* node) {
+    // Nothing to do if the node has no interrupt to take
+    if ((node->irq_pending & node->irq_enabled) == 0) {
+        return;
+    }
+
+    // A waiting node always wakes up, which takes a while, the kernel counts
+    // it without running the node so that its state is only loaded once
+    if (node->status == SIM_NODE_WAITING && sim.latency > 0) {
+        node->status = SIM_NODE_WAKING;
+        node->wake_cookie++;
+        sim_event_push(SIM_EVENT_WAKE, sim.time + sim.latency, node->index, node->wake_cookie);
+        return;
+    }
+
+    // A busy-waiting node is preempted unless interrupts are masked or it is
+    // already in an interrupt
+    if (node->status == SIM_NODE_WAITING ||
+        (node->status == SIM_NODE_SPINNING && node->master_enabled && !node->in_isr)) {
+        sim_node_resume(node);
+    }
+}
+
+uint64_t sim_random(void) {
+    uint64_t z;
+
+    // SplitMix64, good enough to seed the nodes and draw the links
+    z = (sim_random_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+/*=========================== firmware interface ============================*/
+
+void sim_reset(void) {
+    sim_node_t* node = sim.current;
+
+    // Power down the node, everything it had scheduled is discarded
+    node->status = SIM_NODE_OFF;
+    node->timer_cookie++;
+    node->mactimer_cookie++;
+    node->wake_cookie++;
+    sim_air_node_off(node);
+
+    // Boot again after a while, without ever returning to the firmware
+    sim_event_push(SIM_EVENT_BOOT, sim.time + SIM_REBOOT_NS, node->index, 0);
+    _longjmp(sim.context, 1);
+}
+
+void sim_wait(void) {
+    sim_node_t* node = sim.current;
+
+    // An interrupt that is already pending wakes up the CPU immediately,
+    // otherwise sim_node_kick resumes the node once it has woken up
+    if ((node->irq_pending & node->irq_enabled) == 0) {
+        sim_node_yield(node, SIM_NODE_WAITING);
+    }
+
+    sim_irq_dispatch(node);
+}
+
+void sim_spin(uint64_t duration_ns) {
+    sim_spin_until(sim.time + duration_ns);
+}
+
+void sim_spin_until(uint64_t time_ns) {
+    sim_node_t* node = sim.current;
+
+    // Interrupts can preempt the busy-wait, and they can busy-wait too,
+    // so the wake-up is scheduled again after each one of them
+    while (sim.time < time_ns) {
+        node->wake_cookie++;
+        sim_event_push(SIM_EVENT_WAKE, time_ns, node->index, node->wake_cookie);
+        sim_node_yield(node, SIM_NODE_SPINNING);
+        sim_irq_dispatch(node);
+    }
+
+    sim_irq_dispatch(node);
+}
+
+uint64_t sim_time_get(void) {
+    return sim.time;
+}
+
+uint64_t sim_ticks_get(void) {
+    uint64_t seconds, fraction;
+
+    // Split to avoid overflowing the 64-bit intermediate product
+    seconds  = sim.time / SIM_NS_PER_SECOND;
+    fraction = sim.time % SIM_NS_PER_SECOND;
+
+    return (seconds * SIM_TICKS_PER_SECOND) +
+           (fraction * SIM_TICKS_PER_SECOND) / SIM_NS_PER_SECOND;
+}
+
+uint64_t sim_ticks_to_time(uint64_t ticks) {
+    uint64_t seconds, fraction;
+
+    seconds  = ticks / SIM_TICKS_PER_SECOND;
+    fraction = ticks % SIM_TICKS_PER_SECOND;
+
+    // Round up so that the tick counter has reached the value at that time
+    return (seconds * SIM_NS_PER_SECOND) +
+           (fraction * SIM_NS_PER_SECOND + SIM_TICKS_PER_SECOND - 1) / SIM_TICKS_PER_SECOND;
+}
+
+void sim_irq_register(sim_irq_t irq, sim_isr_t isr) {
+    sim.current->isr[irq] = isr;
+}
+
+void sim_irq_enable(sim_irq_t irq) {
+    sim.current->irq_enabled |= (1 << irq);
+}
+
+void sim_irq_disable(sim_irq_t irq) {
+    sim.current->irq_enabled &= ~(1 << irq);
+}
+
+void sim_irq_pend(sim_irq_t irq) {
+    sim.current->irq_pending |= (1 << irq);
+}
+
+void sim_irq_clear(sim_irq_t irq) {
+    sim.current->irq_pending &= ~(1 << irq);
+}
+
+void sim_irq_master_enable(void) {
+    sim.current->master_enabled = true;
+
+    // Pending interrupts are taken as soon as they are unmasked
+    sim_irq_dispatch(sim.current);
+}
+
+bool sim_irq_master_disable(void) {
+    bool disabled = !sim.current->master_enabled;
+
+    sim.current->master_enabled = false;
+
+    return disabled;
+}
+
+sim_irq_t sim_irq_active(void) {
+    return (sim.current->in_isr ? (sim_irq_t) sim.current->isr_active : SIM_IRQ_COUNT);
+}
+
+void sim_timer_set(uint64_t time_ns) {
+    sim_node_t* node = sim.current;
+
+    // Only the last compare value counts
+    node->timer_cookie++;
+    sim_event_push(SIM_EVENT_TIMER, time_ns, node->index, node->timer_cookie);
+}
+
+void sim_timer_cancel(void) {
+    sim.current->timer_cookie++;
+}
+
+uint64_t host_time_get(void) {
+    return sim.time;
+}
+
+void host_error(const char* reason) {
+    sim_node_t* node = sim.current;
+
+    // The firmware has locked up, which is a bug worth stopping for
+    fprintf(stderr, "sim: node %u (%s, 0x%04x) %s at %llu ticks\n",
+            node->index, node->slot->image->name, node->address,
+            reason, (unsigned long long) sim_ticks_get());
+    fflush(NULL);
+    exit(EXIT_FAILURE);
+}
+
+uint16_t host_seed(void) {
+    return sim.current->seed;
+}
+
+void host_eui64(uint8_t* address) {
+    const uint8_t oui[4] = HOST_EUI64_OUI;
+    uint16_t short_address = sim.current->address;
+
+    // The node address fills the last two bytes of the EUI64
+    memcpy(address, oui, sizeof(oui));
+    address[4] = 0x00;
+    address[5] = 0x00;
+    address[6] = (short_address >> 8) & 0xFF;
+    address[7] = (short_address >> 0) & 0xFF;
+}
+
+void host_mactimer_init(host_isr_t isr) {
+    sim_irq_register(SIM_IRQ_MACTIMR, isr);
+    sim_irq_enable(SIM_IRQ_MACTIMR);
+}
+
+void host_mactimer_set(uint64_t time_ns) {
+    sim_node_t* node = sim.current;
+
+    // Only the last compare value counts, one that has already passed
+    // matches right away
+    node->mactimer_cookie++;
+    if (time_ns <= sim.time) {
+        sim_irq_pend(SIM_IRQ_MACTIMR);
+    } else {
+        sim_event_push(SIM_EVENT_MACTIMR, time_ns, node->index, node->mactimer_cookie);
+    }
+}
+
+void host_mactimer_cancel(void) {
+    sim.current->mactimer_cookie++;
+    sim_irq_clear(SIM_IRQ_MACTIMR);
+}
+
+/*================================ private ==================================*/
+
+static void sim_slot_init(sim_slot_t* slot, const sim_image_t* image) {
+    slot->image     = image;
+    slot->data_size = image->data_end - image->data_start;
+    slot->bss_size  = image->bss_end - image->bss_start;
+    slot->resident  = NULL;
+
+    // Keep a copy of the initialized data and the zeroed bss
+    slot->pristine = malloc(slot->data_size + slot->bss_size);
+    if (slot->pristine == NULL) {
+        fprintf(stderr, "sim: unable to allocate the %s image\n", image->name);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(slot->pristine, image->data_start, slot->data_size);
+    memcpy(slot->pristine + slot->data_size, image->bss_start, slot->bss_size);
+}
+
+static void sim_slot_load(sim_node_t* node) {
+    sim_slot_t* slot = node->slot;
+    sim_node_t* resident = slot->resident;
+
+    if (resident == node) {
+        return;
+    }
+
+    // Save the state of the node that ran last from this image
+    if (resident != NULL) {
+        memcpy(resident->state, slot->image->data_start, slot->data_size);
+        memcpy(resident->state + slot->data_size, slot->image->bss_start, slot->bss_size);
+    }
+
+    // Restore the state of the node that is about to run
+    memcpy(slot->image->data_start, node->state, slot->data_size);
+    memcpy(slot->image->bss_start, node->state + slot->data_size, slot->bss_size);
+
+    slot->resident = node;
+    sim.state_swaps++;
+}
+
+static void sim_node_boot(sim_node_t* node) {
+    sim_slot_t* slot = node->slot;
+
+    // Reset the peripherals of the node
+    node->master_enabled = false;
+    node->in_isr         = false;
+    node->irq_enabled    = 0;
+    node->irq_pending    = 0;
+    memset(node->isr, 0, sizeof(node->isr));
+    node->timer_cookie++;
+    node->mactimer_cookie++;
+    node->wake_cookie++;
+    node->radio_irq = 0;
+    sim_air_node_off(node);
+
+    // Restore the state of the image as it was before running
+    memcpy(node->state, slot->pristine, slot->data_size + slot->bss_size);
+    if (slot->resident == node) {
+        slot->resident = NULL;
+    }
+
+    // Start executing the image from main on a fresh stack
+    getcontext(&node->entry);
+    node->entry.uc_stack.ss_sp   = node->stack;
+    node->entry.uc_stack.ss_size = SIM_STACK_SIZE;
+    node->entry.uc_link          = NULL;
+    makecontext(&node->entry, sim_node_entry, 0);
+
+    node->booting = true;
+    node->status = SIM_NODE_RUNNING;
+    node->boots++;
+
+    // Let the host know, it drives the gateway through the UART
+    sim_host_boot(node);
+
+    sim_node_resume(node);
+}
+
+static void sim_node_entry(void) {
+    sim_node_t* node = sim.current;
+
+    node->slot->image->main();
+
+    // The firmware is not supposed to return from main
+    host_error("returned from main");
+}
+
+static void sim_node_resume(sim_node_t* node) {
+    // Bring the state of the node into its image
+    sim_slot_load(node);
+    sim.current = node;
+
+    // Run the node until it waits, busy-waits or resets
+    if (_setjmp(sim.context) == 0) {
+        if (node->booting) {
+            node->booting = false;
+            setcontext(&node->entry);
+        } else {
+            _longjmp(node->context, 1);
+        }
+    }
+
+    sim.current = NULL;
+}
+
+static void sim_node_yield(sim_node_t* node, sim_node_state_t status) {
+    // Go back to the kernel, execution continues here on resume
+    node->status = status;
+    if (_setjmp(node->context) == 0) {
+        _longjmp(sim.context, 1);
+    }
+    node->status = SIM_NODE_RUNNING;
+}
+
+static void sim_irq_dispatch(sim_node_t* node) {
+    uint8_t active;
+    uint8_t irq;
+
+    // Interrupts do not nest and are masked by the master enable
+    if (!node->master_enabled || node->in_isr) {
+        return;
+    }
+
+    // Execute the pending interrupts by priority
+    while ((active = (node->irq_pending & node->irq_enabled)) != 0) {
+        for (irq = 0; (active & (1 << irq)) == 0; irq++);
+
+        node->irq_pending &= ~(1 << irq);
+
+        if (node->isr[irq] != NULL) {
+            node->in_isr = true;
+            node->isr_active = irq;
+            node->isr[irq]();
+            node->in_isr = false;
+        }
+    }
+}
+
+static bool sim_event_before(const sim_event_t* a, const sim_event_t* b) {
+    if (a->time != b->time) {
+        return a->time < b->time;
+    }
+    return a->order < b->order;
+}
+
+static bool sim_event_pop(sim_event_t* event) {
+    sim_event_t last;
+    uint32_t parent, child;
+
+    if (sim.heap_count == 0) {
+        return false;
+    }
+
+    // Take the earliest event and sift the last one down from the top
+    *event = sim.heap[0];
+    last = sim.heap[--sim.heap_count];
+
+    parent = 0;
+    while ((child = 2 * parent + 1) < sim.heap_count) {
+        if (child + 1 < sim.heap_count && sim_event_before(&sim.heap[child + 1], &sim.heap[child])) {
+            child++;
+        }
+        if (!sim_event_before(&sim.heap[child], &last)) {
+            break;
+        }
+        sim.heap[parent] = sim.heap[child];
+        parent = child;
+    }
+    sim.heap[parent] = last;
+
+    return true;
+}
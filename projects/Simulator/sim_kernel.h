@@ -0,0 +1,154 @@
+/**
+ * @file       sim_kernel.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      Discrete-event kernel that runs many firmware images at once.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef SIM_KERNEL_H_
+#define SIM_KERNEL_H_
+
+/*================================ include ==================================*/
+
+#include <setjmp.h>
+#include <ucontext.h>
+
+#include "sim_include.h"
+
+/*================================ define ===================================*/
+
+#define SIM_TIME_NONE                   ( UINT64_MAX )
+
+// The gateway is always the first node
+#define SIM_GATEWAY                     ( 0 )
+
+/*================================ typedef ==================================*/
+
+typedef struct sim_tx sim_tx_t;
+
+typedef enum {
+    SIM_NODE_OFF      = 0x00,
+    SIM_NODE_RUNNING  = 0x01,
+    SIM_NODE_WAITING  = 0x02,
+    SIM_NODE_SPINNING = 0x03,
+    SIM_NODE_WAKING   = 0x04
+} sim_node_state_t;
+
+typedef enum {
+    SIM_EVENT_BOOT      = 0x00,
+    SIM_EVENT_TIMER     = 0x01,
+    SIM_EVENT_WAKE      = 0x02,
+    SIM_EVENT_AIR_START = 0x03,
+    SIM_EVENT_AIR_SFD   = 0x04,
+    SIM_EVENT_AIR_END   = 0x05,
+    SIM_EVENT_HOST      = 0x06,
+    SIM_EVENT_MACTIMR   = 0x07
+} sim_event_type_t;
+
+typedef struct {
+    uint64_t time;                  ///< Time at which the event fires (ns)
+    uint64_t order;                 ///< Keeps events at the same time in FIFO order
+    uint32_t index;                 ///< Node or transmission the event refers to
+    uint32_t cookie;                ///< Discards events that have been superseded
+    sim_event_type_t type;
+} sim_event_t;
+
+/**
+ * Firmware image linked into the simulator, the state of the node that
+ * is resident lives in the image sections, the others in their own copy
+ */
+typedef struct sim_node sim_node_t;
+
+typedef struct {
+    const sim_image_t* image;
+    size_t      data_size;
+    size_t      bss_size;
+    uint8_t*    pristine;           ///< State of the image before it runs
+    sim_node_t* resident;           ///< Node whose state is in the image
+} sim_slot_t;
+
+struct sim_node {
+    uint32_t         index;
+    uint16_t         address;
+    uint16_t         seed;
+    sim_slot_t*      slot;
+    uint8_t*         state;         ///< Copy of .data and .bss when not resident
+    sim_node_state_t status;
+
+    // Execution context
+    jmp_buf    context;
+    ucontext_t entry;
+    uint8_t*   stack;
+    bool       booting;
+
+    // Interrupt controller
+    bool      master_enabled;
+    bool      in_isr;
+    uint8_t   isr_active;           ///< Interrupt being served, if in_isr
+    uint8_t   irq_enabled;
+    uint8_t   irq_pending;
+    sim_isr_t isr[SIM_IRQ_COUNT];
+
+    // Sleep timer, MAC timer and busy-waits
+    uint32_t timer_cookie;
+    uint32_t mactimer_cookie;
+    uint32_t wake_cookie;
+
+    // Radio, managed by the channel model
+    double            gain;         ///< Linear gain of the link to the gateway
+    uint8_t           radio_irq;
+    uint64_t          radio_sfd;    ///< Time of the last SFD raised
+    uint8_t           radio_channel;
+    int32_t           radio_listener;
+    uint64_t          radio_settled; ///< Time from which the receiver hears frames
+    sim_tx_t*         rx_lock;
+    double            rx_power;
+    bool              rx_corrupt;
+    sim_radio_frame_t rx_frame;
+
+    // Statistics
+    uint32_t boots;
+    uint32_t tx_frames;
+};
+
+typedef struct {
+    uint64_t     time;
+    uint64_t     limit;
+    uint64_t     order;
+    uint64_t     events;
+    sim_event_t* heap;
+    uint32_t     heap_count;
+    uint32_t     heap_size;
+    sim_node_t*  nodes;
+    uint32_t     node_count;
+    sim_node_t*  current;
+    jmp_buf      context;
+    bool         stop;
+    uint64_t     latency;           ///< Time to wake up and enter an interrupt (ns)
+    uint64_t     state_swaps;
+} sim_kernel_t;
+
+/*=============================== variables =================================*/
+
+extern sim_kernel_t sim;
+
+/*=============================== prototypes ================================*/
+
+void sim_kernel_init(const sim_image_t* gateway, const sim_image_t* node, uint32_t node_count, uint64_t seed);
+void sim_kernel_run(uint64_t limit_ns);
+void sim_kernel_stop(void);
+
+void sim_event_push(sim_event_type_t type, uint64_t time_ns, uint32_t index, uint32_t cookie);
+void sim_node_kick(sim_node_t* node);
+
+uint64_t sim_random(void);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* SIM_KERNEL_H_ */
@@ -13,6 +13,7 @@
 
 #include "mac.h"
 #include "dq.h"
+#include "dq_core.h"
 
 #include "scheduler.h"
 #include "library.h"
@@ -31,19 +32,21 @@
 #define DQ_DATA_DURATION                ( 152 )
 #define DQ_SIFS_DURATION                ( 16 )
 #define DQ_LIFS_DURATION                ( 32 )
-#define DQ_SLOT_DURATION                ( 1 * DQ_FBP_DURATION  + \
-                                          1 * DQ_LIFS_DURATION + \
-                                          1 * DQ_ARP_DURATION  + \
-                                          1 * DQ_SIFS_DURATION + \
-                                          1 * DQ_ARP_DURATION  + \
-                                          1 * DQ_SIFS_DURATION + \
-                                          1 * DQ_ARP_DURATION  + \
-                                          1 * DQ_SIFS_DURATION + \
-                                          1 * DQ_DATA_DURATION + \
-                                          1 * DQ_SIFS_DURATION   \
-                                        ) // 44 + 32 + 3 * 16 + 3 * 24 + 152 + 16 = 364
-#define DQ_ARP_COUNT                    ( 3 )
 
+// Start of each part of the slot, in ticks from the start of the FBP, which
+// is the anchor of the slot: FBP, SIFS, three times ARP and SIFS, DATA, LIFS
+#define DQ_FBP_OFFSET                   ( 0 )
+#define DQ_ARP_OFFSET(arp)              ( DQ_FBP_DURATION + DQ_SIFS_DURATION + \
+                                          (arp) * (DQ_ARP_DURATION + DQ_SIFS_DURATION) )
+#define DQ_DATA_OFFSET                  ( DQ_ARP_OFFSET(DQ_ARP_COUNT) )
+#define DQ_SLOT_DURATION                ( DQ_DATA_OFFSET + DQ_DATA_DURATION + DQ_LIFS_DURATION ) // 44 + 16 + 3 * (24 + 16) + 152 + 32 = 364
+
+// Ticks the nodes start listening before the FBP, for the drift of their clocks
+#define DQ_FBP_GUARD                    ( MAC_RADIO_IDLE_RX )
+
+// Guard times to prepare and process each part of the slot, also the ticks
+// that the tasks that start and end them may run after their timers expire,
+// the radio itself is started from the timer interrupt at the exact tick
 #if MAC_DEVICE == MAC_GATEWAY
 #define DQ_FBP_PREPARE                  ( 2 )
 #define DQ_FBP_PROCESS                  ( 2 )
@@ -62,6 +65,21 @@
 #error "MAC_DEVICE not defined."
 #endif
 
+// Microseconds the radio may take to start transmitting or receiving from the
+// timer interrupt, radio_transmit and radio_receive only issue the strobe and
+// return while the radio turns around
+#define DQ_RADIO_BUDGET_US              ( 50 )
+
+// Fine tick of the radio timer to start the radio so that it is transmitting
+// or receiving at the given tick
+#define DQ_RADIO_START(ticks)           ( RADIO_TIMER_TICKS(ticks) - RADIO_TIMER_US(MAC_RADIO_TURNAROUND_US) )
+
+// Forward the DATA frames that the gateway receives to the computer, the
+// serial queue holds the packet buffer instead of a copy of the frame
+#ifndef DQ_FORWARD_ENABLED
+#define DQ_FORWARD_ENABLED              ( 0 )
+#endif
+
 #define DQ_RADIO_CHANNEL                ( 26 )
 #define DQ_RSSI_THRESHOLD               ( -85 )
 #define DQ_UNSYNC_ERRORS                ( 8 )
@@ -70,35 +88,12 @@
 
 typedef uint8_t dq_arp_count_t;
 
-typedef uint16_t dq_arp_random_t;
-typedef uint16_t dq_crq_length_t;
-typedef uint16_t dq_dtq_length_t;
-
-typedef enum {
-    DQ_ARP_EMPTY     = 0x00,
-    DQ_ARP_COLLISION = 0x01,
-    DQ_ARP_SUCCESS   = 0x02,
-} dq_arp_state_t;
-
-typedef enum {
-    DQ_ARP_SLOT_0    = 0x00,
-    DQ_ARP_SLOT_1    = 0x01,
-    DQ_ARP_SLOT_2    = 0x02,
-    DQ_ARP_SLOT_SIZE = 0x03
-} dq_arp_slot_t;
-
 typedef enum {
     DQ_ARP_RSSI_NONE  = 0x00,
     DQ_ARP_RSSI_BELOW = 0x01,
     DQ_ARP_RSSI_ABOVE = 0x02
 } dq_arp_rssi_t;
 
-typedef enum {
-    DQ_DATA_EMPTY   = 0x00,
-    DQ_DATA_ERROR   = 0x01,
-    DQ_DATA_SUCCESS = 0x02
-} dq_data_state_t;
-
 typedef enum {
     DQ_NONE = 0x00,
     DQ_WOR  = 0x01,
@@ -118,12 +113,9 @@ typedef struct {
     mac_channel_t next_channel;     ///< The next channel
 
     uint8_t arp_count;              ///<
-    uint8_t arp_selected;           ///<
-    uint8_t arp_transmitted;        ///<
-
     int8_t arp_rssi;                ///<
     int8_t arp_rssi_threshold;      ///<
-    dq_arp_random_t arp_random;     ///<
+    int8_t arp_rssi_slot[DQ_ARP_COUNT]; ///< The RSSI of each ARP
 
     uint8_t arp_total;              ///<
     uint8_t crq_wait;               ///<
@@ -131,26 +123,13 @@ typedef struct {
 
     uint8_t unsync_error;           ///< The number of unsynchronization errors
 
-    dq_crq_length_t crq_local;      ///< The local value of the CRQ
-    dq_crq_length_t pcrq_local;     ///< The local pointer to the CRQ
-    dq_dtq_length_t dtq_local;      ///< The local value of the DTQ
-    dq_dtq_length_t pdtq_local;     ///< The local pointer to the DTQ
-
-    dq_arp_state_t arp1_state;      ///< The state of ARP #1
-    dq_arp_random_t arp1_random;    ///< The value of the ARP #1
-    dq_arp_rssi_t arp1_rssi;        ///< The RSSI of ARP #1
-    dq_arp_state_t arp2_state;      ///< The state of ARP #2
-    dq_arp_random_t arp2_random;    ///< The value of the ARP #2
-    dq_arp_rssi_t arp2_rssi;        ///< The value of the ARP #2
-    dq_arp_state_t arp3_state;      ///< The state of ARP #3
-    dq_arp_random_t arp3_random;    ///< The value of the ARP #3
-    dq_arp_rssi_t arp3_rssi;        ///< The value of the ARP #3
-
-    dq_data_state_t data_state;     ///<
+    dq_queue_t queue;               ///< The local CRQ and DTQ and the position in them
+    dq_feedback_t feedback;         ///< The ARP and DATA states and the global CRQ and DTQ
+
     mac_address_t data_address;     ///<
+    bool data_pending;              ///< The DATA sent waits for the next FBP
 
-    dq_crq_length_t crq_global;     ///< The global value of the CRQ
-    dq_dtq_length_t dtq_global;     ///< The global value of the DTQ
+    bsp_timer_width_t slot;         ///< Tick at which the current slot started
 } dq_vars_t;
 
 /**
@@ -251,12 +230,15 @@ static void dq_arp_done(void);
 static void dq_data_init(void);
 static void dq_data_done(void);
 
+static void dq_radio_error(radio_error_t error);
+
 #if (MAC_DEVICE == MAC_GATEWAY)
 static void dq_arp_rx_init(void);
 static void dq_arp_rx_rssi(void);
 static void dq_arp_rx_done(void);
 static void dq_data_rx_init(void);
 static void dq_data_rx_done(void);
+static void dq_data_rx_packet(packet_buffer_t* packet_buffer);
 static void dq_fbp_tx_init(void);
 static void dq_fbp_tx_done(void);
 
@@ -265,6 +247,7 @@ static void dq_vars_log(void);
 #elif (MAC_DEVICE == MAC_NODE)
 static void dq_fbp_rx_init(void);
 static void dq_fbp_rx_done(void);
+static void dq_fbp_rx_packet(packet_buffer_t* packet_buffer);
 static void dq_arp_tx_init(void);
 static void dq_arp_tx_done(void);
 static void dq_data_tx_init(void);
@@ -275,15 +258,8 @@ static void dq_arp_vars_reset(void);
 static void dq_data_vars_reset(void);
 
 static void dq_vars_update(dq_fbp_t* dq_fbp);
-
-static bool dq_rtr_check(void);
-static bool dq_dtr_check(void);
-static bool dq_qdr_check(void);
-static void dq_qdr_update(void);
 #endif
 
-static void dq_qdr_rules(void);
-
 /*================================= public ==================================*/
 
 /**
@@ -302,6 +278,13 @@ void dq_init(void) {
  * @brief Funtion to start DQ operation
  */
 void dq_start(void) {
+    // The first slot starts once the radio is ready, the nodes anchor it to
+    // the FBP they receive
+    dq_vars.slot = bsp_timer_get() + MAC_RADIO_IDLE_TX + DQ_FBP_PREPARE;
+
+    // Be told when the radio loses a frame
+    radio_set_error_cb(dq_radio_error);
+
     // Schedule the task to start the MAC
     scheduler_push(dq_fbp_init, TASK_PRIO_MAX);
 }
@@ -315,53 +298,58 @@ static void dq_fbp_init(void) {
     dq_fbp_t* dq_fbp = NULL;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_FBP, 0);
     debug_user_on();
 
-    // Obtain a queue entry
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    dq_fbp = (dq_fbp_t *) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(dq_fbp_t);
-
-    // Prepare the FBP
-    dq_fbp->packet_type = DQ_FBP;
-    dq_fbp->source = dq_vars.mac_address;
-    dq_fbp->destination = MAC_ADDR_BCAST;
-    dq_fbp->seq_number = dq_vars.seq_number;
-    dq_fbp->arp1_state = dq_vars.arp1_state;
-    dq_fbp->arp1_random = dq_vars.arp1_random;
-    dq_fbp->arp2_state = dq_vars.arp2_state;
-    dq_fbp->arp2_random = dq_vars.arp2_random;
-    dq_fbp->arp3_state = dq_vars.arp3_state;
-    dq_fbp->arp3_random = dq_vars.arp3_random;
-    dq_fbp->data_state = dq_vars.data_state;
-    dq_fbp->crq_global = dq_vars.crq_global;
-    dq_fbp->dtq_global = dq_vars.dtq_global;
-    dq_fbp->arp_count = dq_vars.arp_count;
-    dq_fbp->next_channel = dq_vars.next_channel;
-
-    // Set the radio transmit callback
-    radio_set_tx_cb(dq_fbp_tx_init, dq_fbp_tx_done);
-
-    // Put the FBP in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
-
-    // Wait for the duration of a FBP
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, DQ_FBP_DURATION, dq_fbp_done, TASK_PRIO_MAX);
+    // Obtain a queue entry, nothing is sent without one
+    mac_vars.queue_mac_tx = packet_buffer_get(sizeof(dq_fbp_t));
+    if (mac_vars.queue_mac_tx != NULL) {
+        dq_fbp = (dq_fbp_t *) mac_vars.queue_mac_tx->payload;
+        mac_vars.queue_mac_tx->length = sizeof(dq_fbp_t);
+
+        // Prepare the FBP
+        dq_fbp->packet_type = DQ_FBP;
+        dq_fbp->source = dq_vars.mac_address;
+        dq_fbp->destination = MAC_ADDR_BCAST;
+        dq_fbp->seq_number = dq_vars.seq_number;
+        dq_fbp->arp1_state = dq_vars.feedback.arp_state[0];
+        dq_fbp->arp1_random = dq_vars.feedback.arp_random[0];
+        dq_fbp->arp2_state = dq_vars.feedback.arp_state[1];
+        dq_fbp->arp2_random = dq_vars.feedback.arp_random[1];
+        dq_fbp->arp3_state = dq_vars.feedback.arp_state[2];
+        dq_fbp->arp3_random = dq_vars.feedback.arp_random[2];
+        dq_fbp->data_state = dq_vars.feedback.data_state;
+        dq_fbp->crq_global = dq_vars.feedback.crq_global;
+        dq_fbp->dtq_global = dq_vars.feedback.dtq_global;
+        dq_fbp->arp_count = dq_vars.arp_count;
+        dq_fbp->next_channel = dq_vars.next_channel;
+
+        // Set the radio transmit callback
+        radio_set_tx_cb(dq_fbp_tx_init, dq_fbp_tx_done);
+
+        // Put the FBP in the radio and transmit it at the start of the slot
+        radio_put_packet(mac_vars.queue_mac_tx);
+        virtual_timer_start_isr_at(DQ_RADIO_START(dq_vars.slot + DQ_FBP_OFFSET), radio_transmit, DQ_RADIO_BUDGET_US, NULL, 0);
+    }
+
+    // Wait for the end of the FBP
+    virtual_timer_start_deadline_at(dq_vars.slot + DQ_FBP_OFFSET + DQ_FBP_DURATION, dq_fbp_done, DQ_FBP_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_fbp_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void dq_fbp_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void dq_fbp_done(void) {
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t expiry;
 
     debug_user_on();
 
@@ -379,66 +367,72 @@ static void dq_fbp_done(void) {
     // Reset the ALP variables
     dq_vars_reset();
 
-    // Wait SIFS to start the ARP
-    ticks = DQ_SIFS_DURATION - MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
+    // Wait for the start of the first ARP
+    expiry = dq_vars.slot + DQ_ARP_OFFSET(0) - MAC_RADIO_IDLE_RX - DQ_ARP_PREPARE;
+    virtual_timer_start_deadline_at(expiry, dq_arp_init, DQ_ARP_PREPARE);
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_FBP, 0);
 }
 
 static void dq_arp_init(void) {
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t start;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_ARP, 0);
     debug_user_on();
 
     // Set the radio receive callbacks
     radio_set_rx_cb(dq_arp_rx_init, dq_arp_rx_done);
 
-    // Put the radio to receive
-    radio_receive();
+    // Put the radio to receive at the start of the ARP
+    start = dq_vars.slot + DQ_ARP_OFFSET(DQ_ARP_COUNT - dq_vars.arp_count);
+    virtual_timer_start_isr_at(DQ_RADIO_START(start), radio_receive, DQ_RADIO_BUDGET_US, NULL, 0);
 
-    // Wait for the duration of an ARP
-    ticks = (DQ_ARP_DURATION >> 1);
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_rx_rssi, TASK_PRIO_MAX);
+    // Wait for the middle of the ARP to read the RSSI
+    virtual_timer_start_deadline_at(start + (DQ_ARP_DURATION >> 1), dq_arp_rx_rssi, DQ_ARP_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_arp_rx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 }
 
 static void dq_arp_rx_rssi(void) {
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t start;
 
     debug_user_on();
 
     // Read and convert the RSSI
     radio_read_rssi(&dq_vars.arp_rssi);
 
-    // Wait for the duration of an ARP
-    ticks = (DQ_ARP_DURATION >> 1) - 1;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_done, TASK_PRIO_MAX);
+    // Wait for the end of the ARP
+    start = dq_vars.slot + DQ_ARP_OFFSET(DQ_ARP_COUNT - dq_vars.arp_count);
+    virtual_timer_start_deadline_at(start + DQ_ARP_DURATION, dq_arp_done, DQ_ARP_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_arp_rx_done(void) {
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    // Get the packet from the radio, if there is a buffer for it
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(dq_arp_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, NULL);
+    }
 
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
 }
 
 static void dq_arp_done(void) {
     dq_arp_t* dq_arp = NULL;
     dq_arp_state_t* current_arp_state = NULL;
-    dq_arp_rssi_t* current_arp_rssi = NULL;
+    dq_arp_rssi_t current_arp_rssi;
     uint16_t* current_arp_random = NULL;
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t expiry;
     uint8_t current_arp = 0;
 
     debug_user_on();
@@ -449,35 +443,18 @@ static void dq_arp_done(void) {
 
     // Know which ARP we are currently processing and point to it
     current_arp = DQ_ARP_COUNT - dq_vars.arp_count;
-    switch(current_arp) {
-        case 0:
-            current_arp_state = &dq_vars.arp1_state;
-            current_arp_rssi = &dq_vars.arp1_rssi;
-            current_arp_random = &dq_vars.arp1_random;
-            break;
-        case 1:
-            current_arp_state = &dq_vars.arp2_state;
-            current_arp_rssi = &dq_vars.arp2_rssi;
-            current_arp_random = &dq_vars.arp2_random;
-            break;
-        case 2:
-            current_arp_state = &dq_vars.arp3_state;
-            current_arp_rssi = &dq_vars.arp3_rssi;
-            current_arp_random = &dq_vars.arp3_random;
-            break;
-        default:
-            break;
-    }
+    current_arp_state = &dq_vars.feedback.arp_state[current_arp];
+    current_arp_random = &dq_vars.feedback.arp_random[current_arp];
 
     // Check if the RSSI is above the threshold
     if (dq_vars.arp_rssi > dq_vars.arp_rssi_threshold) {
-        *current_arp_rssi = DQ_ARP_RSSI_ABOVE;
+        current_arp_rssi = DQ_ARP_RSSI_ABOVE;
     } else {
-        *current_arp_rssi = DQ_ARP_RSSI_BELOW;
+        current_arp_rssi = DQ_ARP_RSSI_BELOW;
     }
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (mac_vars.queue_mac_rx != NULL && mac_vars.queue_mac_rx->crc) {
         // Convert the packet to a ARP packet
         dq_arp = (dq_arp_t *) mac_vars.queue_mac_rx->payload;
         if (dq_arp->packet_type == DQ_ARP) {
@@ -488,7 +465,7 @@ static void dq_arp_done(void) {
             *current_arp_random = 0;
         }
     } else {
-        if (*current_arp_rssi == DQ_ARP_RSSI_ABOVE) {
+        if (current_arp_rssi == DQ_ARP_RSSI_ABOVE) {
             *current_arp_state = DQ_ARP_COLLISION;
             *current_arp_random = 0;
         } else {
@@ -498,7 +475,7 @@ static void dq_arp_done(void) {
     }
 
     // Store the RSSI to send it through UART
-    *current_arp_rssi = dq_vars.arp_rssi;
+    dq_vars.arp_rssi_slot[current_arp] = dq_vars.arp_rssi;
 
     // Free the queue entry
     packet_buffer_release(mac_vars.queue_mac_rx);
@@ -509,69 +486,78 @@ static void dq_arp_done(void) {
 
     // Schedule the next action, ARP or DATA
     if (dq_vars.arp_count == 0) {
-        ticks = DQ_SIFS_DURATION - MAC_RADIO_IDLE_TX - DQ_ARP_PREPARE - DQ_ARP_PROCESS;
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_data_init, TASK_PRIO_MAX);
+        expiry = dq_vars.slot + DQ_DATA_OFFSET - MAC_RADIO_IDLE_RX - DQ_DATA_PREPARE;
+        virtual_timer_start_deadline_at(expiry, dq_data_init, DQ_DATA_PREPARE);
     } else {
-        ticks = DQ_SIFS_DURATION - MAC_RADIO_IDLE_RX - 2*DQ_ARP_PREPARE - DQ_ARP_PROCESS;
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
+        expiry = dq_vars.slot + DQ_ARP_OFFSET(DQ_ARP_COUNT - dq_vars.arp_count) - MAC_RADIO_IDLE_RX - DQ_ARP_PREPARE;
+        virtual_timer_start_deadline_at(expiry, dq_arp_init, DQ_ARP_PREPARE);
     }
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_ARP, 0);
 }
 
 static void dq_data_init(void) {
-    virtual_timer_width_t ticks;
-
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_DATA, 0);
     debug_user_on();
 
     // Set the radio receive callbacks
     radio_set_rx_cb(dq_data_rx_init, dq_data_rx_done);
 
-    // Put the radio to receive
-    radio_receive();
+    // Put the radio to receive at the start of the DATA
+    virtual_timer_start_isr_at(DQ_RADIO_START(dq_vars.slot + DQ_DATA_OFFSET), radio_receive, DQ_RADIO_BUDGET_US, NULL, 0);
 
-    // Wait for the duration of a DATA packet
-    ticks = DQ_DATA_DURATION;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_data_done, TASK_PRIO_MAX);
+    // Wait for the end of the DATA
+    virtual_timer_start_deadline_at(dq_vars.slot + DQ_DATA_OFFSET + DQ_DATA_DURATION, dq_data_done, DQ_DATA_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_data_rx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 }
 
 static void dq_data_rx_done(void) {
-    dq_data_t* dq_data = NULL;
+    // Get the packet from the radio, if there is a buffer for it, it is
+    // checked once it is in the buffer
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(dq_data_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, dq_data_rx_packet);
+    } else {
+        dq_vars.feedback.data_state = DQ_DATA_ERROR;
+        dq_vars.data_address = 0x00;
+    }
 
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
+}
+
+static void dq_data_rx_packet(packet_buffer_t* packet_buffer) {
+    dq_data_t* dq_data = NULL;
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (packet_buffer->crc) {
         // Convert the packet to a data packet
-        dq_data = (dq_data_t *) mac_vars.queue_mac_rx->payload;
+        dq_data = (dq_data_t *) packet_buffer->payload;
 
         if (dq_data->packet_type == DQ_DATA) {
-            dq_vars.data_state   = DQ_DATA_SUCCESS;
+            dq_vars.feedback.data_state = DQ_DATA_SUCCESS;
             dq_vars.data_address = dq_data->source;
             dq_vars.arp_total    = dq_data->arp_total;
             dq_vars.crq_wait     = dq_data->crq_wait;
             dq_vars.dtq_wait     = dq_data->dtq_wait;
         }
     } else {
-        dq_vars.data_state   = DQ_DATA_ERROR;
+        dq_vars.feedback.data_state = DQ_DATA_ERROR;
         dq_vars.data_address = 0x00;
     }
-
-    debug_radio_off();
 }
 
 static void dq_data_done(void) {
-    bsp_timer_width_t ticks;
+    bsp_timer_width_t expiry;
 
     debug_user_on();
 
@@ -579,16 +565,25 @@ static void dq_data_done(void) {
     radio_idle();
     radio_cancel_rx_cb();
 
-    // Free the queue entry
+#if DQ_FORWARD_ENABLED
+    // Forward the frame received, the frame is dropped if the serial queue
+    // is full
+    if (mac_vars.queue_mac_rx != NULL && mac_vars.queue_mac_rx->crc &&
+        dq_vars.feedback.data_state == DQ_DATA_SUCCESS) {
+        serial_push_slice(SERIAL_MOTE2PC_FRAME, mac_vars.queue_mac_rx, 0, mac_vars.queue_mac_rx->length);
+    }
+#endif
+
+    // Release the queue entry, the serial queue may still hold it
     packet_buffer_release(mac_vars.queue_mac_rx);
     mac_vars.queue_mac_rx = NULL;
 
     // Apply the QDR rules to the local CRQ and DTQ counters
-    dq_qdr_rules();
+    dq_core_rules(&dq_vars.queue, &dq_vars.feedback);
 
     // Update the CRQ and DTQ global counters based on the QDR rules
-    dq_vars.crq_global = dq_vars.crq_local;
-    dq_vars.dtq_global = dq_vars.dtq_local;
+    dq_vars.feedback.crq_global = dq_vars.queue.crq_local;
+    dq_vars.feedback.dtq_global = dq_vars.queue.dtq_local;
 
     // Move to the next channel previous to change it
     // radio_set_channel(dq_vars.next_channel);
@@ -601,32 +596,30 @@ static void dq_data_done(void) {
     // Update the debug variables
     dq_vars_log();
 
-    // Wait LIFS to start FBP
-    ticks = DQ_LIFS_DURATION - MAC_RADIO_IDLE_TX - DQ_DATA_PREPARE - DQ_DATA_PROCESS;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
+    // Wait for the FBP that starts the next slot
+    dq_vars.slot += DQ_SLOT_DURATION;
+    expiry = dq_vars.slot + DQ_FBP_OFFSET - MAC_RADIO_IDLE_TX - DQ_FBP_PREPARE;
+    virtual_timer_start_deadline_at(expiry, dq_fbp_init, DQ_FBP_PREPARE);
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_DATA, 0);
 }
 
 static void dq_vars_reset(void) {
-    dq_vars.arp_count = DQ_ARP_COUNT;
-
-    dq_vars.arp1_state  = DQ_ARP_EMPTY;
-    dq_vars.arp1_rssi   = DQ_ARP_RSSI_NONE;
-    dq_vars.arp1_random = 0;
+    uint8_t i;
 
-    dq_vars.arp2_state  = DQ_ARP_EMPTY;
-    dq_vars.arp2_rssi   = DQ_ARP_RSSI_NONE;
-    dq_vars.arp2_random = 0;
+    dq_vars.arp_count = DQ_ARP_COUNT;
 
-    dq_vars.arp3_state  = DQ_ARP_EMPTY;
-    dq_vars.arp3_rssi   = DQ_ARP_RSSI_NONE;
-    dq_vars.arp3_random = 0;
+    for (i = 0; i < DQ_ARP_COUNT; i++) {
+        dq_vars.feedback.arp_state[i]  = DQ_ARP_EMPTY;
+        dq_vars.feedback.arp_random[i] = 0;
+        dq_vars.arp_rssi_slot[i]       = DQ_ARP_RSSI_NONE;
+    }
 
     dq_vars.arp_rssi_threshold = DQ_RSSI_THRESHOLD;
 
-    dq_vars.data_state   = DQ_DATA_EMPTY;
+    dq_vars.feedback.data_state = DQ_DATA_EMPTY;
     dq_vars.data_address = 0;
 
     dq_vars.arp_total = 0;
@@ -637,42 +630,43 @@ static void dq_vars_reset(void) {
 static void dq_vars_log(void) {
     dq_debug_serial.mac_type = MAC_TYPE_DQ;
 
-    dq_debug_serial.arp1_state  = dq_vars.arp1_state;
-    dq_debug_serial.arp1_random = dq_vars.arp1_random;
-    dq_debug_serial.arp1_rssi   = dq_vars.arp1_rssi;
-    dq_debug_serial.arp2_state  = dq_vars.arp2_state;
-    dq_debug_serial.arp2_random = dq_vars.arp2_random;
-    dq_debug_serial.arp2_rssi   = dq_vars.arp2_rssi;
-    dq_debug_serial.arp3_state  = dq_vars.arp3_state;
-    dq_debug_serial.arp3_random = dq_vars.arp3_random;
-    dq_debug_serial.arp3_rssi   = dq_vars.arp3_rssi;
-
-    dq_debug_serial.data_state   = dq_vars.data_state;
+    dq_debug_serial.arp1_state  = dq_vars.feedback.arp_state[0];
+    dq_debug_serial.arp1_random = dq_vars.feedback.arp_random[0];
+    dq_debug_serial.arp1_rssi   = dq_vars.arp_rssi_slot[0];
+    dq_debug_serial.arp2_state  = dq_vars.feedback.arp_state[1];
+    dq_debug_serial.arp2_random = dq_vars.feedback.arp_random[1];
+    dq_debug_serial.arp2_rssi   = dq_vars.arp_rssi_slot[1];
+    dq_debug_serial.arp3_state  = dq_vars.feedback.arp_state[2];
+    dq_debug_serial.arp3_random = dq_vars.feedback.arp_random[2];
+    dq_debug_serial.arp3_rssi   = dq_vars.arp_rssi_slot[2];
+
+    dq_debug_serial.data_state   = dq_vars.feedback.data_state;
     dq_debug_serial.data_address = dq_vars.data_address;
 
     dq_debug_serial.arp_total = dq_vars.arp_total;
     dq_debug_serial.crq_wait  = dq_vars.crq_wait;
     dq_debug_serial.dtq_wait  = dq_vars.dtq_wait;
 
-    dq_debug_serial.crq_local  = dq_vars.crq_local;
-    dq_debug_serial.crq_global = dq_vars.crq_global;
-    dq_debug_serial.pcrq_local = dq_vars.pcrq_local;
+    dq_debug_serial.crq_local  = dq_vars.queue.crq_local;
+    dq_debug_serial.crq_global = dq_vars.feedback.crq_global;
+    dq_debug_serial.pcrq_local = dq_vars.queue.pcrq_local;
 
-    dq_debug_serial.dtq_global = dq_vars.dtq_global;
-    dq_debug_serial.dtq_local  = dq_vars.dtq_global;
-    dq_debug_serial.pdtq_local = dq_vars.pdtq_local;
+    dq_debug_serial.dtq_global = dq_vars.feedback.dtq_global;
+    dq_debug_serial.dtq_local  = dq_vars.feedback.dtq_global;
+    dq_debug_serial.pdtq_local = dq_vars.queue.pdtq_local;
 }
 #endif /* MAC_DEVICE == MAC_GATEWAY */
 
 // If the device type is END NODE
 #if (MAC_DEVICE == MAC_NODE)
 
-virtual_timer_id_t virtual_timer_id;
+static virtual_timer_id_t virtual_timer_id;
 
 static void dq_fbp_init(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_FBP, 0);
     debug_user_on();
 
     // Restore the variable values
@@ -683,7 +677,7 @@ static void dq_fbp_init(void) {
 
     // Register and start the radio timer callback
     ticks = DQ_FBP_DURATION << 4;
-    virtual_timer_id = virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_done, TASK_PRIO_MAX);
+    virtual_timer_id = virtual_timer_start_deadline(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_done, DQ_FBP_PROCESS);
 
     // Put the radio to receive
     radio_receive();
@@ -692,29 +686,36 @@ static void dq_fbp_init(void) {
 }
 
 static void dq_fbp_rx_init(void) {
-    virtual_timer_width_t ticks;
-
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 
-    // Start the radio timer callback
-    ticks = DQ_FBP_DURATION - 2 * MAC_RADIO_PHY_HEADER - MAC_RADIO_IDLE_RX,
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_done, TASK_PRIO_MAX);
+    // Anchor the slot to the SFD of the FBP and wait for its end
+    dq_vars.slot = radio_get_sfd() - MAC_RADIO_PHY_HEADER;
+    virtual_timer_start_deadline_at(dq_vars.slot + DQ_FBP_OFFSET + DQ_FBP_DURATION, dq_fbp_done, DQ_FBP_PROCESS);
 
     // Stop the old virtual timer
     virtual_timer_stop(virtual_timer_id);
 }
 
 static void dq_fbp_rx_done(void) {
-    dq_fbp_t* dq_fbp = NULL;
+    // Get the packet from the radio, if there is a buffer for it, it is
+    // checked once it is in the buffer
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(dq_fbp_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, dq_fbp_rx_packet);
+    }
 
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
+}
+
+static void dq_fbp_rx_packet(packet_buffer_t* packet_buffer) {
+    dq_fbp_t* dq_fbp = NULL;
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (packet_buffer->crc) {
         // Convert the packet to a FBP
-        dq_fbp = (dq_fbp_t *) mac_vars.queue_mac_rx->payload;
+        dq_fbp = (dq_fbp_t *) packet_buffer->payload;
 
         // If we really got a FBP
         if (dq_fbp->packet_type == DQ_FBP) {
@@ -722,12 +723,12 @@ static void dq_fbp_rx_done(void) {
             dq_vars_update(dq_fbp);
         }
     }
-
-    debug_radio_off();
 }
 
 static void dq_fbp_done(void) {
     virtual_timer_width_t ticks;
+    bsp_timer_width_t expiry;
+    dq_action_t action;
 
     debug_user_on();
 
@@ -739,6 +740,18 @@ static void dq_fbp_done(void) {
     packet_buffer_release(mac_vars.queue_mac_rx);
     mac_vars.queue_mac_rx = NULL;
 
+    // Settle the DATA sent in the last slot, the FBP tells whether the
+    // gateway received it, otherwise it is sent again
+    if (dq_vars.data_pending) {
+        if (dq_vars.packet_type == DQ_FBP &&
+            dq_vars.feedback.data_state == DQ_DATA_SUCCESS) {
+            app_queue_commit();
+        } else {
+            app_queue_requeue();
+        }
+        dq_vars.data_pending = false;
+    }
+
     // If we are unsynchronized get the DTQ and CRQ values
     if (mac_vars.mac_state == MAC_STATE_UNSYNC) {
         // Reset the ARP and DATA-related variables
@@ -754,11 +767,11 @@ static void dq_fbp_done(void) {
         // We reset the unsynchronized errors variable
         dq_vars.unsync_error = DQ_UNSYNC_ERRORS;
 
-        // Apply the QDR rules
-        dq_qdr_rules();
+        // Apply the QDR rules and update the DTQ and CRQ
+        action = dq_core_step(&dq_vars.queue, &dq_vars.feedback);
 
         // Check if the DTQ and CRQ values are NOT consistent
-        if (!dq_qdr_check()) {
+        if (action == DQ_ACTION_UNSYNC) {
             // Notify we have lost synchronization
             mac_toggle_synchronized(MAC_STATE_UNSYNC);
 
@@ -767,46 +780,39 @@ static void dq_fbp_done(void) {
             radio_cancel_tx_cb();
 
             // Register and start the radio timer callback
-            ticks = DQ_SLOT_DURATION - DQ_FBP_DURATION - 2 * MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-            virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
+            expiry = dq_vars.slot + DQ_SLOT_DURATION - DQ_FBP_GUARD - MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE;
+            virtual_timer_start_deadline_at(expiry, dq_fbp_init, DQ_FBP_PREPARE);
         } else {
-            // Update the DTQ and CRQ
-            dq_qdr_update();
-
             // Update the CRQ and DTQ wait states
-            if (dq_vars.crq_local != 0) {
+            if (dq_vars.queue.crq_local != 0) {
                 dq_vars.crq_wait++;
-            } else if (dq_vars.dtq_local != 0) {
+            } else if (dq_vars.queue.dtq_local != 0) {
                 dq_vars.dtq_wait++;
             }
 
-            // Check if we are allowed to transmit an ARP and we have to
-            if (dq_rtr_check()) {
+            // Check if we are allowed to transmit an ARP and we have to,
+            // that is the application has a payload to send
+            if (action == DQ_ACTION_ARP && app_queue_peek() != NULL) {
                 // Set the number of ARP and select one at random
                 dq_arp_vars_set();
 
                 // Register and start the radio timer callback
-                if (dq_vars.arp_count == dq_vars.arp_selected) {
-                    ticks = DQ_SIFS_DURATION - MAC_RADIO_IDLE_TX - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-                    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
-                } else {
-                    ticks = DQ_SIFS_DURATION - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-                    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
-                }
-            } else if (dq_dtr_check()) { // Otherwise check if we are allowed to transmit a DATA
+                expiry = dq_vars.slot + DQ_ARP_OFFSET(0) - MAC_RADIO_IDLE_TX - DQ_ARP_PREPARE;
+                virtual_timer_start_deadline_at(expiry, dq_arp_init, DQ_ARP_PREPARE);
+            } else if (action == DQ_ACTION_DATA) { // Otherwise check if we are allowed to transmit a DATA
                 // Reset the ARP-related variables
                 dq_arp_vars_reset();
 
                 // Register and start the radio timer callback
-                ticks = 4 * DQ_SIFS_DURATION + 3 * DQ_ARP_DURATION - MAC_RADIO_IDLE_TX - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-                virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_data_init, TASK_PRIO_MAX);
+                expiry = dq_vars.slot + DQ_DATA_OFFSET - MAC_RADIO_IDLE_TX - DQ_DATA_PREPARE;
+                virtual_timer_start_deadline_at(expiry, dq_data_init, DQ_DATA_PREPARE);
             } else { // Otherwise we jump to the next FBP
                 // Reset the ARP-related variables
                 dq_arp_vars_reset();
 
                 // Register and start the radio timer callback
-                ticks = DQ_SLOT_DURATION - DQ_FBP_DURATION - 2 * MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE - DQ_FBP_PROCESS;
-                virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
+                expiry = dq_vars.slot + DQ_SLOT_DURATION - DQ_FBP_GUARD - MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE;
+                virtual_timer_start_deadline_at(expiry, dq_fbp_init, DQ_FBP_PREPARE);
             }
         }
     } else { // If the packet is not a FBP
@@ -828,60 +834,64 @@ static void dq_fbp_done(void) {
             // ticks = DQ_SLOT_DURATION - DQ_FBP_DURATION - 2 * MAC_RADIO_IDLE_RX;
             // virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
             ticks = VIRTUAL_TIMER_KICK_NOW;
-            virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
+            virtual_timer_start_deadline(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, DQ_FBP_PREPARE);
         }
     }
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_FBP, 0);
 }
 
 static void dq_arp_init(void) {
     dq_arp_t* dq_arp = NULL;
-    virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_ARP, 0);
     debug_user_on();
 
     // If this is the ARP slot we selected
-    if (dq_vars.arp_count == dq_vars.arp_selected) {
-        // Obtain a queue entry
-        mac_vars.queue_mac_tx = packet_buffer_get();
-        dq_arp = (dq_arp_t *) mac_vars.queue_mac_tx->payload;
-        mac_vars.queue_mac_tx->length = sizeof(dq_arp_t);
-
-        // Configure the ARP
-        dq_arp->packet_type = DQ_ARP;
-        dq_arp->random_number = dq_vars.arp_random;
-
-        // Set the radio callbacks
-        radio_set_tx_cb(dq_arp_tx_init, dq_arp_tx_done);
-
-        // Account for the transmitted ARP
-        dq_vars.arp_total += 1;
-
-        // Put the ARP in the radio and transmit it
-        radio_put_packet(mac_vars.queue_mac_tx);
-        radio_transmit();
+    if (dq_vars.arp_count == dq_vars.queue.arp_selected) {
+        // Obtain a queue entry, nothing is sent without one
+        mac_vars.queue_mac_tx = packet_buffer_get(sizeof(dq_arp_t));
+        if (mac_vars.queue_mac_tx != NULL) {
+            dq_arp = (dq_arp_t *) mac_vars.queue_mac_tx->payload;
+            mac_vars.queue_mac_tx->length = sizeof(dq_arp_t);
+
+            // Configure the ARP
+            dq_arp->packet_type = DQ_ARP;
+            dq_arp->random_number = dq_vars.queue.arp_random;
+
+            // Set the radio callbacks
+            radio_set_tx_cb(dq_arp_tx_init, dq_arp_tx_done);
+
+            // Account for the transmitted ARP
+            dq_vars.arp_total += 1;
+
+            // Put the ARP in the radio and transmit it at the start of the ARP
+            radio_put_packet(mac_vars.queue_mac_tx);
+            virtual_timer_start_isr_at(DQ_RADIO_START(dq_vars.slot + DQ_ARP_OFFSET(dq_vars.arp_count)), radio_transmit, DQ_RADIO_BUDGET_US, NULL, 0);
+        }
     }
 
     // Register and start the radio timer callback
-    ticks = DQ_ARP_DURATION;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_done, TASK_PRIO_MAX);
+    virtual_timer_start_deadline_at(dq_vars.slot + DQ_ARP_OFFSET(dq_vars.arp_count) + DQ_ARP_DURATION, dq_arp_done, DQ_ARP_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_arp_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void dq_arp_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void dq_arp_done(void) {
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t expiry;
 
     debug_user_on();
 
@@ -898,76 +908,84 @@ static void dq_arp_done(void) {
 
     // Register and start the radio timer callback
     if (dq_vars.arp_count == DQ_ARP_COUNT) { // This is the last ARP
-        ticks = DQ_SIFS_DURATION + DQ_DATA_DURATION + DQ_LIFS_DURATION - 2 * MAC_RADIO_IDLE_RX - DQ_ARP_PREPARE - DQ_ARP_PROCESS;
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
-    } else if (dq_vars.arp_count == dq_vars.arp_selected) { // This is the selected ARP
-        ticks = DQ_SIFS_DURATION - MAC_RADIO_IDLE_TX - DQ_ARP_PREPARE - DQ_ARP_PROCESS;
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
-    } else { // This is NOT the selected ARP
-        ticks = DQ_SIFS_DURATION - DQ_ARP_PREPARE - DQ_ARP_PROCESS;
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_arp_init, TASK_PRIO_MAX);
+        expiry = dq_vars.slot + DQ_SLOT_DURATION - DQ_FBP_GUARD - MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE;
+        virtual_timer_start_deadline_at(expiry, dq_fbp_init, DQ_FBP_PREPARE);
+    } else { // Whether it is the selected ARP or not
+        expiry = dq_vars.slot + DQ_ARP_OFFSET(dq_vars.arp_count) - MAC_RADIO_IDLE_TX - DQ_ARP_PREPARE;
+        virtual_timer_start_deadline_at(expiry, dq_arp_init, DQ_ARP_PREPARE);
     }
 
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_ARP, 0);
     debug_user_off();
 }
 
 static void dq_data_init(void) {
     dq_data_t* dq_data = NULL;
-    virtual_timer_width_t ticks;
+    packet_buffer_t* app = NULL;
+    uint8_t length;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_DATA, 0);
     debug_user_on();
 
-    // Obtain a queue entry
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    dq_data = (dq_data_t *) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(dq_data_t);
-
-    // Configure the DATA
-    dq_data->mac_type = MAC_TYPE_DQ;
-    dq_data->packet_type = DQ_DATA;
-    dq_data->destination = MAC_ADDR_BCAST;
-    dq_data->source = dq_vars.mac_address;
-    dq_data->arp_total = dq_vars.arp_total;
-    dq_data->crq_wait = dq_vars.crq_wait;
-    dq_data->dtq_wait = dq_vars.dtq_wait;
-
-    // Fill in the DATA packet
-    uint16_t random = random_get();
-    for (uint8_t i = 0; i < sizeof(dq_data->data); i++) {
-        dq_data->data[i] = random >> 0;
+    // Take the oldest payload of the application and obtain a queue entry,
+    // nothing is sent without both
+    app = app_queue_peek();
+    if (app != NULL) {
+        mac_vars.queue_mac_tx = packet_buffer_get(sizeof(dq_data_t));
+    }
+    if (mac_vars.queue_mac_tx != NULL) {
+        dq_data = (dq_data_t *) mac_vars.queue_mac_tx->payload;
+        length = (app->length < sizeof(dq_data->data) ? app->length : sizeof(dq_data->data));
+        mac_vars.queue_mac_tx->length = sizeof(dq_data_t) - sizeof(dq_data->data) + length;
+
+        // Configure the DATA
+        dq_data->mac_type = MAC_TYPE_DQ;
+        dq_data->packet_type = DQ_DATA;
+        dq_data->destination = MAC_ADDR_BCAST;
+        dq_data->source = dq_vars.mac_address;
+        dq_data->arp_total = dq_vars.arp_total;
+        dq_data->crq_wait = dq_vars.crq_wait;
+        dq_data->dtq_wait = dq_vars.dtq_wait;
+
+        // Fill in the DATA packet with the payload
+        memcpy(dq_data->data, app->payload, length);
+
+        // Reset the ARP, DTQ and CRQ counters
+        dq_vars.arp_total = 0;
+        dq_vars.dtq_wait  = 0;
+        dq_vars.crq_wait  = 0;
+
+        // The next FBP tells whether the gateway received it
+        dq_vars.data_pending = true;
+
+        // Register the radio callback
+        radio_set_tx_cb(dq_data_tx_init, dq_data_tx_done);
+
+        // Put the DATA in the radio and transmit it at the start of the DATA
+        radio_put_packet(mac_vars.queue_mac_tx);
+        virtual_timer_start_isr_at(DQ_RADIO_START(dq_vars.slot + DQ_DATA_OFFSET), radio_transmit, DQ_RADIO_BUDGET_US, NULL, 0);
     }
-
-    // Reset the ARP, DTQ and CRQ counters
-    dq_vars.arp_total = 0;
-    dq_vars.dtq_wait  = 0;
-    dq_vars.crq_wait  = 0;
-
-    // Register the radio callback
-    radio_set_tx_cb(dq_data_tx_init, dq_data_tx_done);
-
-    // Put the DATA in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
 
     // Register and start the radio timer callback
-    ticks = DQ_DATA_DURATION;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_data_done, TASK_PRIO_MAX);
+    virtual_timer_start_deadline_at(dq_vars.slot + DQ_DATA_OFFSET + DQ_DATA_DURATION, dq_data_done, DQ_DATA_PROCESS);
 
     debug_user_off();
 }
 
 static void dq_data_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void dq_data_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void dq_data_done(void) {
-    virtual_timer_width_t ticks;
+    bsp_timer_width_t expiry;
 
     debug_user_on();
 
@@ -987,33 +1005,27 @@ static void dq_data_done(void) {
     // board_reset();
 
     // Register and start the radio timer callback
-    ticks = DQ_LIFS_DURATION - 2 * MAC_RADIO_IDLE_RX - DQ_DATA_PREPARE - DQ_DATA_PROCESS;
-    virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, dq_fbp_init, TASK_PRIO_MAX);
+    expiry = dq_vars.slot + DQ_SLOT_DURATION - DQ_FBP_GUARD - MAC_RADIO_IDLE_RX - DQ_FBP_PREPARE;
+    virtual_timer_start_deadline_at(expiry, dq_fbp_init, DQ_FBP_PREPARE);
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_DATA, 0);
 }
 
 static void dq_arp_vars_set(void) {
-    dq_vars.arp_selected    = random_get() % DQ_ARP_SLOT_SIZE;
-    dq_vars.arp_transmitted = true;
-    dq_vars.arp_count       = 0;
-    // dq_vars.arp_random   = random_get();
-    dq_vars.arp_random      = dq_vars.mac_address;
+    // dq_core_arp_set(&dq_vars.queue, random_get() % DQ_ARP_SLOT_SIZE, random_get());
+    dq_core_arp_set(&dq_vars.queue, random_get() % DQ_ARP_SLOT_SIZE, dq_vars.mac_address);
+    dq_vars.arp_count = 0;
 }
 
 static void dq_arp_vars_reset(void) {
-    dq_vars.arp_selected    = 0;
-    dq_vars.arp_transmitted = false;
-    dq_vars.arp_count       = 0;
-    dq_vars.arp_random      = 0;
+    dq_core_arp_reset(&dq_vars.queue);
+    dq_vars.arp_count = 0;
 }
 
 static void dq_data_vars_reset(void) {
-    dq_vars.crq_local  = dq_vars.crq_global;
-    dq_vars.dtq_local  = dq_vars.dtq_global;
-    dq_vars.pcrq_local = 0;
-    dq_vars.pdtq_local = 0;
+    dq_core_sync(&dq_vars.queue, &dq_vars.feedback);
 }
 
 static void dq_vars_update(dq_fbp_t* dq_fbp) {
@@ -1022,183 +1034,36 @@ static void dq_vars_update(dq_fbp_t* dq_fbp) {
     dq_vars.seq_number   = dq_fbp->seq_number;
     dq_vars.arp_count    = dq_fbp->arp_count;
 
-    dq_vars.arp1_state  = dq_fbp->arp1_state;
-    dq_vars.arp1_random = dq_fbp->arp1_random;
-    dq_vars.arp2_state  = dq_fbp->arp2_state;
-    dq_vars.arp2_random = dq_fbp->arp2_random;
-    dq_vars.arp3_state  = dq_fbp->arp3_state;
-    dq_vars.arp3_random = dq_fbp->arp3_random;
+    dq_vars.feedback.arp_state[0]  = dq_fbp->arp1_state;
+    dq_vars.feedback.arp_random[0] = dq_fbp->arp1_random;
+    dq_vars.feedback.arp_state[1]  = dq_fbp->arp2_state;
+    dq_vars.feedback.arp_random[1] = dq_fbp->arp2_random;
+    dq_vars.feedback.arp_state[2]  = dq_fbp->arp3_state;
+    dq_vars.feedback.arp_random[2] = dq_fbp->arp3_random;
 
-    dq_vars.data_state = dq_fbp->data_state;
+    dq_vars.feedback.data_state = dq_fbp->data_state;
 
-    dq_vars.crq_global = dq_fbp->crq_global;
-    dq_vars.dtq_global = dq_fbp->dtq_global;
+    dq_vars.feedback.crq_global = dq_fbp->crq_global;
+    dq_vars.feedback.dtq_global = dq_fbp->dtq_global;
 }
 
-static bool dq_dtr_check(void) {
-    // If the node is at the head of the DTQ it can transmit in DATA
-    if (dq_vars.pdtq_local == 1) {
-        return true;
-    } else { // Otherwise the node is not allowed to transmit in the DATA
-        return false;
-    }
-}
-
-static bool dq_rtr_check(void) {
-    // If no collisions are pending and node does not occupy any position in the CRQ or DTQ
-    if (dq_vars.crq_local == 0 && dq_vars.pcrq_local == 0 && dq_vars.pdtq_local == 0) {
-        return true;
-    } else if (dq_vars.pcrq_local == 1) { // If the node is at the head of the CRQ
-        return true;
-    } else { // Otherwise the node is not allowed to transmit in the ARP
-        return false;
-    }
-}
-
-static bool dq_qdr_check(void) {
-    // Perform a sanity check of the CRQ and DTQ variables
-    if (dq_vars.crq_local != dq_vars.crq_global ||
-        dq_vars.dtq_local != dq_vars.dtq_global) {
-        return false;
-    }
-    return true;
-}
-
-static void dq_qdr_update(void) {
-    dq_arp_state_t* current_arp_state = NULL;
-    uint16_t* current_arp_random = NULL;
-    uint8_t total_success = 0;
-    uint8_t relative_success = 0;
-    uint8_t total_collision = 0;
-    uint8_t relative_collision = 0;
-
-    // Update the pDTQ if DATA was successful or empty
-    if ((dq_vars.pdtq_local > 0) &&
-        (dq_vars.data_state != DQ_DATA_ERROR)) {
-        dq_vars.pdtq_local -= 1;
-    }
-
-    // Update the pCRQ to account for the collision resolution attempt
-    if (dq_vars.pcrq_local > 0) {
-        dq_vars.pcrq_local -= 1;
-    }
+#endif /* MAC_DEVICE == MAC_NODE */
 
-    // Know which ARP we are currently processing and point to it
-    switch (dq_vars.arp_selected) {
-        case DQ_ARP_SLOT_0:
-            current_arp_state = &dq_vars.arp1_state;
-            current_arp_random = &dq_vars.arp1_random;
-            relative_success = 1;
-            relative_collision = 1;
-            break;
-        case DQ_ARP_SLOT_1:
-            current_arp_state = &dq_vars.arp2_state;
-            current_arp_random = &dq_vars.arp2_random;
-            if (dq_vars.arp1_state == DQ_ARP_SUCCESS) {
-                relative_success = 2;
-            } else {
-                relative_success = 1;
-            }
-            if (dq_vars.arp1_state == DQ_ARP_COLLISION) {
-                relative_collision = 2;
-            } else {
-                relative_collision = 1;
-            }
+static void dq_radio_error(radio_error_t error) {
+    // The frame being received or sent is lost and its done callback will not
+    // run, the end of the slot puts the radio back to idle
+    switch (error) {
+        case RADIO_ERROR_RX_OVERFLOW:
+        case RADIO_ERROR_RX_UNDERFLOW:
+            debug_radio_off();
+            TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
             break;
-        case DQ_ARP_SLOT_2:
-            current_arp_state = &dq_vars.arp3_state;
-            current_arp_random = &dq_vars.arp3_random;
-            if (dq_vars.arp1_state == DQ_ARP_SUCCESS && dq_vars.arp2_state == DQ_ARP_SUCCESS) {
-                relative_success = 3;
-            } else if (dq_vars.arp1_state == DQ_ARP_SUCCESS || dq_vars.arp2_state == DQ_ARP_SUCCESS) {
-                relative_success = 2;
-            } else {
-                relative_success = 1;
-            }
-            if (dq_vars.arp1_state == DQ_ARP_COLLISION && dq_vars.arp2_state == DQ_ARP_COLLISION) {
-                relative_collision = 3;
-            } else if (dq_vars.arp1_state == DQ_ARP_COLLISION || dq_vars.arp2_state == DQ_ARP_COLLISION) {
-                relative_collision = 2;
-            } else {
-                relative_collision = 1;
-            }
+        case RADIO_ERROR_TX_OVERFLOW:
+        case RADIO_ERROR_TX_UNDERFLOW:
+            debug_radio_off();
+            TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
             break;
         default:
             break;
     }
-
-    // Increase DTQ and CRQ by one for each success/collision ARP
-    total_success = 0;
-    total_collision = 0;
-
-    // Check ARP1 state
-    if (dq_vars.arp1_state == DQ_ARP_SUCCESS) {
-        total_success += 1;
-    } else if (dq_vars.arp1_state == DQ_ARP_COLLISION) {
-        total_collision += 1;
-    }
-
-    // Check ARP2 state
-    if (dq_vars.arp2_state == DQ_ARP_SUCCESS) {
-        total_success += 1;
-    } else if (dq_vars.arp2_state == DQ_ARP_COLLISION) {
-        total_collision += 1;
-    }
-
-    // Check ARP3 state
-    if (dq_vars.arp3_state == DQ_ARP_SUCCESS) {
-        total_success += 1;
-    } else if (dq_vars.arp3_state == DQ_ARP_COLLISION) {
-        total_collision += 1;
-    }
-
-    // Update the pDTQ and pCRQ according to the FBP status
-    if (dq_vars.arp_transmitted) {
-        // If ARP success enter the DTQ
-        if (*current_arp_state == DQ_ARP_SUCCESS &&
-            dq_vars.arp_random == *current_arp_random) {
-            // Calculate the position in the DTQ
-            dq_vars.pdtq_local = dq_vars.dtq_local + relative_success - total_success;
-        } else { // Otherwise mark the ARP as collision for further processing
-            *current_arp_state = DQ_ARP_COLLISION;
-        }
-
-        // If ARP collision enter the CRQ
-        if (*current_arp_state == DQ_ARP_COLLISION) {
-            // Calculate the poisition in the CRQ
-            dq_vars.pcrq_local = dq_vars.crq_local + relative_collision - total_collision;
-        }
-    }
-}
-
-#endif /* MAC_DEVICE == MAC_NODE */
-
-static void dq_qdr_rules(void) {
-    // Decrease CRQ to account for the collision resolution attempt
-    if (dq_vars.crq_local > 0) {
-        dq_vars.crq_local -= 1;
-    }
-
-    // Decrease DTQ by one for each success or empty DATA
-    if (dq_vars.dtq_local > 0 &&
-        dq_vars.data_state != DQ_DATA_ERROR) {
-        dq_vars.dtq_local -= 1;
-    }
-
-    // Increase DTQ and CRQ by one for each success/collision ARP
-    if (dq_vars.arp1_state == DQ_ARP_SUCCESS) {
-        dq_vars.dtq_local += 1;
-    } else if (dq_vars.arp1_state == DQ_ARP_COLLISION) {
-        dq_vars.crq_local += 1;
-    }
-    if (dq_vars.arp2_state == DQ_ARP_SUCCESS) {
-        dq_vars.dtq_local += 1;
-    } else if (dq_vars.arp2_state == DQ_ARP_COLLISION) {
-        dq_vars.crq_local += 1;
-    }
-    if (dq_vars.arp3_state == DQ_ARP_SUCCESS) {
-        dq_vars.dtq_local += 1;
-    } else if (dq_vars.arp3_state == DQ_ARP_COLLISION) {
-        dq_vars.crq_local += 1;
-    }
 }
@@ -0,0 +1,256 @@
+/**
+ * @file       dq_core.c
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      DQ queueing rules without side effects.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+/*================================ include ==================================*/
+
+#include "dq_core.h"
+
+/*================================ define ===================================*/
+
+/*================================ typedef ==================================*/
+
+/**
+ * What every node needs to know about the ARPs of a frame
+ */
+typedef struct {
+    uint8_t total_success;                      ///< The number of successful ARPs
+    uint8_t total_collision;                    ///< The number of collided ARPs
+    uint8_t relative_success[DQ_ARP_COUNT];     ///< One plus the successful ARPs before each ARP
+    uint8_t relative_collision[DQ_ARP_COUNT];   ///< One plus the collided ARPs before each ARP
+} dq_core_summary_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+static void dq_core_summarize(const dq_feedback_t* feedback, dq_core_summary_t* summary);
+static void dq_core_rules_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary);
+static void dq_core_update_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary);
+static dq_action_t dq_core_step_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary);
+
+/*================================= public ==================================*/
+
+/**
+ * @brief Applies the QDR rules of a frame to the local CRQ and DTQ
+ */
+void dq_core_rules(dq_queue_t* queue, const dq_feedback_t* feedback) {
+    dq_core_summary_t summary;
+
+    dq_core_summarize(feedback, &summary);
+    dq_core_rules_apply(queue, feedback, &summary);
+}
+
+/**
+ * @brief Checks that the local CRQ and DTQ match the global ones
+ */
+bool dq_core_check(const dq_queue_t* queue, const dq_feedback_t* feedback) {
+    // Perform a sanity check of the CRQ and DTQ variables
+    if (queue->crq_local != feedback->crq_global ||
+        queue->dtq_local != feedback->dtq_global) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Updates the position of the node in the CRQ and DTQ
+ */
+void dq_core_update(dq_queue_t* queue, const dq_feedback_t* feedback) {
+    dq_core_summary_t summary;
+
+    dq_core_summarize(feedback, &summary);
+    dq_core_update_apply(queue, feedback, &summary);
+}
+
+/**
+ * @brief Checks if the node is allowed to transmit an ARP
+ */
+bool dq_core_rtr(const dq_queue_t* queue) {
+    // If no collisions are pending and node does not occupy any position in the CRQ or DTQ
+    if (queue->crq_local == 0 && queue->pcrq_local == 0 && queue->pdtq_local == 0) {
+        return true;
+    } else if (queue->pcrq_local == 1) { // If the node is at the head of the CRQ
+        return true;
+    } else { // Otherwise the node is not allowed to transmit in the ARP
+        return false;
+    }
+}
+
+/**
+ * @brief Checks if the node is allowed to transmit the DATA
+ */
+bool dq_core_dtr(const dq_queue_t* queue) {
+    // If the node is at the head of the DTQ it can transmit in DATA
+    if (queue->pdtq_local == 1) {
+        return true;
+    } else { // Otherwise the node is not allowed to transmit in the DATA
+        return false;
+    }
+}
+
+/**
+ * @brief Takes the CRQ and DTQ from the feedback and leaves both queues
+ */
+void dq_core_sync(dq_queue_t* queue, const dq_feedback_t* feedback) {
+    queue->crq_local  = feedback->crq_global;
+    queue->dtq_local  = feedback->dtq_global;
+    queue->pcrq_local = 0;
+    queue->pdtq_local = 0;
+}
+
+/**
+ * @brief Records the ARP that the node transmits in this frame
+ */
+void dq_core_arp_set(dq_queue_t* queue, uint8_t arp_selected, dq_arp_random_t arp_random) {
+    queue->arp_selected    = arp_selected;
+    queue->arp_transmitted = true;
+    queue->arp_random      = arp_random;
+}
+
+/**
+ * @brief Records that the node does not transmit an ARP in this frame
+ */
+void dq_core_arp_reset(dq_queue_t* queue) {
+    queue->arp_selected    = 0;
+    queue->arp_transmitted = false;
+    queue->arp_random      = 0;
+}
+
+/**
+ * @brief Processes the feedback of a frame on a synchronized node
+ *
+ * If the node has to transmit an ARP the caller selects it with
+ * dq_core_arp_set, otherwise the ARP of the last frame is cleared.
+ */
+dq_action_t dq_core_step(dq_queue_t* queue, const dq_feedback_t* feedback) {
+    dq_core_summary_t summary;
+
+    dq_core_summarize(feedback, &summary);
+    return dq_core_step_apply(queue, feedback, &summary);
+}
+
+/**
+ * @brief Processes the feedback of a frame on many nodes at once
+ */
+void dq_core_step_batch(dq_queue_t* queues, dq_action_t* actions, uint32_t count, const dq_feedback_t* feedback) {
+    dq_core_summary_t summary;
+    uint32_t i;
+
+    // The feedback is the same for all the nodes
+    dq_core_summarize(feedback, &summary);
+
+    for (i = 0; i < count; i++) {
+        actions[i] = dq_core_step_apply(&queues[i], feedback, &summary);
+    }
+}
+
+/*================================ private ==================================*/
+
+static void dq_core_summarize(const dq_feedback_t* feedback, dq_core_summary_t* summary) {
+    uint8_t i;
+
+    summary->total_success = 0;
+    summary->total_collision = 0;
+
+    // Count the successful and collided ARPs up to each ARP
+    for (i = 0; i < DQ_ARP_COUNT; i++) {
+        summary->relative_success[i] = summary->total_success + 1;
+        summary->relative_collision[i] = summary->total_collision + 1;
+
+        if (feedback->arp_state[i] == DQ_ARP_SUCCESS) {
+            summary->total_success += 1;
+        } else if (feedback->arp_state[i] == DQ_ARP_COLLISION) {
+            summary->total_collision += 1;
+        }
+    }
+}
+
+static void dq_core_rules_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary) {
+    // Decrease CRQ to account for the collision resolution attempt
+    if (queue->crq_local > 0) {
+        queue->crq_local -= 1;
+    }
+
+    // Decrease DTQ by one for each success or empty DATA
+    if (queue->dtq_local > 0 &&
+        feedback->data_state != DQ_DATA_ERROR) {
+        queue->dtq_local -= 1;
+    }
+
+    // Increase DTQ and CRQ by one for each success/collision ARP
+    queue->dtq_local += summary->total_success;
+    queue->crq_local += summary->total_collision;
+}
+
+static void dq_core_update_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary) {
+    dq_arp_state_t arp_state;
+    uint8_t selected;
+
+    // Update the pDTQ if DATA was successful or empty
+    if ((queue->pdtq_local > 0) &&
+        (feedback->data_state != DQ_DATA_ERROR)) {
+        queue->pdtq_local -= 1;
+    }
+
+    // Update the pCRQ to account for the collision resolution attempt
+    if (queue->pcrq_local > 0) {
+        queue->pcrq_local -= 1;
+    }
+
+    // Update the pDTQ and pCRQ according to the FBP status
+    if (queue->arp_transmitted && queue->arp_selected < DQ_ARP_COUNT) {
+        selected = queue->arp_selected;
+        arp_state = feedback->arp_state[selected];
+
+        // If ARP success enter the DTQ
+        if (arp_state == DQ_ARP_SUCCESS &&
+            queue->arp_random == feedback->arp_random[selected]) {
+            // Calculate the position in the DTQ
+            queue->pdtq_local = queue->dtq_local + summary->relative_success[selected] - summary->total_success;
+        } else { // Otherwise mark the ARP as collision for further processing
+            arp_state = DQ_ARP_COLLISION;
+        }
+
+        // If ARP collision enter the CRQ
+        if (arp_state == DQ_ARP_COLLISION) {
+            // Calculate the position in the CRQ
+            queue->pcrq_local = queue->crq_local + summary->relative_collision[selected] - summary->total_collision;
+        }
+    }
+}
+
+static dq_action_t dq_core_step_apply(dq_queue_t* queue, const dq_feedback_t* feedback, const dq_core_summary_t* summary) {
+    // Apply the QDR rules
+    dq_core_rules_apply(queue, feedback, summary);
+
+    // Check if the DTQ and CRQ values are NOT consistent
+    if (!dq_core_check(queue, feedback)) {
+        return DQ_ACTION_UNSYNC;
+    }
+
+    // Update the DTQ and CRQ
+    dq_core_update_apply(queue, feedback, summary);
+
+    // Check if we are allowed to transmit an ARP
+    if (dq_core_rtr(queue)) {
+        return DQ_ACTION_ARP;
+    }
+
+    // The ARP of the last frame has been accounted for
+    dq_core_arp_reset(queue);
+
+    // Otherwise check if we are allowed to transmit a DATA
+    if (dq_core_dtr(queue)) {
+        return DQ_ACTION_DATA;
+    }
+
+    return DQ_ACTION_WAIT;
+}
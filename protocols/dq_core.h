@@ -0,0 +1,105 @@
+/**
+ * @file       dq_core.h
+ * @author     Pere Tuset-Peiro (peretuset@openmote.com)
+ * @version    v0.1
+ * @date       May 2015
+ * @brief      DQ queueing rules without side effects.
+ *
+ *             The functions only read the feedback of a frame and update the
+ *             queue state that they are given, so the firmware, the simulator
+ *             and the tools on the computer all run the same rules.
+ *
+ * @copyright  Copyright 2015, OpenMote Technologies, S.L.
+ *             This file is licensed under the GNU General Public License v2.
+ */
+
+#ifndef DQ_CORE_H_
+#define DQ_CORE_H_
+
+/*================================ include ==================================*/
+
+#include "types.h"
+
+/*================================ define ===================================*/
+
+#define DQ_ARP_COUNT                    ( 3 )
+
+/*================================ typedef ==================================*/
+
+typedef uint16_t dq_arp_random_t;
+typedef uint16_t dq_crq_length_t;
+typedef uint16_t dq_dtq_length_t;
+
+typedef enum {
+    DQ_ARP_EMPTY     = 0x00,
+    DQ_ARP_COLLISION = 0x01,
+    DQ_ARP_SUCCESS   = 0x02,
+} dq_arp_state_t;
+
+typedef enum {
+    DQ_ARP_SLOT_0    = 0x00,
+    DQ_ARP_SLOT_1    = 0x01,
+    DQ_ARP_SLOT_2    = 0x02,
+    DQ_ARP_SLOT_SIZE = 0x03
+} dq_arp_slot_t;
+
+typedef enum {
+    DQ_DATA_EMPTY   = 0x00,
+    DQ_DATA_ERROR   = 0x01,
+    DQ_DATA_SUCCESS = 0x02
+} dq_data_state_t;
+
+typedef enum {
+    DQ_ACTION_UNSYNC = 0x00,        ///< The queues do not match the feedback
+    DQ_ACTION_ARP    = 0x01,        ///< Transmit an ARP in this frame
+    DQ_ACTION_DATA   = 0x02,        ///< Transmit the DATA in this frame
+    DQ_ACTION_WAIT   = 0x03         ///< Wait for the next frame
+} dq_action_t;
+
+/**
+ * Feedback of a frame, as broadcast by the gateway in the FBP
+ */
+typedef struct {
+    dq_arp_state_t arp_state[DQ_ARP_COUNT];     ///< The state of each ARP
+    dq_arp_random_t arp_random[DQ_ARP_COUNT];   ///< The random number of each successful ARP
+    dq_data_state_t data_state;                 ///< The state of the DATA
+    dq_crq_length_t crq_global;                 ///< The global value of the CRQ
+    dq_dtq_length_t dtq_global;                 ///< The global value of the DTQ
+} dq_feedback_t;
+
+/**
+ * Queue state of a node (the gateway only uses the local CRQ and DTQ)
+ */
+typedef struct {
+    dq_crq_length_t crq_local;      ///< The local value of the CRQ
+    dq_crq_length_t pcrq_local;     ///< The local pointer to the CRQ
+    dq_dtq_length_t dtq_local;      ///< The local value of the DTQ
+    dq_dtq_length_t pdtq_local;     ///< The local pointer to the DTQ
+
+    uint8_t arp_selected;           ///< The ARP where the node transmitted
+    bool arp_transmitted;           ///< The node transmitted an ARP
+    dq_arp_random_t arp_random;     ///< The random number of the ARP
+} dq_queue_t;
+
+/*=============================== variables =================================*/
+
+/*=============================== prototypes ================================*/
+
+void dq_core_rules(dq_queue_t* queue, const dq_feedback_t* feedback);
+bool dq_core_check(const dq_queue_t* queue, const dq_feedback_t* feedback);
+void dq_core_update(dq_queue_t* queue, const dq_feedback_t* feedback);
+bool dq_core_rtr(const dq_queue_t* queue);
+bool dq_core_dtr(const dq_queue_t* queue);
+
+void dq_core_sync(dq_queue_t* queue, const dq_feedback_t* feedback);
+void dq_core_arp_set(dq_queue_t* queue, uint8_t arp_selected, dq_arp_random_t arp_random);
+void dq_core_arp_reset(dq_queue_t* queue);
+
+dq_action_t dq_core_step(dq_queue_t* queue, const dq_feedback_t* feedback);
+void dq_core_step_batch(dq_queue_t* queues, dq_action_t* actions, uint32_t count, const dq_feedback_t* feedback);
+
+/*================================= public ==================================*/
+
+/*================================ private ==================================*/
+
+#endif /* DQ_CORE_H_ */
@@ -72,6 +72,7 @@ typedef struct {
     mac_seq_number_t seq_number;    ///< Sequence number of the packet
 
     uint8_t packet_success;         ///< Packet was received successfully
+    bool data_pending;              ///< The DATA sent waits for the ACK
 
     uint8_t slot_total;             ///< Total number of slots in the frame
     uint8_t slot_count;             ///< Current slot in the frame
@@ -179,10 +180,12 @@ static void fsa_vars_log(void);
 #elif (MAC_DEVICE == MAC_NODE)
 static void fsa_fbp_rx_init(void);
 static void fsa_fbp_rx_done(void);
+static void fsa_fbp_rx_packet(packet_buffer_t* packet_buffer);
 static void fsa_data_tx_init(void);
 static void fsa_data_tx_done(void);
 static void fsa_ack_rx_init(void);
 static void fsa_ack_rx_done(void);
+static void fsa_ack_rx_packet(packet_buffer_t* packet_buffer);
 static void fsa_vars_update(fsa_fbp_t* fsa_fbp);
 #endif
 
@@ -226,31 +229,34 @@ static void fsa_fbp_init(void) {
     fsa_fbp_t* fsa_fbp = NULL;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_FBP, 0);
     debug_user_on();
 
     // Restore the local FSA variables
     fsa_vars_reset();
 
-    // Obtain a queue entry and populate it
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    fsa_fbp = (fsa_fbp_t *) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(fsa_fbp_t);
-
-    // Prepare the FBP
-    fsa_fbp->mac_type = MAC_TYPE_FSA;
-    fsa_fbp->mac_packet = MAC_PACKET_FBP;
-    fsa_fbp->source = fsa_vars.mac_address;
-    fsa_fbp->destination = MAC_ADDR_BCAST;
-    fsa_fbp->seq_number = fsa_vars.seq_number;
-    fsa_fbp->slot_count = fsa_vars.slot_total;
-    fsa_fbp->next_channel = mac_vars.mac_channel;
-
-    // Set the radio transmit callback
-    radio_set_tx_cb(fsa_fbp_tx_init, fsa_fbp_tx_done);
-
-    // Put the FBP in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
+    // Obtain a queue entry and populate it, nothing is sent without one
+    mac_vars.queue_mac_tx = packet_buffer_get(sizeof(fsa_fbp_t));
+    if (mac_vars.queue_mac_tx != NULL) {
+        fsa_fbp = (fsa_fbp_t *) mac_vars.queue_mac_tx->payload;
+        mac_vars.queue_mac_tx->length = sizeof(fsa_fbp_t);
+
+        // Prepare the FBP
+        fsa_fbp->mac_type = MAC_TYPE_FSA;
+        fsa_fbp->mac_packet = MAC_PACKET_FBP;
+        fsa_fbp->source = fsa_vars.mac_address;
+        fsa_fbp->destination = MAC_ADDR_BCAST;
+        fsa_fbp->seq_number = fsa_vars.seq_number;
+        fsa_fbp->slot_count = fsa_vars.slot_total;
+        fsa_fbp->next_channel = mac_vars.mac_channel;
+
+        // Set the radio transmit callback
+        radio_set_tx_cb(fsa_fbp_tx_init, fsa_fbp_tx_done);
+
+        // Put the FBP in the radio and transmit it
+        radio_put_packet(mac_vars.queue_mac_tx);
+        radio_transmit();
+    }
 
     // Wait for the duration of a FBP
     ticks = FSA_FBP_DURATION;
@@ -261,10 +267,12 @@ static void fsa_fbp_init(void) {
 
 static void fsa_fbp_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void fsa_fbp_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void fsa_fbp_done(void) {
@@ -289,12 +297,14 @@ static void fsa_fbp_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_FBP, 0);
 }
 
 static void fsa_data_init(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_DATA, 0);
     debug_user_on();
 
     // Set the radio receive callbacks
@@ -312,6 +322,7 @@ static void fsa_data_init(void) {
 
 static void fsa_data_rx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 }
 
 static void fsa_data_rx_rssi(void) {
@@ -330,11 +341,14 @@ static void fsa_data_rx_rssi(void) {
 }
 
 static void fsa_data_rx_done(void) {
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    // Get the packet from the radio, if there is a buffer for it
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(fsa_data_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, NULL);
+    }
 
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
 }
 
 static void fsa_data_done(void) {
@@ -358,7 +372,7 @@ static void fsa_data_done(void) {
     }
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (mac_vars.queue_mac_rx != NULL && mac_vars.queue_mac_rx->crc) {
         // Convert the packet to a data packet
         fsa_data = (fsa_data_t *) mac_vars.queue_mac_rx->payload;
         if (fsa_data->mac_type == MAC_TYPE_FSA &&
@@ -396,6 +410,7 @@ static void fsa_data_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_DATA, 0);
 }
 
 static void fsa_ack_init(void) {
@@ -403,26 +418,29 @@ static void fsa_ack_init(void) {
     fsa_ack_t* fsa_ack = NULL;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_ACK, 0);
     debug_user_on();
 
-    // Obtain a queue entry and populate it
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    fsa_ack = (fsa_ack_t *) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(fsa_ack_t);
-
-    // Prepare the ACK
-    fsa_ack->mac_type = MAC_TYPE_FSA;
-    fsa_ack->mac_packet = MAC_PACKET_ACK;
-    fsa_ack->source = fsa_vars.mac_address;
-    fsa_ack->destination = fsa_vars.data_address;
-    fsa_ack->data_state = fsa_vars.data_state;
-
-    // Set the radio transmit callback
-    radio_set_tx_cb(fsa_ack_tx_init, fsa_ack_tx_done);
-
-    // Put the ACK packet in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
+    // Obtain a queue entry and populate it, nothing is sent without one
+    mac_vars.queue_mac_tx = packet_buffer_get(sizeof(fsa_ack_t));
+    if (mac_vars.queue_mac_tx != NULL) {
+        fsa_ack = (fsa_ack_t *) mac_vars.queue_mac_tx->payload;
+        mac_vars.queue_mac_tx->length = sizeof(fsa_ack_t);
+
+        // Prepare the ACK
+        fsa_ack->mac_type = MAC_TYPE_FSA;
+        fsa_ack->mac_packet = MAC_PACKET_ACK;
+        fsa_ack->source = fsa_vars.mac_address;
+        fsa_ack->destination = fsa_vars.data_address;
+        fsa_ack->data_state = fsa_vars.data_state;
+
+        // Set the radio transmit callback
+        radio_set_tx_cb(fsa_ack_tx_init, fsa_ack_tx_done);
+
+        // Put the ACK packet in the radio and transmit it
+        radio_put_packet(mac_vars.queue_mac_tx);
+        radio_transmit();
+    }
 
     // Wait for the duration of a ACK
     ticks = FSA_ACK_DURATION;
@@ -433,10 +451,12 @@ static void fsa_ack_init(void) {
 
 static void fsa_ack_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void fsa_ack_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void fsa_ack_done(void) {
@@ -470,6 +490,7 @@ static void fsa_ack_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_ACK, 0);
 }
 
 static void fsa_vars_init(void) {
@@ -496,12 +517,13 @@ static void fsa_vars_log(void) {
 // If the device type is END NODE
 #if (MAC_DEVICE == MAC_NODE)
 
-virtual_timer_id_t virtual_timer_id;
+static virtual_timer_id_t virtual_timer_id;
 
 static void fsa_fbp_init(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_FBP, 0);
     debug_user_on();
 
     // Restore the local FSA variables
@@ -524,6 +546,7 @@ static void fsa_fbp_rx_init(void) {
     virtual_timer_width_t ticks;
 
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 
     // Stop the old virtual timer
     virtual_timer_stop(virtual_timer_id);
@@ -534,16 +557,24 @@ static void fsa_fbp_rx_init(void) {
 }
 
 static void fsa_fbp_rx_done(void) {
-    fsa_fbp_t* fsa_fbp = NULL;
+    // Get the packet from the radio, if there is a buffer for it, it is
+    // checked once it is in the buffer
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(fsa_fbp_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, fsa_fbp_rx_packet);
+    }
 
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
+}
+
+static void fsa_fbp_rx_packet(packet_buffer_t* packet_buffer) {
+    fsa_fbp_t* fsa_fbp = NULL;
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (packet_buffer->crc) {
         // Convert the packet to a FBP
-        fsa_fbp = (fsa_fbp_t *) mac_vars.queue_mac_rx->payload;
+        fsa_fbp = (fsa_fbp_t *) packet_buffer->payload;
 
         // If packet is FSA and FBP
         if (fsa_fbp->mac_type == MAC_TYPE_FSA &&
@@ -552,8 +583,6 @@ static void fsa_fbp_rx_done(void) {
             fsa_vars_update(fsa_fbp);
         }
     }
-
-    debug_radio_off();
 }
 
 static void fsa_fbp_done(void) {
@@ -610,39 +639,50 @@ static void fsa_fbp_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_FBP, 0);
 }
 
 static void fsa_data_init(void) {
     virtual_timer_width_t ticks;
     fsa_data_t* fsa_data = NULL;
+    packet_buffer_t* app = NULL;
+    uint8_t length;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_DATA, 0);
     debug_user_on();
 
-    // Obtain a queue entry
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    fsa_data = (fsa_data_t *) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(fsa_data_t);
-
-    // Create the DATA packet
-    fsa_data->mac_type = MAC_TYPE_FSA;
-    fsa_data->mac_packet = MAC_PACKET_DATA;
-    fsa_data->destination = MAC_ADDR_BCAST;
-    fsa_data->source = fsa_vars.mac_address;
-    fsa_data->fsa_total = fsa_stats.fsa_total;
-
-    // Fill in the DATA packet
-    uint16_t random = random_get();
-    for (uint8_t i = 0; i < sizeof(fsa_data->data); i++) {
-        fsa_data->data[i] = random >> 0;
+    // Take the oldest payload of the application and obtain a queue entry,
+    // nothing is sent without both
+    app = app_queue_peek();
+    if (app != NULL) {
+        mac_vars.queue_mac_tx = packet_buffer_get(sizeof(fsa_data_t));
+    }
+    if (mac_vars.queue_mac_tx != NULL) {
+        fsa_data = (fsa_data_t *) mac_vars.queue_mac_tx->payload;
+        length = (app->length < sizeof(fsa_data->data) ? app->length : sizeof(fsa_data->data));
+        mac_vars.queue_mac_tx->length = sizeof(fsa_data_t) - sizeof(fsa_data->data) + length;
+
+        // Create the DATA packet
+        fsa_data->mac_type = MAC_TYPE_FSA;
+        fsa_data->mac_packet = MAC_PACKET_DATA;
+        fsa_data->destination = MAC_ADDR_BCAST;
+        fsa_data->source = fsa_vars.mac_address;
+        fsa_data->fsa_total = fsa_stats.fsa_total;
+
+        // Fill in the DATA packet with the payload
+        memcpy(fsa_data->data, app->payload, length);
+
+        // The ACK tells whether the gateway received it
+        fsa_vars.data_pending = true;
+
+        // Register the radio callback
+        radio_set_tx_cb(fsa_data_tx_init, fsa_data_tx_done);
+
+        // Put the DATA in the radio and transmit it
+        radio_put_packet(mac_vars.queue_mac_tx);
+        radio_transmit();
     }
-
-    // Register the radio callback
-    radio_set_tx_cb(fsa_data_tx_init, fsa_data_tx_done);
-
-    // Put the DATA in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
 
     // Register and start the radio timer callback
     ticks = FSA_DATA_DURATION - FSA_DATA_PREPARE;
@@ -653,10 +693,12 @@ static void fsa_data_init(void) {
 
 static void fsa_data_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 static void fsa_data_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 static void fsa_data_done(void) {
@@ -677,6 +719,7 @@ static void fsa_data_done(void) {
     virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, ticks, fsa_ack_init, TASK_PRIO_MAX);
 
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_DATA, 0);
     debug_user_off();
 }
 
@@ -684,6 +727,7 @@ static void fsa_ack_init(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_ACK, 0);
     debug_user_on();
 
     // Register the radio callbacks
@@ -701,19 +745,31 @@ static void fsa_ack_init(void) {
 
 static void fsa_ack_rx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 }
 
 static void fsa_ack_rx_done(void) {
-    fsa_ack_t* fsa_ack = NULL;
+    // Get the packet from the radio, if there is a buffer for it, it is
+    // checked once it is in the buffer
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(fsa_ack_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, fsa_ack_rx_packet);
+    } else {
+        // Notify we have lost synchronization
+        mac_toggle_synchronized(MAC_STATE_UNSYNC);
+    }
 
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
+}
+
+static void fsa_ack_rx_packet(packet_buffer_t* packet_buffer) {
+    fsa_ack_t* fsa_ack = NULL;
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (packet_buffer->crc) {
         // Convert the packet to a FBP
-        fsa_ack = (fsa_ack_t*) mac_vars.queue_mac_rx->payload;
+        fsa_ack = (fsa_ack_t*) packet_buffer->payload;
         if (fsa_ack->mac_type == MAC_TYPE_FSA &&
             fsa_ack->mac_packet == MAC_PACKET_ACK) {
             if (fsa_ack->data_state == MAC_DATA_SUCCESS &&
@@ -727,8 +783,6 @@ static void fsa_ack_rx_done(void) {
         // Notify we have lost synchronization
         mac_toggle_synchronized(MAC_STATE_UNSYNC);
     }
-
-    debug_radio_off();
 }
 
 static void fsa_ack_done(void) {
@@ -744,6 +798,16 @@ static void fsa_ack_done(void) {
     packet_buffer_release(mac_vars.queue_mac_rx);
     mac_vars.queue_mac_rx = NULL;
 
+    // Settle the DATA sent, otherwise it is sent again in the next frame
+    if (fsa_vars.data_pending) {
+        if (fsa_vars.packet_success) {
+            app_queue_commit();
+        } else {
+            app_queue_requeue();
+        }
+        fsa_vars.data_pending = false;
+    }
+
     // Start the radio timer callback
     ticks  = FSA_SIFS_DURATION - MAC_RADIO_IDLE_RX - FSA_ACK_PROCESS;
     ticks += fsa_vars.slot_remaining * FSA_SLOT_DURATION;
@@ -751,6 +815,7 @@ static void fsa_ack_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_ACK, 0);
 }
 
 static void fsa_vars_init(void) {
@@ -34,6 +34,9 @@
 #define MAC_RADIO_RX_IDLE               ( 0 )
 #define MAC_RADIO_PHY_HEADER            ( 4 ) // 128 us
 
+// Exact time the radio takes from idle to transmit or receive
+#define MAC_RADIO_TURNAROUND_US         ( 192 )
+
 #define MAC_DEFAULT_CHANNEL             ( 26 )
 
 /*================================ typedef ==================================*/
@@ -79,6 +79,7 @@ void wor_start(void);
 void wor_rx_init(void);
 void wor_tx_init(void);
 void wor_rx_done(void);
+void wor_rx_packet(packet_buffer_t* packet_buffer);
 void wor_tx_done(void);
 void wor_timeout(void);
 void wor_done(void);
@@ -126,32 +127,35 @@ void wor_start(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_WOR, 0);
     debug_user_on();
 
-    // Obtain a queue entry
-    mac_vars.queue_mac_tx = packet_buffer_get();
-    wor_packet = (wor_packet_t*) mac_vars.queue_mac_tx->payload;
-    mac_vars.queue_mac_tx->length = sizeof(wor_packet_t);
+    // Obtain a queue entry, nothing is sent without one
+    mac_vars.queue_mac_tx = packet_buffer_get(sizeof(wor_packet_t));
+    if (mac_vars.queue_mac_tx != NULL) {
+        wor_packet = (wor_packet_t*) mac_vars.queue_mac_tx->payload;
+        mac_vars.queue_mac_tx->length = sizeof(wor_packet_t);
 
-    // Prepare the WOR
-    wor_packet->mac_type = mac_vars.mac_type;
-    wor_packet->mac_packet = mac_vars.mac_packet;
-    wor_packet->mac_time = mac_vars.mac_time;
-    wor_packet->mac_channel = mac_vars.mac_channel;
+        // Prepare the WOR
+        wor_packet->mac_type = mac_vars.mac_type;
+        wor_packet->mac_packet = mac_vars.mac_packet;
+        wor_packet->mac_time = mac_vars.mac_time;
+        wor_packet->mac_channel = mac_vars.mac_channel;
 
-    // Wake up the radio
-    radio_idle();
+        // Wake up the radio
+        radio_idle();
 
-    // Set the radio to the WOR channel
-    radio_set_channel(wor_vars.wor_channel);
+        // Set the radio to the WOR channel
+        radio_set_channel(wor_vars.wor_channel);
 
-    // Set the radio transmit callbacks
-    radio_set_tx_cb(wor_tx_init, wor_tx_done);
-    radio_enable_interrupts();
+        // Set the radio transmit callbacks
+        radio_set_tx_cb(wor_tx_init, wor_tx_done);
+        radio_enable_interrupts();
 
-    // Put the WOR in the radio and transmit it
-    radio_put_packet(mac_vars.queue_mac_tx);
-    radio_transmit();
+        // Put the WOR in the radio and transmit it
+        radio_put_packet(mac_vars.queue_mac_tx);
+        radio_transmit();
+    }
 
     // Wait for the duration of a FBP
     ticks = wor_vars.tx_period - MAC_RADIO_IDLE_TX - WOR_PREPARE;
@@ -162,10 +166,12 @@ void wor_start(void) {
 
 void wor_tx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_TX);
 }
 
 void wor_tx_done(void) {
     debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_TX);
 }
 
 void wor_done(void) {
@@ -201,6 +207,7 @@ void wor_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_WOR, 0);
 }
 
 #endif /* MAC_DEVICE == MAC_GATEWAY */
@@ -222,6 +229,7 @@ void wor_start(void) {
     virtual_timer_width_t ticks;
 
     debug_system_on();
+    TRACE_SLOT(TRACE_BEGIN, TRACE_EVENT_WOR, 0);
     debug_user_on();
 
     // Wake up the radio
@@ -246,19 +254,28 @@ void wor_start(void) {
 
 void wor_rx_init(void) {
     debug_radio_on();
+    TRACE_RADIO(TRACE_BEGIN, TRACE_RADIO_RX);
 }
 
 void wor_rx_done(void) {
-    wor_packet_t* wor_packet = NULL;
+    // Get the packet from the radio, if there is a buffer for it, it is
+    // checked once it is in the buffer
+    mac_vars.queue_mac_rx = packet_buffer_get(sizeof(wor_packet_t));
+    if (mac_vars.queue_mac_rx != NULL) {
+        radio_get_packet(mac_vars.queue_mac_rx, wor_rx_packet);
+    }
 
-    // Get the packet from the radio
-    mac_vars.queue_mac_rx = packet_buffer_get();
-    radio_get_packet(mac_vars.queue_mac_rx);
+    debug_radio_off();
+    TRACE_RADIO(TRACE_END, TRACE_RADIO_RX);
+}
+
+void wor_rx_packet(packet_buffer_t* packet_buffer) {
+    wor_packet_t* wor_packet = NULL;
 
     // Check if the received packet is correct
-    if (mac_vars.queue_mac_rx->crc) {
+    if (packet_buffer->crc) {
         // Convert the packet to a WOR packet
-        wor_packet = (wor_packet_t *) mac_vars.queue_mac_rx->payload;
+        wor_packet = (wor_packet_t *) packet_buffer->payload;
         if (wor_packet->mac_packet == MAC_PACKET_WOR) {
             // Update the WOR variables
             mac_set_type(wor_packet->mac_type);
@@ -272,8 +289,6 @@ void wor_rx_done(void) {
             radio_idle();
         }
     }
-
-    debug_radio_off();
 }
 
 void wor_timeout(void) {
@@ -317,6 +332,7 @@ void wor_done(void) {
 
     debug_user_off();
     debug_system_off();
+    TRACE_SLOT(TRACE_END, TRACE_EVENT_WOR, 0);
 }
 
 #endif
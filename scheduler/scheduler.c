@@ -12,124 +12,441 @@
     
 #include "scheduler.h"
 
+#include "bsp_timer.h"
 #include "cpu.h"
 #include "leds.h"
 
+#include "deadline.h"
+#include "latency.h"
+#include "power.h"
+#include "profiler.h"
+#include "trace.h"
 #include "virtual_timer.h"
 
 /*================================ define ===================================*/
 
 #define TASK_BUFFER_SIZE            ( 16 )
 
+// One queue per priority, TASK_PRIO_NONE included so they are indexed directly
+#define SCHEDULER_QUEUES            ( TASK_PRIO_MAX + 1 )
+
+// One ring per interrupt that pushes tasks, the tasks wait there (power of two)
+#define SCHEDULER_RINGS             ( CPU_INTERRUPT_OTHER - 1 )
+#define SCHEDULER_RING_SIZE         ( 8 )
+#define SCHEDULER_RING_MASK         ( SCHEDULER_RING_SIZE - 1 )
+
 #define SCHEDULER_LED_ON_TICKS      ( 64 )
 #define SCHEDULER_LED_OFF_TICKS     ( 32704 )
 
 /*================================ typedef ==================================*/
 
-typedef struct task_list_t {
+// Container of the tasks pushed as a callback
+typedef struct {
+    task_t task;
     task_cb_t callback;
-    task_prio_t priority;
-    struct task_list_t* next_task;
-} task_list_t;
+} task_container_t;
+
+typedef struct {
+    task_t* head;
+    task_t* tail;
+} task_queue_t;
+
+typedef struct {
+    task_post_t buffer[SCHEDULER_RING_SIZE];
+    volatile uint8_t head;          ///< Only written by the interrupt
+    volatile uint8_t tail;          ///< Only written by the scheduler
+    uint32_t overflows;             ///< Only written by the interrupt
+} task_ring_t;
 
 typedef struct {
-    task_list_t task_buffer[TASK_BUFFER_SIZE];
-    task_list_t* task_head;
+    task_container_t task_buffer[TASK_BUFFER_SIZE];
+    task_t* task_free;                          ///< Containers not in use
+    task_queue_t task_queue[SCHEDULER_QUEUES];  ///< FIFO of each priority
+    task_t* task_edf;                           ///< Tasks with a deadline, earliest first
+    uint8_t task_ready;                         ///< Bit i set if queue i has tasks
+    uint32_t overflows;                         ///< Tasks lost to a full buffer
+    uint32_t strays;                            ///< Tasks lost to an interrupt without a ring
+    task_ring_t task_ring[SCHEDULER_RINGS];     ///< Tasks pushed by the interrupts
+    task_t task_led;
 } scheduler_vars_t;
 
 /*=============================== variables =================================*/
 
 static scheduler_vars_t scheduler_vars;
 
+// Highest priority with tasks for each value of the ready bitmap
+static const uint8_t scheduler_highest[1 << SCHEDULER_QUEUES] = {
+    TASK_PRIO_NONE, TASK_PRIO_NONE, TASK_PRIO_MIN, TASK_PRIO_MIN,
+    TASK_PRIO_MED,  TASK_PRIO_MED,  TASK_PRIO_MED, TASK_PRIO_MED,
+    TASK_PRIO_MAX,  TASK_PRIO_MAX,  TASK_PRIO_MAX, TASK_PRIO_MAX,
+    TASK_PRIO_MAX,  TASK_PRIO_MAX,  TASK_PRIO_MAX, TASK_PRIO_MAX
+};
+
 /*=============================== prototypes ================================*/
 
-static void scheduler_toggle_led(void);
+static bool scheduler_insert(const task_post_t* post);
+static void scheduler_drain(void);
+static bool scheduler_ready(void);
+static task_t* scheduler_pop(void);
+static void scheduler_release(task_t* task);
+static task_cb_t scheduler_callback(const task_t* task);
+static void scheduler_container(void* context);
+static void scheduler_toggle_led(void* context);
 
 /*================================= public ==================================*/
 
 void scheduler_init() {
     // Initialize the memory of the scheduler variables
     memset(&scheduler_vars, 0, sizeof(scheduler_vars_t));
+
+    // Chain all the task containers in the free list
+    for (uint8_t i = 0; i < TASK_BUFFER_SIZE - 1; i++) {
+        scheduler_vars.task_buffer[i].task.next_task = &scheduler_vars.task_buffer[i + 1].task;
+    }
+    scheduler_vars.task_free = &scheduler_vars.task_buffer[0].task;
+
+    // The task that controls the system led
+    scheduler_task_init(&scheduler_vars.task_led, scheduler_toggle_led, NULL, TASK_PRIO_MIN);
 }
 
 void scheduler_start(void) {
-    task_list_t* current_task = NULL;
+    task_t* task = NULL;
+#if PROFILER_ENABLED
+    uint32_t start;
+#endif
 
     // Push the task that controls the system led
-    scheduler_push(scheduler_toggle_led, TASK_PRIO_MIN);
+    scheduler_push_task(&scheduler_vars.task_led);
 
     // Enable the CPU interrupts
     cpu_enable_interrupts();
 
     // The scheduler loops forever
     while (true) {
-        // If there is a task to be executed
-        while (scheduler_vars.task_head != NULL) {
-            // Point to the next task to be executed
-            current_task = scheduler_vars.task_head;
+        // Execute the tasks, earliest deadline first, then highest priority
+        // first and in order within a priority
+        while ((task = scheduler_pop()) != NULL) {
+            TRACE_TASK(TRACE_BEGIN, TRACE_EVENT_TASK, (uint32_t) (uintptr_t) scheduler_callback(task));
+
+            // Account for the task that starts after its deadline
+            if (task->edf) {
+                deadline_task(scheduler_callback(task), (int32_t) (bsp_timer_get() - task->deadline));
+            }
 
-            // Update the pointer to the next task to be executed
-            scheduler_vars.task_head = current_task->next_task;
+#if LATENCY_ENABLED
+            // Account for how late the timer task starts
+            if (task->timed) {
+                latency_timer(scheduler_callback(task), task->due);
+            }
+#endif
 
+#if PROFILER_ENABLED
+            // Execute the current task and account for its duration
+            start = profiler_start();
+            task->callback(task->context);
+            profiler_stop(scheduler_callback(task), start);
+#else
             // Execute the current task
-            current_task->callback();
+            task->callback(task->context);
+#endif
 
-            // Empty the task container of the task that has just been executed
-            current_task->callback = NULL;
-            current_task->priority = TASK_PRIO_NONE;
-            current_task->next_task = NULL;
+            TRACE_TASK(TRACE_END, TRACE_EVENT_TASK, (uint32_t) (uintptr_t) scheduler_callback(task));
+
+            // Return the container of the task that has just been executed
+            scheduler_release(task);
+        }
+
+        // Sleep until the next interrupt, unless one has pushed a task since
+        // the queues were checked, it still wakes up the CPU while masked
+        cpu_disable_interrupts();
+        if (!scheduler_ready()) {
+            power_idle();
         }
-        cpu_wait();
+        cpu_enable_interrupts();
     }
 }
 
-void scheduler_push(task_cb_t callback, task_prio_t priority) {
-    task_list_t* current_task = NULL;
-    task_list_t** task_walker = NULL;
+bool scheduler_push(task_cb_t callback, task_prio_t priority) {
+    task_post_t post;
+
+    // Fill in the task information
+    memset(&post, 0, sizeof(task_post_t));
+    post.callback = callback;
+    post.priority = priority;
+
+    return scheduler_post(&post);
+}
+
+bool scheduler_push_deadline(task_cb_t callback, uint32_t deadline) {
+    task_post_t post;
+
+    // Fill in the task information and when it must start
+    memset(&post, 0, sizeof(task_post_t));
+    post.callback = callback;
+    post.priority = TASK_PRIO_MAX;
+    post.edf = true;
+    post.deadline = deadline;
+
+    return scheduler_post(&post);
+}
 
-    // Disable interrupts
-    cpu_disable_interrupts();
+bool scheduler_post(const task_post_t* post) {
+    cpu_interrupt_t source;
+    task_ring_t* ring = NULL;
+    uint8_t head;
 
-    // Find a position in the task buffer
-    current_task = &scheduler_vars.task_buffer[0];
-    while (current_task->callback != NULL && current_task <= &scheduler_vars.task_buffer[TASK_BUFFER_SIZE - 1]) {
-       current_task++;
+    // The queues only belong to the scheduler loop, so the tasks queue
+    // their tasks directly, without masking the interrupts
+    source = cpu_interrupt_get();
+    if (source == CPU_INTERRUPT_NONE) {
+        return scheduler_insert(post);
     }
 
-    // The task list has overflown, this should never happpen!
-    if (current_task > &scheduler_vars.task_buffer[TASK_BUFFER_SIZE - 1]) {
-       // Turn on the error LED
-       leds_error_on();
-       // Lock the scheduler
-       while(true);
+    // An interrupt that has no ring could preempt another writer of the
+    // ring it would share, report it and drop the task, the count is taken
+    // atomically since such interrupts can also preempt each other
+    if (source == CPU_INTERRUPT_OTHER) {
+        __sync_fetch_and_add(&scheduler_vars.strays, 1);
+        leds_error_on();
+        return false;
     }
 
-    // Fill in the current task information
-    current_task->callback = callback;
-    current_task->priority = priority;
+    // An interrupt only writes to its own ring, which it cannot preempt,
+    // and the scheduler loop moves the tasks to the queues
+    ring = &scheduler_vars.task_ring[source - 1];
+    head = ring->head;
 
-    // Find a position in the task queue
-    task_walker = &scheduler_vars.task_head;
-    while (*task_walker != NULL && (*task_walker)->priority < current_task->priority) {
-        task_walker = (task_list_t**) &((*task_walker)->next_task);
+    // The ring is full, report it and drop the task
+    if ((uint8_t) (head - ring->tail) == SCHEDULER_RING_SIZE) {
+        ring->overflows++;
+        leds_error_on();
+        return false;
     }
 
-    // Insert the task in the given queue position
-    current_task->next_task = *task_walker;
-    *task_walker = current_task;
+    // Publish the task once it has been written
+    ring->buffer[head & SCHEDULER_RING_MASK] = *post;
+    __sync_synchronize();
+    ring->head = head + 1;
 
-    // Reenable interrupts
-    cpu_enable_interrupts();
+    return true;
+}
+
+uint32_t scheduler_get_overflows(void) {
+    uint32_t overflows = scheduler_vars.overflows + scheduler_vars.strays;
+
+    // Add the tasks that found the ring of their interrupt full
+    for (uint8_t i = 0; i < SCHEDULER_RINGS; i++) {
+        overflows += scheduler_vars.task_ring[i].overflows;
+    }
+
+    return overflows;
+}
+
+void scheduler_task_init(task_t* task, task_ctx_cb_t callback, void* context, task_prio_t priority) {
+    // Initialize the memory of the descriptor
+    memset(task, 0, sizeof(task_t));
+
+    task->callback = callback;
+    task->context  = context;
+    task->priority = priority;
+}
+
+bool scheduler_push_task(task_t* task) {
+    task_post_t post;
+
+    // Point to the descriptor, it holds the rest
+    memset(&post, 0, sizeof(task_post_t));
+    post.task = task;
+
+    return scheduler_post(&post);
+}
+
+bool scheduler_push_task_deadline(task_t* task, uint32_t deadline) {
+    task_post_t post;
+
+    // Point to the descriptor and tell when it must start
+    memset(&post, 0, sizeof(task_post_t));
+    post.task = task;
+    post.edf = true;
+    post.deadline = deadline;
+
+    return scheduler_post(&post);
 }
 
 /*================================ private ==================================*/
 
-static void scheduler_toggle_led(void) {
+static bool scheduler_insert(const task_post_t* post) {
+    task_container_t* container = NULL;
+    task_t* task = post->task;
+    task_queue_t* queue = NULL;
+    task_t** next = NULL;
+
+    if (task != NULL) {
+        // A descriptor that is already waiting runs once
+        if (task->queued) {
+            return true;
+        }
+    } else {
+        // The task list has overflown, report it and drop the task
+        if (scheduler_vars.task_free == NULL) {
+            scheduler_vars.overflows++;
+            leds_error_on();
+            return false;
+        }
+
+        // Take a container from the free list and fill it in
+        task = scheduler_vars.task_free;
+        scheduler_vars.task_free = task->next_task;
+
+        container = (task_container_t*) task;
+        container->callback = post->callback;
+        task->callback = scheduler_container;
+        task->context = container;
+        task->priority = post->priority;
+    }
+
+    // The priority is wrong, report it and drop the task
+    if (!post->edf && (task->priority == TASK_PRIO_NONE || task->priority > TASK_PRIO_MAX)) {
+        scheduler_vars.overflows++;
+        leds_error_on();
+        scheduler_release(task);
+        return false;
+    }
+
+    task->queued = true;
+    task->timed = post->timed;
+    task->due = post->due;
+    task->edf = post->edf;
+    task->deadline = post->deadline;
+    task->next_task = NULL;
+
+    // Insert the task with a deadline after the ones that are due earlier
+    // or at the same time, the counter wraps around, the difference does not
+    if (task->edf) {
+        next = &scheduler_vars.task_edf;
+        while (*next != NULL && (int32_t) ((*next)->deadline - task->deadline) <= 0) {
+            next = &(*next)->next_task;
+        }
+        task->next_task = *next;
+        *next = task;
+
+        return true;
+    }
+
+    // Append the task to the queue of its priority
+    queue = &scheduler_vars.task_queue[task->priority];
+    if (queue->tail == NULL) {
+        queue->head = task;
+    } else {
+        queue->tail->next_task = task;
+    }
+    queue->tail = task;
+
+    // Mark the priority as ready
+    scheduler_vars.task_ready |= (1 << task->priority);
+
+    return true;
+}
+
+static void scheduler_drain(void) {
+    task_ring_t* ring = NULL;
+    uint8_t tail;
+
+    // Move the tasks pushed by the interrupts to the queues
+    for (uint8_t i = 0; i < SCHEDULER_RINGS; i++) {
+        ring = &scheduler_vars.task_ring[i];
+        tail = ring->tail;
+        while (tail != ring->head) {
+            // Read the task only after it has been published
+            __sync_synchronize();
+            scheduler_insert(&ring->buffer[tail & SCHEDULER_RING_MASK]);
+            ring->tail = ++tail;
+        }
+    }
+}
+
+static bool scheduler_ready(void) {
+    // Tasks in the queues or in the rings of the interrupts
+    if (scheduler_vars.task_edf != NULL || scheduler_vars.task_ready != 0) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < SCHEDULER_RINGS; i++) {
+        if (scheduler_vars.task_ring[i].tail != scheduler_vars.task_ring[i].head) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static task_t* scheduler_pop(void) {
+    task_t* task = NULL;
+    task_queue_t* queue = NULL;
+    uint8_t priority;
+
+    // Queue the tasks that the interrupts pushed meanwhile
+    scheduler_drain();
+
+    // Take the task with the earliest deadline, otherwise the first task
+    // of the highest priority that is ready
+    priority = scheduler_highest[scheduler_vars.task_ready];
+    if (scheduler_vars.task_edf != NULL) {
+        task = scheduler_vars.task_edf;
+        scheduler_vars.task_edf = task->next_task;
+
+        // From now on the task can be pushed again
+        task->queued = false;
+    } else if (priority != TASK_PRIO_NONE) {
+        queue = &scheduler_vars.task_queue[priority];
+        task = queue->head;
+        queue->head = task->next_task;
+
+        // The priority is no longer ready once its queue is empty
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+            scheduler_vars.task_ready &= ~(1 << priority);
+        }
+
+        // From now on the task can be pushed again
+        task->queued = false;
+    }
+
+    return task;
+}
+
+static void scheduler_release(task_t* task) {
+    // Descriptors belong to the caller, containers go back to the free list
+    if (task->callback != scheduler_container) {
+        return;
+    }
+
+    memset(task->context, 0, sizeof(task_container_t));
+    task->next_task = scheduler_vars.task_free;
+    scheduler_vars.task_free = task;
+}
+
+static task_cb_t scheduler_callback(const task_t* task) {
+    // The callback that names the task in the statistics and the trace
+    if (task->callback == scheduler_container) {
+        return ((const task_container_t*) task->context)->callback;
+    }
+
+    return (task_cb_t) task->callback;
+}
+
+static void scheduler_container(void* context) {
+    task_container_t* container = (task_container_t*) context;
+
+    container->callback();
+}
+
+static void scheduler_toggle_led(void* context) {
     static uint8_t led_status = false;
     if (led_status == true) {
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, SCHEDULER_LED_OFF_TICKS, scheduler_toggle_led, TASK_PRIO_MIN);
+        virtual_timer_start_task(VIRTUAL_TIMER_TYPE_ONE_SHOT, SCHEDULER_LED_OFF_TICKS, &scheduler_vars.task_led);
     } else {
-        virtual_timer_start(VIRTUAL_TIMER_TYPE_ONE_SHOT, SCHEDULER_LED_ON_TICKS, scheduler_toggle_led, TASK_PRIO_MIN);
+        virtual_timer_start_task(VIRTUAL_TIMER_TYPE_ONE_SHOT, SCHEDULER_LED_ON_TICKS, &scheduler_vars.task_led);
     }
     leds_system_toggle();
     led_status = !led_status;
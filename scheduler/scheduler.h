@@ -3,7 +3,37 @@
  * @author     Pere Tuset-Peiro (peretuset@openmote.com)
  * @version    v0.1
  * @date       May 2015
- * @brief
+ * @brief      Run to completion tasks, one FIFO queue per priority.
+ *
+ *             Tasks run from TASK_PRIO_MAX down to TASK_PRIO_MIN and in the
+ *             order they were pushed within a priority. Pushing a task and
+ *             taking the next one cost the same whatever the queues hold.
+ *
+ *             Tasks pushed with a deadline, the tick of the sleep timer by
+ *             which they must start, run before all the others and earliest
+ *             deadline first, so the tasks of the MAC are never held back by
+ *             the ones that can wait. Each time one of them starts late the
+ *             miss is counted for its callback, see deadline.h.
+ *
+ *             A task is either a callback, that scheduler_push copies to a
+ *             container of the scheduler, or a task_t descriptor owned by
+ *             the caller, that scheduler_push_task links to the queue as it
+ *             is. A descriptor calls its callback with its context, so that
+ *             one callback serves several instances, and it can be pushed
+ *             again as soon as it starts running. Pushing it while it waits
+ *             in a queue does nothing.
+ *
+ *             Interrupts never touch the queues: each source of
+ *             cpu_interrupt_t pushes its tasks to a ring of its own, that
+ *             the scheduler loop empties into the queues before taking the
+ *             next task, and pushing never masks the interrupts. The tasks
+ *             of different interrupts keep their order only if they come
+ *             between two tasks. An interrupt that cpu_interrupt_get does
+ *             not know has no ring, and pushing a task from it stops the
+ *             node.
+ *
+ *             A task that finds its ring or the buffer full is dropped and
+ *             counted, and scheduler_push returns false.
  *
  * @copyright  Copyright 2015, OpenMote Technologies, S.L.
  *             This file is licensed under the GNU General Public License v2.
@@ -21,6 +51,7 @@
 /*================================ typedef ==================================*/
 
 typedef void (* task_cb_t)(void);
+typedef void (* task_ctx_cb_t)(void* context);
 
 typedef enum {
    TASK_PRIO_NONE = 0x00,
@@ -29,13 +60,43 @@ typedef enum {
    TASK_PRIO_MAX  = 0x03
 } task_prio_t;
 
+typedef struct task_t {
+    task_ctx_cb_t  callback;
+    void*          context;
+    task_prio_t    priority;
+    bool           queued;          ///< Waiting in a queue of the scheduler
+    bool           timed;           ///< Pushed by a timer that was due
+    uint32_t       due;             ///< Cycle count at which it was due
+    bool           edf;             ///< Runs by deadline, before the priorities
+    uint32_t       deadline;        ///< Tick by which it must start
+    struct task_t* next_task;
+} task_t;
+
+// A task with everything it can be pushed with
+typedef struct {
+    task_t*        task;            ///< Descriptor, or NULL to push the callback
+    task_cb_t      callback;
+    task_prio_t    priority;
+    bool           timed;
+    uint32_t       due;
+    bool           edf;
+    uint32_t       deadline;
+} task_post_t;
+
 /*=============================== variables =================================*/
 
 /*=============================== prototypes ================================*/
 
 void scheduler_init(void);
 void scheduler_start(void);
-void scheduler_push(task_cb_t callback, task_prio_t priority);
+bool scheduler_push(task_cb_t callback, task_prio_t priority);
+bool scheduler_push_deadline(task_cb_t callback, uint32_t deadline);
+bool scheduler_post(const task_post_t* post);
+uint32_t scheduler_get_overflows(void);
+
+void scheduler_task_init(task_t* task, task_ctx_cb_t callback, void* context, task_prio_t priority);
+bool scheduler_push_task(task_t* task);
+bool scheduler_push_task_deadline(task_t* task, uint32_t deadline);
 
 /*================================= public ==================================*/
 